@@ -9,17 +9,30 @@
 #include <libnotify/notify.h>
 #include <libnotify/notification.h>
 #include <glib.h>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <mutex>
 
 #include "evento.h"
 #include "historial.h"
 #include "filtro.h"
+#include "reparador_de_utf8.h"
 
 using namespace std;
 namespace lognotify
 {
 
+/**
+* Indica si alguno de los bytes de un bloque es igual al byte repetido en un patrón. La comprobación es exacta
+* cuando no hay ninguno, que es el caso que permite saltar el bloque
+*/
+static inline bool contieneByte (const unsigned long long bloque, const unsigned long long patron)
+{
+	unsigned long long diferencia = bloque ^ patron;
+	return ((diferencia - 0x0101010101010101ULL) & ~diferencia & 0x8080808080808080ULL) != 0;
+}
+
 CentroDeNotificaciones::CentroDeNotificaciones (void):
 	inicializado_(false),
 //	ruta_icono_aplicacion_(RUTA_ICONO_POR_DEFECTO),
@@ -44,7 +57,11 @@ void CentroDeNotificaciones::notificar (Evento& evento)
 	else cabecera = evento.obtener_ubicacion() + evento.obtener_nombre();
 	cuerpo = evento.obtener_descripcion();
 	if (anadir_remitente_)
-		cuerpo = cuerpo + "\nDesde: " + evento.obtener_direccion() + "/" + evento.obtener_puerto();
+	{
+		//Los servidores locales se identifican sólo por la ruta de su socket, sin puerto
+		cuerpo = cuerpo + "\nDesde: " + evento.obtener_direccion();
+		if (!evento.obtener_puerto().empty()) cuerpo = cuerpo + "/" + evento.obtener_puerto();
+	}
 	
 	//Se bloquea el mutex de notificación
 	mutex_notificacion_.lock();
@@ -68,6 +85,11 @@ void CentroDeNotificaciones::notificar (Evento& evento)
 	mutex_historial_.unlock();
 }
 
+std::string CentroDeNotificaciones::exportarFiltro (const std::string& direccion)
+{
+	return filtro_.exportar(direccion);
+}
+
 void CentroDeNotificaciones::establecer_tiempo_visible (const int milisegundos)
 {
 	tiempo_visible_ = milisegundos;
@@ -103,14 +125,22 @@ bool CentroDeNotificaciones::mostrarNotificacionDeEscritorio (	const std::string
 																const std::string& cuerpo,
 																const std::string& icono	)
 {
+	//Los textos deben ser UTF-8 válido para el demonio de notificaciones, y el cuerpo admite marcado, por lo
+	//que se escapan los caracteres que lo introducen para que se muestre tal y como aparece en el registro
+	std::string resumen = cabecera;
+	ReparadorDeUtf8::reparar(resumen);
+	std::string texto = cuerpo;
+	ReparadorDeUtf8::reparar(texto);
+	texto = escaparMarcado(texto);
+	
 	//Se crea una nueva notificación de libnotify
 	NotifyNotification *notificacion;
 	
 	//Se comprueba si se desea añadir un icono o no a la notificación
 	if (icono == "")
-		notificacion = notify_notification_new (&cabecera[0], &cuerpo[0], nullptr);
+		notificacion = notify_notification_new (&resumen[0], &texto[0], nullptr);
 	else
-		notificacion = notify_notification_new (&cabecera[0], &cuerpo[0], &icono[0]);
+		notificacion = notify_notification_new (&resumen[0], &texto[0], &icono[0]);
 		
 	//Se establece el tiempo que permanecerá en pantalla la notificación
 	notify_notification_set_timeout (notificacion, tiempo_visible_);
@@ -125,4 +155,44 @@ bool CentroDeNotificaciones::mostrarNotificacionDeEscritorio (	const std::string
 	return mostrada;	
 }
 
+std::string CentroDeNotificaciones::escaparMarcado (const std::string& texto)
+{
+	//Se saltan de 8 en 8 bytes los bloques sin caracteres que escapar: '"', que se busca por sí solo, '&' y
+	//'\'' (que sólo difieren en el bit 0x01), y '<' y '>' (que sólo difieren en el bit 0x02), que se buscan de
+	//dos en dos fijando ese bit. Si no hay ninguno, el texto no se copia
+	const char* datos = texto.data();
+	size_t longitud = texto.length();
+	size_t posicion = 0;
+	unsigned long long bloque;
+	while (posicion + 8 <= longitud)
+	{
+		memcpy(&bloque, &datos[posicion], 8);
+		if (contieneByte(bloque, 0x2222222222222222ULL) ||
+			contieneByte(bloque | 0x0101010101010101ULL, 0x2727272727272727ULL) ||
+			contieneByte(bloque | 0x0202020202020202ULL, 0x3E3E3E3E3E3E3E3EULL))
+			break;
+		posicion = posicion + 8;
+	}
+	while ((posicion < longitud) && (strchr("&<>'\"", datos[posicion]) == nullptr)) ++posicion;
+	if (posicion >= longitud) return texto;
+	
+	//A partir del primer carácter que escapar, se compone el texto escapado
+	std::string escapado;
+	escapado.reserve(longitud + 32);
+	escapado.append(datos, posicion);
+	for (; posicion < longitud; ++posicion)
+	{
+		switch (datos[posicion])
+		{
+			case '&': escapado.append("&amp;"); break;
+			case '<': escapado.append("&lt;"); break;
+			case '>': escapado.append("&gt;"); break;
+			case '\'': escapado.append("&#39;"); break;
+			case '"': escapado.append("&quot;"); break;
+			default: escapado.push_back(datos[posicion]);
+		}
+	}
+	return escapado;
+}
+
 } //namespace lognotify
\ No newline at end of file
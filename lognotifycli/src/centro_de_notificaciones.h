@@ -72,6 +72,15 @@ class CentroDeNotificaciones
 	*/
 	void notificar (Evento& evento);
 	
+	/**
+	* Obtiene las reglas del filtro de notificaciones que pueden cumplirse para el servidor especificado, con
+	* la sintaxis del fichero de filtro, para que el servidor pueda omitir los eventos filtrados sin enviarlos
+	* @param direccion Dirección del servidor para el que se exportan las reglas, o cadena vacía si es un
+	* repetidor que reenvía eventos de varios servidores
+	* @return Texto con las reglas del filtro particularizadas para el servidor
+	*/
+	std::string exportarFiltro (const std::string& direccion);
+	
 	/**
 	* Especifica el tiempo que las notificaciones de escritorio permanecen en pantalla una vez mostradas
 	* @param milisegundos Tiempo en milisegundos que las notificaciones permancerán en pantalla
@@ -130,6 +139,14 @@ class CentroDeNotificaciones
 											const std::string& cuerpo,
 											const std::string& icono	);
 	
+	/**
+	* Escapa los caracteres que introducen marcado en el cuerpo de las notificaciones (&, <, >, ' y "), que
+	* algunos demonios de notificaciones interpretan, para que el texto se muestre tal cual
+	* @param texto Texto que se escapa
+	* @return Texto con los caracteres escapados como entidades, o el propio texto si no contiene ninguno
+	*/
+	static std::string escaparMarcado (const std::string& texto);
+	
 	//Variables miembro
 	bool inicializado_;					///< Indica si ya ha sido inicializado correctamente
 	Historial historial_de_sesion_;		///< Historial de eventos de la sesión
@@ -59,6 +59,10 @@ bool ClienteDeNotificaciones::inicializar	(	const std::string& rutaFicheroServid
 			
 		}
 		
+		//Los servidores que se ejecutan en la misma máquina pueden indicarse mediante la ruta de su socket local,
+		//en la forma unix:/ruta/del/socket
+		else if (regex_match(linea, regex("unix:/.+"))) conectarServidor(anadirServidor(linea, ""));
+		
 	}
 	fichero_servidores.close();
 	
@@ -8,8 +8,11 @@
 
 #include <string>
 #include <regex>
+#include <vector>
 
 #include "evento.h"
+#include "analizador_de_syslog.h"
+#include "extractor_de_json.h"
 
 using namespace std;
 namespace lognotify
@@ -17,6 +20,7 @@ namespace lognotify
 
 Condicion::Condicion (const std::string& regex, bool signo):
 	regex_(regex),
+	expresion_(regex),
 	signo_(signo) { }
 
 bool CondicionDeFichero::evaluar (Evento& evento)
@@ -24,14 +28,64 @@ bool CondicionDeFichero::evaluar (Evento& evento)
 	return signo_ == regex_match(evento.obtener_nombre(), regex_);
 }
 
+std::string CondicionDeFichero::exportar (void)
+{
+	return (signo_ ? "fichero=" : "fichero!=") + expresion_;
+}
+
 bool CondicionDeRemitente::evaluar (Evento& evento)
 {
 	return signo_ == regex_match(evento.obtener_direccion(), regex_);
 }
 
+std::string CondicionDeRemitente::exportar (void)
+{
+	return (signo_ ? "origen=" : "origen!=") + expresion_;
+}
+
 bool CondicionDeContenido::evaluar (Evento& evento)
 {
 	return signo_ == regex_match(evento.obtener_descripcion(), regex_);
 }
 
+std::string CondicionDeContenido::exportar (void)
+{
+	return (signo_ ? "contenido=" : "contenido!=") + expresion_;
+}
+
+CondicionDeCampo::CondicionDeCampo (const std::string& clave, const std::string& regex, bool signo):
+	Condicion(regex, signo),
+	claves_(1, clave) { }
+
+bool CondicionDeCampo::evaluar (Evento& evento)
+{
+	//Se localiza la clave en cada línea de la descripción que es un objeto JSON, o cuyo mensaje lo es si tiene
+	//cabecera de syslog, sin analizar el resto de la línea
+	string descripcion = evento.obtener_descripcion();
+	string valor = "";
+	AnalizadorDeSyslog::Campos cabecera;
+	ExtractorDeJson::Miembro miembro;
+	size_t inicio = 0;
+	while (inicio < descripcion.length())
+	{
+		size_t fin = descripcion.find('\n', inicio);
+		if (fin == string::npos) fin = descripcion.length();
+		AnalizadorDeSyslog::analizar(&descripcion[inicio], fin - inicio, cabecera);
+		size_t mensaje = inicio + cabecera.inicio[AnalizadorDeSyslog::CAMPO_MENSAJE];
+		if (ExtractorDeJson::extraer(	&descripcion[mensaje], cabecera.longitud[AnalizadorDeSyslog::CAMPO_MENSAJE],
+										claves_, &miembro	) > 0)
+		{
+			if (!valor.empty()) valor.push_back('\n');
+			valor.append(descripcion, mensaje + miembro.inicio_valor, miembro.longitud_valor);
+		}
+		inicio = fin + 1;
+	}
+	return signo_ == regex_match(valor, regex_);
+}
+
+std::string CondicionDeCampo::exportar (void)
+{
+	return "campo." + claves_[0] + (signo_ ? "=" : "!=") + expresion_;
+}
+
 } //namespace lognotify
\ No newline at end of file
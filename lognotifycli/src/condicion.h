@@ -9,6 +9,7 @@
 
 #include <string>
 #include <regex>
+#include <vector>
 
 #include "evento.h"
 
@@ -39,10 +40,25 @@ class Condicion
 	*/
 	virtual bool evaluar (Evento& evento) = 0;
 	
+	/**
+	* Función virtual pura que expresa la Condicion como una línea con la sintaxis del fichero de filtro, tal
+	* y como se envía a los servidores para que filtren los eventos antes de enviarlos
+	* @return Línea del fichero de filtro correspondiente a la condición (ej. "fichero!=syslog")
+	*/
+	virtual std::string exportar (void) = 0;
+	
+	/**
+	* Indica si la Condicion depende únicamente del servidor que envía el evento, en cuyo caso puede
+	* resolverse de antemano para cada servidor
+	* @return true si la condición depende únicamente del servidor remitente, false en caso contrario
+	*/
+	virtual bool dependeDelRemitente (void) { return false; }
+	
 	protected:
 	
 	//Variables miembro
 	std::regex regex_;		///< Expresión regular en formato ECMAScript utilizada para evaluar la condición
+	std::string expresion_;	///< Texto de la expresión regular, tal y como fue definida
 	bool signo_;			///< Indica si la condición evalúa true cuando es igual (true) o cuando NO (false)
 };
 
@@ -63,6 +79,12 @@ class CondicionDeFichero: public Condicion
 	* @return true si la condición se cumple, false en caso contrario
 	*/
 	bool evaluar (Evento& evento);
+	
+	/**
+	* Expresa la Condicion como una línea con la sintaxis del fichero de filtro
+	* @return Línea del fichero de filtro correspondiente a la condición
+	*/
+	std::string exportar (void);
 };
 
 /**
@@ -82,6 +104,18 @@ class CondicionDeRemitente: public Condicion
 	* @return true si la condición se cumple, false en caso contrario
 	*/
 	bool evaluar (Evento& evento);
+	
+	/**
+	* Expresa la Condicion como una línea con la sintaxis del fichero de filtro
+	* @return Línea del fichero de filtro correspondiente a la condición
+	*/
+	std::string exportar (void);
+	
+	/**
+	* Indica que la Condicion depende únicamente del servidor que envía el evento
+	* @return true
+	*/
+	bool dependeDelRemitente (void) { return true; }
 };
 
 /**
@@ -101,6 +135,52 @@ class CondicionDeContenido: public Condicion
 	* @return true si la condición se cumple, false en caso contrario
 	*/
 	bool evaluar (Evento& evento);
+	
+	/**
+	* Expresa la Condicion como una línea con la sintaxis del fichero de filtro
+	* @return Línea del fichero de filtro correspondiente a la condición
+	*/
+	std::string exportar (void);
+};
+
+/**
+* Condición basada en el valor de una clave de las líneas JSON del evento (o de su mensaje, si tienen cabecera
+* de syslog), como el nivel o el servicio que las escribe. El valor es el de todas las líneas en que aparece la
+* clave, separados por '\n', o cadena vacía si no aparece en ninguna; los valores de tipo cadena se comparan sin
+* comillas. Si el valor se iguala con la expresión regular que define la instancia de CondicionDeCampo, la
+* condición se cumple
+*/
+class CondicionDeCampo: public Condicion
+{
+	public:
+	
+	/**
+	* Constructor de la clase CondicionDeCampo
+	* @param clave Clave de las líneas JSON cuyo valor se compara
+	* @param regex Expresión regular en formato ECMAScript utilizada para evaluar la condición
+	* @param signo Si se desea que la condición evalúe a true cuando la expresión regular NO sea igual y a false
+	* cuando sí lo sea (es decir, negación lógica del resultado) introducir signo = false.
+	*/
+	CondicionDeCampo (const std::string& clave, const std::string& regex, bool signo);
+	
+	/**
+	* Decide si la Condicion se cumple o no para el evento especificado. La condición se cumple cuando el
+	* valor de la clave en las líneas JSON del evento iguala la expresión regular que define la condición
+	* @param evento Evento para el que la condición es evaluada
+	* @return true si la condición se cumple, false en caso contrario
+	*/
+	bool evaluar (Evento& evento);
+	
+	/**
+	* Expresa la Condicion como una línea con la sintaxis del fichero de filtro
+	* @return Línea del fichero de filtro correspondiente a la condición
+	*/
+	std::string exportar (void);
+	
+	private:
+	
+	//Variables miembro
+	std::vector<std::string> claves_;	///< Clave comparada, como único elemento para buscarla en las líneas
 };
 
 }
@@ -8,6 +8,7 @@
 #define _evento_h_
 
 #include <string>
+#include <utility>
 
 namespace lognotify
 {
@@ -30,16 +31,16 @@ class Evento
 	* @param dirección La dirección IP del servidor que ha enviado el evento
 	* @param puerto El puerto TCP de la conexión con el servidor que ha enviado el evento
 	*/
-	Evento (	const std::string& nombre,
-				const std::string& ubicacion,
-				const std::string& descripcion,
-				const std::string& direccion,
-				const std::string& puerto	):
-		nombre_(nombre),
-		ubicacion_(ubicacion),
-		descripcion_(descripcion),
-		direccion_(direccion),
-		puerto_(puerto) {}
+	Evento (	std::string nombre,
+				std::string ubicacion,
+				std::string descripcion,
+				std::string direccion,
+				std::string puerto	):
+		nombre_(std::move(nombre)),
+		ubicacion_(std::move(ubicacion)),
+		descripcion_(std::move(descripcion)),
+		direccion_(std::move(direccion)),
+		puerto_(std::move(puerto)) {}
 		
 	/**
 	* Obtiene el nombre del fichero que ha provocado el evento
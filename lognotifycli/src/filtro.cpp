@@ -40,6 +40,15 @@ bool Filtro::evaluar (Evento& evento)
 	return true; 
 }
 
+std::string Filtro::exportar (const std::string& direccion)
+{
+	//Se exportan una por una todas las reglas del filtro; las que no pueden cumplirse para el servidor
+	//especificado no son añadidas
+	string reglas = "";
+	for (unsigned int i = 0; i < reglas_.size(); ++i) reglas_[i]->exportar(direccion, reglas);
+	return reglas;
+}
+
 bool Filtro::cargarReglas (const std::string& rutaDeReglas)
 {
 	//Se abre el fichero de reglas
@@ -148,6 +157,40 @@ bool Filtro::cargarReglas (const std::string& rutaDeReglas)
 			unique_ptr<CondicionDeContenido> condicion_con (new CondicionDeContenido(expresion, false));
 			reglas_.back()->anadirCondicion(move(condicion_con));
 		}
+		//Si la línea comienza con la palabra clave campo., es una nueva condición de clave JSON igual a ...
+		else if (regex_match(linea, regex("[\\s\\t]*campo\\.[^=]*[^=!]=.*")))
+		{
+			//Si no hay una regla creada, se crea una nueva
+			if (reglas_.empty())
+			{
+				unique_ptr<Regla> regla (new Regla ());
+				reglas_.push_back(move(regla));
+			}
+			
+			//Se extraen la clave y la expresión regular de la linea y se construye y añade la nueva condición
+			size_t comienzo = linea.find("campo.") + 6;
+			string clave = linea.substr(comienzo, linea.find_first_of('=') - comienzo);
+			expresion = linea.substr(linea.find_first_of('=') + 1, string::npos);
+			unique_ptr<CondicionDeCampo> condicion_cam (new CondicionDeCampo(clave, expresion, true));
+			reglas_.back()->anadirCondicion(move(condicion_cam));
+		}
+		//Si la línea comienza con la palabra clave campo., es una nueva condición de clave JSON distinta de ...
+		else if (regex_match(linea, regex("[\\s\\t]*campo\\.[^=]+!=.*")))
+		{
+			//Si no hay una regla creada, se crea una nueva
+			if (reglas_.empty())
+			{
+				unique_ptr<Regla> regla (new Regla ());
+				reglas_.push_back(move(regla));
+			}
+			
+			//Se extraen la clave y la expresión regular de la linea y se construye y añade la nueva condición
+			size_t comienzo = linea.find("campo.") + 6;
+			string clave = linea.substr(comienzo, linea.find_first_of('=') - comienzo - 1);
+			expresion = linea.substr(linea.find_first_of('=') + 1, string::npos);
+			unique_ptr<CondicionDeCampo> condicion_cam (new CondicionDeCampo(clave, expresion, false));
+			reglas_.back()->anadirCondicion(move(condicion_cam));
+		}
 		//En caso contrario, la expresión no puede ser reconocida y es ignorada
 	}
 	
@@ -55,6 +55,16 @@ class Filtro
 	*/
 	inline bool estaInicializado (void) { return inicializado_; }
 	
+	/**
+	* Expresa las reglas del Filtro que pueden cumplirse para el servidor especificado, con la sintaxis del
+	* fichero de filtro. El resultado se envía al servidor para que omita los eventos filtrados antes de
+	* enviarlos, evitando así que lleguen a transmitirse por la red
+	* @param direccion Dirección del servidor para el que se exportan las reglas, o cadena vacía si es un
+	* repetidor que reenvía eventos de varios servidores
+	* @return Texto con las reglas del Filtro particularizadas para el servidor
+	*/
+	std::string exportar (const std::string& direccion);
+	
 	private:
 	
 	/**
@@ -0,0 +1,101 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "lector_de_tramas.h"
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr size_t LectorDeTramas::TAMANO_MAXIMO_;
+
+LectorDeTramas::LectorDeTramas (void):
+	buffer_(TAMANO_INICIAL_),
+	inicio_(0),
+	fin_(0),
+	explorado_(0),
+	completos_(0) {}
+
+char* LectorDeTramas::reservar (size_t& disponible)
+{
+	//Si se han extraído todas las tramas recibidas, el buffer vuelve a empezar sin mover nada
+	if (inicio_ == fin_)
+	{
+		inicio_ = 0;
+		fin_ = 0;
+	}
+	
+	//Si queda poco espacio libre, la trama en curso se lleva al principio del buffer, y si aun así no cabe lo
+	//que resta por recibir de ella, el buffer crece, salvo que ya tenga su tamaño máximo. Las posiciones de la
+	//trama en curso son relativas a su inicio, por lo que no cambian
+	if (buffer_.size() - fin_ < MIN_RECEPCION_)
+	{
+		if (inicio_ > 0)
+		{
+			memmove(&buffer_[0], &buffer_[inicio_], fin_ - inicio_);
+			fin_ = fin_ - inicio_;
+			inicio_ = 0;
+		}
+		if (buffer_.size() - fin_ < MIN_RECEPCION_)
+		{
+			if (buffer_.size() >= TAMANO_MAXIMO_)
+			{
+				disponible = 0;
+				return nullptr;
+			}
+			buffer_.resize(min(2 * buffer_.size(), TAMANO_MAXIMO_));
+		}
+	}
+	disponible = buffer_.size() - fin_;
+	return &buffer_[fin_];
+}
+
+bool LectorDeTramas::extraer (const unsigned int numeroDeCampos, Campo* campos)
+{
+	if ((numeroDeCampos == 0) || (numeroDeCampos > MAX_CAMPOS)) return false;
+	
+	//Se buscan los separadores que faltan a partir de donde terminó la búsqueda anterior
+	const char *trama = buffer_.data() + inicio_;
+	while (completos_ < numeroDeCampos)
+	{
+		const char *separador = (const char*) memchr(trama + explorado_, '\0', fin_ - inicio_ - explorado_);
+		if (separador == nullptr)
+		{
+			explorado_ = fin_ - inicio_;
+			return false;
+		}
+		finales_[completos_] = separador - trama;
+		++completos_;
+		explorado_ = finales_[completos_ - 1] + 1;
+	}
+	
+	//La trama está completa: se entrega la vista de cada campo y la siguiente comienza tras el último
+	size_t comienzo = 0;
+	for (unsigned int i = 0; i < numeroDeCampos; ++i)
+	{
+		campos[i].inicio = trama + comienzo;
+		campos[i].longitud = finales_[i] - comienzo;
+		comienzo = finales_[i] + 1;
+	}
+	inicio_ = inicio_ + comienzo;
+	explorado_ = 0;
+	completos_ = 0;
+	return true;
+}
+
+void LectorDeTramas::vaciar (void)
+{
+	inicio_ = 0;
+	fin_ = 0;
+	explorado_ = 0;
+	completos_ = 0;
+}
+
+}//namespace lognotify
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _lector_de_tramas_h_
+#define _lector_de_tramas_h_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace lognotify
+{
+
+/**
+* Un LectorDeTramas extrae de forma incremental las tramas que el servidor envía por una conexión, formadas por
+* campos de texto terminados en '\0', a medida que se reciben sus bytes. Los bytes se reciben directamente en
+* su buffer (ver reservar), y cada campo se entrega como una vista de su posición y longitud dentro de él, sin
+* copiarlo ni reservar memoria alguna por trama. Los separadores se buscan con memchr, continuando donde
+* terminó la búsqueda anterior, por lo que los bytes de una trama recibida en varias partes sólo se recorren
+* una vez.
+* El buffer sólo crece si una trama no cabe en él; en caso contrario, cuando queda poco espacio libre, la trama
+* en curso se lleva a su principio, de forma que cada byte se mueve como mucho una vez. Nunca crece más allá de
+* TAMANO_MAXIMO_: una trama mayor no es de un servidor legítimo, y la conexión debe descartarse.
+*/
+class LectorDeTramas
+{
+	public:
+	
+	//Constantes públicas
+	constexpr static unsigned int MAX_CAMPOS = 4;	///< Máximo de campos de una trama
+	
+	/**
+	* Vista de un campo de una trama dentro del buffer del LectorDeTramas. Es válida hasta la siguiente llamada
+	* a reservar o vaciar
+	*/
+	struct Campo
+	{
+		const char *inicio;		///< Primer carácter del campo, que va seguido del '\0' que lo termina
+		size_t longitud;		///< Número de caracteres del campo, sin el '\0'
+		
+		/**
+		* Indica si el campo está vacío
+		* @return true si el campo no tiene ningún carácter, false en caso contrario
+		*/
+		inline bool vacio (void) const { return longitud == 0; }
+		
+		/**
+		* Compara el campo con un texto
+		* @param texto Texto terminado en '\0'
+		* @return true si el campo es igual al texto, false en caso contrario
+		*/
+		inline bool es (const char* texto) const
+		{
+			return (strlen(texto) == longitud) && (memcmp(inicio, texto, longitud) == 0);
+		}
+		
+		/**
+		* Copia el campo en una cadena
+		* @return Cadena con el contenido del campo
+		*/
+		inline std::string copiar (void) const { return std::string(inicio, longitud); }
+	};
+	
+	/**
+	* Constructor de la clase LectorDeTramas
+	*/
+	LectorDeTramas (void);
+	
+	/**
+	* Obtiene espacio libre al final del buffer en el que recibir más bytes, de al menos MIN_RECEPCION_. Las
+	* vistas de los campos ya entregados dejan de ser válidas
+	* @param disponible Número de bytes que pueden recibirse a partir de la posición devuelta
+	* @return Posición del buffer en la que recibir los bytes, o nullptr si la trama en curso ya no cabe en un
+	* buffer de TAMANO_MAXIMO_ bytes
+	*/
+	char* reservar (size_t& disponible);
+	
+	/**
+	* Anota los bytes recibidos en el espacio obtenido con reservar
+	* @param recibidos Número de bytes recibidos
+	*/
+	inline void anadir (const size_t recibidos) { fin_ = fin_ + recibidos; }
+	
+	/**
+	* Extrae la siguiente trama completa recibida, si la hay
+	* @param numeroDeCampos Número de campos de la trama, como mucho MAX_CAMPOS. Si varía entre dos llamadas,
+	* la búsqueda de la trama en curso continúa con el nuevo número
+	* @param campos Vector de al menos numeroDeCampos elementos en el que se devuelve la vista de cada campo
+	* @return true si se ha extraído una trama, false si todavía no se ha recibido completa
+	*/
+	bool extraer (const unsigned int numeroDeCampos, Campo* campos);
+	
+	/**
+	* Descarta todos los bytes recibidos, incluida la trama en curso, por ejemplo al comenzar una nueva conexión
+	*/
+	void vaciar (void);
+	
+	private:
+	
+	//Constantes de clase privadas
+	constexpr static size_t TAMANO_INICIAL_ = 262144;	///< Tamaño inicial del buffer
+	constexpr static size_t MIN_RECEPCION_ = 65536;		///< Mínimo de bytes que pueden recibirse en cada llamada
+	constexpr static size_t TAMANO_MAXIMO_ = 67108864;	///< Tamaño máximo del buffer, y por tanto de una trama
+	
+	//Variables miembro
+	std::vector<char> buffer_;		///< Buffer en el que se reciben los bytes
+	size_t inicio_;					///< Posición del primer byte de la trama en curso
+	size_t fin_;					///< Posición que sigue al último byte recibido
+	size_t explorado_;				///< Bytes de la trama en curso en los que ya se han buscado separadores
+	size_t finales_ [MAX_CAMPOS];	///< Posición en la trama en curso del '\0' de cada campo completo
+	unsigned int completos_;		///< Número de campos completos de la trama en curso
+};
+
+}//namespace lognotify
+
+#endif //_lector_de_tramas_h_
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "condicion.h"
 #include "evento.h"
@@ -32,4 +33,27 @@ bool Regla::evaluar (Evento& evento)
 	return true;
 }
 
+bool Regla::exportar (const std::string& direccion, std::string& destino)
+{
+	//Se construye un evento vacío procedente del servidor para resolver las condiciones de remitente
+	Evento evento_del_servidor ("", "", "", direccion, "");
+	
+	//Se recorren las condiciones: las de remitente se resuelven (bastando una que no se cumpla para que la
+	//regla nunca lo haga, o que no se conozca el remitente) y el resto se expresan como líneas del fichero de
+	//filtro
+	string lineas = "regla\n";
+	for (unsigned int i = 0; i < condiciones_.size(); ++i)
+	{
+		if (condiciones_[i]->dependeDelRemitente())
+		{
+			if (direccion.empty() || !condiciones_[i]->evaluar(evento_del_servidor)) return false;
+		}
+		else lineas = lineas + condiciones_[i]->exportar() + '\n';
+	}
+	
+	//Si la regla puede cumplirse, se añade al destino
+	destino = destino + lineas;
+	return true;
+}
+
 } //namespace lognotify
\ No newline at end of file
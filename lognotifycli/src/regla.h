@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "condicion.h"
 #include "evento.h"
@@ -41,6 +42,19 @@ class Regla
 	*/
 	bool evaluar (Evento& evento);
 	
+	/**
+	* Expresa la Regla con la sintaxis del fichero de filtro, particularizada para el servidor especificado:
+	* las condiciones que dependen únicamente del remitente se resuelven de antemano, pues el servidor no
+	* puede evaluarlas. Si alguna de ellas no se cumple, la Regla nunca se cumplirá para eventos de ese servidor.
+	* Para un repetidor, cuyos eventos proceden de varios remitentes, las condiciones de remitente no pueden
+	* resolverse, por lo que una Regla que tenga alguna no se exporta
+	* @param direccion Dirección del servidor para el que se exporta la Regla, o cadena vacía si es un repetidor
+	* @param destino Cadena a la que se añaden las líneas correspondientes a la Regla
+	* @return true si la Regla puede cumplirse para el servidor y ha sido añadida a destino, false en caso
+	* contrario
+	*/
+	bool exportar (const std::string& direccion, std::string& destino);
+	
 	private:
 	
 	//Variables miembro
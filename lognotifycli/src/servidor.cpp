@@ -8,10 +8,23 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
 #include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
 #include <cstring>
+#include <cstdlib>
 #include <string>
+#include <vector>
+#include <map>
 #include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
 
 #include "centro_de_notificaciones.h"
 
@@ -19,16 +32,101 @@ using namespace std;
 namespace lognotify
 {
 
+constexpr int Servidor::SEGUNDOS_RECONEXION_;
+constexpr const char *Servidor::PREFIJO_LOCAL_;
+
 Servidor::Servidor (const std::string& direccion, const std::string& puerto):
 	direccion_(direccion),
 	puerto_(puerto),
-	descriptor_socket_(-1),
-	estado_(ESTADO_DESCONECTADO) {}
+	conexion_(make_shared<Conexion>()) {}
 
 bool Servidor::conectar (CentroDeNotificaciones& destino)
 {
-	//Si ya está conectado, se termina la conexión pre-existente en primer lugar
-	if (estado_ == ESTADO_CONECTADO) desconectar();
+	//Si ya está conectado, se termina la conexión pre-existente en primer lugar, esperando a que termine su
+	//hilo de recepción
+	desconectar();
+	esperar();
+	
+	//Se establece la conexión con el servidor; si no es posible, se actualiza el estado y se termina
+	int descriptor_socket = abrirConexion(direccion_, puerto_);
+	
+	//Se sube al servidor el filtro de notificaciones particularizado para él, de forma que no envíe los eventos
+	//que de todos modos serían omitidos, y se le solicita que envíe los eventos con su número de secuencia,
+	//para poder reanudar la recepción si la conexión se pierde. Si el servidor no soporta estas órdenes, las
+	//ignora; el filtro se sigue aplicando también a la llegada de los eventos
+	if ((descriptor_socket >= 0) && !iniciarSesion(descriptor_socket, destino, direccion_, ""))
+	{
+		close(descriptor_socket);
+		descriptor_socket = -1;
+	}
+	
+	//Una vez conseguida la conexión, se actualiza el estado
+	conexion_->mutex.lock();
+	conexion_->descriptor_socket = descriptor_socket;
+	conexion_->estado = (descriptor_socket >= 0) ? ESTADO_CONECTADO : ESTADO_ERROR;
+	conexion_->mutex.unlock();
+	if (descriptor_socket < 0) return false;
+	
+	//Se lanza el hilo para recibir datos y se retorna con éxito
+	hilo_recepcion_ = thread(&Servidor::recibir, conexion_, &destino, direccion_, puerto_);
+	return true;
+}
+
+void Servidor::desconectar (void)
+{
+	conexion_->mutex.lock();
+	
+	//Si el estado actual es conectado, se cierra el socket de conexión con el servidor
+	//El hilo en el que se reciben los eventos del servidor terminará por sí sólo al fallar la recepción
+	if (conexion_->estado == ESTADO_CONECTADO)
+	{
+		shutdown(conexion_->descriptor_socket, SHUT_RDWR);
+		close(conexion_->descriptor_socket);
+		conexion_->descriptor_socket = -1;
+	}
+	
+	//Fuera cual fuera el estado previo, se establece el estado actual como desconectado, y se avisa al hilo
+	//de recepción por si está esperando para recuperar la conexión
+	conexion_->estado = ESTADO_DESCONECTADO;
+	conexion_->mutex.unlock();
+	conexion_->cambio.notify_all();
+}
+
+void Servidor::esperar (void)
+{
+	//Si el hilo es joinable (es decir, está escuchando mensajes) espera a que termine
+	if (hilo_recepcion_.joinable()) hilo_recepcion_.join();
+}
+
+unsigned int Servidor::obtener_estado (void)
+{
+	conexion_->mutex.lock();
+	unsigned int estado = conexion_->estado;
+	conexion_->mutex.unlock();
+	return estado;
+}
+
+int Servidor::abrirConexion (const std::string& direccion, const std::string& puerto)
+{
+	//Si la dirección corresponde a un socket local, se conecta directamente a su ruta
+	if (direccion.compare(0, strlen(PREFIJO_LOCAL_), PREFIJO_LOCAL_) == 0)
+	{
+		struct sockaddr_un local;
+		string ruta = direccion.substr(strlen(PREFIJO_LOCAL_));
+		if (ruta.empty() || (ruta.length() >= sizeof local.sun_path)) return -1;
+		memset(&local, 0, sizeof local);
+		local.sun_family = AF_UNIX;
+		memcpy(local.sun_path, ruta.c_str(), ruta.length());
+		
+		int descriptor_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (descriptor_socket < 0) return -1;
+		if (connect(descriptor_socket, (struct sockaddr *) &local, sizeof local) != 0)
+		{
+			close(descriptor_socket);
+			return -1;
+		}
+		return descriptor_socket;
+	}
 	
 	//Se obtiene la información de direcciones del servidor
 	struct addrinfo indicaciones, *info_servidor;
@@ -37,214 +135,376 @@ bool Servidor::conectar (CentroDeNotificaciones& destino)
 	indicaciones.ai_family = AF_UNSPEC;
 	indicaciones.ai_socktype = SOCK_STREAM;
 	
-	//Si el proceso para obtener las direcciones del servidor falla, se actualiza el estado y se termina
-	if (getaddrinfo(&direccion_[0], &puerto_[0], &indicaciones, &info_servidor) != 0)
-	{
-		estado_ = ESTADO_ERROR;
-		return false;
-    }
+	//Si el proceso para obtener las direcciones del servidor falla, se termina con error
+	if (getaddrinfo(&direccion[0], &puerto[0], &indicaciones, &info_servidor) != 0) return -1;
 	
 	//Se recorren las posibles direcciones obtenidas, conectando a la primera que lo permita
-	descriptor_socket_ = -1;
+	int descriptor_socket = -1;
 	for (struct addrinfo *p = info_servidor; p != nullptr; p = p->ai_next)
 	{
-		descriptor_socket_ = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-		if (descriptor_socket_ >= 0)
+		descriptor_socket = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+		if (descriptor_socket >= 0)
 		{
 			//Se ha obtenido un socket válido al que intentar conectar
 			//Si consigue establecer conexión, termina la búsqueda
-			if (connect(descriptor_socket_, p->ai_addr, p->ai_addrlen) == 0) break;
+			if (connect(descriptor_socket, p->ai_addr, p->ai_addrlen) == 0) break;
 			else
 			{
 				//En caso contrario, se cierra el socket y se continúa
-				close(descriptor_socket_);
-				descriptor_socket_ = -1;
+				close(descriptor_socket);
+				descriptor_socket = -1;
 			}
 		}
 	}
 	
-	//Se libera la información de direcciones del servidor
+	//Se libera la información de direcciones del servidor y se devuelve el socket conectado, si lo hay
 	freeaddrinfo(info_servidor);
+	return descriptor_socket;
+}
+
+int Servidor::unirseAMultidifusion (const std::string& destino)
+{
+	//Se separan el grupo y el puerto; un grupo IPv6 puede ir entre corchetes
+	size_t separador = destino.rfind(':');
+	if ((separador == string::npos) || (separador == 0) || (separador + 1 == destino.length())) return -1;
+	string grupo = destino.substr(0, separador);
+	string puerto = destino.substr(separador + 1);
+	if ((grupo.front() == '[') && (grupo.back() == ']')) grupo = grupo.substr(1, grupo.length() - 2);
+	
+	//Se obtiene la dirección del grupo
+	struct addrinfo indicaciones, *info_grupo;
+	memset(&indicaciones, 0, sizeof indicaciones);
+	indicaciones.ai_family = AF_UNSPEC;
+	indicaciones.ai_socktype = SOCK_DGRAM;
+	indicaciones.ai_flags = AI_NUMERICHOST;
+	if (getaddrinfo(&grupo[0], &puerto[0], &indicaciones, &info_grupo) != 0) return -1;
+	
+	//Se asocia el socket a la dirección del grupo, de forma que sólo reciba sus datagramas aunque otros grupos
+	//usen el mismo puerto, y se une al grupo en la interfaz que elija el sistema
+	int descriptor_socket = socket(info_grupo->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	int reutilizar = 1;
+	bool unido = (descriptor_socket >= 0) &&
+		(setsockopt(descriptor_socket, SOL_SOCKET, SO_REUSEADDR, &reutilizar, sizeof reutilizar) == 0) &&
+		(bind(descriptor_socket, info_grupo->ai_addr, info_grupo->ai_addrlen) == 0);
+	if (unido && (info_grupo->ai_family == AF_INET))
+	{
+		struct ip_mreq solicitud;
+		memset(&solicitud, 0, sizeof solicitud);
+		solicitud.imr_multiaddr = ((struct sockaddr_in*) info_grupo->ai_addr)->sin_addr;
+		solicitud.imr_interface.s_addr = htonl(INADDR_ANY);
+		unido = (setsockopt(descriptor_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &solicitud, sizeof solicitud) == 0);
+	}
+	else if (unido)
+	{
+		struct ipv6_mreq solicitud;
+		memset(&solicitud, 0, sizeof solicitud);
+		solicitud.ipv6mr_multiaddr = ((struct sockaddr_in6*) info_grupo->ai_addr)->sin6_addr;
+		unido = (setsockopt(descriptor_socket, IPPROTO_IPV6, IPV6_JOIN_GROUP, &solicitud, sizeof solicitud) == 0);
+	}
+	freeaddrinfo(info_grupo);
 	
-	//Al finalizar la búsqueda de una dirección válida, si no se ha conectado se termina con error
-	if (descriptor_socket_ < 0)
+	//Si no ha sido posible unirse, se seguirán recibiendo los eventos por la conexión
+	if (!unido && (descriptor_socket >= 0))
 	{
-		estado_ = ESTADO_ERROR;
-		return false;
+		close(descriptor_socket);
+		descriptor_socket = -1;
 	}
+	return descriptor_socket;
+}
+
+bool Servidor::iniciarSesion (	const int descriptorSocket,
+								CentroDeNotificaciones& destino,
+								const std::string& direccion,
+								const std::string& posicion	)
+{
+	return	enviarOrden(descriptorSocket, "filtro", destino.exportarFiltro(direccion)) &&
+			enviarOrden(descriptorSocket, "repetidor", "") &&
+			enviarOrden(descriptorSocket, "reanudar", posicion);
+}
+
+bool Servidor::enviarOrden (const int descriptorSocket, const std::string& orden, const std::string& argumento)
+{
+	//Se compone la orden con cada campo terminado en '\0'
+	string mensaje = orden + '\0' + argumento + '\0';
+	
+	//Se envía el contenido completo, haciendo tantas llamadas send como sea necesario
+	unsigned int enviados = 0;
+	int resultado;
+	while (enviados < mensaje.length())
+	{
+		resultado = send(descriptorSocket, &mensaje[enviados], mensaje.length() - enviados, MSG_NOSIGNAL);
+		
+		//En caso de que la última llamada haya fallado, se asume un fallo de conexión y se termina
+		if (resultado < 0) return false;
+		enviados = enviados + resultado;
+	}
+	return true;
+}
+
+Evento Servidor::componerEvento (	const LectorDeTramas::Campo& nombre,
+									const LectorDeTramas::Campo& ubicacion,
+									const LectorDeTramas::Campo& descripcion,
+									const std::string& direccion,
+									const std::string& puerto	)
+{
+	//Las ubicaciones locales son rutas absolutas; si no lo es, va precedida del servidor de origen
+	const char *separador = nullptr;
+	if (!ubicacion.vacio() && (ubicacion.inicio[0] != '/'))
+		for (size_t i = 0; (i + 1 < ubicacion.longitud) && (separador == nullptr); ++i)
+			if ((ubicacion.inicio[i] == ':') && (ubicacion.inicio[i + 1] == '/')) separador = ubicacion.inicio + i;
+	if (separador == nullptr)
+		return Evento(nombre.copiar(), ubicacion.copiar(), descripcion.copiar(), direccion, puerto);
+	string origen (ubicacion.inicio, separador);
+	string ruta (separador + 1, ubicacion.inicio + ubicacion.longitud);
+	size_t separador_puerto = origen.rfind('/');
+	if (separador_puerto == string::npos)
+		return Evento(nombre.copiar(), move(ruta), descripcion.copiar(), move(origen), "");
+	return Evento(	nombre.copiar(), move(ruta), descripcion.copiar(),
+					origen.substr(0, separador_puerto), origen.substr(separador_puerto + 1)	);
+}
+
+void Servidor::recibir (	std::shared_ptr<Conexion> conexion,
+							CentroDeNotificaciones *notificador,
+							const std::string direccion,
+							const std::string puerto	)
+{
+	//Se lleva la cuenta del último evento recibido ("instancia:secuencia" según el servidor), para solicitar
+	//el reenvío de los que se pierdan si se pierde la conexión. Mientras el servidor no lo indique (si no
+	//soporta la orden reanudar) se desconoce
+	string instancia = "";
+	unsigned long long secuencia = 0;
 	
-	//Una vez conseguida la conexión, se actualiza el estado y se lanza el hilo para recibir datos
-	estado_ = ESTADO_CONECTADO;
+	//Si el servidor es un repetidor, sus eventos proceden de varios servidores, por lo que el filtro que se le
+	//sube no puede particularizarse para ninguno
+	bool repetidor = false;
 	
-	thread hilo_recepcion ([]
-		(	int descriptor_socket,
-			CentroDeNotificaciones *notificador,
-			const string& direccion,
-			const string& puerto	)
+	conexion->mutex.lock();
+	int descriptor_socket = conexion->descriptor_socket;
+	conexion->mutex.unlock();
+	
+	//Los bytes recibidos por la conexión se acumulan en el lector, del que se extrae cada evento completo como
+	//vistas de sus campos, sin copiarlos hasta componer el Evento
+	LectorDeTramas lector;
+	LectorDeTramas::Campo campos [LectorDeTramas::MAX_CAMPOS];
+	vector<char> datagrama (TAMANO_DATAGRAMA_);
+	while (true)
+	{
+		//Se deserializan notificaciones hasta que la conexión falle. Cada conexión comienza con los eventos en
+		//formato "nombre"\0"ubicacion"\0"descripcion"\0 hasta que se recibe el evento de control con el que el
+		//servidor acepta la orden reanudar (con nombre vacío, ubicación "reanudar" y la posición del cliente
+		//como descripción); a partir de él, cada evento va precedido de su número de secuencia
+		lector.vaciar();
+		unsigned int campos_por_evento = 3;
+		unsigned long long confirmada = 0;
+		
+		//Si el servidor anuncia un grupo de multidifusión, se reciben también sus datagramas. Con el primero se
+		//le pide que deje de enviar los eventos por la conexión, que pasa a usarse sólo para reparar los que
+		//se pierden: los eventos que llegan tras un salto en la secuencia se guardan adelantados hasta recibir
+		//por la conexión los que faltan. Un datagrama perdido se detecta al llegar el siguiente o, si no llega
+		//ninguno más, con el siguiente latido
+		int descriptor_multidifusion = -1;
+		bool por_multidifusion = false;
+		bool reparando = false;
+		map<unsigned long long, vector<string>> adelantados;
+		
+		//Si el servidor envía latidos, indica su intervalo en cada uno. Desde el primero, se le envían también
+		//con el mismo intervalo, y la conexión se da por perdida si no se recibe nada por ella durante tres
+		//intervalos, sin esperar a que lo detecte TCP
+		unsigned int segundos_latido = 0;
+		chrono::steady_clock::time_point ultima_recepcion = chrono::steady_clock::now();
+		chrono::steady_clock::time_point ultimo_latido = ultima_recepcion;
+		
+		int recibidos = 1;
+		while (recibidos > 0)
 		{
-			//En el hilo de recepción, se recuperan eventos de monitorización y se pasan al notificador
-			//Estos vienen en formato "nombre"\0"ubicacion"\0"descripcion"\0
-			char buffer [Servidor::TAMANO_BUFFER_];
-			int recibidos = 1;
-			int procesados = 1;
-			int longitud;
-			bool terminado;
-			string nombre, ubicacion, descripcion;
-			Evento *nuevo_evento;
-			
-			//Se deserializan notificaciones hasta que la conexión falle
-			while (recibidos > 0)
+			int espera = -1;
+			if (segundos_latido > 0)
 			{
-				
-			//En primer lugar hay que obtener el nombre de la notificación
-				
-				terminado = false;
-				nombre = "";
-				
-				//Si el buffer actual ya ha sido completamente procesado, se lee uno nuevo antes de continuar
-				if (procesados == recibidos)
+				chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+				chrono::steady_clock::duration intervalo = chrono::seconds(segundos_latido);
+				if (ahora - ultima_recepcion >= 3 * intervalo) break;
+				if (ahora - ultimo_latido >= intervalo)
 				{
-					//Se asegura que el contenido del buffer más allá de lo leído sea 0's
-					memset(&buffer[0], 0, sizeof(buffer));
-					recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-					procesados = 0;
+					enviarOrden(descriptor_socket, "latido", "");
+					ultimo_latido = ahora;
 				}
-				
-				//Se concatenan bufferes al nombre hasta que se lea un \0 entre los recibidos (o falle)
-				while ((recibidos > 0) && !terminado)
+				chrono::steady_clock::time_point limite = min(ultimo_latido + intervalo, ultima_recepcion + 3 * intervalo);
+				espera = chrono::duration_cast<chrono::milliseconds>(limite - ahora).count() + 1;
+			}
+			
+			struct pollfd descriptores [2];
+			descriptores[0].fd = descriptor_socket;
+			descriptores[0].events = POLLIN;
+			descriptores[1].fd = descriptor_multidifusion;
+			descriptores[1].events = POLLIN;
+			if (poll(descriptores, (descriptor_multidifusion >= 0) ? 2 : 1, espera) < 0)
+			{
+				if (errno == EINTR) continue;
+				break;
+			}
+			
+			//Se guardan como adelantados los eventos de cada datagrama recibido del grupo, si pertenecen a esta
+			//ejecución del servidor y no se han procesado ya
+			if ((descriptor_multidifusion >= 0) && (descriptores[1].revents & POLLIN))
+			{
+				ssize_t longitud = recv(descriptor_multidifusion, &datagrama[0], datagrama.size(), 0);
+				const char *inicio = &datagrama[0];
+				const char *fin = inicio + ((longitud > 0) ? longitud : 0);
+				const char *separador = (const char*) memchr(inicio, '\0', fin - inicio);
+				if ((separador != nullptr) && (instancia.compare(0, string::npos, inicio, separador - inicio) == 0))
 				{
-					//Al concatenar, sólo lo hace hasta el primer \0 que encuentre (puede ser entre los leídos,
-					//o el 1º más allá de estos, en cuyo caso no habrá terminado aún y habrá que continuar)
-					longitud = nombre.length();
-					nombre = nombre + &buffer[procesados];
-					procesados = procesados + nombre.length() - longitud;
-					
-					//Como string::length() no cuenta el byte \0, si los bytes procesados calculados de la forma
-					//anterior son < recibidos, significa que ha encontrado un \0 entre los recibidos y termina
-					if (procesados < recibidos) terminado = true;
-					else
+					if (!por_multidifusion) por_multidifusion = enviarOrden(descriptor_socket, "multidifusion", "");
+					vector<string> evento;
+					for (inicio = separador + 1; inicio < fin; inicio = separador + 1)
 					{
-						//Si no, se llena otro buffer para continuar añadiendo al nombre
-						memset(&buffer[0], 0, sizeof(buffer));
-						recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-						procesados = 0;
+						separador = (const char*) memchr(inicio, '\0', fin - inicio);
+						if (separador == nullptr) break;
+						evento.emplace_back(inicio, separador - inicio);
+						if (evento.size() < 4) continue;
+						unsigned long long secuencia_evento = strtoull(&evento[0][0], nullptr, 10);
+						if ((secuencia_evento > secuencia) && (adelantados.size() < MAX_ADELANTADOS_))
+							adelantados[secuencia_evento] = move(evento);
+						evento.clear();
 					}
 				}
-				//Una vez terminado con el nombre, se incrementa procesados para contabilizar el \0 finalmente
-				//leído de entre los recibidos...
-				++procesados;
-								
-			//Ahora hay que obtener la ubicación repitiendo el procedimiento anterior por donde se dejó
+			}
 			
-				terminado = false;
-				ubicacion = "";
-				
-				//Si el buffer actual ya ha sido completamente procesado, se lee uno nuevo antes de continuar
-				if ((recibidos > 0) && (procesados == recibidos))
+			if (descriptores[0].revents != 0)
+			{
+				//Los bytes se reciben directamente en el lector, tantos como quepan en su espacio libre. Si una
+				//trama no cabe en él ni siquiera con su tamaño máximo, se descarta la conexión
+				size_t disponible;
+				char *destino = lector.reservar(disponible);
+				if (destino == nullptr) break;
+				recibidos = recv(descriptor_socket, destino, disponible, 0);
+				if (recibidos > 0)
 				{
-					//Se asegura que el contenido del buffer más allá de lo leído sea 0's
-					memset(&buffer[0], 0, sizeof(buffer));
-					recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-					procesados = 0;
+					ultima_recepcion = chrono::steady_clock::now();
+					lector.anadir(recibidos);
 				}
 				
-				//Se concatenan bufferes a la ubicación hasta que se lea un \0 entre los recibidos (o falle)
-				while ((recibidos > 0) && !terminado)
+				//Se extraen todos los eventos completos recibidos. Cada campo va seguido en el buffer del '\0' que
+				//lo termina, por lo que los números pueden leerse directamente de él
+				while (lector.extraer(campos_por_evento, campos))
 				{
-					//Al concatenar, sólo lo hace hasta el primer \0 que encuentre (puede ser entre los leídos,
-					//o el 1º más allá de estos, en cuyo caso no habrá terminado aún y habrá que continuar)
-					longitud = ubicacion.length();
-					ubicacion = ubicacion + &buffer[procesados];
-					procesados = procesados + ubicacion.length() - longitud;
-					
-					//Como string::length() no cuenta el byte \0, si los bytes procesados calculados de la forma
-					//anterior son < recibidos, significa que ha encontrado un \0 entre los recibidos y termina
-					if (procesados < recibidos) terminado = true;
-					else
+					if ((campos_por_evento == 3) && campos[0].vacio() && campos[1].es("reanudar"))
 					{
-						//Si no, se llena otro buffer para continuar añadiendo a la ubicacion
-						memset(&buffer[0], 0, sizeof(buffer));
-						recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-						procesados = 0;
+						//El evento de control indica la posición del cliente y el cambio de formato
+						string posicion = campos[2].copiar();
+						size_t separador_posicion = posicion.rfind(':');
+						if (separador_posicion != string::npos)
+						{
+							instancia = posicion.substr(0, separador_posicion);
+							secuencia = strtoull(&posicion[separador_posicion + 1], nullptr, 10);
+							campos_por_evento = 4;
+						}
+					}
+					else if (campos_por_evento == 3)
+					{
+						Evento nuevo_evento = componerEvento(campos[0], campos[1], campos[2], direccion, puerto);
+						notificador->notificar(nuevo_evento);
 					}
-				}
-				//Una vez terminado con la ubicacion, se incrementa procesados para contabilizar el \0 finalmente
-				//leído de entre los recibidos...
-				++procesados;
-				
-			//Por último, se repite el mismo procedimiento para la descripción
-			
-				terminado = false;
-				descripcion = "";
-				
-				//Si el buffer actual ya ha sido completamente procesado, se lee uno nuevo antes de continuar
-				if ((recibidos > 0) && (procesados == recibidos))
-				{
-					//Se asegura que el contenido del buffer más allá de lo leído sea 0's
-					memset(&buffer[0], 0, sizeof(buffer));
-					recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-					procesados = 0;
-				}
-				
-				//Se concatenan bufferes a la descripción hasta que se lea un \0 entre los recibidos (o falle)
-				while ((recibidos > 0) && !terminado)
-				{
-					//Al concatenar, sólo lo hace hasta el primer \0 que encuentre (puede ser entre los leídos,
-					//o el 1º más allá de estos, en cuyo caso no habrá terminado aún y habrá que continuar)
-					longitud = descripcion.length();
-					descripcion = descripcion + &buffer[procesados];
-					procesados = procesados + descripcion.length() - longitud;
-					
-					//Como string::length() no cuenta el byte \0, si los bytes procesados calculados de la forma
-					//anterior son < recibidos, significa que ha encontrado un \0 entre los recibidos y termina
-					if (procesados < recibidos) terminado = true;
 					else
 					{
-						//Si no, se llena otro buffer para continuar añadiendo a la descripción
-						memset(&buffer[0], 0, sizeof(buffer));
-						recibidos = recv (descriptor_socket, buffer, Servidor::TAMANO_BUFFER_ - 1, MSG_NOSIGNAL);
-						procesados = 0;
+						//Se anota la secuencia del evento; los eventos con nombre vacío son de control. Mientras se
+						//reciben por multidifusión, los eventos ya procesados (por llegar también por el grupo o
+						//por haberse reparado dos veces) se descartan. Los latidos sólo indican su intervalo
+						unsigned long long secuencia_evento = strtoull(campos[0].inicio, nullptr, 10);
+						if (campos[1].vacio() && campos[2].es("multidifusion") && (descriptor_multidifusion < 0))
+							descriptor_multidifusion = unirseAMultidifusion(campos[3].copiar());
+						if (campos[1].vacio() && campos[2].es("reparado")) reparando = false;
+						if (campos[1].vacio() && campos[2].es("repetidor") && !repetidor)
+							repetidor = enviarOrden(descriptor_socket, "filtro", notificador->exportarFiltro(""));
+						if (campos[1].vacio() && campos[2].es("latido"))
+						{
+							//Por multidifusión, el latido indica el último evento publicado en el grupo, y revela
+							//así la pérdida de los últimos datagramas, tras los que no ha llegado otro que muestre
+							//el salto
+							segundos_latido = strtoul(campos[3].inicio, nullptr, 10);
+							bool perdidos = por_multidifusion && (secuencia_evento > secuencia);
+							if (perdidos && adelantados.empty() && !reparando)
+								reparando = enviarOrden(descriptor_socket, "reparar",
+									to_string(secuencia + 1) + ":" + to_string(secuencia_evento));
+						}
+						else if (!por_multidifusion || (secuencia_evento > secuencia))
+						{
+							secuencia = secuencia_evento;
+							if (!campos[1].vacio())
+							{
+								Evento nuevo_evento = componerEvento(campos[1], campos[2], campos[3], direccion, puerto);
+								notificador->notificar(nuevo_evento);
+							}
+						}
 					}
 				}
-				//Una vez terminado con la descripción, se incrementa procesados para contabilizar el \0 finalmente
-				//leído de entre los recibidos...
-				++procesados;
-				
-				//Si la conexión no ha fallado, en este punto hay un evento completo deserializado
-				//Se crea y se envía
-				if (recibidos > 0)
+			}
+			
+			//Se procesan en orden los eventos adelantados que ya son los siguientes, descartando los ya recibidos
+			//por la conexión. Si sigue faltando alguno anterior, se solicita su reparación
+			while (!adelantados.empty() && (adelantados.begin()->first <= secuencia + 1))
+			{
+				if (adelantados.begin()->first == secuencia + 1)
 				{
-					nuevo_evento = new Evento (nombre, ubicacion, descripcion, direccion, puerto);
-					notificador->notificar(*nuevo_evento);
-					delete nuevo_evento;
+					vector<string>& evento = adelantados.begin()->second;
+					secuencia = adelantados.begin()->first;
+					LectorDeTramas::Campo nombre = {evento[1].data(), evento[1].length()};
+					LectorDeTramas::Campo ubicacion = {evento[2].data(), evento[2].length()};
+					LectorDeTramas::Campo descripcion = {evento[3].data(), evento[3].length()};
+					Evento nuevo_evento = componerEvento(nombre, ubicacion, descripcion, direccion, puerto);
+					notificador->notificar(nuevo_evento);
 				}
+				adelantados.erase(adelantados.begin());
 			}
-					
-		}, descriptor_socket_, &destino, direccion_, puerto_);
-	
-	//se guarda el estado del hilo creado y se retorna con éxito
-	hilo_recepcion_ = move(hilo_recepcion);
-	return true;
-}
-
-void Servidor::desconectar (void)
-{
-	//Si el estado actual es conectado, se cierra el socket de conexión con el servidor
-	//El hilo en el que se reciben los eventos del servidor terminará por sí sólo al fallar la recepción
-	if (estado_ == ESTADO_CONECTADO)
-	{
-		close (descriptor_socket_);
-		descriptor_socket_ = -1;
+			if (!adelantados.empty() && !reparando)
+				reparando = enviarOrden(descriptor_socket, "reparar",
+					to_string(secuencia + 1) + ":" + to_string(adelantados.begin()->first - 1));
+			
+			//Tras procesar lo recibido, se confirma al servidor el último evento procesado, de forma que pueda
+			//seguir enviando eventos sin superar la ventana de datos en vuelo que admite para cada cliente
+			if ((campos_por_evento == 4) && (secuencia != confirmada))
+			{
+				enviarOrden(descriptor_socket, "confirmar", to_string(secuencia));
+				confirmada = secuencia;
+			}
+		}
+		if (descriptor_multidifusion >= 0) close(descriptor_multidifusion);
+		
+		//La conexión ha terminado. Si ha sido por una desconexión explícita, el socket ya está cerrado y el hilo
+		//termina; en caso contrario se ha perdido
+		unique_lock<mutex> bloqueo (conexion->mutex);
+		if (conexion->estado == ESTADO_DESCONECTADO) return;
+		close(descriptor_socket);
+		conexion->descriptor_socket = -1;
+		conexion->estado = ESTADO_PERDIDO;
+		
+		//Se intenta recuperar la conexión periódicamente, solicitando el reenvío de los eventos perdidos, hasta
+		//conseguirlo o hasta que se desconecte explícitamente
+		descriptor_socket = -1;
+		while (descriptor_socket < 0)
+		{
+			if (conexion->cambio.wait_for(bloqueo, chrono::seconds(SEGUNDOS_RECONEXION_), [&conexion]
+				{ return conexion->estado == ESTADO_DESCONECTADO; })) return;
+			bloqueo.unlock();
+			
+			string posicion = instancia.empty() ? "" : instancia + ":" + to_string(secuencia);
+			descriptor_socket = abrirConexion(direccion, puerto);
+			if ((descriptor_socket >= 0) && !iniciarSesion(descriptor_socket, *notificador, repetidor ? "" : direccion, posicion))
+			{
+				close(descriptor_socket);
+				descriptor_socket = -1;
+			}
+			bloqueo.lock();
+		}
+		
+		//Si se ha desconectado mientras tanto, se descarta la nueva conexión
+		if (conexion->estado == ESTADO_DESCONECTADO)
+		{
+			close(descriptor_socket);
+			return;
+		}
+		conexion->descriptor_socket = descriptor_socket;
+		conexion->estado = ESTADO_CONECTADO;
 	}
-	
-	//Fuera cual fuera el estado previo, se establece el estado actual como desconectado
-	estado_ = ESTADO_DESCONECTADO;
-}
-
-void Servidor::esperar (void)
-{
-	//Si el hilo es joinable (es decir, está escuchando mensajes) espera a que termine
-	if (hilo_recepcion_.joinable()) hilo_recepcion_.join();
 }
 
 } //namespace lognotify
\ No newline at end of file
@@ -9,7 +9,11 @@
 
 #include <string>
 #include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "centro_de_notificaciones.h"
+#include "lector_de_tramas.h"
 
 namespace lognotify
 {
@@ -19,6 +23,15 @@ namespace lognotify
 * Permite conectar con dicho servidor, recibiendo datos del mismo de forma concurrente al hilo principal de
 * la aplicación, así como gestionar cualquier otro tipo de interacción con el mismo, incluyendo la obtención
 * de los datos del servidor o su estado.
+* Si la conexión se pierde, el Servidor intenta recuperarla periódicamente hasta que se desconecta
+* explícitamente. Al recuperarla, solicita al servidor que le reenvíe los eventos que se ha perdido.
+* Si el servidor difunde los eventos por multidifusión, el Servidor se une al grupo y, en cuanto recibe sus
+* datagramas, los recibe sólo por él, solicitando por la conexión los que se pierden.
+* Si el servidor es un repetidor, los eventos que reenvía de otros servidores indican su origen, que se
+* conserva como remitente del Evento. El Servidor lo solicita al iniciar cada sesión, antes de reanudar, de
+* forma que ninguno de esos eventos le llegue sin él.
+* Si el servidor envía latidos, el Servidor le responde con los suyos y da la conexión por perdida en cuanto
+* deja de recibirlos, aunque TCP aún no haya detectado el fallo.
 */
 class Servidor
 {
@@ -33,15 +46,17 @@ class Servidor
 	
 	/**
 	* Constructor de la clase Servidor
-	* @param direccion Dirección IP del servidor
-	* @param puerto Puerto TCP correspondiente a la conexión con el servidor
+	* @param direccion Dirección IP del servidor, o "unix:" seguido de la ruta de su socket local (AF_UNIX) si
+	* se ejecuta en la misma máquina
+	* @param puerto Puerto TCP correspondiente a la conexión con el servidor (no se utiliza con un socket local)
 	*/
 	Servidor (const std::string& direccion, const std::string& puerto);
 	
 	/**
 	* Solicita una conexión al servidor. En caso de tener éxito, el Servidor comenzará a transmitir eventos
 	* al CentroDeNotificaciones especificado. Este proceso se lleva a cabo de forma concurrente al hilo
-	* principal de la aplicación, por lo que ésta puede proseguir normalmente una vez realizada esta llamada
+	* principal de la aplicación, por lo que ésta puede proseguir normalmente una vez realizada esta llamada.
+	* Si la conexión se pierde después, se recupera automáticamente
 	* @param destino CentroDeNotificaciones al que el Servidor debe dirigir cada Evento enviado
 	* @return true si la conexión se ha establecido correctamente, false si ha ocurrido algún error 
 	*/
@@ -55,7 +70,8 @@ class Servidor
 	/**
 	* Espera a que el Servidor termine el hilo de recepción de mensajes de notificación, si hay uno en marcha.
 	* NOTA: Esto bloqueará efectivamente el hilo desde el que se llame la función hasta que el hilo de recepción
-	* termine 
+	* termine, lo que no ocurre hasta que se llame a desconectar, pues mientras tanto el hilo de recepción
+	* intenta recuperar la conexión si ésta se pierde
 	*/
 	void esperar (void);
 	
@@ -65,7 +81,7 @@ class Servidor
 	* se corresponden a los distintos estados de conexión posibles
 	* @return Estado de conexión actual del servidor
 	*/
-	inline unsigned int obtener_estado (void) { return estado_; }
+	unsigned int obtener_estado (void);
 	
 	/**
 	* Devuelve la dirección IP del servidor
@@ -81,15 +97,107 @@ class Servidor
 	
 	private:
 	
+	/**
+	* Estado de la conexión con el servidor, compartido entre el Servidor y su hilo de recepción, que lo
+	* actualiza al perder y recuperar la conexión
+	*/
+	struct Conexion
+	{
+		Conexion (void): descriptor_socket(-1), estado(ESTADO_DESCONECTADO) {}
+		
+		std::mutex mutex;					///< Mutex para sincronizar los cambios de estado
+		std::condition_variable cambio;		///< Aviso de desconexión al hilo de recepción
+		int descriptor_socket;				///< Descriptor de fichero del socket de la conexión actual
+		unsigned int estado;				///< Estado actual de la conexión
+	};
+	
+	/**
+	* Establece una conexión TCP con el servidor o, si su dirección comienza por "unix:", una conexión local
+	* con su socket de dominio UNIX
+	* @param direccion Dirección IP del servidor, o "unix:" seguido de la ruta de su socket local
+	* @param puerto Puerto TCP en el que el servidor espera la conexión
+	* @return Descriptor de fichero del socket conectado, o un valor negativo si no ha sido posible conectar
+	*/
+	static int abrirConexion (const std::string& direccion, const std::string& puerto);
+	
+	/**
+	* Crea un socket unido a un grupo de multidifusión, por el que recibir los datagramas que el servidor
+	* difunde a él
+	* @param destino Grupo de multidifusión y puerto UDP anunciados por el servidor, en la forma "grupo:puerto"
+	* @return Descriptor de fichero del socket, o un valor negativo si no ha sido posible unirse al grupo
+	*/
+	static int unirseAMultidifusion (const std::string& destino);
+	
+	/**
+	* Envía al servidor las órdenes con que comienza cada conexión: sube el filtro de notificaciones
+	* particularizado para él, indica que entiende el origen de los eventos reenviados si es un repetidor y
+	* solicita recibir los eventos con su número de secuencia, reenviando los que se han perdido desde la
+	* posición indicada
+	* @param descriptorSocket Descriptor de fichero del socket de la conexión
+	* @param destino CentroDeNotificaciones del que se exporta el filtro
+	* @param direccion Dirección IP del servidor
+	* @param posicion Último evento recibido en una conexión anterior, "instancia:secuencia", o cadena vacía
+	* si no se ha recibido ninguno
+	* @return true si las órdenes han sido enviadas, false si la conexión ha fallado
+	*/
+	static bool iniciarSesion (	const int descriptorSocket,
+								CentroDeNotificaciones& destino,
+								const std::string& direccion,
+								const std::string& posicion	);
+	
+	/**
+	* Envía una orden al servidor a través de la conexión establecida. Las órdenes tienen el mismo formato que
+	* los eventos que envía el servidor: "orden"\0"argumento"\0. Los servidores que no reconocen una orden
+	* simplemente la ignoran
+	* @param descriptorSocket Descriptor de fichero del socket de la conexión
+	* @param orden Nombre de la orden
+	* @param argumento Argumento de la orden
+	* @return true si la orden ha sido enviada, false si la conexión ha fallado
+	*/
+	static bool enviarOrden (const int descriptorSocket, const std::string& orden, const std::string& argumento);
+	
+	/**
+	* Crea un Evento recibido del servidor a partir de las vistas de sus campos, copiando cada uno una sola vez.
+	* Si el servidor es un repetidor y el evento procede de otro servidor, su ubicación viene precedida de su
+	* origen ("direccion/puerto:ubicacion"), que pasa a ser su remitente
+	* @param nombre Nombre del evento
+	* @param ubicacion Ubicación del evento, precedida de su origen si procede de otro servidor
+	* @param descripcion Descripción del evento
+	* @param direccion Dirección IP del servidor del que se ha recibido
+	* @param puerto Puerto TCP del servidor del que se ha recibido
+	* @return Evento con su remitente
+	*/
+	static Evento componerEvento (	const LectorDeTramas::Campo& nombre,
+									const LectorDeTramas::Campo& ubicacion,
+									const LectorDeTramas::Campo& descripcion,
+									const std::string& direccion,
+									const std::string& puerto	);
+	
+	/**
+	* Función del hilo de recepción: recibe eventos del servidor y los pasa al notificador, recuperando la
+	* conexión cada vez que se pierde, hasta que se desconecta explícitamente
+	* @param conexion Estado de la conexión, compartido con el Servidor
+	* @param notificador CentroDeNotificaciones al que se dirige cada Evento recibido
+	* @param direccion Dirección IP del servidor
+	* @param puerto Puerto TCP de la conexión con el servidor
+	*/
+	static void recibir (	std::shared_ptr<Conexion> conexion,
+							CentroDeNotificaciones *notificador,
+							const std::string direccion,
+							const std::string puerto	);
+	
 	//Constantes de clase privadas
-	constexpr static int TAMANO_BUFFER_ = 1024;	///< Tamaño del buffer utilizado para recibir datos
+	constexpr static int SEGUNDOS_RECONEXION_ = 5;	///< Intervalo entre intentos de recuperar la conexión
+	constexpr static unsigned int TAMANO_DATAGRAMA_ = 65536;	///< Tamaño máximo de un datagrama recibido
+	constexpr static unsigned int MAX_ADELANTADOS_ = 65536;	///< Máximo de eventos guardados a la espera de los
+															///< perdidos por multidifusión
+	constexpr static const char *PREFIJO_LOCAL_ = "unix:";	///< Prefijo de la dirección de un socket local
 	
 	//Variables miembro
 	std::string direccion_;			///< Dirección IP del servidor
 	std::string puerto_;			///< Puerto TCP de la conexión con el servidor
-	int descriptor_socket_;			///< Descriptor de fichero del socket correspondiente a la conexión
 	std::thread hilo_recepcion_;	///< Hilo en el que recibe notificaciones
-	unsigned int estado_;			///< Estado actual de la conexión con el servidor
+	std::shared_ptr<Conexion> conexion_;	///< Estado de la conexión con el servidor
 	
 };
 
@@ -0,0 +1,178 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "analizador_de_syslog.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace lognotify
+{
+
+constexpr unsigned char AnalizadorDeSyslog::FORMATO_NINGUNO;
+constexpr unsigned char AnalizadorDeSyslog::FORMATO_RFC3164;
+constexpr unsigned char AnalizadorDeSyslog::FORMATO_RFC5424;
+constexpr unsigned int AnalizadorDeSyslog::NUMERO_DE_CAMPOS;
+
+static inline bool esCifra (const char caracter)
+{
+	return (unsigned char) (caracter - '0') < 10;
+}
+
+bool AnalizadorDeSyslog::analizar (const char* linea, const size_t longitud, Campos& campos)
+{
+	descartar(0, campos);
+	size_t posicion = 0;
+	int prioridad = analizarPrioridad(linea, longitud, posicion);
+	
+	//RFC5424: tras la prioridad va la versión (1 o 2 cifras, sin ceros a la izquierda) y cinco campos separados
+	//por un espacio, seguidos de los datos estructurados y del mensaje
+	if ((prioridad >= 0) && (posicion + 1 < longitud) && (linea[posicion] != '0') && esCifra(linea[posicion]))
+	{
+		size_t version = posicion + 1;
+		if ((version < longitud) && esCifra(linea[version])) ++version;
+		if ((version < longitud) && (linea[version] == ' '))
+		{
+			posicion = version + 1;
+			bool correcto = true;
+			for (unsigned int i = CAMPO_FECHA; (i <= CAMPO_MSGID) && correcto; ++i)
+				correcto = anotarHastaEspacio(linea, longitud, posicion, campos, i);
+			if (correcto && (posicion < longitud))
+			{
+				//Los datos estructurados son "-" o uno o varios elementos "[...]", en cuyos valores entre comillas
+				//pueden aparecer corchetes escapados con '\'
+				campos.inicio[CAMPO_DATOS] = posicion;
+				if (linea[posicion] == '-') ++posicion;
+				else
+				{
+					bool comillas = false;
+					while ((posicion < longitud) && (linea[posicion] == '['))
+					{
+						++posicion;
+						while ((posicion < longitud) && (comillas || (linea[posicion] != ']')))
+						{
+							if (comillas && (linea[posicion] == '\\')) ++posicion;
+							else if (linea[posicion] == '"') comillas = !comillas;
+							++posicion;
+						}
+						if (posicion >= longitud)
+						{
+							correcto = false;
+							break;
+						}
+						++posicion;
+					}
+					if (posicion == campos.inicio[CAMPO_DATOS]) correcto = false;
+					campos.longitud[CAMPO_DATOS] = posicion - campos.inicio[CAMPO_DATOS];
+				}
+				if (correcto && ((posicion == longitud) || (linea[posicion] == ' ')))
+				{
+					//El mensaje puede comenzar por la marca de orden de bytes de UTF-8, que no forma parte de él
+					if (posicion < longitud) ++posicion;
+					if ((longitud - posicion >= 3) && (memcmp(&linea[posicion], "\xEF\xBB\xBF", 3) == 0)) posicion += 3;
+					campos.inicio[CAMPO_MENSAJE] = posicion;
+					campos.longitud[CAMPO_MENSAJE] = longitud - posicion;
+					campos.formato = FORMATO_RFC5424;
+					campos.prioridad = prioridad;
+					return true;
+				}
+			}
+			return descartar(longitud, campos);
+		}
+	}
+	
+	//RFC3164: tras la prioridad, que falta en los ficheros, va la fecha tradicional ("Mmm dd hh:mm:ss") o en
+	//RFC3339, que es una única palabra
+	campos.inicio[CAMPO_FECHA] = posicion;
+	bool correcto = false;
+	if ((longitud - posicion > 15) && (linea[posicion] >= 'A') && (linea[posicion] <= 'Z') &&
+		(linea[posicion + 3] == ' ') && (linea[posicion + 6] == ' ') && (linea[posicion + 9] == ':') &&
+		(linea[posicion + 12] == ':') && (linea[posicion + 15] == ' '))
+	{
+		campos.longitud[CAMPO_FECHA] = 15;
+		posicion = posicion + 16;
+		correcto = true;
+	}
+	else if ((longitud - posicion > 10) && esCifra(linea[posicion]) && esCifra(linea[posicion + 3]) &&
+		(linea[posicion + 4] == '-') && (linea[posicion + 7] == '-') && (linea[posicion + 10] == 'T'))
+		correcto = anotarHastaEspacio(linea, longitud, posicion, campos, CAMPO_FECHA);
+	
+	//Después van el host y la etiqueta: el programa, seguido opcionalmente del pid entre corchetes, y ':'. Si
+	//no hay etiqueta, el mensaje comienza tras el host
+	if (correcto) correcto = anotarHastaEspacio(linea, longitud, posicion, campos, CAMPO_HOST);
+	if (!correcto) return descartar(longitud, campos);
+	size_t fin = posicion;
+	while ((fin < longitud) && (linea[fin] != '[') && (linea[fin] != ':') && (linea[fin] != ' ')) ++fin;
+	size_t fin_pid = fin;
+	if ((fin < longitud) && (linea[fin] == '['))
+	{
+		const char* cierre = (const char*) memchr(&linea[fin], ']', longitud - fin);
+		if (cierre != nullptr) fin_pid = cierre - linea + 1;
+	}
+	if ((fin_pid < longitud) && (linea[fin_pid] == ':'))
+	{
+		campos.inicio[CAMPO_PROGRAMA] = posicion;
+		campos.longitud[CAMPO_PROGRAMA] = fin - posicion;
+		if (fin_pid > fin)
+		{
+			campos.inicio[CAMPO_PID] = fin + 1;
+			campos.longitud[CAMPO_PID] = fin_pid - fin - 2;
+		}
+		posicion = fin_pid + 1;
+		if ((posicion < longitud) && (linea[posicion] == ' ')) ++posicion;
+	}
+	campos.inicio[CAMPO_MENSAJE] = posicion;
+	campos.longitud[CAMPO_MENSAJE] = longitud - posicion;
+	campos.formato = FORMATO_RFC3164;
+	campos.prioridad = prioridad;
+	return true;
+}
+
+bool AnalizadorDeSyslog::descartar (const size_t longitud, Campos& campos)
+{
+	campos.formato = FORMATO_NINGUNO;
+	campos.prioridad = -1;
+	for (unsigned int i = 0; i < NUMERO_DE_CAMPOS; ++i)
+	{
+		campos.inicio[i] = 0;
+		campos.longitud[i] = 0;
+	}
+	campos.longitud[CAMPO_MENSAJE] = longitud;
+	return false;
+}
+
+bool AnalizadorDeSyslog::anotarHastaEspacio (	const char* linea,
+												const size_t longitud,
+												size_t& posicion,
+												Campos& campos,
+												const unsigned int campo	)
+{
+	//Los campos de RFC5424 vacíos se indican con "-"
+	const char* espacio = (const char*) memchr(&linea[posicion], ' ', longitud - posicion);
+	size_t fin = (espacio != nullptr) ? espacio - linea : longitud;
+	campos.inicio[campo] = posicion;
+	campos.longitud[campo] = ((fin - posicion == 1) && (linea[posicion] == '-')) ? 0 : fin - posicion;
+	posicion = (espacio != nullptr) ? fin + 1 : longitud;
+	return (espacio != nullptr) && (fin > campos.inicio[campo]);
+}
+
+int AnalizadorDeSyslog::analizarPrioridad (const char* linea, const size_t longitud, size_t& posicion)
+{
+	//La prioridad tiene entre 1 y 3 cifras, y como máximo vale 191 (facilidad 23, severidad 7)
+	if ((longitud < 3) || (linea[0] != '<')) return -1;
+	int prioridad = 0;
+	size_t i = 1;
+	while ((i < longitud) && (i <= 3) && esCifra(linea[i]))
+	{
+		prioridad = prioridad * 10 + (linea[i] - '0');
+		++i;
+	}
+	if ((i == 1) || (i >= longitud) || (linea[i] != '>') || (prioridad > 191)) return -1;
+	posicion = i + 1;
+	return prioridad;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _analizador_de_syslog_h_
+#define _analizador_de_syslog_h_
+
+#include <cstddef>
+
+namespace lognotify
+{
+
+/**
+* El AnalizadorDeSyslog extrae los campos de la cabecera de las líneas en los formatos de syslog habituales,
+* sin expresiones regulares ni copias: cada campo se devuelve como su posición y longitud dentro de la línea.
+* Reconoce:
+*	- RFC5424: "<PRI>VERSION FECHA HOST PROGRAMA PID MSGID DATOS MENSAJE", donde "-" indica un campo vacío
+*	- RFC3164 y los ficheros escritos por syslogd/rsyslog: "[<PRI>]FECHA HOST PROGRAMA[PID]: MENSAJE", con la
+*	  fecha tradicional ("Oct 18 20:19:01") o en RFC3339 ("2026-10-18T20:19:01.123+02:00")
+* Las líneas se recorren una única vez, buscando los separadores con memchr.
+*/
+class AnalizadorDeSyslog
+{
+	public:
+	
+	//Constantes
+	constexpr static unsigned char FORMATO_NINGUNO = 0;		///< La línea no tiene cabecera de syslog
+	constexpr static unsigned char FORMATO_RFC3164 = 1;		///< Cabecera RFC3164 o de fichero de syslogd
+	constexpr static unsigned char FORMATO_RFC5424 = 2;		///< Cabecera RFC5424
+	constexpr static unsigned int NUMERO_DE_CAMPOS = 7;		///< Número de campos de texto de una línea
+	constexpr static unsigned int CAMPO_FECHA = 0;			///< Índice del campo con la fecha
+	constexpr static unsigned int CAMPO_HOST = 1;			///< Índice del campo con el host
+	constexpr static unsigned int CAMPO_PROGRAMA = 2;		///< Índice del campo con el programa
+	constexpr static unsigned int CAMPO_PID = 3;			///< Índice del campo con el identificador de proceso
+	constexpr static unsigned int CAMPO_MSGID = 4;			///< Índice del campo con el tipo de mensaje (RFC5424)
+	constexpr static unsigned int CAMPO_DATOS = 5;			///< Índice del campo con los datos estructurados (RFC5424)
+	constexpr static unsigned int CAMPO_MENSAJE = 6;		///< Índice del campo con el mensaje
+	
+	/**
+	* Campos de la cabecera de una línea
+	*/
+	struct Campos
+	{
+		unsigned char formato;						///< Formato reconocido, FORMATO_NINGUNO si no se reconoce
+		int prioridad;								///< Prioridad (facilidad * 8 + severidad), o -1 si no consta
+		size_t inicio [NUMERO_DE_CAMPOS];			///< Posición de cada campo en la línea
+		size_t longitud [NUMERO_DE_CAMPOS];			///< Longitud de cada campo, 0 si está vacío o no consta
+	};
+	
+	/**
+	* Analiza la cabecera de una línea
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea, sin el salto de línea
+	* @param campos Campos en que se devuelve la cabecera. Si no se reconoce, su formato es FORMATO_NINGUNO y
+	* todos los campos quedan vacíos salvo el mensaje, que es la línea completa
+	* @return true si se ha reconocido la cabecera, false en caso contrario
+	*/
+	static bool analizar (const char* linea, const size_t longitud, Campos& campos);
+	
+	private:
+	
+	/**
+	* Vacía los campos de una línea cuya cabecera no se reconoce, cuyo mensaje es la línea completa
+	* @param longitud Número de caracteres de la línea
+	* @param campos Campos que se vacían
+	* @return false, para devolverlo directamente al descartar la línea
+	*/
+	static bool descartar (const size_t longitud, Campos& campos);
+	
+	/**
+	* Anota un campo que comienza en una posición y termina en el siguiente espacio o al final de la línea
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición de comienzo del campo, que se avanza tras el espacio que lo termina
+	* @param campos Campos en que se anota el campo
+	* @param campo Índice del campo
+	* @return true si el campo termina en un espacio, false si termina al final de la línea
+	*/
+	static bool anotarHastaEspacio (	const char* linea,
+										const size_t longitud,
+										size_t& posicion,
+										Campos& campos,
+										const unsigned int campo	);
+	
+	/**
+	* Analiza la prioridad "<PRI>" con que puede comenzar una línea
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición tras la prioridad, si la hay
+	* @return Prioridad, o -1 si la línea no comienza por una prioridad válida
+	*/
+	static int analizarPrioridad (const char* linea, const size_t longitud, size_t& posicion);
+};
+
+} //namespace lognotify
+
+#endif //_analizador_de_syslog_h_
\ No newline at end of file
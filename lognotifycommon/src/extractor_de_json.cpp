@@ -0,0 +1,199 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "extractor_de_json.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace lognotify
+{
+
+/**
+* Indica si alguno de los bytes de un bloque es igual al byte repetido en un patrón. La comprobación es exacta
+* cuando no hay ninguno, que es el caso que permite saltar el bloque
+*/
+static inline bool contieneByte (const unsigned long long bloque, const unsigned long long patron)
+{
+	unsigned long long diferencia = bloque ^ patron;
+	return ((diferencia - 0x0101010101010101ULL) & ~diferencia & 0x8080808080808080ULL) != 0;
+}
+
+bool ExtractorDeJson::esObjeto (const char* linea, const size_t longitud)
+{
+	size_t posicion = saltarEspacios(linea, longitud, 0);
+	return (posicion < longitud) && (linea[posicion] == '{');
+}
+
+unsigned int ExtractorDeJson::extraer (	const char* linea,
+										const size_t longitud,
+										const std::vector<std::string>& claves,
+										Miembro* miembros	)
+{
+	for (unsigned int i = 0; i < claves.size(); ++i) miembros[i].longitud_clave = 0;
+	size_t posicion;
+	if (claves.empty() || !abrirObjeto(linea, longitud, posicion)) return 0;
+	
+	//Se recorren los miembros hasta encontrar todas las claves. Sólo se comparan las claves con la longitud
+	//buscada, y los valores del resto de miembros se saltan sin analizarlos
+	unsigned int encontradas = 0;
+	Miembro miembro;
+	bool ultimo = false;
+	while (!ultimo && leerMiembro(linea, longitud, posicion, miembro, ultimo))
+	{
+		for (unsigned int i = 0; i < claves.size(); ++i)
+		{
+			if ((miembros[i].longitud_clave > 0) || (miembro.longitud_clave != claves[i].length()) ||
+				(memcmp(&linea[miembro.inicio_clave], claves[i].data(), miembro.longitud_clave) != 0))
+				continue;
+			miembros[i] = miembro;
+			if (++encontradas == claves.size()) return encontradas;
+			break;
+		}
+	}
+	return encontradas;
+}
+
+unsigned int ExtractorDeJson::indexar (	const char* linea,
+										const size_t longitud,
+										Miembro* miembros,
+										const unsigned int maximo	)
+{
+	size_t posicion;
+	if (!abrirObjeto(linea, longitud, posicion)) return 0;
+	unsigned int numero = 0;
+	bool ultimo = false;
+	while (!ultimo && (numero < maximo) && leerMiembro(linea, longitud, posicion, miembros[numero], ultimo)) ++numero;
+	return numero;
+}
+
+bool ExtractorDeJson::abrirObjeto (const char* linea, const size_t longitud, size_t& posicion)
+{
+	posicion = saltarEspacios(linea, longitud, 0);
+	if ((posicion >= longitud) || (linea[posicion] != '{')) return false;
+	posicion = saltarEspacios(linea, longitud, posicion + 1);
+	return (posicion < longitud) && (linea[posicion] != '}');
+}
+
+bool ExtractorDeJson::leerMiembro (	const char* linea,
+									const size_t longitud,
+									size_t& posicion,
+									Miembro& miembro,
+									bool& ultimo	)
+{
+	//La clave es una cadena, seguida de ':'
+	if ((posicion >= longitud) || (linea[posicion] != '"')) return false;
+	size_t fin = cerrarCadena(linea, longitud, posicion + 1);
+	if (fin >= longitud) return false;
+	miembro.inicio_clave = posicion + 1;
+	miembro.longitud_clave = fin - posicion - 1;
+	posicion = saltarEspacios(linea, longitud, fin + 1);
+	if ((posicion >= longitud) || (linea[posicion] != ':')) return false;
+	posicion = saltarEspacios(linea, longitud, posicion + 1);
+	if (posicion >= longitud) return false;
+	
+	//El valor puede ser una cadena, un objeto o vector anidado, que se salta entero, o un número o literal,
+	//que termina en el siguiente separador
+	if (linea[posicion] == '"')
+	{
+		fin = cerrarCadena(linea, longitud, posicion + 1);
+		if (fin >= longitud) return false;
+		miembro.inicio_valor = posicion + 1;
+		miembro.longitud_valor = fin - posicion - 1;
+		posicion = fin + 1;
+	}
+	else if ((linea[posicion] == '{') || (linea[posicion] == '['))
+	{
+		fin = cerrarAnidado(linea, longitud, posicion);
+		if (fin >= longitud) return false;
+		miembro.inicio_valor = posicion;
+		miembro.longitud_valor = fin - posicion + 1;
+		posicion = fin + 1;
+	}
+	else
+	{
+		miembro.inicio_valor = posicion;
+		while ((posicion < longitud) && (linea[posicion] != ',') && (linea[posicion] != '}') &&
+			(linea[posicion] != ' ') && (linea[posicion] != '\t') && (linea[posicion] != '\r')) ++posicion;
+		miembro.longitud_valor = posicion - miembro.inicio_valor;
+		if (miembro.longitud_valor == 0) return false;
+	}
+	
+	//Tras el valor, ',' da paso al siguiente miembro y '}' cierra el objeto
+	posicion = saltarEspacios(linea, longitud, posicion);
+	if (posicion >= longitud) return false;
+	ultimo = (linea[posicion] == '}');
+	if (!ultimo && (linea[posicion] != ',')) return false;
+	posicion = saltarEspacios(linea, longitud, posicion + 1);
+	return true;
+}
+
+size_t ExtractorDeJson::cerrarCadena (const char* linea, const size_t longitud, size_t posicion)
+{
+	while (true)
+	{
+		posicion = saltarBloques(linea, longitud, posicion, true);
+		if (posicion >= longitud) return longitud;
+		if (linea[posicion] == '"') return posicion;
+		posicion = posicion + ((linea[posicion] == '\\') ? 2 : 1);
+	}
+}
+
+size_t ExtractorDeJson::cerrarAnidado (const char* linea, const size_t longitud, size_t posicion)
+{
+	unsigned int profundidad = 0;
+	while (true)
+	{
+		posicion = saltarBloques(linea, longitud, posicion, false);
+		if (posicion >= longitud) return longitud;
+		char caracter = linea[posicion];
+		if (caracter == '"')
+		{
+			posicion = cerrarCadena(linea, longitud, posicion + 1);
+			if (posicion >= longitud) return longitud;
+		}
+		else if ((caracter == '{') || (caracter == '[')) ++profundidad;
+		else if (((caracter == '}') || (caracter == ']')) && (--profundidad == 0)) return posicion;
+		++posicion;
+	}
+}
+
+size_t ExtractorDeJson::saltarBloques (const char* linea, const size_t longitud, size_t posicion, const bool cadena)
+{
+	//En las cadenas se buscan '"' y '\'. En los valores anidados se buscan '"' y, tras activar el bit 0x20 de
+	//cada byte, que convierte '[' y ']' en '{' y '}', las llaves
+	unsigned long long bloque;
+	while (posicion + 8 <= longitud)
+	{
+		memcpy(&bloque, &linea[posicion], 8);
+		if (contieneByte(bloque, 0x2222222222222222ULL)) return posicion;
+		if (cadena)
+		{
+			if (contieneByte(bloque, 0x5C5C5C5C5C5C5C5CULL)) return posicion;
+		}
+		else
+		{
+			bloque = bloque | 0x2020202020202020ULL;
+			if (contieneByte(bloque, 0x7B7B7B7B7B7B7B7BULL) || contieneByte(bloque, 0x7D7D7D7D7D7D7D7DULL))
+				return posicion;
+		}
+		posicion = posicion + 8;
+	}
+	return posicion;
+}
+
+size_t ExtractorDeJson::saltarEspacios (const char* linea, const size_t longitud, size_t posicion)
+{
+	while ((posicion < longitud) &&
+		((linea[posicion] == ' ') || (linea[posicion] == '\t') || (linea[posicion] == '\r') || (linea[posicion] == '\n')))
+		++posicion;
+	return posicion;
+}
+
+} //namespace lognotify
\ No newline at end of file
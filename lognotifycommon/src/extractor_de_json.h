@@ -0,0 +1,142 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _extractor_de_json_h_
+#define _extractor_de_json_h_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lognotify
+{
+
+/**
+* El ExtractorDeJson localiza los miembros de primer nivel de las líneas JSON (un objeto por línea, como las
+* que escriben muchos servicios o los entornos de ejecución de contenedores) sin construir su árbol: cada
+* miembro se devuelve como la posición y longitud de su clave y de su valor dentro de la línea. Los valores
+* anidados (objetos y vectores) no se analizan, sino que se saltan buscando sus caracteres estructurales de 8
+* en 8 bytes, y la búsqueda de claves concretas termina en cuanto se han encontrado todas. Las claves y los
+* valores de tipo cadena se devuelven sin comillas y tal y como aparecen en la línea, sin resolver sus
+* secuencias de escape; el resto de valores se devuelven como su texto completo ("42", "true", "{...}").
+* Si la línea está mal formada o truncada, se devuelven los miembros anteriores al error.
+*/
+class ExtractorDeJson
+{
+	public:
+	
+	/**
+	* Posición y longitud de la clave y del valor de un miembro dentro de su línea
+	*/
+	struct Miembro
+	{
+		size_t inicio_clave;						///< Posición de la clave, tras sus comillas
+		size_t longitud_clave;						///< Longitud de la clave, 0 si no se ha encontrado
+		size_t inicio_valor;						///< Posición del valor, tras sus comillas si es una cadena
+		size_t longitud_valor;						///< Longitud del valor
+	};
+	
+	/**
+	* Indica si una línea es un objeto JSON, es decir, si su primer carácter distinto de espacio es '{'
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @return true si la línea comienza por un objeto JSON, false en caso contrario
+	*/
+	static bool esObjeto (const char* linea, const size_t longitud);
+	
+	/**
+	* Localiza en una línea JSON los valores de las claves indicadas, y sólo de ellas
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param claves Claves buscadas, no vacías
+	* @param miembros Vector, de tantos elementos como claves, en que se devuelve el miembro de cada clave. Las
+	* que no se encuentran tienen longitud_clave 0. Si una clave aparece varias veces, se devuelve la primera
+	* @return Número de claves encontradas
+	*/
+	static unsigned int extraer (	const char* linea,
+									const size_t longitud,
+									const std::vector<std::string>& claves,
+									Miembro* miembros	);
+	
+	/**
+	* Localiza en una línea JSON sus miembros de primer nivel, en el orden en que aparecen
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param miembros Vector en que se devuelven los miembros
+	* @param maximo Número máximo de miembros que se devuelven
+	* @return Número de miembros devueltos, 0 si la línea no es un objeto JSON
+	*/
+	static unsigned int indexar (const char* linea, const size_t longitud, Miembro* miembros, const unsigned int maximo);
+	
+	private:
+	
+	/**
+	* Sitúa una posición en el primer miembro del objeto con que comienza una línea
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición en que se devuelve el comienzo del primer miembro
+	* @return true si el objeto tiene algún miembro, false si está vacío o la línea no es un objeto JSON
+	*/
+	static bool abrirObjeto (const char* linea, const size_t longitud, size_t& posicion);
+	
+	/**
+	* Lee un miembro del objeto y se sitúa en el siguiente
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición del miembro, que se avanza hasta el comienzo del siguiente
+	* @param miembro Miembro en que se devuelve el leído
+	* @param ultimo Se devuelve a true si el miembro leído es el último del objeto
+	* @return true si se ha leído el miembro, false si la línea está mal formada
+	*/
+	static bool leerMiembro (	const char* linea,
+								const size_t longitud,
+								size_t& posicion,
+								Miembro& miembro,
+								bool& ultimo	);
+	
+	/**
+	* Busca las comillas que cierran una cadena, saltando los caracteres escapados
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición siguiente a las comillas que abren la cadena
+	* @return Posición de las comillas que cierran la cadena, o longitud si no se cierra
+	*/
+	static size_t cerrarCadena (const char* linea, const size_t longitud, size_t posicion);
+	
+	/**
+	* Busca el carácter que cierra un objeto o vector anidado, saltando sus cadenas
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición del carácter que abre el objeto o vector
+	* @return Posición del carácter que lo cierra, o longitud si no se cierra
+	*/
+	static size_t cerrarAnidado (const char* linea, const size_t longitud, size_t posicion);
+	
+	/**
+	* Salta los bloques de 8 bytes que no contienen ningún carácter relevante: comillas y '\' dentro de las
+	* cadenas, o comillas, llaves y corchetes dentro de los valores anidados
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición desde la que se salta
+	* @param cadena Indica si se salta el interior de una cadena (true) o de un valor anidado (false)
+	* @return Posición del primer bloque con algún carácter relevante, o de los últimos bytes de la línea, que
+	* no completan un bloque
+	*/
+	static size_t saltarBloques (const char* linea, const size_t longitud, size_t posicion, const bool cadena);
+	
+	/**
+	* Salta los espacios en blanco de JSON
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param posicion Posición desde la que se salta
+	* @return Posición del primer carácter que no es un espacio en blanco, o longitud si no lo hay
+	*/
+	static size_t saltarEspacios (const char* linea, const size_t longitud, size_t posicion);
+};
+
+} //namespace lognotify
+
+#endif //_extractor_de_json_h_
\ No newline at end of file
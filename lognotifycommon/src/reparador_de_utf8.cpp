@@ -0,0 +1,133 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "reparador_de_utf8.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+using namespace std;
+namespace lognotify
+{
+
+bool ReparadorDeUtf8::esValido (const char* texto, const size_t longitud)
+{
+	size_t posicion = 0;
+	size_t avance;
+	while (true)
+	{
+		posicion = saltarImprimibles(texto, longitud, posicion);
+		if (posicion >= longitud) return true;
+		if (!medirSecuencia(texto, longitud, posicion, avance)) return false;
+		posicion = posicion + avance;
+	}
+}
+
+bool ReparadorDeUtf8::reparar (std::string& texto)
+{
+	//Se busca la primera secuencia que debe sustituirse; si no hay ninguna, el texto se deja intacto
+	const char* datos = texto.data();
+	size_t longitud = texto.length();
+	size_t posicion = 0;
+	size_t avance = 0;
+	while (true)
+	{
+		posicion = saltarImprimibles(datos, longitud, posicion);
+		if (posicion >= longitud) return false;
+		if (!medirSecuencia(datos, longitud, posicion, avance)) break;
+		posicion = posicion + avance;
+	}
+	
+	//A partir de ella se compone el texto reparado, copiando de una vez cada tramo válido
+	string reparado;
+	reparado.reserve(longitud + 16);
+	reparado.append(datos, posicion);
+	while (posicion < longitud)
+	{
+		size_t inicio = posicion;
+		while (true)
+		{
+			posicion = saltarImprimibles(datos, longitud, posicion);
+			if ((posicion >= longitud) || !medirSecuencia(datos, longitud, posicion, avance)) break;
+			posicion = posicion + avance;
+		}
+		reparado.append(datos + inicio, posicion - inicio);
+		if (posicion < longitud)
+		{
+			reparado.append("\xEF\xBF\xBD", 3);
+			posicion = posicion + avance;
+		}
+	}
+	texto.swap(reparado);
+	return true;
+}
+
+size_t ReparadorDeUtf8::saltarImprimibles (const char* texto, const size_t longitud, size_t posicion)
+{
+	//Un bloque es ASCII imprimible si ningún byte tiene el bit alto activo, es menor que 0x20 o vale 0x7F
+	unsigned long long bloque;
+	while (posicion + 8 <= longitud)
+	{
+		memcpy(&bloque, &texto[posicion], 8);
+		unsigned long long suprimir = bloque ^ 0x7F7F7F7F7F7F7F7FULL;
+		if ((bloque & 0x8080808080808080ULL) ||
+			((bloque - 0x2020202020202020ULL) & ~bloque & 0x8080808080808080ULL) ||
+			((suprimir - 0x0101010101010101ULL) & ~suprimir & 0x8080808080808080ULL))
+			return posicion;
+		posicion = posicion + 8;
+	}
+	return posicion;
+}
+
+bool ReparadorDeUtf8::medirSecuencia (const char* texto, const size_t longitud, const size_t posicion, size_t& avance)
+{
+	//Los caracteres ASCII son válidos salvo los de control, excepto el tabulador y los saltos de línea
+	const unsigned char* bytes = (const unsigned char*) texto;
+	unsigned char primero = bytes[posicion];
+	avance = 1;
+	if (primero < 0x80)
+		return	((primero >= 0x20) && (primero != 0x7F)) ||
+				(primero == '\t') || (primero == '\n') || (primero == '\r');
+	
+	//El primer byte determina el número de bytes de continuación y el rango admitido para el segundo, que
+	//excluye las formas no mínimas, los sustitutos (U+D800 a U+DFFF) y lo que supera U+10FFFF
+	unsigned int continuaciones;
+	unsigned char minimo = 0x80;
+	unsigned char maximo = 0xBF;
+	if ((primero >= 0xC2) && (primero <= 0xDF)) continuaciones = 1;
+	else if ((primero >= 0xE0) && (primero <= 0xEF))
+	{
+		continuaciones = 2;
+		if (primero == 0xE0) minimo = 0xA0;
+		else if (primero == 0xED) maximo = 0x9F;
+	}
+	else if ((primero >= 0xF0) && (primero <= 0xF4))
+	{
+		continuaciones = 3;
+		if (primero == 0xF0) minimo = 0x90;
+		else if (primero == 0xF4) maximo = 0x8F;
+	}
+	else return false;
+	
+	//Si algún byte de continuación falta o no es válido, la subsecuencia no válida termina antes de él
+	for (unsigned int i = 1; i <= continuaciones; ++i)
+	{
+		if ((posicion + i >= longitud) || (bytes[posicion + i] < minimo) || (bytes[posicion + i] > maximo))
+		{
+			avance = i;
+			return false;
+		}
+		minimo = 0x80;
+		maximo = 0xBF;
+	}
+	avance = continuaciones + 1;
+	
+	//Los caracteres de control C1 (U+0080 a U+009F) tampoco se admiten
+	return (primero != 0xC2) || (bytes[posicion + 1] >= 0xA0);
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _reparador_de_utf8_h_
+#define _reparador_de_utf8_h_
+
+#include <cstddef>
+#include <string>
+
+namespace lognotify
+{
+
+/**
+* El ReparadorDeUtf8 garantiza que un texto leído de un fichero de registro es UTF-8 válido y no contiene
+* caracteres de control, que los demonios de notificaciones rechazan y que, en el caso de '\0', romperían el
+* protocolo de texto. Cada subsecuencia no válida máxima (según la recomendación de Unicode, la misma que
+* aplican los navegadores) y cada carácter de control (C0 salvo el tabulador, el salto de línea y el retorno
+* de carro, DEL y C1) se sustituye por U+FFFD. La comprobación recorre el texto de 8 en 8 bytes mientras sólo
+* contiene ASCII imprimible, por lo que el caso habitual apenas cuesta más que leerlo, y la reparación sólo
+* copia el texto cuando hay algo que sustituir.
+*/
+class ReparadorDeUtf8
+{
+	public:
+	
+	/**
+	* Comprueba si un texto es UTF-8 válido sin caracteres de control, es decir, si no necesita repararse
+	* @param texto Puntero al primer byte del texto
+	* @param longitud Número de bytes del texto
+	* @return true si el texto es válido, false si debe repararse
+	*/
+	static bool esValido (const char* texto, const size_t longitud);
+	
+	/**
+	* Repara un texto, sustituyendo por U+FFFD sus subsecuencias no válidas y sus caracteres de control
+	* @param texto Texto que se repara
+	* @return true si el texto ha cambiado, false si ya era válido
+	*/
+	static bool reparar (std::string& texto);
+	
+	private:
+	
+	/**
+	* Salta los bloques de 8 bytes que sólo contienen ASCII imprimible
+	* @param texto Puntero al primer byte del texto
+	* @param longitud Número de bytes del texto
+	* @param posicion Posición desde la que se salta
+	* @return Posición del primer bloque con algún otro byte, o de los últimos bytes del texto, que no completan
+	* un bloque
+	*/
+	static size_t saltarImprimibles (const char* texto, const size_t longitud, size_t posicion);
+	
+	/**
+	* Mide la secuencia que comienza en una posición del texto
+	* @param texto Puntero al primer byte del texto
+	* @param longitud Número de bytes del texto
+	* @param posicion Posición del primer byte de la secuencia
+	* @param avance Se devuelve el número de bytes de la secuencia si es válida o, si no lo es, el de su
+	* subsecuencia no válida máxima, que se sustituye por un único U+FFFD
+	* @return true si la secuencia es un carácter válido que no es de control, false en caso contrario
+	*/
+	static bool medirSecuencia (const char* texto, const size_t longitud, const size_t posicion, size_t& avance);
+};
+
+} //namespace lognotify
+
+#endif //_reparador_de_utf8_h_
\ No newline at end of file
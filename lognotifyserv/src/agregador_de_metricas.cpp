@@ -0,0 +1,268 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "agregador_de_metricas.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <regex>
+#include <algorithm>
+
+#include "filtro.h"
+#include "regla.h"
+#include "condicion.h"
+#include "evento.h"
+#include "analizador_de_syslog.h"
+#include "extractor_de_json.h"
+
+using namespace std;
+namespace lognotify
+{
+
+AgregadorDeMetricas::AgregadorDeMetricas (const unsigned int fragmentos):
+	fragmentos_((fragmentos > 0) ? fragmentos : 1),
+	agregados_(make_shared<const vector<shared_ptr<Agregado>>>()),
+	siguiente_identificador_(0) {}
+
+int AgregadorDeMetricas::registrar (const std::string& definicion)
+{
+	//La primera línea es la duración de la ventana, y el resto las reglas
+	size_t salto = definicion.find('\n');
+	string segundos = definicion.substr(0, salto);
+	char *fin_numero;
+	unsigned long duracion = strtoul(segundos.c_str(), &fin_numero, 10);
+	if (segundos.empty() || (*fin_numero != '\0') || (duracion == 0) || (duracion > MAX_SEGUNDOS_VENTANA_)) return -1;
+	string reglas = (salto != string::npos) ? definicion.substr(salto + 1) : "";
+	Filtro filtro;
+	if (!filtro.inicializar(reglas) || filtro.estaVacio()) return -1;
+	string canonica = to_string(duracion) + '\n' + Filtro::normalizarReglas(reglas);
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Si ya existe un agregado idéntico, simplemente se anota un nuevo registro del mismo
+	shared_ptr<const vector<shared_ptr<Agregado>>> agregados = atomic_load(&agregados_);
+	for (unsigned int i = 0; i < agregados->size(); ++i)
+	{
+		Agregado& agregado = *(*agregados)[i];
+		if (agregado.definicion != canonica) continue;
+		++agregado.referencias;
+		mutex_.unlock();
+		return agregado.identificador;
+	}
+	mutex_.unlock();
+	
+	//En caso contrario se compilan sus expresiones regulares sin el mutex adquirido, pues puede ser costoso
+	shared_ptr<Agregado> nuevo = make_shared<Agregado>();
+	nuevo->definicion = canonica;
+	nuevo->segundos = duracion;
+	try
+	{
+		const vector<Regla>& reglas_filtro = filtro.obtener_reglas();
+		for (unsigned int i = 0; i < reglas_filtro.size(); ++i)
+		{
+			const vector<Condicion>& condiciones = reglas_filtro[i].obtener_condiciones();
+			nuevo->reglas.emplace_back();
+			for (unsigned int j = 0; j < condiciones.size(); ++j)
+			{
+				CondicionCompilada condicion;
+				condicion.campo = condiciones[j].obtener_campo();
+				condicion.clave = condiciones[j].obtener_clave();
+				condicion.regex = regex(condiciones[j].obtener_expresion());
+				condicion.signo = condiciones[j].obtener_signo();
+				if ((condicion.campo == Condicion::CAMPO_JSON) &&
+					(find(nuevo->claves.begin(), nuevo->claves.end(), condicion.clave) == nuevo->claves.end()))
+					nuevo->claves.push_back(condicion.clave);
+				nuevo->reglas.back().push_back(move(condicion));
+			}
+		}
+	}
+	catch (regex_error&)
+	{
+		return -1;
+	}
+	nuevo->contadores.reset(new Contador [fragmentos_]);
+	for (unsigned int i = 0; i < fragmentos_; ++i) nuevo->contadores[i].lineas = 0;
+	nuevo->fin = chrono::steady_clock::now() + chrono::seconds(duracion);
+	nuevo->referencias = 1;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Se publica una nueva versión de la lista con el agregado, salvo que otro hilo haya registrado uno idéntico
+	//entre tanto, en cuyo caso se comparte con él
+	agregados = atomic_load(&agregados_);
+	for (unsigned int i = 0; i < agregados->size(); ++i)
+	{
+		Agregado& agregado = *(*agregados)[i];
+		if (agregado.definicion != canonica) continue;
+		++agregado.referencias;
+		mutex_.unlock();
+		return agregado.identificador;
+	}
+	nuevo->identificador = siguiente_identificador_++;
+	shared_ptr<vector<shared_ptr<Agregado>>> nuevos = make_shared<vector<shared_ptr<Agregado>>>(*agregados);
+	nuevos->push_back(nuevo);
+	atomic_store(&agregados_, shared_ptr<const vector<shared_ptr<Agregado>>>(move(nuevos)));
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	return nuevo->identificador;
+}
+
+void AgregadorDeMetricas::retirar (const int identificador)
+{
+	if (identificador < 0) return;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Si todavía quedan registros vigentes del agregado, basta con descontar éste. En caso contrario se publica
+	//una nueva versión de la lista sin él; los hilos que todavía recorran la anterior pueden seguir contando
+	shared_ptr<const vector<shared_ptr<Agregado>>> agregados = atomic_load(&agregados_);
+	for (unsigned int i = 0; i < agregados->size(); ++i)
+	{
+		Agregado& agregado = *(*agregados)[i];
+		if ((agregado.identificador != (unsigned int) identificador) || (--agregado.referencias > 0)) continue;
+		shared_ptr<vector<shared_ptr<Agregado>>> nuevos = make_shared<vector<shared_ptr<Agregado>>>(*agregados);
+		nuevos->erase(nuevos->begin() + i);
+		atomic_store(&agregados_, shared_ptr<const vector<shared_ptr<Agregado>>>(move(nuevos)));
+		break;
+	}
+	
+	//Se libera el mutex
+	mutex_.unlock();
+}
+
+void AgregadorDeMetricas::contar (Evento& evento, const unsigned int fragmento)
+{
+	contar(evento.obtener_nombre(), evento.obtener_descripcion(), fragmento);
+}
+
+void AgregadorDeMetricas::contar (const std::string& nombre, const std::string& contenido, const unsigned int fragmento)
+{
+	//Si no hay ningún agregado no se cuenta nada
+	shared_ptr<const vector<shared_ptr<Agregado>>> agregados = atomic_load(&agregados_);
+	if (agregados->empty() || (fragmento >= fragmentos_)) return;
+	
+	vector<unsigned int> posibles;
+	for (unsigned int i = 0; i < agregados->size(); ++i)
+	{
+		//Las condiciones sobre el fichero son las mismas para todas las líneas, por lo que se evalúan una vez
+		//por Evento y sólo se recorren las líneas con las reglas que las cumplen
+		Agregado& agregado = *(*agregados)[i];
+		posibles.clear();
+		for (unsigned int j = 0; j < agregado.reglas.size(); ++j)
+		{
+			bool posible = true;
+			for (unsigned int k = 0; (k < agregado.reglas[j].size()) && posible; ++k)
+			{
+				const CondicionCompilada& condicion = agregado.reglas[j][k];
+				if ((condicion.campo == Condicion::CAMPO_FICHERO) &&
+					(regex_match(nombre, condicion.regex) != condicion.signo)) posible = false;
+			}
+			if (posible) posibles.push_back(j);
+		}
+		if (posibles.empty()) continue;
+		
+		//Sólo este hilo incrementa el contador de su fragmento, por lo que no necesita ordenación alguna
+		unsigned long long lineas = contarLineas(agregado, posibles, contenido);
+		if (lineas > 0) agregado.contadores[fragmento].lineas.fetch_add(lineas, memory_order_relaxed);
+	}
+}
+
+std::vector<AgregadorDeMetricas::Medida> AgregadorDeMetricas::cerrarVentanas (void)
+{
+	vector<Medida> medidas;
+	shared_ptr<const vector<shared_ptr<Agregado>>> agregados = atomic_load(&agregados_);
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	long long fin = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+	for (unsigned int i = 0; i < agregados->size(); ++i)
+	{
+		//La medida de cada ventana vencida es la suma de los contadores de todos los fragmentos, que se reinician
+		//para la siguiente. Lo que se cuente mientras tanto pasa a ésta o a la siguiente, pero no se pierde
+		Agregado& agregado = *(*agregados)[i];
+		if (ahora < agregado.fin) continue;
+		Medida medida;
+		medida.agregado = agregado.identificador;
+		medida.lineas = 0;
+		for (unsigned int j = 0; j < fragmentos_; ++j)
+			medida.lineas = medida.lineas + agregado.contadores[j].lineas.exchange(0, memory_order_relaxed);
+		medida.fin = fin;
+		medida.segundos = agregado.segundos;
+		medidas.push_back(medida);
+		
+		//La siguiente ventana comienza al cerrarse ésta, salvo que se haya quedado atrás (por ejemplo, durante
+		//un relevo), en cuyo caso comienza ahora
+		agregado.fin = agregado.fin + chrono::seconds(agregado.segundos);
+		if (agregado.fin <= ahora) agregado.fin = ahora + chrono::seconds(agregado.segundos);
+	}
+	return medidas;
+}
+
+unsigned long long AgregadorDeMetricas::contarLineas (	const Agregado& agregado,
+														const std::vector<unsigned int>& posibles,
+														const std::string& descripcion	)
+{
+	unsigned long long lineas = 0;
+	vector<ExtractorDeJson::Miembro> miembros (agregado.claves.size());
+	AnalizadorDeSyslog::Campos cabecera;
+	size_t inicio = 0;
+	while (inicio <= descripcion.length())
+	{
+		size_t fin = descripcion.find('\n', inicio);
+		if (fin == string::npos) fin = descripcion.length();
+		const char *linea = descripcion.data() + inicio;
+		
+		//Si alguna condición compara claves JSON, se localizan en la línea o, si tiene cabecera de syslog, en
+		//su mensaje, como en los filtros
+		const char *mensaje = linea;
+		if (!agregado.claves.empty())
+		{
+			AnalizadorDeSyslog::analizar(linea, fin - inicio, cabecera);
+			mensaje = linea + cabecera.inicio[AnalizadorDeSyslog::CAMPO_MENSAJE];
+			ExtractorDeJson::extraer(mensaje, cabecera.longitud[AnalizadorDeSyslog::CAMPO_MENSAJE], agregado.claves,
+				&miembros[0]);
+		}
+		
+		//La línea se cuenta si cumple alguna de las reglas posibles. Las condiciones sobre el fichero ya se han
+		//comprobado, y las claves que no aparecen en la línea valen cadena vacía
+		bool cumplida = false;
+		for (unsigned int i = 0; (i < posibles.size()) && !cumplida; ++i)
+		{
+			const vector<CondicionCompilada>& condiciones = agregado.reglas[posibles[i]];
+			cumplida = true;
+			for (unsigned int j = 0; (j < condiciones.size()) && cumplida; ++j)
+			{
+				const CondicionCompilada& condicion = condiciones[j];
+				bool igual;
+				if (condicion.campo == Condicion::CAMPO_FICHERO) continue;
+				if (condicion.campo == Condicion::CAMPO_CONTENIDO)
+					igual = regex_match(linea, descripcion.data() + fin, condicion.regex);
+				else
+				{
+					size_t indice = find(agregado.claves.begin(), agregado.claves.end(), condicion.clave) -
+						agregado.claves.begin();
+					const char *valor = mensaje + miembros[indice].inicio_valor;
+					if (miembros[indice].longitud_clave == 0) igual = regex_match("", condicion.regex);
+					else igual = regex_match(valor, valor + miembros[indice].longitud_valor, condicion.regex);
+				}
+				if (igual != condicion.signo) cumplida = false;
+			}
+		}
+		if (cumplida) ++lineas;
+		inicio = fin + 1;
+	}
+	return lineas;
+}
+
+} //namespace lognotify
\ No newline at end of file
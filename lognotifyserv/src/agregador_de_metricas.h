@@ -0,0 +1,162 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _agregador_de_metricas_h_
+#define _agregador_de_metricas_h_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <regex>
+
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* El AgregadorDeMetricas cuenta las líneas de los eventos que cumplen las reglas de cada agregado al que se han
+* suscrito los clientes (por ejemplo, los accesos fallidos por ssh o las respuestas 5xx de un servidor web) y,
+* al cerrar cada ventana del agregado, obtiene una única medida con el número de líneas contadas en ella, de
+* forma que a los clientes que sólo necesitan la cuenta les baste un evento por ventana en lugar de uno por
+* línea. Cada agregado se define por la duración de su ventana, en segundos, y un conjunto de reglas con la
+* sintaxis de los filtros (ver Filtro); una línea se cuenta si cumple alguna de ellas, evaluando las
+* condiciones contenido= sobre la propia línea, las condiciones campo.clave= sobre su valor en la línea, si es
+* un objeto JSON, y las condiciones fichero= sobre el nombre del fichero del evento. Los agregados idénticos se
+* comparten entre todos los clientes que los solicitan.
+* Cada hilo que aporta eventos cuenta en su propio fragmento de los contadores, un contador atómico por agregado
+* que sólo él incrementa y que no comparte línea de caché con los de otros hilos, por lo que contar no
+* requiere ningún mutex ni provoca contención. La lista de agregados se publica como una versión inmutable que
+* se sustituye completa al registrar o retirar alguno (copia en escritura).
+* El AgregadorDeMetricas es thread safe.
+*/
+class AgregadorDeMetricas
+{
+	public:
+	
+	/**
+	* Medida obtenida al cerrar una ventana de un agregado
+	*/
+	struct Medida
+	{
+		unsigned int agregado;						///< Identificador del agregado
+		unsigned long long lineas;					///< Líneas contadas durante la ventana
+		long long fin;								///< Instante de cierre de la ventana, en segundos desde 1970
+		unsigned int segundos;						///< Duración de la ventana
+	};
+	
+	/**
+	* Constructor de la clase AgregadorDeMetricas
+	* @param fragmentos Número de hilos que cuentan las líneas de sus eventos, cada uno en su fragmento
+	*/
+	AgregadorDeMetricas (const unsigned int fragmentos);
+	
+	/**
+	* Registra un agregado. Si ya hay registrado uno idéntico, se comparte con él
+	* @param definicion Definición del agregado: duración de su ventana en segundos (entre 1 y
+	* MAX_SEGUNDOS_VENTANA_) en la primera línea, y sus reglas, con la sintaxis de los filtros, en las siguientes
+	* @return Identificador asignado al agregado, o -1 si la definición no es válida o no contiene ninguna regla.
+	* El identificador es válido hasta que se retire el agregado mediante retirar, y no se reasigna
+	*/
+	int registrar (const std::string& definicion);
+	
+	/**
+	* Retira un agregado. Cada llamada a registrar debe corresponderse con una llamada a retirar cuando el
+	* agregado deje de utilizarse
+	* @param identificador Identificador asignado al agregado durante su registro
+	*/
+	void retirar (const int identificador);
+	
+	/**
+	* Cuenta las líneas de un Evento que cumplen las reglas de cada agregado registrado. Cada hilo debe contar
+	* siempre en el mismo fragmento, distinto del de los demás
+	* @param evento Evento cuyas líneas se cuentan
+	* @param fragmento Fragmento de los contadores en que cuenta el hilo, menor que el número de fragmentos
+	*/
+	void contar (Evento& evento, const unsigned int fragmento);
+	
+	/**
+	* Cuenta las líneas leídas de un fichero que cumplen las reglas de cada agregado registrado, como contar con
+	* un Evento, pero sin necesidad de construirlo
+	* @param nombre Nombre del fichero
+	* @param contenido Líneas leídas, separadas por '\n'
+	* @param fragmento Fragmento de los contadores en que cuenta el hilo, menor que el número de fragmentos
+	*/
+	void contar (const std::string& nombre, const std::string& contenido, const unsigned int fragmento);
+	
+	/**
+	* Cierra las ventanas de los agregados que han vencido, reiniciando sus contadores, y comienza la siguiente.
+	* Debe llamarse siempre desde el mismo hilo, con una frecuencia de al menos una vez por segundo
+	* @return Medida de cada ventana cerrada
+	*/
+	std::vector<Medida> cerrarVentanas (void);
+	
+	private:
+	
+	/**
+	* Condición de una regla de un agregado, con su expresión regular compilada
+	*/
+	struct CondicionCompilada
+	{
+		unsigned int campo;							///< Campo comparado (ver Condicion::CAMPO_XXXX)
+		std::string clave;							///< Clave JSON comparada, si el campo es CAMPO_JSON
+		std::regex regex;							///< Expresión regular compilada
+		bool signo;									///< Indica si se cumple cuando es igual (true) o cuando no
+	};
+	
+	/**
+	* Contador de líneas de un fragmento, que ocupa una línea de caché completa para no compartirla con el de
+	* otro fragmento
+	*/
+	struct Contador
+	{
+		std::atomic<unsigned long long> lineas;		///< Líneas contadas en la ventana en curso
+		char relleno [64 - sizeof(std::atomic<unsigned long long>)];	///< Relleno hasta la línea de caché
+	};
+	
+	/**
+	* Agregado registrado: reglas compiladas y contadores de cada fragmento
+	*/
+	struct Agregado
+	{
+		unsigned int identificador;					///< Identificador asignado al agregado
+		std::string definicion;						///< Definición en forma canónica, que lo identifica
+		unsigned int segundos;						///< Duración de la ventana
+		std::vector<std::vector<CondicionCompilada>> reglas;	///< Condiciones de cada regla
+		std::vector<std::string> claves;			///< Claves JSON que utiliza alguna condición, sin repetir
+		std::unique_ptr<Contador[]> contadores;		///< Contador de cada fragmento
+		std::chrono::steady_clock::time_point fin;	///< Instante de cierre de la ventana en curso
+		unsigned int referencias;					///< Número de registros vigentes del agregado
+	};
+	
+	/**
+	* Cuenta las líneas de una descripción que cumplen alguna de las reglas indicadas de un agregado
+	* @param agregado Agregado cuyas reglas se evalúan
+	* @param posibles Índices de las reglas del agregado cuyas condiciones sobre el fichero se cumplen
+	* @param descripcion Descripción del Evento, con sus líneas separadas por '\n'
+	* @return Número de líneas que cumplen alguna de las reglas
+	*/
+	static unsigned long long contarLineas (	const Agregado& agregado,
+												const std::vector<unsigned int>& posibles,
+												const std::string& descripcion	);
+	
+	//Constantes
+	constexpr static unsigned int MAX_SEGUNDOS_VENTANA_ = 86400;	///< Duración máxima de una ventana
+	
+	//Variables miembro
+	unsigned int fragmentos_;					///< Número de fragmentos de los contadores
+	std::shared_ptr<const std::vector<std::shared_ptr<Agregado>>> agregados_;	///< Versión vigente de la
+																				///< lista de agregados
+	unsigned int siguiente_identificador_;		///< Identificador que se asignará al siguiente agregado
+	std::mutex mutex_;							///< Mutex que serializa las modificaciones de la lista
+};
+
+} //namespace lognotify
+
+#endif //_agregador_de_metricas_h_
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "anillo_compartido.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include <string>
+
+#include "mensaje.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr uint32_t CabeceraDeAnilloCompartido::MAGIA;
+constexpr uint32_t CabeceraDeAnilloCompartido::VERSION;
+constexpr unsigned int CabeceraDeAnilloCompartido::TAMANO_CABECERA;
+
+AnilloCompartido::~AnilloCompartido (void)
+{
+	if (cabecera_ != nullptr)
+	{
+		munmap(cabecera_, tamano_segmento_);
+		shm_unlink(nombre_.c_str());
+	}
+}
+
+bool AnilloCompartido::crear (const std::string& nombre, const unsigned long capacidad)
+{
+	//Sólo puede crearse una vez
+	if (estaCreado()) return false;
+	
+	//La capacidad se redondea a una potencia de 2, para que las posiciones absolutas sigan siendo continuas al
+	//dar la vuelta a sus 64 bits
+	uint64_t capacidad_real = 4096;
+	while (capacidad_real < capacidad) capacidad_real = capacidad_real * 2;
+	unsigned long tamano = CabeceraDeAnilloCompartido::TAMANO_CABECERA + capacidad_real;
+	
+	//Se crea un segmento nuevo, eliminando antes el de una ejecución anterior si existe. Sólo el propietario
+	//y su grupo pueden acceder a él, pues los lectores deben poder anotar en la cabecera que están esperando
+	shm_unlink(nombre.c_str());
+	int descriptor = shm_open(nombre.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+	if (descriptor < 0) return false;
+	if (ftruncate(descriptor, tamano) < 0)
+	{
+		close(descriptor);
+		shm_unlink(nombre.c_str());
+		return false;
+	}
+	void *segmento = mmap(nullptr, tamano, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (segmento == MAP_FAILED)
+	{
+		shm_unlink(nombre.c_str());
+		return false;
+	}
+	
+	//Se inicializa la cabecera. La magia se escribe la última, para que los lectores no usen el anillo antes
+	//de estar listo
+	cabecera_ = new (segmento) CabeceraDeAnilloCompartido;
+	cabecera_->version = CabeceraDeAnilloCompartido::VERSION;
+	cabecera_->capacidad = capacidad_real;
+	cabecera_->escritura.store(0);
+	cabecera_->validez.store(0);
+	cabecera_->aviso.store(0);
+	cabecera_->esperando.store(0);
+	atomic_thread_fence(memory_order_release);
+	cabecera_->magia = CabeceraDeAnilloCompartido::MAGIA;
+	
+	datos_ = (char*) segmento + CabeceraDeAnilloCompartido::TAMANO_CABECERA;
+	tamano_segmento_ = tamano;
+	escritura_ = 0;
+	nombre_ = nombre;
+	return true;
+}
+
+bool AnilloCompartido::publicar (const unsigned long long secuencia, Mensaje& mensaje)
+{
+	if (!estaCreado() || (secuencia == 0)) return false;
+	
+	//Se calcula el espacio que ocupará la trama, alineado a 16 bytes. Si no cabe en la mitad del anillo, no
+	//se publica, para que los lectores tengan siempre ocasión de leerla
+	const char *contenido = mensaje.obtener_inicio() + mensaje.obtener_longitud_cabecera();
+	uint32_t longitud = mensaje.obtener_longitud() - mensaje.obtener_longitud_cabecera();
+	uint64_t capacidad = cabecera_->capacidad;
+	uint64_t tamano = (sizeof(RegistroDeAnilloCompartido) + longitud + 15) & ~((uint64_t) 15);
+	if (tamano > capacidad / 2) return false;
+	
+	//Si la trama no cabe antes del final de la zona de datos, se rellena el final y se empieza por el principio
+	uint64_t desplazamiento = escritura_ & (capacidad - 1);
+	uint64_t relleno = (desplazamiento + tamano > capacidad) ? capacidad - desplazamiento : 0;
+	
+	//Antes de sobrescribir nada, se anota hasta dónde dejan de ser válidas las tramas antiguas. La barrera
+	//garantiza que un lector que vea los datos nuevos vea también la nueva validez
+	uint64_t fin = escritura_ + relleno + tamano;
+	if (fin > capacidad) cabecera_->validez.store(fin - capacidad, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	
+	//Se escribe el relleno, si es necesario, y la trama
+	RegistroDeAnilloCompartido registro;
+	if (relleno > 0)
+	{
+		registro.tamano = relleno;
+		registro.longitud = 0;
+		registro.secuencia = 0;
+		memcpy(datos_ + desplazamiento, &registro, sizeof registro);
+		desplazamiento = 0;
+	}
+	registro.tamano = tamano;
+	registro.longitud = longitud;
+	registro.secuencia = secuencia;
+	memcpy(datos_ + desplazamiento, &registro, sizeof registro);
+	memcpy(datos_ + desplazamiento + sizeof registro, contenido, longitud);
+	
+	//Se publica la nueva posición de escritura y se despierta a los lectores que estén esperando, si los hay
+	escritura_ = fin;
+	cabecera_->escritura.store(fin, memory_order_release);
+	cabecera_->aviso.fetch_add(1);
+	if (cabecera_->esperando.load() > 0)
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&cabecera_->aviso), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	return true;
+}
+
+} //namespace lognotify
\ No newline at end of file
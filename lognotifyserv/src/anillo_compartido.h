@@ -0,0 +1,114 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _anillo_compartido_h_
+#define _anillo_compartido_h_
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+#include "mensaje.h"
+
+namespace lognotify
+{
+
+/**
+* Cabecera del segmento de memoria compartida de un AnilloCompartido, seguida (a partir del byte
+* TAMANO_CABECERA) de la zona de datos, de capacidad bytes. Las posiciones de escritura y validez son
+* absolutas (crecen indefinidamente); la posición en la zona de datos es su resto entre la capacidad.
+* Cada trama de la zona de datos comienza con un RegistroDeAnilloCompartido alineado a 16 bytes.
+*/
+struct CabeceraDeAnilloCompartido
+{
+	//Constantes públicas
+	constexpr static uint32_t MAGIA = 0x414E474C;			///< Valor de magia cuando el anillo está listo
+	constexpr static uint32_t VERSION = 1;					///< Versión del formato del segmento
+	constexpr static unsigned int TAMANO_CABECERA = 256;	///< Desplazamiento de la zona de datos
+	
+	uint32_t magia;									///< MAGIA, escrito al terminar de crear el anillo
+	uint32_t version;								///< Versión del formato del segmento
+	uint64_t capacidad;								///< Tamaño de la zona de datos (potencia de 2)
+	alignas(64) std::atomic<uint64_t> escritura;	///< Posición en que se escribirá la siguiente trama
+	std::atomic<uint64_t> validez;					///< Posición más antigua que no ha sido sobrescrita
+	alignas(64) std::atomic<uint32_t> aviso;		///< Palabra futex, incrementada con cada publicación
+	std::atomic<uint32_t> esperando;				///< Número de lectores esperando en la palabra futex
+};
+
+/**
+* Cabecera de cada trama de la zona de datos. Las tramas de relleno (secuencia 0) sólo ocupan el final de la
+* zona de datos cuando la siguiente trama no cabe antes de volver al principio
+*/
+struct RegistroDeAnilloCompartido
+{
+	uint32_t tamano;		///< Bytes ocupados por la trama, cabecera incluida (múltiplo de 16)
+	uint32_t longitud;		///< Bytes de contenido que siguen a la cabecera
+	uint64_t secuencia;		///< Número de secuencia del evento, o 0 en las tramas de relleno
+};
+
+/**
+* Un AnilloCompartido publica los eventos serializados en un anillo de memoria compartida (/dev/shm), con un
+* único productor y cualquier número de lectores en otros procesos de la misma máquina, que los leen en su
+* sitio, sin copias ni llamadas al sistema, cada uno a su ritmo (ver LectorDeAnilloCompartido). El productor
+* nunca espera a los lectores: sobrescribe las tramas más antiguas y anota hasta dónde lo ha hecho, de forma
+* que un lector que se queda atrás lo detecta. Los lectores que esperan nuevas tramas lo indican en la
+* cabecera y son despertados mediante un futex, que sólo se invoca si hay alguno esperando.
+* El AnilloCompartido NO es thread safe; debe publicarse desde un único hilo.
+*/
+class AnilloCompartido
+{
+	public:
+	
+	/**
+	* Constructor de la clase AnilloCompartido
+	*/
+	AnilloCompartido (void): cabecera_(nullptr), datos_(nullptr), tamano_segmento_(0), escritura_(0) {}
+	
+	/**
+	* Destructor de la clase AnilloCompartido. Libera el segmento de memoria compartida, que deja de ser
+	* accesible para nuevos lectores
+	*/
+	~AnilloCompartido (void);
+	
+	AnilloCompartido (const AnilloCompartido&) = delete;
+	AnilloCompartido& operator= (const AnilloCompartido&) = delete;
+	
+	/**
+	* Crea el segmento de memoria compartida del anillo. Si ya existe uno con el mismo nombre (por ejemplo, de
+	* una ejecución anterior), se sustituye; los lectores que lo tuvieran abierto deben volver a abrirlo
+	* @param nombre Nombre del segmento, de la forma "/nombre"
+	* @param capacidad Tamaño en bytes de la zona de datos, que se redondea a la siguiente potencia de 2
+	* @return true si el anillo ha sido creado, false en caso contrario
+	*/
+	bool crear (const std::string& nombre, const unsigned long capacidad);
+	
+	/**
+	* Indica si el anillo ha sido creado correctamente
+	* @return true si el anillo ha sido creado, false en caso contrario
+	*/
+	inline bool estaCreado (void) { return cabecera_ != nullptr; }
+	
+	/**
+	* Publica un Mensaje en el anillo, sobrescribiendo las tramas más antiguas que sea necesario
+	* @param secuencia Número de secuencia del Mensaje, mayor que 0
+	* @param mensaje Mensaje serializado por ServidorDeNotificaciones; se publica su contenido sin la cabecera
+	* @return true si el Mensaje ha sido publicado, false si el anillo no está creado o el Mensaje no cabe
+	*/
+	bool publicar (const unsigned long long secuencia, Mensaje& mensaje);
+	
+	private:
+	
+	//Variables miembro
+	CabeceraDeAnilloCompartido *cabecera_;	///< Cabecera del segmento de memoria compartida
+	char *datos_;							///< Zona de datos del segmento
+	unsigned long tamano_segmento_;			///< Tamaño total del segmento
+	uint64_t escritura_;					///< Posición de escritura de la siguiente trama
+	std::string nombre_;					///< Nombre del segmento de memoria compartida
+};
+
+} //namespace lognotify
+
+#endif //_anillo_compartido_h_
\ No newline at end of file
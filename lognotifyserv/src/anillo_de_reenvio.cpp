@@ -0,0 +1,76 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "anillo_de_reenvio.h"
+
+#include <vector>
+#include <memory>
+
+#include "mensaje.h"
+
+using namespace std;
+namespace lognotify
+{
+
+AnilloDeReenvio::AnilloDeReenvio (const unsigned int maxMensajes, const unsigned long maxBytes):
+	posiciones_(maxMensajes),
+	max_bytes_(maxBytes),
+	bytes_(0),
+	primera_(1),
+	ultima_(0) {}
+
+void AnilloDeReenvio::anadir (const unsigned long long secuencia, std::shared_ptr<Mensaje> mensaje)
+{
+	//Si el mensaje no es consecutivo al último, los conservados dejan de formar una serie continua y se
+	//descartan todos
+	if (secuencia != ultima_ + 1)
+		while (primera_ <= ultima_) descartarPrimero();
+	if (primera_ > ultima_) primera_ = secuencia;
+	ultima_ = secuencia;
+	
+	//Si el mensaje no cabe en el anillo por sí solo, no se conserva
+	if (posiciones_.empty() || (mensaje->obtener_longitud() > max_bytes_))
+	{
+		while (primera_ < ultima_) descartarPrimero();
+		primera_ = ultima_ + 1;
+		return;
+	}
+	
+	//Se descartan los mensajes más antiguos hasta que haya una posición y memoria suficientes para el nuevo
+	while ((ultima_ - primera_ >= posiciones_.size()) || (bytes_ + mensaje->obtener_longitud() > max_bytes_))
+		descartarPrimero();
+	
+	//Y se guarda en la posición que le corresponde
+	bytes_ = bytes_ + mensaje->obtener_longitud();
+	posiciones_[secuencia % posiciones_.size()] = move(mensaje);
+}
+
+std::shared_ptr<Mensaje> AnilloDeReenvio::obtener (const unsigned long long secuencia)
+{
+	if ((secuencia < primera_) || (secuencia > ultima_)) return nullptr;
+	return posiciones_[secuencia % posiciones_.size()];
+}
+
+void AnilloDeReenvio::reiniciar (const unsigned long long ultima)
+{
+	while (primera_ <= ultima_) descartarPrimero();
+	primera_ = ultima + 1;
+	ultima_ = ultima;
+}
+
+void AnilloDeReenvio::descartarPrimero (void)
+{
+	//Se libera la posición del mensaje más antiguo, que sólo se destruye si no está siendo enviado
+	shared_ptr<Mensaje>& posicion = posiciones_[primera_ % posiciones_.size()];
+	if (posicion)
+	{
+		bytes_ = bytes_ - posicion->obtener_longitud();
+		posicion.reset();
+	}
+	++primera_;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _anillo_de_reenvio_h_
+#define _anillo_de_reenvio_h_
+
+#include <vector>
+#include <memory>
+
+#include "mensaje.h"
+
+namespace lognotify
+{
+
+/**
+* Un AnilloDeReenvio conserva los últimos mensajes difundidos a los clientes, identificados por su número de
+* secuencia, para poder reenviarlos a un cliente que ha perdido la conexión y la recupera. Su tamaño está
+* acotado tanto en número de mensajes (un número fijo de posiciones reservadas de antemano) como en memoria
+* total ocupada por éstos: al añadir un mensaje se descartan los más antiguos que sea necesario. Los mensajes
+* se guardan compartidos con los envíos en curso, sin copiar su contenido.
+* El AnilloDeReenvio NO es thread safe; su acceso debe protegerse externamente.
+*/
+class AnilloDeReenvio
+{
+	public:
+	
+	/**
+	* Constructor de la clase AnilloDeReenvio
+	* @param maxMensajes Número máximo de mensajes conservados
+	* @param maxBytes Memoria máxima (en bytes) ocupada por el contenido de los mensajes conservados. Con 0 no
+	* se conserva ningún mensaje, aunque se sigue llevando la cuenta de los números de secuencia
+	*/
+	AnilloDeReenvio (const unsigned int maxMensajes, const unsigned long maxBytes);
+	
+	/**
+	* Añade un mensaje al anillo, descartando los más antiguos si es necesario para respetar sus límites
+	* @param secuencia Número de secuencia del mensaje. Debe ser mayor que el del último mensaje añadido; si no
+	* es consecutivo a éste, los mensajes conservados se descartan
+	* @param mensaje Mensaje que desea conservarse
+	*/
+	void anadir (const unsigned long long secuencia, std::shared_ptr<Mensaje> mensaje);
+	
+	/**
+	* Obtiene un mensaje conservado en el anillo
+	* @param secuencia Número de secuencia del mensaje
+	* @return Mensaje correspondiente, o nullptr si no se conserva (ya ha sido descartado o no existe)
+	*/
+	std::shared_ptr<Mensaje> obtener (const unsigned long long secuencia);
+	
+	/**
+	* Descarta todos los mensajes conservados y continúa la numeración a partir del número de secuencia
+	* indicado, como si fuera el del último mensaje añadido
+	* @param ultima Número de secuencia que se considera el del último mensaje añadido
+	*/
+	void reiniciar (const unsigned long long ultima);
+	
+	/**
+	* Devuelve el número de secuencia del mensaje más antiguo conservado en el anillo
+	* @return Número de secuencia del mensaje más antiguo. Si el anillo está vacío, es el siguiente al último
+	* añadido
+	*/
+	inline unsigned long long obtener_primera (void) { return primera_; }
+	
+	/**
+	* Devuelve el número de secuencia del último mensaje añadido al anillo
+	* @return Número de secuencia del último mensaje añadido, o 0 si no se ha añadido ninguno
+	*/
+	inline unsigned long long obtener_ultima (void) { return ultima_; }
+	
+	private:
+	
+	/**
+	* Descarta el mensaje más antiguo conservado en el anillo
+	*/
+	void descartarPrimero (void);
+	
+	//Variables miembro
+	std::vector<std::shared_ptr<Mensaje>> posiciones_;	///< Mensajes conservados, indexados por secuencia
+	unsigned long max_bytes_;		///< Memoria máxima ocupada por los mensajes conservados
+	unsigned long bytes_;			///< Memoria ocupada actualmente por los mensajes conservados
+	unsigned long long primera_;	///< Número de secuencia del mensaje conservado más antiguo
+	unsigned long long ultima_;		///< Número de secuencia del último mensaje añadido
+};
+
+} //namespace lognotify
+
+#endif //_anillo_de_reenvio_h_
\ No newline at end of file
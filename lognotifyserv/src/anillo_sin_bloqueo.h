@@ -0,0 +1,88 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _anillo_sin_bloqueo_h_
+#define _anillo_sin_bloqueo_h_
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+namespace lognotify
+{
+
+/**
+* Un AnilloSinBloqueo es una cola de capacidad fija entre exactamente un hilo productor y un hilo consumidor,
+* que no utiliza ningún mutex: cada extremo sólo escribe su propia posición (en líneas de caché distintas) y
+* lee la del otro, por lo que insertar y extraer nunca esperan ni compiten entre sí. Las posiciones son
+* absolutas (crecen indefinidamente); la posición en el anillo es su resto entre la capacidad.
+* Sólo es thread safe con un único productor (insertar) y un único consumidor (extraer) a la vez.
+*/
+template <typename T>
+class AnilloSinBloqueo
+{
+	public:
+	
+	/**
+	* Constructor de la clase AnilloSinBloqueo
+	* @param capacidad Número máximo de elementos en el anillo
+	*/
+	AnilloSinBloqueo (const unsigned int capacidad): posiciones_(capacidad), lectura_(0), escritura_(0) {}
+	
+	AnilloSinBloqueo (const AnilloSinBloqueo&) = delete;
+	AnilloSinBloqueo& operator= (const AnilloSinBloqueo&) = delete;
+	
+	/**
+	* Inserta una copia de un elemento al final del anillo. Sólo puede llamarse desde el hilo productor
+	* @param elemento Elemento que desea insertarse
+	* @return true si el elemento ha sido insertado, false si el anillo está lleno
+	*/
+	bool insertar (const T& elemento)
+	{
+		unsigned long long escritura = escritura_.load(std::memory_order_relaxed);
+		if (escritura - lectura_.load(std::memory_order_acquire) >= posiciones_.size()) return false;
+		posiciones_[escritura % posiciones_.size()] = elemento;
+		escritura_.store(escritura + 1, std::memory_order_release);
+		return true;
+	}
+	
+	/**
+	* Extrae el primer elemento del anillo, dejando su posición vacía. Sólo puede llamarse desde el hilo
+	* consumidor
+	* @param elemento Elemento en el que se devuelve el extraído
+	* @return true si se ha extraído un elemento, false si el anillo está vacío
+	*/
+	bool extraer (T& elemento)
+	{
+		unsigned long long lectura = lectura_.load(std::memory_order_relaxed);
+		if (lectura == escritura_.load(std::memory_order_acquire)) return false;
+		elemento = std::move(posiciones_[lectura % posiciones_.size()]);
+		posiciones_[lectura % posiciones_.size()] = T();
+		lectura_.store(lectura + 1, std::memory_order_release);
+		return true;
+	}
+	
+	/**
+	* Indica si el anillo está vacío. Desde el hilo consumidor, un resultado false es definitivo
+	* @return true si no hay elementos por extraer, false en caso contrario
+	*/
+	inline bool estaVacio (void) const
+	{
+		return lectura_.load(std::memory_order_acquire) == escritura_.load(std::memory_order_acquire);
+	}
+	
+	private:
+	
+	//Variables miembro
+	std::vector<T> posiciones_;						///< Posiciones del anillo
+	std::atomic<unsigned long long> lectura_;		///< Posición del siguiente elemento a extraer
+	char separacion_ [64];							///< Separa ambas posiciones en distintas líneas de caché
+	std::atomic<unsigned long long> escritura_;		///< Posición en que se insertará el siguiente
+};
+
+} //namespace lognotify
+
+#endif //_anillo_sin_bloqueo_h_
\ No newline at end of file
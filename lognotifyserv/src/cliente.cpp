@@ -8,91 +8,295 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <memory>
 #include <vector>
-#include <future>
+#include <deque>
+#include <utility>
+#include <string>
 #include <chrono>
+#include <functional>
 
 #include "mensaje.h"
 #include "evento.h"
+#include "codificador.h"
 
 using namespace std;
 namespace lognotify
 {
 
-Cliente::Cliente (const int descriptorSocket): descriptor_socket_(descriptorSocket) {}
+Cliente::Cliente (const int descriptorSocket):
+	descriptor_socket_(descriptorSocket),
+	filtro_(-1),
+	secuenciado_(false),
+	formato_(Codificador::FORMATO_TEXTO),
+	multidifusion_(false),
+	origenes_(false),
+	secuencia_de_alta_(ULLONG_MAX),
+	en_espera_(false),
+	bytes_retenidos_(0),
+	confirmando_(false),
+	cursor_(ULLONG_MAX),
+	bytes_en_vuelo_(0),
+	latiendo_(false),
+	resumido_(false),
+	bytes_acotados_(0),
+	envios_pendientes_(false)
+{
+	//El socket se hace no bloqueante, de forma que ningún envío espere a que el cliente lea lo anterior
+	int opciones = fcntl(descriptor_socket_, F_GETFL);
+	if (opciones >= 0) fcntl(descriptor_socket_, F_SETFL, opciones | O_NONBLOCK);
+}
 
 bool Cliente::enviar (std::shared_ptr<Mensaje> mensaje)
+{
+	return enviar(vector<shared_ptr<Mensaje>> (1, move(mensaje)));
+}
+
+bool Cliente::enviar (const std::vector<std::shared_ptr<Mensaje>>& mensajes)
+{
+	//Se envía el contenido de cada mensaje directamente desde su buffer, omitiendo la cabecera si el cliente no
+	//la entiende
+	vector<Tramo> tramos;
+	for (unsigned int i = 0; i < mensajes.size(); ++i)
+	{
+		unsigned int desplazamiento = secuenciado_ ? 0 : mensajes[i]->obtener_longitud_cabecera();
+		if (mensajes[i]->obtener_longitud() <= desplazamiento) continue;
+		size_t longitud = mensajes[i]->obtener_longitud() - desplazamiento;
+		tramos.push_back(Tramo {mensajes[i], nullptr, nullptr, desplazamiento, longitud, true});
+	}
+	return encolar(tramos);
+}
+
+bool Cliente::reenviar (const std::vector<std::shared_ptr<Mensaje>>& mensajes)
+{
+	//Se envían como en enviar, pero sin contar para el límite de la cola de salida
+	vector<Tramo> tramos;
+	for (unsigned int i = 0; i < mensajes.size(); ++i)
+	{
+		unsigned int desplazamiento = secuenciado_ ? 0 : mensajes[i]->obtener_longitud_cabecera();
+		if (mensajes[i]->obtener_longitud() <= desplazamiento) continue;
+		size_t longitud = mensajes[i]->obtener_longitud() - desplazamiento;
+		tramos.push_back(Tramo {mensajes[i], nullptr, nullptr, desplazamiento, longitud, false});
+	}
+	return encolar(tramos);
+}
+
+bool Cliente::retener (const unsigned long long secuencia, std::shared_ptr<Mensaje> mensaje)
+{
+	bytes_retenidos_ = bytes_retenidos_ + mensaje->obtener_longitud();
+	retenidos_.push_back(make_pair(secuencia, move(mensaje)));
+	return bytes_retenidos_ <= MAX_BYTES_EN_COLA_;
+}
+
+std::vector<std::pair<unsigned long long, std::shared_ptr<Mensaje>>> Cliente::tomarRetenidos (void)
+{
+	vector<pair<unsigned long long, shared_ptr<Mensaje>>> retenidos;
+	retenidos.swap(retenidos_);
+	bytes_retenidos_ = 0;
+	return retenidos;
+}
+
+bool Cliente::enviarFichero (	std::shared_ptr<const std::string> ruta,
+								const std::vector<std::pair<long long, std::string>>& tramas,
+								std::shared_ptr<const int> fichero,
+								const long long hasta	)
+{
+	//Cada cabecera se copia a un Mensaje propio y le siguen los bytes de su trama, que no se leen hasta enviarlos
+	vector<Tramo> tramos;
+	for (unsigned int i = 0; i < tramas.size(); ++i)
+	{
+		const string& cabecera = tramas[i].second;
+		if (!cabecera.empty())
+		{
+			shared_ptr<Mensaje> mensaje = make_shared<Mensaje>(cabecera.data(), cabecera.length());
+			tramos.push_back(Tramo {move(mensaje), nullptr, nullptr, 0, cabecera.length(), true});
+		}
+		long long fin = (i + 1 < tramas.size()) ? tramas[i + 1].first : hasta;
+		if (fin > tramas[i].first)
+			tramos.push_back(Tramo {nullptr, fichero, ruta, tramas[i].first, (size_t) (fin - tramas[i].first), true});
+	}
+	return encolar(tramos);
+}
+
+void Cliente::terminarConexion (void)
+{
+	//Se chequea si el descriptor de socket es válido (y por tanto corresponde a una conexión abierta)
+	if (descriptor_socket_ >= 0)
+	{
+		//En caso afirmativo, se cierra el socket terminando la conexión. La llamada a shutdown despierta
+		//además al hilo que pueda estar esperando órdenes del cliente en el mismo socket
+		shutdown(descriptor_socket_, SHUT_RDWR);
+		close(descriptor_socket_);
+		descriptor_socket_ = -1;
+	}
+	
+	//Los envíos pendientes ya no pueden completarse
+	salida_.clear();
+	envios_pendientes_ = false;
+}
+
+bool Cliente::continuarEnvios (void)
 {
 	//Se chequea si el socket es válido
 	if (descriptor_socket_ < 0) return false;
-		
-	//Se comprueba el estado de las confirmaciones de envío pendientes eliminando las ya recibidas antes
-	//de introducir una nueva
-	int fallo = false;
-	for (int i = pendientes_.size() - 1; i >= 0; --i)
-	{	
-		//Si el estado de la confirmación pendiente no es válido, se elimina el retorno pendiente
-		if (!pendientes_[i].valid())
+	
+	//Se envían los tramos en orden hasta vaciar la cola o hasta que el socket no admita más
+	bool lleno = false;
+	while (!salida_.empty() && !lleno)
+	{
+		ssize_t enviados;
+		if (salida_.front().mensaje)
 		{
-			fallo = true;
-			pendientes_[i] = move(pendientes_.back());
-			pendientes_.pop_back();
+			//Los tramos de mensajes consecutivos se envían con una única llamada a sendmsg. Si les sigue un
+			//fichero, se indica que hay más datos para que su comienzo vaya en el mismo segmento
+			vector<struct iovec> segmentos;
+			unsigned int i = 0;
+			for (; (i < salida_.size()) && salida_[i].mensaje && (segmentos.size() < IOV_MAX); ++i)
+			{
+				struct iovec segmento;
+				segmento.iov_base = salida_[i].mensaje->obtener_inicio() + salida_[i].posicion;
+				segmento.iov_len = salida_[i].pendientes;
+				segmentos.push_back(segmento);
+			}
+			struct msghdr cabecera;
+			memset(&cabecera, 0, sizeof cabecera);
+			cabecera.msg_iov = &segmentos[0];
+			cabecera.msg_iovlen = segmentos.size();
+			int opciones = MSG_NOSIGNAL | MSG_DONTWAIT;
+			if (i < salida_.size() && salida_[i].fichero) opciones = opciones | MSG_MORE;
+			enviados = sendmsg(descriptor_socket_, &cabecera, opciones);
 		}
 		else
 		{
-			//Se comprueba si la confirmación ya ha sido retornada
-			if (pendientes_[i].wait_for(chrono::steady_clock::duration::zero()) == future_status::ready)
+			//Los bytes del fichero pasan directamente de la caché de páginas al socket. Si se acaban antes de
+			//tiempo, el fichero ha sido truncado: se termina la trama y se resincroniza al cliente
+			off_t posicion = salida_.front().posicion;
+			enviados = sendfile(descriptor_socket_, *salida_.front().fichero, &posicion, salida_.front().pendientes);
+			if (enviados == 0)
 			{
-				//En caso afirmativo, se comprueba si el envío correspondiente fue exitoso o falló
-				if (pendientes_[i].get() == false) fallo = true;
-				
-				//En cualquier caso, el retorno ya no está pendiente así que se elimina
-				pendientes_[i] = move(pendientes_.back());
-				pendientes_.pop_back();
+				completarTramaTruncada();
+				continue;
 			}
 		}
-	}
-	
-	//Si se ha detectado que alguno de los envíos pendientes ha fallado, se intrepreta que la conexión ha
-	//fallado y se devuelve false sin más intentos
-	if (fallo) return false;
-	
-	//Se dispara el envío asíncrono registrando el retorno futuro en pendientes_
-	pendientes_.push_back(async(launch::async, []
-		(const int descriptorSocket, shared_ptr<Mensaje> msj)
+		
+		//Si el socket no admite más se conserva el resto para más adelante. Cualquier otro fallo se interpreta
+		//como un fallo de conexión
+		if (enviados < 0)
 		{
-			//La tarea asíncrona envía el mensaje a través del socket especificado
-			int enviados = 0;
-			char *siguiente = msj->obtener_inicio();
-			while (enviados < msj->obtener_longitud())
-			{
-				//Hasta que se haya enviado el contenido completo, se hacen llamadas send
-				enviados = send(descriptorSocket, siguiente, msj->obtener_longitud() - enviados, MSG_NOSIGNAL);
-				
-				//En caso de que la última llamada haya fallado, se asume un fallo de conexión y se termina
-				if (enviados < 0) return false;
-			}
-			
-			//Se termina la tarea correctamente
-			return true;
-			
-		}, descriptor_socket_, move(mensaje)));
+			if (errno == EINTR) continue;
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) return false;
+			lleno = true;
+			continue;
+		}
 		
-	//Se termina la funcion en true
+		//Se retiran los tramos enviados por completo y, si el último lo ha sido sólo en parte, se ajusta para
+		//continuar por donde se quedó
+		while (enviados > 0)
+		{
+			Tramo& tramo = salida_.front();
+			size_t parte = ((size_t) enviados < tramo.pendientes) ? enviados : tramo.pendientes;
+			tramo.posicion = tramo.posicion + parte;
+			tramo.pendientes = tramo.pendientes - parte;
+			if (tramo.acotado) bytes_acotados_ = bytes_acotados_ - parte;
+			enviados = enviados - parte;
+			if (tramo.pendientes == 0) salida_.pop_front();
+		}
+	}
+	envios_pendientes_ = !salida_.empty();
 	return true;
 }
 
-void Cliente::terminarConexion (void)
+void Cliente::completarTramaTruncada (void)
 {
-	//Se chequea si el descriptor de socket es válido (y por tanto corresponde a una conexión abierta)
-	if (descriptor_socket_ >= 0)
+	//La trama termina en cualquier caso donde anunció su cabecera, y la siguiente, vacía, indica dónde termina
+	//ahora el fichero: al ser anterior al final de lo recibido, el cliente descarta lo que sigue a esa posición
+	Tramo tramo = salida_.front();
+	salida_.pop_front();
+	struct stat estado;
+	long long final = tramo.posicion;
+	if ((fstat(*tramo.fichero, &estado) == 0) && (estado.st_size < final)) final = estado.st_size;
+	string relleno (tramo.pendientes, '\0');
+	string cierre = Codificador::generarCabeceraCruda(*tramo.ruta, final, 0);
+	salida_.push_front(Tramo {make_shared<Mensaje>(cierre.data(), cierre.length()), nullptr, nullptr, 0,
+		cierre.length(), false});
+	salida_.push_front(Tramo {make_shared<Mensaje>(relleno.data(), relleno.length()), nullptr, nullptr, 0,
+		relleno.length(), tramo.acotado});
+}
+
+bool Cliente::esperarEnvios (const std::chrono::steady_clock::time_point& limite)
+{
+	//Se continúan los envíos hasta vaciar la cola, esperando entre intentos a que el socket admita más
+	while (true)
 	{
-		//En caso afirmativo, se cierra el socket terminando la conexión
-		close(descriptor_socket_);
-		descriptor_socket_ = -1;
+		if (!continuarEnvios()) return false;
+		if (salida_.empty()) return true;
+		chrono::steady_clock::duration restante = limite - chrono::steady_clock::now();
+		if (restante <= chrono::steady_clock::duration::zero()) return false;
+		struct pollfd espera;
+		espera.fd = descriptor_socket_;
+		espera.events = POLLOUT;
+		poll(&espera, 1, chrono::duration_cast<chrono::milliseconds>(restante).count() + 1);
+	}
+}
+
+void Cliente::confirmar (const unsigned long long secuencia)
+{
+	//Los mensajes en vuelo están ordenados por secuencia, por lo que se retiran desde el principio
+	while (!en_vuelo_.empty() && (en_vuelo_.front().first <= secuencia))
+	{
+		bytes_en_vuelo_ = bytes_en_vuelo_ - en_vuelo_.front().second;
+		en_vuelo_.pop_front();
 	}
+	confirmando_ = true;
+}
+
+void Cliente::anotarEnvio (const unsigned long long secuencia, const unsigned int longitud)
+{
+	en_vuelo_.push_back(make_pair(secuencia, longitud));
+	bytes_en_vuelo_ = bytes_en_vuelo_ + longitud;
+}
+
+bool Cliente::reflejaFichero (const std::string& ruta)
+{
+	for (unsigned int i = 0; i < reflejados_.size(); ++i)
+		if (reflejados_[i] == ruta) return true;
+	return false;
+}
+
+void Cliente::anadirReflejo (const std::string& ruta)
+{
+	if (!reflejaFichero(ruta)) reflejados_.push_back(ruta);
+}
+
+bool Cliente::encolar (std::vector<Tramo>& tramos)
+{
+	//Se chequea si el socket es válido
+	if (descriptor_socket_ < 0) return false;
+	
+	//Si ya había envíos pendientes, el socket está lleno y el hilo que vacía la cola ya lo sabe: basta con
+	//añadir los tramos tras ellos, salvo que el cliente se haya retrasado demasiado
+	size_t acotados = 0;
+	for (unsigned int i = 0; i < tramos.size(); ++i)
+		if (tramos[i].acotado) acotados = acotados + tramos[i].pendientes;
+	bool esperaban = !salida_.empty();
+	if (esperaban && (bytes_acotados_ + acotados > MAX_BYTES_EN_COLA_)) return false;
+	for (unsigned int i = 0; i < tramos.size(); ++i) salida_.push_back(move(tramos[i]));
+	bytes_acotados_ = bytes_acotados_ + acotados;
+	if (esperaban) return true;
+	
+	//En caso contrario se envía lo que el socket admite y, si queda algo, se avisa al hilo que vacía la cola
+	if (!continuarEnvios()) return false;
+	if (!salida_.empty() && aviso_) aviso_();
+	return true;
 }
 
 } //namespace lognotify
\ No newline at end of file
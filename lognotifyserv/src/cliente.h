@@ -7,9 +7,16 @@
 #ifndef _cliente_h_
 #define _cliente_h_
 
+#include <sys/uio.h>
 #include <memory>
 #include <vector>
-#include <future>
+#include <deque>
+#include <utility>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <functional>
 
 #include "mensaje.h"
 #include "evento.h"
@@ -21,7 +28,12 @@ namespace lognotify
 * Cada Cliente es una abstracción de una conexión con un cliente del sistema, que permite enviar objetos de
 * tipo Mensaje a dicho cliente a través de la conexión TCP/IP creada. Crear y aceptar dicha conexión no es
 * responsabilidad de la clase Cliente; una vez creada la conexión, el descriptor de fichero del socket será
-* pasado al constructor de esta clase para crear la abstracción del cliente en torno al mismo
+* pasado al constructor de esta clase para crear la abstracción del cliente en torno al mismo.
+* Los envíos nunca bloquean: lo que el socket no admite en el momento queda en una cola de salida propia del
+* cliente, que vacía más tarde el TrabajadorDeDifusion de su partición a medida que el socket lo admite (ver
+* continuarEnvios). Así un cliente lento no detiene los envíos a los demás ni requiere un hilo propio.
+* Cada Cliente dispone de un mutex propio (ver bloquear y desbloquear) que debe adquirirse para acceder a él
+* desde varios hilos, de forma que operar sobre un cliente no bloquee a los demás
 */
 class Cliente
 {
@@ -34,14 +46,58 @@ class Cliente
 	Cliente (const int descriptorSocket);
 	
 	/**
-	* Envía el Evento especificado al cliente. El mensaje es enviado de forma asíncrona, de forma que una
-	* vez que se ha llamado a esta función el mensaje queda en proceso de ser enviado a su destino, pero esto
-	* puede ocurrir de forma no inmediata. La ejecución puede continuar normalmente como si el mensaje hubiera
-	* sido enviado (lo que ocurrirá tan pronto como sea posible)
+	* Adquiere el mutex del cliente, bloqueando hasta conseguirlo
+	*/
+	inline void bloquear (void) { mutex_.lock(); }
+	
+	/**
+	* Libera el mutex del cliente
+	*/
+	inline void desbloquear (void) { mutex_.unlock(); }
+	
+	/**
+	* Envía el Mensaje especificado al cliente. Lo que el socket admite sin bloquear se envía de inmediato, y
+	* el resto queda en la cola de salida del cliente, de forma que la ejecución puede continuar normalmente como
+	* si el mensaje hubiera sido enviado (lo que ocurrirá tan pronto como sea posible). Los mensajes llegan al
+	* cliente en el mismo orden en que se envían
 	* @param mensaje Mensaje que desea enviarse
 	* @return false si se detecta que la conexión ha fallado, true en caso contrario
 	*/
 	bool enviar (std::shared_ptr<Mensaje> mensaje);
+	
+	/**
+	* Envía una serie de mensajes al cliente, en el orden especificado y sin bloquear como en el caso de un
+	* único Mensaje. Los mensajes se envían directamente desde sus buffers, sin copiarlos a uno común
+	* @param mensajes Mensajes que desean enviarse
+	* @return false si se detecta que la conexión ha fallado, true en caso contrario
+	*/
+	bool enviar (const std::vector<std::shared_ptr<Mensaje>>& mensajes);
+	
+	/**
+	* Envía al cliente eventos tomados del AnilloDeReenvio, como enviar, pero sin contarlos para el límite de la
+	* cola de salida, pues el propio anillo acota su número
+	* @param mensajes Mensajes que desean enviarse
+	* @return false si se detecta que la conexión ha fallado, true en caso contrario
+	*/
+	bool reenviar (const std::vector<std::shared_ptr<Mensaje>>& mensajes);
+	
+	/**
+	* Envía al cliente un rango de bytes de un fichero dividido en tramas, cada una precedida de su cabecera, sin
+	* bloquear y en orden con el resto de mensajes como en enviar. Los bytes pasan directamente del fichero al
+	* socket (sendfile), sin copiarse en memoria del proceso. Si el fichero se trunca antes de enviarlos todos,
+	* la trama se completa con ceros, pues su cabecera ya anunció su longitud, y le sigue una trama vacía en la
+	* posición en que termina ahora el fichero, con la que el cliente se resincroniza (ver
+	* TablaDeClientes::reflejarFichero)
+	* @param ruta Ruta del fichero que figura en las tramas
+	* @param tramas Posición en el fichero del primer byte de cada trama y cabecera que lo precede, en orden
+	* @param fichero Descriptor del fichero abierto, que se cierra cuando ya no lo necesita ningún envío
+	* @param hasta Posición en el fichero siguiente al último byte de la última trama
+	* @return false si se detecta que la conexión ha fallado, true en caso contrario
+	*/
+	bool enviarFichero (	std::shared_ptr<const std::string> ruta,
+							const std::vector<std::pair<long long, std::string>>& tramas,
+							std::shared_ptr<const int> fichero,
+							const long long hasta	);
 		
 	/**
 	* Termina la conexión con el cliente si esta aún está vigente y cierra el socket de conexión.
@@ -51,11 +107,359 @@ class Cliente
 	*/
 	void terminarConexion (void);
 	
+	/**
+	* Envía lo que el socket admite sin bloquear de la cola de salida del cliente
+	* @return false si la conexión ha fallado, true en caso contrario (aunque queden envíos pendientes)
+	*/
+	bool continuarEnvios (void);
+	
+	/**
+	* Indica si la cola de salida del cliente tiene envíos pendientes. Puede consultarse sin adquirir el mutex
+	* del cliente, para no adquirirlo cuando no hay nada que enviar
+	* @return true si quedan envíos pendientes, false en caso contrario
+	*/
+	inline bool obtener_envios_pendientes (void) { return envios_pendientes_.load(); }
+	
+	/**
+	* Establece la función a la que se llama cuando un envío no cabe en el socket y queda pendiente en la cola
+	* de salida, que debe despertar al hilo que la vacía (ver TrabajadorDeDifusion::despertar)
+	* @param aviso Función de aviso
+	*/
+	inline void establecer_aviso (std::function<void(void)> aviso) { aviso_ = std::move(aviso); }
+	
+	/**
+	* Devuelve el descriptor de fichero del socket correspondiente a la conexión con el cliente
+	* @return Descriptor de fichero del socket, o un valor negativo si la conexión ya ha sido terminada
+	*/
+	inline int obtener_descriptor (void) { return descriptor_socket_; }
+	
+	/**
+	* Devuelve el identificador en el MotorDeSuscripciones del Filtro que el cliente ha subido al servidor
+	* @return Identificador del Filtro del cliente. Será negativo si el cliente no ha subido ninguno, en cuyo
+	* caso deben enviársele todos los eventos
+	*/
+	inline int obtener_filtro (void) { return filtro_; }
+	
+	/**
+	* Establece el Filtro que decide qué eventos se envían al cliente
+	* @param filtro Identificador en el MotorDeSuscripciones del Filtro del cliente, o un valor negativo para
+	* enviarle todos los eventos
+	*/
+	inline void establecer_filtro (const int filtro) { filtro_ = filtro; }
+	
+	/**
+	* Indica si el cliente ha solicitado recibir los eventos con su número de secuencia, es decir, si se le
+	* envían los mensajes completos, incluida su cabecera
+	* @return true si se envían al cliente los mensajes con cabecera, false en caso contrario
+	*/
+	inline bool obtener_secuenciado (void) { return secuenciado_; }
+	
+	/**
+	* Establece si se envían al cliente los mensajes completos, incluida su cabecera con el número de secuencia
+	* @param secuenciado true para enviar los mensajes con cabecera, false para enviarlos sin ella
+	*/
+	inline void establecer_secuenciado (const bool secuenciado) { secuenciado_ = secuenciado; }
+	
+	/**
+	* Devuelve el formato en que se envían al cliente los mensajes con número de secuencia (ver Codificador)
+	* @return Formato de los mensajes enviados al cliente
+	*/
+	inline unsigned int obtener_formato (void) { return formato_; }
+	
+	/**
+	* Establece el formato en que se envían al cliente los mensajes con número de secuencia
+	* @param formato Formato de los mensajes enviados al cliente (ver Codificador)
+	*/
+	inline void establecer_formato (const unsigned int formato) { formato_ = formato; }
+	
+	/**
+	* Indica si el cliente recibe los eventos por multidifusión, en cuyo caso por su conexión sólo se le envían
+	* los que solicita para reparar los datagramas perdidos
+	* @return true si el cliente recibe los eventos por multidifusión, false en caso contrario
+	*/
+	inline bool obtener_multidifusion (void) { return multidifusion_; }
+	
+	/**
+	* Establece si el cliente recibe los eventos por multidifusión
+	* @param multidifusion true si el cliente recibe los eventos por multidifusión, false si por su conexión
+	*/
+	inline void establecer_multidifusion (const bool multidifusion) { multidifusion_ = multidifusion; }
+	
+	/**
+	* Indica si el cliente entiende el origen con que un repetidor precede la ubicación de los eventos que
+	* reenvía de otros servidores. A los demás se les envían sin él
+	* @return true si el cliente recibe la ubicación de los eventos precedida de su origen, false en caso contrario
+	*/
+	inline bool obtener_origenes (void) { return origenes_; }
+	
+	/**
+	* Establece si el cliente entiende el origen de los eventos reenviados por un repetidor
+	* @param origenes true si el cliente recibe la ubicación de los eventos precedida de su origen
+	*/
+	inline void establecer_origenes (const bool origenes) { origenes_ = origenes; }
+	
+	/**
+	* Devuelve el número de secuencia del último evento difundido antes de la conexión del cliente. Los
+	* eventos posteriores se le envían directamente (si su filtro los deja pasar) una vez que ha decidido cómo
+	* recibirlos
+	* @return Número de secuencia del último evento anterior a la conexión. Mientras no se haya establecido,
+	* es el mayor posible, de forma que no se le envía ningún evento
+	*/
+	inline unsigned long long obtener_secuencia_de_alta (void) { return secuencia_de_alta_; }
+	
+	/**
+	* Establece el número de secuencia del último evento difundido antes de la conexión del cliente, que es
+	* también el último tratado para él
+	* @param secuencia Número de secuencia del último evento anterior a la conexión
+	*/
+	inline void establecer_secuencia_de_alta (const unsigned long long secuencia)
+	{
+		secuencia_de_alta_ = secuencia;
+		cursor_ = secuencia;
+	}
+	
+	/**
+	* Indica si todavía se espera a que el cliente decida cómo recibir los eventos (ver
+	* TablaDeClientes::reanudarCliente), en cuyo caso no se le envía ninguno hasta entonces
+	* @return true si se espera la decisión del cliente, false en caso contrario
+	*/
+	inline bool obtener_en_espera (void) { return en_espera_; }
+	
+	/**
+	* Establece si se espera a que el cliente decida cómo recibir los eventos
+	* @param en_espera true para comenzar la espera, false para terminarla
+	*/
+	inline void establecer_en_espera (const bool en_espera) { en_espera_ = en_espera; }
+	
+	/**
+	* Retiene un evento difundido mientras se espera a que el cliente decida cómo recibir los eventos, de forma
+	* que pueda enviársele cuando termine la espera aunque el anillo de reenvío ya no lo conserve
+	* @param secuencia Número de secuencia del evento
+	* @param mensaje Mensaje del evento, sin codificar
+	* @return false si los eventos retenidos ocupan ya más de MAX_BYTES_EN_COLA_ bytes, en cuyo caso debe
+	* terminarse la espera sin aguardar más al cliente; true en caso contrario
+	*/
+	bool retener (const unsigned long long secuencia, std::shared_ptr<Mensaje> mensaje);
+	
+	/**
+	* Toma los eventos retenidos durante la espera, que dejan de estarlo
+	* @return Número de secuencia y mensaje de cada evento retenido, en orden de secuencia
+	*/
+	std::vector<std::pair<unsigned long long, std::shared_ptr<Mensaje>>> tomarRetenidos (void);
+	
+	/**
+	* Indica si el cliente confirma los eventos que procesa, en cuyo caso los bytes enviados y todavía no
+	* confirmados (en vuelo) se limitan a una ventana, y los eventos que no caben se le envían más tarde
+	* @return true si el cliente ha confirmado algún evento, false en caso contrario
+	*/
+	inline bool obtener_confirmando (void) { return confirmando_; }
+	
+	/**
+	* Registra la confirmación del cliente de haber procesado los eventos hasta el número de secuencia
+	* indicado, dejando de contar como en vuelo los enviados hasta él. La primera confirmación activa el
+	* control de flujo del cliente
+	* @param secuencia Número de secuencia del último evento procesado por el cliente
+	*/
+	void confirmar (const unsigned long long secuencia);
+	
+	/**
+	* Anota el envío de un Mensaje con número de secuencia al cliente, que queda en vuelo hasta su confirmación
+	* @param secuencia Número de secuencia del Mensaje enviado
+	* @param longitud Longitud en bytes del Mensaje enviado
+	*/
+	void anotarEnvio (const unsigned long long secuencia, const unsigned int longitud);
+	
+	/**
+	* Comprueba si un Mensaje cabe en la ventana de bytes en vuelo del cliente. Si no hay ninguno en vuelo, cabe
+	* siempre, para que un Mensaje mayor que la ventana no detenga los envíos indefinidamente
+	* @param longitud Longitud en bytes del Mensaje
+	* @param ventana Máximo de bytes en vuelo permitido
+	* @return true si el Mensaje puede enviarse ahora, false si debe esperar a nuevas confirmaciones
+	*/
+	inline bool cabeEnVentana (const unsigned int longitud, const unsigned long ventana)
+	{
+		return (bytes_en_vuelo_ == 0) || (bytes_en_vuelo_ + longitud <= ventana);
+	}
+	
+	/**
+	* Devuelve el número de secuencia del último evento ya tratado para el cliente (enviado u omitido por su
+	* filtro). Cuando se aplica control de flujo, los posteriores están pendientes de enviarle
+	* @return Número de secuencia del último evento tratado
+	*/
+	inline unsigned long long obtener_cursor (void) { return cursor_; }
+	
+	/**
+	* Establece el número de secuencia del último evento ya tratado para el cliente
+	* @param cursor Número de secuencia del último evento tratado
+	*/
+	inline void establecer_cursor (const unsigned long long cursor) { cursor_ = cursor; }
+	
+	/**
+	* Devuelve las reglas de filtrado subidas por el cliente, tal como las envió
+	* @return Texto de las reglas de filtrado, o cadena vacía si no ha subido ninguna
+	*/
+	inline std::string obtener_reglas (void) { return reglas_; }
+	
+	/**
+	* Establece las reglas de filtrado subidas por el cliente, a partir de las que se ha registrado su Filtro
+	* @param reglas Texto de las reglas de filtrado
+	*/
+	inline void establecer_reglas (const std::string& reglas) { reglas_ = reglas; }
+	
+	/**
+	* Devuelve la orden que el cliente había enviado sólo en parte cuando se detuvo la recepción de sus órdenes
+	* (ver Relevo), tal como se recibió
+	* @return Bytes recibidos de la orden incompleta
+	*/
+	inline std::string obtener_orden_pendiente (void) { return orden_pendiente_; }
+	
+	/**
+	* Indica si el cliente enviaba latidos cuando se detuvo la recepción de sus órdenes
+	* @return true si el cliente enviaba latidos, false en caso contrario
+	*/
+	inline bool obtener_latiendo (void) { return latiendo_; }
+	
+	/**
+	* Anota el estado de la recepción de las órdenes del cliente al detenerse, para que pueda continuar en otra
+	* ejecución del servidor
+	* @param ordenPendiente Bytes recibidos de la orden que el cliente había enviado sólo en parte
+	* @param latiendo Indica si el cliente enviaba latidos
+	*/
+	inline void anotarOrdenPendiente (const std::string& ordenPendiente, const bool latiendo)
+	{
+		orden_pendiente_ = ordenPendiente;
+		latiendo_ = latiendo;
+	}
+	
+	/**
+	* Completa los envíos pendientes en la cola de salida del cliente, esperando a que el socket los admita
+	* @param limite Instante hasta el que esperar como máximo
+	* @return true si todos los envíos han terminado con éxito, false si alguno ha fallado o no ha terminado a
+	* tiempo
+	*/
+	bool esperarEnvios (const std::chrono::steady_clock::time_point& limite);
+	
+	/**
+	* Indica si el cliente refleja ficheros en crudo, en cuyo caso sólo se le envían los bytes añadidos a ellos
+	* y ningún evento
+	* @return true si el cliente refleja algún fichero, false en caso contrario
+	*/
+	inline bool obtener_crudo (void) { return !reflejados_.empty(); }
+	
+	/**
+	* Devuelve las rutas de los ficheros que refleja el cliente
+	* @return Rutas de los ficheros reflejados, relativas al directorio de ficheros de registro
+	*/
+	inline std::vector<std::string> obtener_reflejados (void) { return reflejados_; }
+	
+	/**
+	* Indica si el cliente refleja un fichero
+	* @param ruta Ruta del fichero, relativa al directorio de ficheros de registro
+	* @return true si el cliente refleja el fichero, false en caso contrario
+	*/
+	bool reflejaFichero (const std::string& ruta);
+	
+	/**
+	* Añade un fichero a los que refleja el cliente, si no lo reflejaba ya
+	* @param ruta Ruta del fichero, relativa al directorio de ficheros de registro
+	*/
+	void anadirReflejo (const std::string& ruta);
+	
+	/**
+	* Devuelve los agregados a los que está suscrito el cliente (ver AgregadorDeMetricas), en el orden en que
+	* los solicitó, que es el índice con que se identifica cada uno en sus medidas
+	* @return Identificador en el AgregadorDeMetricas y definición, tal como la envió el cliente, de cada agregado
+	*/
+	inline std::vector<std::pair<int, std::string>> obtener_agregados (void) { return agregados_; }
+	
+	/**
+	* Suscribe al cliente a un agregado más
+	* @param identificador Identificador del agregado en el AgregadorDeMetricas
+	* @param definicion Definición del agregado, tal como la envió el cliente
+	*/
+	inline void anadirAgregado (const int identificador, const std::string& definicion)
+	{
+		agregados_.push_back(std::make_pair(identificador, definicion));
+	}
+	
+	/**
+	* Anula todas las suscripciones del cliente a agregados
+	*/
+	inline void vaciarAgregados (void) { agregados_.clear(); }
+	
+	/**
+	* Indica si el cliente recibe periódicamente el resumen de las plantillas de las líneas (ver
+	* MinadorDePlantillas)
+	* @return true si el cliente recibe los resúmenes, false en caso contrario
+	*/
+	inline bool obtener_resumido (void) { return resumido_; }
+	
+	/**
+	* Establece si el cliente recibe periódicamente el resumen de las plantillas de las líneas
+	* @param resumido true si el cliente recibe los resúmenes, false en caso contrario
+	*/
+	inline void establecer_resumido (const bool resumido) { resumido_ = resumido; }
+	
 	private:
 	
+	/**
+	* Tramo de la cola de salida: bytes pendientes de enviar de un Mensaje o de un fichero
+	*/
+	struct Tramo
+	{
+		std::shared_ptr<Mensaje> mensaje;	///< Mensaje cuyos bytes se envían, o nulo si son de un fichero
+		std::shared_ptr<const int> fichero;	///< Descriptor del fichero cuyos bytes se envían
+		std::shared_ptr<const std::string> ruta;	///< Ruta del fichero que figura en sus tramas
+		long long posicion;					///< Posición del siguiente byte pendiente en el Mensaje o el fichero
+		size_t pendientes;					///< Número de bytes pendientes de enviar
+		bool acotado;						///< Indica si el tramo cuenta para el límite de la cola de salida
+	};
+	
+	/**
+	* Encola los tramos de un envío en la cola de salida y, si no había otros pendientes antes, envía lo que el
+	* socket admite. Si queda algo pendiente, avisa al hilo que vacía la cola. Un cliente al día admite un envío
+	* de cualquier tamaño, pero si ya tenía envíos pendientes y con éste pasaría de MAX_BYTES_EN_COLA_ bytes
+	* acotados, se da la conexión por fallida: un cliente que no lee no acumula memoria indefinidamente
+	* @param tramos Tramos del envío, en orden
+	* @return false si la conexión ha fallado o el cliente se ha retrasado demasiado, true en caso contrario
+	*/
+	bool encolar (std::vector<Tramo>& tramos);
+	
+	/**
+	* Sustituye el tramo de fichero al frente de la cola de salida, cuyo fichero se ha truncado, por ceros hasta
+	* completar la trama, seguidos de una trama vacía en la posición en que termina ahora el fichero
+	*/
+	void completarTramaTruncada (void);
+	
+	//Constantes
+	constexpr static size_t MAX_BYTES_EN_COLA_ = 262144;	///< Máximo de bytes acotados pendientes en la cola
+	
 	//Variables miembro
 	int descriptor_socket_;		///< Descriptor de fichero del socket correspondiente a la conexión al cliente
-	std::vector<std::future<bool>> pendientes_;	///< Confirmaciones de envío pendientes de recibir
+	int filtro_;				///< Identificador del Filtro subido por el cliente (negativo si no hay ninguno)
+	bool secuenciado_;			///< Indica si se envían al cliente los mensajes con su cabecera
+	unsigned int formato_;		///< Formato de los mensajes con secuencia enviados al cliente
+	bool multidifusion_;		///< Indica si el cliente recibe los eventos por multidifusión
+	bool origenes_;				///< Indica si el cliente entiende el origen de los eventos reenviados
+	unsigned long long secuencia_de_alta_;	///< Secuencia del último evento anterior a la conexión del cliente
+	bool en_espera_;			///< Indica si se espera a que el cliente decida cómo recibir los eventos
+	std::vector<std::pair<unsigned long long, std::shared_ptr<Mensaje>>> retenidos_;	///< Eventos retenidos
+	size_t bytes_retenidos_;	///< Bytes de los eventos retenidos
+	bool confirmando_;			///< Indica si el cliente confirma los eventos procesados (control de flujo)
+	unsigned long long cursor_;	///< Secuencia del último evento tratado para el cliente
+	unsigned long bytes_en_vuelo_;	///< Bytes enviados al cliente y todavía no confirmados
+	std::deque<std::pair<unsigned long long, unsigned int>> en_vuelo_;	///< Mensajes en vuelo (secuencia, bytes)
+	std::string reglas_;		///< Reglas de filtrado subidas por el cliente
+	std::string orden_pendiente_;	///< Orden incompleta al detenerse la recepción de sus órdenes
+	bool latiendo_;				///< Indica si el cliente enviaba latidos al detenerse la recepción de sus órdenes
+	std::vector<std::string> reflejados_;	///< Ficheros que el cliente refleja en crudo
+	std::vector<std::pair<int, std::string>> agregados_;	///< Agregados a los que está suscrito el cliente
+	bool resumido_;				///< Indica si el cliente recibe los resúmenes de plantillas
+	std::deque<Tramo> salida_;	///< Cola de salida: tramos pendientes de enviar, en orden
+	size_t bytes_acotados_;		///< Bytes pendientes en la cola de salida que cuentan para su límite
+	std::atomic<bool> envios_pendientes_;	///< Indica si la cola de salida tiene envíos pendientes
+	std::function<void(void)> aviso_;	///< Aviso al hilo que vacía la cola de salida cuando queda algo pendiente
+	std::mutex mutex_;			///< Mutex para permitir acceso concurrente seguro al cliente
 };
 
 } //namespace lognotify
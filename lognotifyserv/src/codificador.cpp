@@ -0,0 +1,213 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "codificador.h"
+
+#include <zlib.h>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+#include "mensaje.h"
+#include "analizador_de_syslog.h"
+#include "extractor_de_json.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int Codificador::FORMATO_TEXTO;
+constexpr unsigned int Codificador::FORMATO_BINARIO;
+constexpr unsigned int Codificador::FORMATO_COMPRIMIDO;
+constexpr unsigned int Codificador::FORMATO_ESTRUCTURADO;
+constexpr unsigned int Codificador::NUMERO_DE_FORMATOS;
+constexpr unsigned char Codificador::TIPO_PLANO;
+constexpr unsigned char Codificador::TIPO_COMPRIMIDO;
+constexpr unsigned char Codificador::TIPO_CRUDO;
+constexpr unsigned char Codificador::TIPO_ESTRUCTURADO;
+constexpr unsigned int Codificador::MIEMBROS_POR_LINEA_;
+constexpr unsigned int Codificador::VARIANTE_SIN_ORIGEN_;
+
+bool Codificador::interpretarFormato (const std::string& nombre, unsigned int& formato)
+{
+	if (nombre == "texto") formato = FORMATO_TEXTO;
+	else if (nombre == "binario") formato = FORMATO_BINARIO;
+	else if (nombre == "comprimido") formato = FORMATO_COMPRIMIDO;
+	else if (nombre == "estructurado") formato = FORMATO_ESTRUCTURADO;
+	else return false;
+	return true;
+}
+
+std::shared_ptr<Mensaje> Codificador::codificar (	const std::shared_ptr<Mensaje>& mensaje,
+													const unsigned int formato,
+													const bool conOrigen	)
+{
+	//Los clientes que no entienden el origen reciben la variante sin él, que conserva sus propias codificaciones
+	unsigned int posicion;
+	if (!conOrigen && (localizarOrigen(*mensaje, posicion) > 0))
+		return codificar(mensaje->obtener_codificacion(VARIANTE_SIN_ORIGEN_, &Codificador::retirarOrigen), formato);
+	
+	//Los mensajes se serializan en el formato de texto; el resto de formatos se generan a partir de él la
+	//primera vez que algún cliente los necesita, y se conservan junto al mensaje para los siguientes
+	if (formato == FORMATO_TEXTO) return mensaje;
+	return mensaje->obtener_codificacion(formato, &Codificador::generarTrama);
+}
+
+unsigned int Codificador::localizarOrigen (Mensaje& mensaje, unsigned int& posicion)
+{
+	//La ubicación es el segundo campo tras la cabecera. Los eventos de control, con el nombre vacío, y los
+	//producidos en este servidor, cuya ubicación es una ruta absoluta, no tienen origen
+	const char *inicio = mensaje.obtener_inicio();
+	const char *fin = inicio + mensaje.obtener_longitud();
+	const char *nombre = inicio + mensaje.obtener_longitud_cabecera();
+	const char *ubicacion = (nombre < fin) ? (const char*) memchr(nombre, '\0', fin - nombre) : nullptr;
+	if ((ubicacion == nullptr) || (ubicacion == nombre) || (++ubicacion >= fin) || (*ubicacion == '/')) return 0;
+	
+	//El origen termina en el primer ':' seguido de la ruta absoluta
+	const char *final = (const char*) memchr(ubicacion, '\0', fin - ubicacion);
+	if (final == nullptr) return 0;
+	for (const char *caracter = ubicacion; caracter + 1 < final; ++caracter)
+	{
+		if ((caracter[0] == ':') && (caracter[1] == '/'))
+		{
+			posicion = ubicacion - inicio;
+			return caracter + 1 - ubicacion;
+		}
+	}
+	return 0;
+}
+
+Mensaje Codificador::retirarOrigen (Mensaje& mensaje, const unsigned int)
+{
+	//Se copia el mensaje saltando el origen, sin alterar la cabecera
+	unsigned int posicion = 0;
+	unsigned int longitud_origen = localizarOrigen(mensaje, posicion);
+	string buffer (mensaje.obtener_inicio(), posicion);
+	buffer.append(	mensaje.obtener_inicio() + posicion + longitud_origen,
+					mensaje.obtener_longitud() - posicion - longitud_origen	);
+	return Mensaje(&buffer[0], buffer.length(), mensaje.obtener_longitud_cabecera());
+}
+
+std::string Codificador::generarCabeceraCruda (	const std::string& ruta,
+												const unsigned long long posicion,
+												const unsigned int longitud	)
+{
+	//La longitud de la trama incluye los bytes del fichero, que no forman parte de la cabecera
+	string cabecera;
+	cabecera.reserve(17 + ruta.length());
+	anadirNumero(cabecera, 1 + 8 + 4 + ruta.length() + longitud, 4);
+	cabecera.push_back((char) TIPO_CRUDO);
+	anadirNumero(cabecera, posicion, 8);
+	anadirNumero(cabecera, ruta.length(), 4);
+	cabecera.append(ruta);
+	return cabecera;
+}
+
+Mensaje Codificador::generarTrama (Mensaje& mensaje, const unsigned int formato)
+{
+	//Se localizan los cuatro campos del mensaje de texto: secuencia, nombre, ubicación y descripción. Los que
+	//falten (en un mensaje mal formado) se consideran vacíos
+	const char *campos [4];
+	unsigned int longitudes [4];
+	const char *inicio = mensaje.obtener_inicio();
+	const char *fin = inicio + mensaje.obtener_longitud();
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		const char *separador = (const char*) memchr(inicio, '\0', fin - inicio);
+		if (separador == nullptr) separador = fin;
+		campos[i] = inicio;
+		longitudes[i] = separador - inicio;
+		inicio = (separador < fin) ? separador + 1 : fin;
+	}
+	
+	//Se compone el cuerpo de la trama: la secuencia como número y cada campo precedido de su longitud
+	string cuerpo;
+	cuerpo.reserve(8 + 12 + longitudes[1] + longitudes[2] + longitudes[3]);
+	anadirNumero(cuerpo, strtoull(string(campos[0], longitudes[0]).c_str(), nullptr, 10), 8);
+	for (unsigned int i = 1; i < 4; ++i)
+	{
+		anadirNumero(cuerpo, longitudes[i], 4);
+		cuerpo.append(campos[i], longitudes[i]);
+	}
+	
+	//En el formato estructurado, tras el cuerpo van los campos de syslog de cada línea de la descripción y los
+	//miembros JSON de su mensaje, con sus posiciones relativas al comienzo de ésta
+	unsigned char tipo = TIPO_PLANO;
+	if (formato == FORMATO_ESTRUCTURADO)
+	{
+		const char *descripcion = campos[3];
+		const char *final = descripcion + longitudes[3];
+		unsigned int lineas = 1 + count(descripcion, final, '\n');
+		cuerpo.reserve(cuerpo.length() + 4 + lineas * (3 + 8 * AnalizadorDeSyslog::NUMERO_DE_CAMPOS));
+		anadirNumero(cuerpo, lineas, 4);
+		AnalizadorDeSyslog::Campos campos_linea;
+		ExtractorDeJson::Miembro miembros [MIEMBROS_POR_LINEA_];
+		const char *linea = descripcion;
+		for (unsigned int i = 0; i < lineas; ++i)
+		{
+			const char *fin_linea = (const char*) memchr(linea, '\n', final - linea);
+			if (fin_linea == nullptr) fin_linea = final;
+			AnalizadorDeSyslog::analizar(linea, fin_linea - linea, campos_linea);
+			cuerpo.push_back((char) campos_linea.formato);
+			cuerpo.push_back((char) ((campos_linea.prioridad >= 0) ? campos_linea.prioridad : 255));
+			for (unsigned int j = 0; j < AnalizadorDeSyslog::NUMERO_DE_CAMPOS; ++j)
+			{
+				anadirNumero(cuerpo, (linea - descripcion) + campos_linea.inicio[j], 4);
+				anadirNumero(cuerpo, campos_linea.longitud[j], 4);
+			}
+			size_t mensaje = (linea - descripcion) + campos_linea.inicio[AnalizadorDeSyslog::CAMPO_MENSAJE];
+			unsigned int numero = ExtractorDeJson::indexar(	descripcion + mensaje,
+															campos_linea.longitud[AnalizadorDeSyslog::CAMPO_MENSAJE],
+															miembros, MIEMBROS_POR_LINEA_	);
+			cuerpo.push_back((char) numero);
+			for (unsigned int j = 0; j < numero; ++j)
+			{
+				anadirNumero(cuerpo, mensaje + miembros[j].inicio_clave, 4);
+				anadirNumero(cuerpo, miembros[j].longitud_clave, 4);
+				anadirNumero(cuerpo, mensaje + miembros[j].inicio_valor, 4);
+				anadirNumero(cuerpo, miembros[j].longitud_valor, 4);
+			}
+			linea = (fin_linea < final) ? fin_linea + 1 : final;
+		}
+		tipo = TIPO_ESTRUCTURADO;
+	}
+	
+	//En el formato comprimido, el cuerpo se comprime si así ocupa menos. Se prima la velocidad, pues cada
+	//evento se comprime por separado y los más pequeños apenas se benefician
+	if (formato == FORMATO_COMPRIMIDO)
+	{
+		uLongf longitud_comprimida = compressBound(cuerpo.length());
+		string comprimido (4 + longitud_comprimida, '\0');
+		if ((compress2(	(Bytef*) &comprimido[4], &longitud_comprimida,
+						(const Bytef*) cuerpo.data(), cuerpo.length(), Z_BEST_SPEED) == Z_OK) &&
+			(4 + longitud_comprimida < cuerpo.length()))
+		{
+			string longitud_original;
+			anadirNumero(longitud_original, cuerpo.length(), 4);
+			comprimido.replace(0, 4, longitud_original);
+			comprimido.resize(4 + longitud_comprimida);
+			cuerpo.swap(comprimido);
+			tipo = TIPO_COMPRIMIDO;
+		}
+	}
+	
+	//Se antepone al cuerpo la longitud de la trama y su tipo
+	string trama;
+	trama.reserve(5 + cuerpo.length());
+	anadirNumero(trama, cuerpo.length() + 1, 4);
+	trama.push_back((char) tipo);
+	trama.append(cuerpo);
+	return Mensaje(trama.data(), trama.length());
+}
+
+void Codificador::anadirNumero (std::string& buffer, const unsigned long long numero, const unsigned int bytes)
+{
+	for (unsigned int i = bytes; i > 0; --i) buffer.push_back((char) ((numero >> (8 * (i - 1))) & 0xFF));
+}
+
+} //namespace lognotify
\ No newline at end of file
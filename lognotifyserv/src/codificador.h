@@ -0,0 +1,130 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _codificador_h_
+#define _codificador_h_
+
+#include <string>
+#include <memory>
+
+#include "mensaje.h"
+
+namespace lognotify
+{
+
+/**
+* El Codificador traduce los mensajes con número de secuencia, serializados en el formato de texto
+* "secuencia"\0"nombre"\0"ubicacion"\0"descripcion"\0, a los demás formatos que los clientes pueden solicitar
+* para su conexión (ver TablaDeClientes::establecerFormato). Cada codificación se genera una única vez por
+* mensaje y se conserva junto a él (ver Mensaje::obtener_codificacion), por lo que el coste de difundir un
+* evento crece con el número de formatos en uso, no con el de clientes.
+* En el formato binario cada mensaje es una trama: "longitud" (4 bytes, orden de red, de lo que sigue), "tipo"
+* (1 byte) y cuerpo. El cuerpo contiene la secuencia (8 bytes, orden de red) y el nombre, la ubicación y la
+* descripción, cada uno precedido de su longitud (4 bytes, orden de red). Con tipo TIPO_PLANO el cuerpo va tal
+* cual; con TIPO_COMPRIMIDO, comprimido con zlib y precedido de su longitud sin comprimir (4 bytes).
+* El formato comprimido utiliza las mismas tramas, comprimiendo cada cuerpo siempre que así ocupe menos.
+* El formato estructurado utiliza tramas de tipo TIPO_ESTRUCTURADO, cuyo cuerpo es el de TIPO_PLANO seguido de
+* los campos de syslog de cada línea de la descripción (ver AnalizadorDeSyslog), de forma que los clientes no
+* tengan que volver a interpretar el texto: el número de líneas (4 bytes, orden de red) y, por cada una, el
+* formato de su cabecera (1 byte), su prioridad (1 byte, 255 si no consta) y la posición y la longitud en la
+* descripción (4 bytes cada una, orden de red) de la fecha, el host, el programa, el pid, el tipo de mensaje,
+* los datos estructurados y el mensaje. Si el mensaje es un objeto JSON, siguen el número de sus miembros de
+* primer nivel (1 byte, como máximo MIEMBROS_POR_LINEA_) y, por cada uno, la posición y la longitud en la
+* descripción de su clave y de su valor (4 bytes cada una, orden de red), sin las comillas de las cadenas (ver
+* ExtractorDeJson); si no, el número es 0. Las líneas se analizan una única vez por evento, al generar la trama.
+* Los clientes que reflejan ficheros en crudo (ver TablaDeClientes::reflejarFichero) reciben tramas de tipo
+* TIPO_CRUDO, cuyo cuerpo es la posición en el fichero de los bytes que contiene (8 bytes, orden de red), la ruta
+* del fichero precedida de su longitud (4 bytes, orden de red) y los propios bytes, tal cual.
+*/
+class Codificador
+{
+	public:
+	
+	//Constantes
+	constexpr static unsigned int FORMATO_TEXTO = 0;		///< Formato de texto, separado por '\0' (por defecto)
+	constexpr static unsigned int FORMATO_BINARIO = 1;		///< Formato binario, con campos precedidos de su longitud
+	constexpr static unsigned int FORMATO_COMPRIMIDO = 2;	///< Formato binario con el cuerpo comprimido
+	constexpr static unsigned int FORMATO_ESTRUCTURADO = 3;	///< Formato binario con los campos de syslog
+	constexpr static unsigned int NUMERO_DE_FORMATOS = 4;	///< Número de formatos disponibles
+	constexpr static unsigned char TIPO_PLANO = 0;			///< Trama binaria con el cuerpo sin comprimir
+	constexpr static unsigned char TIPO_COMPRIMIDO = 1;		///< Trama binaria con el cuerpo comprimido con zlib
+	constexpr static unsigned char TIPO_CRUDO = 2;			///< Trama binaria con bytes de un fichero reflejado
+	constexpr static unsigned char TIPO_ESTRUCTURADO = 3;	///< Trama binaria con los campos de syslog
+	
+	/**
+	* Obtiene el formato correspondiente al nombre con que lo solicita un cliente
+	* @param nombre Nombre del formato: "texto", "binario", "comprimido" o "estructurado"
+	* @param formato Formato correspondiente, si el nombre es válido
+	* @return true si el nombre corresponde a un formato, false en caso contrario
+	*/
+	static bool interpretarFormato (const std::string& nombre, unsigned int& formato);
+	
+	/**
+	* Obtiene la codificación de un mensaje en un formato, generándola sólo si es la primera vez que se
+	* solicita para ese mensaje. A los clientes que no han indicado que entienden el origen de los eventos
+	* reenviados por un repetidor (ver Evento::obtener_ubicacion_completa) se les codifica la variante del
+	* mensaje sin él, que también se genera una única vez y se conserva junto al mensaje
+	* @param mensaje Mensaje en formato de texto, con número de secuencia
+	* @param formato Formato en que desea obtenerse
+	* @param conOrigen false si la ubicación no debe ir precedida del origen del evento
+	* @return El propio mensaje en el formato de texto, o su codificación en el formato indicado
+	*/
+	static std::shared_ptr<Mensaje> codificar (	const std::shared_ptr<Mensaje>& mensaje,
+												const unsigned int formato,
+												const bool conOrigen = true	);
+	
+	/**
+	* Genera la cabecera de una trama de tipo TIPO_CRUDO, a la que deben seguir los bytes del fichero
+	* @param ruta Ruta del fichero, relativa al directorio de ficheros de registro
+	* @param posicion Posición en el fichero del primer byte de la trama
+	* @param longitud Número de bytes del fichero que siguen a la cabecera
+	* @return Cabecera de la trama
+	*/
+	static std::string generarCabeceraCruda (const std::string& ruta, const unsigned long long posicion, const unsigned int longitud);
+	
+	private:
+	
+	/**
+	* Genera la trama binaria correspondiente a un mensaje en formato de texto
+	* @param mensaje Mensaje en formato de texto, con número de secuencia
+	* @param formato FORMATO_BINARIO, FORMATO_COMPRIMIDO o FORMATO_ESTRUCTURADO
+	* @return Trama binaria del mensaje
+	*/
+	static Mensaje generarTrama (Mensaje& mensaje, const unsigned int formato);
+	
+	/**
+	* Localiza en un mensaje en formato de texto el origen que precede a la ubicación de los eventos
+	* reenviados por un repetidor, "origen:ubicacion"
+	* @param mensaje Mensaje en formato de texto, con número de secuencia
+	* @param posicion Posición en el mensaje del comienzo de la ubicación, si la precede un origen
+	* @return Longitud del origen junto con el separador ':', o 0 si el mensaje no tiene origen
+	*/
+	static unsigned int localizarOrigen (Mensaje& mensaje, unsigned int& posicion);
+	
+	/**
+	* Genera la variante de un mensaje en formato de texto sin el origen que precede a su ubicación
+	* @param mensaje Mensaje en formato de texto, con número de secuencia y origen
+	* @param variante VARIANTE_SIN_ORIGEN_
+	* @return Mensaje con la ubicación sin su origen
+	*/
+	static Mensaje retirarOrigen (Mensaje& mensaje, const unsigned int variante);
+	
+	/**
+	* Añade a un buffer un número en orden de red (big endian)
+	* @param buffer Buffer al que se añade el número
+	* @param numero Número que desea añadirse
+	* @param bytes Número de bytes que ocupa en el buffer
+	*/
+	static void anadirNumero (std::string& buffer, const unsigned long long numero, const unsigned int bytes);
+	
+	//Constantes
+	constexpr static unsigned int MIEMBROS_POR_LINEA_ = 32;	///< Miembros JSON de cada línea en las tramas
+	constexpr static unsigned int VARIANTE_SIN_ORIGEN_ = NUMERO_DE_FORMATOS;	///< Variante conservada sin origen
+};
+
+} //namespace lognotify
+
+#endif //_codificador_h_
\ No newline at end of file
@@ -0,0 +1,83 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _condicion_h_
+#define _condicion_h_
+
+#include <string>
+
+namespace lognotify
+{
+
+/**
+* Una Condicion describe una condición de una Regla de un Filtro subido por un cliente: la comparación de uno
+* de los campos del Evento, o del valor de una clave de sus líneas JSON, con una expresión regular en formato
+* ECMAScript. A diferencia de su homónima de
+* lognotifycli, la Condicion del servidor no se evalúa por sí misma: las expresiones regulares se compilan y
+* evalúan en el MotorDeSuscripciones, que comparte cada una entre todas las condiciones que la utilizan
+*/
+class Condicion
+{
+	public:
+	
+	//Constantes públicas
+	constexpr static unsigned int CAMPO_FICHERO = 0;	///< Campo comparado: nombre del fichero
+	constexpr static unsigned int CAMPO_CONTENIDO = 1;	///< Campo comparado: contenido (descripción)
+	constexpr static unsigned int CAMPO_JSON = 2;		///< Campo comparado: valor de una clave de las líneas JSON
+	
+	/**
+	* Constructor de la clase Condicion
+	* @param campo Campo del Evento comparado con la expresión regular (constantes públicas CAMPO_XXXX)
+	* @param expresion Expresión regular en formato ECMAScript utilizada para evaluar la condición
+	* @param signo Si se desea que la condición evalúe a true cuando la expresión regular NO sea igual y a false
+	* cuando sí lo sea (es decir, negación lógica del resultado) introducir signo = false.
+	* @param clave Clave de las líneas JSON cuyo valor se compara, si el campo es CAMPO_JSON
+	*/
+	Condicion (	const unsigned int campo,
+				const std::string& expresion,
+				const bool signo,
+				const std::string& clave = ""	):
+		campo_(campo),
+		expresion_(expresion),
+		signo_(signo),
+		clave_(clave) {}
+	
+	/**
+	* Devuelve el campo del Evento comparado con la expresión regular
+	* @return Campo del Evento comparado (constantes públicas CAMPO_XXXX)
+	*/
+	inline unsigned int obtener_campo (void) const { return campo_; }
+	
+	/**
+	* Devuelve la expresión regular de la condición
+	* @return Expresión regular en formato ECMAScript
+	*/
+	inline const std::string& obtener_expresion (void) const { return expresion_; }
+	
+	/**
+	* Indica si la condición se cumple cuando la expresión regular es igual (true) o cuando NO lo es (false)
+	* @return Signo de la condición
+	*/
+	inline bool obtener_signo (void) const { return signo_; }
+	
+	/**
+	* Devuelve la clave de las líneas JSON cuyo valor se compara
+	* @return Clave comparada, o cadena vacía si el campo no es CAMPO_JSON
+	*/
+	inline const std::string& obtener_clave (void) const { return clave_; }
+	
+	private:
+	
+	//Variables miembro
+	unsigned int campo_;		///< Campo del Evento comparado con la expresión regular
+	std::string expresion_;		///< Expresión regular en formato ECMAScript utilizada para evaluar la condición
+	bool signo_;				///< Indica si la condición evalúa true cuando es igual (true) o cuando NO (false)
+	std::string clave_;			///< Clave de las líneas JSON comparada, si el campo es CAMPO_JSON
+};
+
+} //namespace lognotify
+
+#endif //_condicion_h_
\ No newline at end of file
@@ -0,0 +1,295 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "deduplicador_de_lineas.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+
+#include "evento.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int DeduplicadorDeLineas::ENTRADAS_POR_FICHERO_;
+
+//Constantes primas de xxHash64
+static const unsigned long long PRIMO_1 = 11400714785074694791ULL;
+static const unsigned long long PRIMO_2 = 14029467366897019727ULL;
+static const unsigned long long PRIMO_3 = 1609587929392839161ULL;
+static const unsigned long long PRIMO_4 = 9650029242287828579ULL;
+static const unsigned long long PRIMO_5 = 2870177450012600261ULL;
+
+static inline unsigned long long rotar (const unsigned long long valor, const unsigned int bits)
+{
+	return (valor << bits) | (valor >> (64 - bits));
+}
+
+static inline unsigned long long acumular (unsigned long long acumulador, const unsigned long long valor)
+{
+	acumulador = acumulador + valor * PRIMO_2;
+	return rotar(acumulador, 31) * PRIMO_1;
+}
+
+static inline unsigned long long leer64 (const char* datos)
+{
+	unsigned long long valor;
+	memcpy(&valor, datos, sizeof(valor));
+	return valor;
+}
+
+static inline unsigned long long leer32 (const char* datos)
+{
+	unsigned int valor;
+	memcpy(&valor, datos, sizeof(valor));
+	return valor;
+}
+
+void DeduplicadorDeLineas::configurar (const unsigned int segundos, const bool ignorarCifras)
+{
+	segundos_ = segundos;
+	ignorar_cifras_ = ignorarCifras;
+	tablas_.clear();
+}
+
+std::string DeduplicadorDeLineas::deduplicar (	const std::string& nombre,
+												const std::string& ubicacion,
+												const std::string& contenido	)
+{
+	//Se cierran las ventanas vencidas del fichero y se busca cada línea no vacía entre las últimas distintas del
+	//fichero. Cada línea del resultado se termina en '\n', y al final se retira el último
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	Tabla& tabla = obtenerTabla(nombre, ubicacion);
+	string resultado;
+	cerrarVentanas(tabla, ahora, resultado);
+	size_t inicio = 0;
+	while (inicio <= contenido.length())
+	{
+		size_t fin = contenido.find('\n', inicio);
+		if (fin == string::npos) fin = contenido.length();
+		if (!anotar(tabla, &contenido[inicio], fin - inicio, ahora, resultado))
+		{
+			resultado.append(contenido, inicio, fin - inicio);
+			resultado.push_back('\n');
+		}
+		inicio = fin + 1;
+	}
+	if (!resultado.empty()) resultado.pop_back();
+	return resultado;
+}
+
+std::string DeduplicadorDeLineas::deduplicar (	const std::string& nombre,
+												const std::string& ubicacion,
+												const std::vector<std::string>& registros	)
+{
+	//Se procede como con las líneas, pero cada registro cuenta como una unidad
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	Tabla& tabla = obtenerTabla(nombre, ubicacion);
+	string resultado;
+	cerrarVentanas(tabla, ahora, resultado);
+	for (unsigned int i = 0; i < registros.size(); ++i)
+		if (!anotar(tabla, registros[i].data(), registros[i].length(), ahora, resultado))
+		{
+			resultado.append(registros[i]);
+			resultado.push_back('\n');
+		}
+	if (!resultado.empty()) resultado.pop_back();
+	return resultado;
+}
+
+int DeduplicadorDeLineas::obtenerEspera (void)
+{
+	//Se busca la ventana con repeticiones que antes se cierra
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	long long espera = -1;
+	for (map<string, Tabla>::iterator i = tablas_.begin(); i != tablas_.end(); ++i)
+		for (unsigned int j = 0; j < i->second.entradas.size(); ++j)
+		{
+			const Entrada& entrada = i->second.entradas[j];
+			if (entrada.repeticiones == 0) continue;
+			long long restante = chrono::duration_cast<chrono::milliseconds>(entrada.inicio +
+				chrono::seconds(segundos_) - ahora).count() + 1;
+			if (restante < 0) restante = 0;
+			if ((espera < 0) || (restante < espera)) espera = restante;
+		}
+	return (int) espera;
+}
+
+std::unique_ptr<Evento> DeduplicadorDeLineas::vencer (void)
+{
+	//Se cierran las ventanas vencidas de cada tabla hasta encontrar una con repeticiones que resumir
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	for (map<string, Tabla>::iterator i = tablas_.begin(); i != tablas_.end(); ++i)
+	{
+		string resumenes;
+		cerrarVentanas(i->second, ahora, resumenes);
+		if (!resumenes.empty())
+		{
+			resumenes.pop_back();
+			return unique_ptr<Evento>(new Evento(i->second.nombre, i->second.ubicacion, resumenes));
+		}
+	}
+	return nullptr;
+}
+
+DeduplicadorDeLineas::Tabla& DeduplicadorDeLineas::obtenerTabla (const std::string& nombre, const std::string& ubicacion)
+{
+	Tabla& tabla = tablas_[ubicacion + nombre];
+	if (tabla.nombre.empty())
+	{
+		tabla.nombre = nombre;
+		tabla.ubicacion = ubicacion;
+	}
+	return tabla;
+}
+
+bool DeduplicadorDeLineas::anotar (	Tabla& tabla,
+									const char* texto,
+									const size_t longitud,
+									const std::chrono::steady_clock::time_point ahora,
+									std::string& resumenes	)
+{
+	//Los textos vacíos no se colapsan
+	if (longitud == 0) return false;
+	
+	//Si el texto está entre los últimos distintos, se cuenta como repetición. Si no se ignoran las cifras, se
+	//confirma comparando el texto, de forma que una colisión del resumen nunca oculte una línea distinta
+	unsigned long long resumen = resumirLinea(texto, longitud);
+	for (unsigned int i = 0; i < tabla.entradas.size(); ++i)
+		if ((tabla.entradas[i].resumen == resumen) &&
+			(ignorar_cifras_ || (tabla.entradas[i].linea.compare(0, string::npos, texto, longitud) == 0)))
+		{
+			++tabla.entradas[i].repeticiones;
+			return true;
+		}
+	
+	//Si no, se anota, sustituyendo si es necesario al más antiguo, cuyas repeticiones se resumen
+	if (tabla.entradas.size() >= ENTRADAS_POR_FICHERO_)
+	{
+		vector<Entrada>::iterator antigua = tabla.entradas.begin();
+		for (vector<Entrada>::iterator i = tabla.entradas.begin(); i != tabla.entradas.end(); ++i)
+			if (i->inicio < antigua->inicio) antigua = i;
+		resumir(*antigua, resumenes);
+		tabla.entradas.erase(antigua);
+	}
+	Entrada nueva;
+	nueva.resumen = resumen;
+	nueva.linea = string(texto, longitud);
+	nueva.inicio = ahora;
+	nueva.repeticiones = 0;
+	tabla.entradas.push_back(nueva);
+	return false;
+}
+
+void DeduplicadorDeLineas::cerrarVentanas (	Tabla& tabla,
+											const std::chrono::steady_clock::time_point ahora,
+											std::string& resumenes	)
+{
+	vector<Entrada>::iterator i = tabla.entradas.begin();
+	while (i != tabla.entradas.end())
+	{
+		if (ahora - i->inicio >= chrono::seconds(segundos_))
+		{
+			resumir(*i, resumenes);
+			i = tabla.entradas.erase(i);
+		}
+		else ++i;
+	}
+}
+
+void DeduplicadorDeLineas::resumir (const Entrada& entrada, std::string& resumenes)
+{
+	if (entrada.repeticiones == 0) return;
+	resumenes.append("Línea repetida " + to_string(entrada.repeticiones) + " veces más: " + entrada.linea + '\n');
+}
+
+unsigned long long DeduplicadorDeLineas::resumirLinea (const char* linea, const size_t longitud)
+{
+	//Si no se ignoran las cifras, se resume el texto exacto
+	if (!ignorar_cifras_) return calcularResumen(linea, longitud);
+	
+	//Si no, se copia la línea sin sus cifras en el espacio de normalización, que conserva su capacidad entre
+	//llamadas
+	normalizada_.clear();
+	bool cifra = false;
+	for (size_t i = 0; i < longitud; ++i)
+	{
+		if ((linea[i] >= '0') && (linea[i] <= '9'))
+		{
+			if (!cifra) normalizada_.push_back('#');
+			cifra = true;
+		}
+		else
+		{
+			normalizada_.push_back(linea[i]);
+			cifra = false;
+		}
+	}
+	return calcularResumen(normalizada_.data(), normalizada_.length());
+}
+
+unsigned long long DeduplicadorDeLineas::calcularResumen (const char* datos, const size_t longitud)
+{
+	const char* puntero = datos;
+	const char* final = datos + longitud;
+	unsigned long long resumen;
+	
+	//Los bloques de 32 bytes se reparten entre cuatro acumuladores, que después se combinan
+	if (longitud >= 32)
+	{
+		unsigned long long acumuladores [4] = { PRIMO_1 + PRIMO_2, PRIMO_2, 0, 0 - PRIMO_1 };
+		do
+		{
+			for (unsigned int i = 0; i < 4; ++i) acumuladores[i] = acumular(acumuladores[i], leer64(puntero + 8 * i));
+			puntero = puntero + 32;
+		}
+		while (puntero + 32 <= final);
+		resumen = rotar(acumuladores[0], 1) + rotar(acumuladores[1], 7) + rotar(acumuladores[2], 12) +
+			rotar(acumuladores[3], 18);
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			resumen = resumen ^ acumular(0, acumuladores[i]);
+			resumen = resumen * PRIMO_1 + PRIMO_4;
+		}
+	}
+	else resumen = PRIMO_5;
+	resumen = resumen + longitud;
+	
+	//Se incorporan los bytes restantes, de 8 en 8, de 4 en 4 y de uno en uno
+	while (puntero + 8 <= final)
+	{
+		resumen = resumen ^ acumular(0, leer64(puntero));
+		resumen = rotar(resumen, 27) * PRIMO_1 + PRIMO_4;
+		puntero = puntero + 8;
+	}
+	if (puntero + 4 <= final)
+	{
+		resumen = resumen ^ (leer32(puntero) * PRIMO_1);
+		resumen = rotar(resumen, 23) * PRIMO_2 + PRIMO_3;
+		puntero = puntero + 4;
+	}
+	while (puntero < final)
+	{
+		resumen = resumen ^ ((unsigned long long) (unsigned char) *puntero * PRIMO_5);
+		resumen = rotar(resumen, 11) * PRIMO_1;
+		++puntero;
+	}
+	
+	//Se mezclan finalmente los bits del resumen
+	resumen = resumen ^ (resumen >> 33);
+	resumen = resumen * PRIMO_2;
+	resumen = resumen ^ (resumen >> 29);
+	resumen = resumen * PRIMO_3;
+	resumen = resumen ^ (resumen >> 32);
+	return resumen;
+}
+
+} //namespace lognotify
\ No newline at end of file
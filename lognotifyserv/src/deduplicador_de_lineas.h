@@ -0,0 +1,184 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _deduplicador_de_lineas_h_
+#define _deduplicador_de_lineas_h_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* Un DeduplicadorDeLineas colapsa las líneas repetidas que se añaden a cada fichero dentro de una ventana de
+* tiempo (bucles de reintento, enlaces que se caen y levantan...), de forma que sólo se difunde la primera y,
+* al cerrarse la ventana, una línea que indica cuántas veces se ha repetido. Para no comparar el texto completo
+* de cada línea, de cada una se calcula un resumen de 64 bits (xxHash64) y se busca en una pequeña tabla con
+* los resúmenes de las últimas líneas distintas de su fichero; sólo si coincide se compara el texto. Si se
+* solicita, las cifras no intervienen en el resumen, de forma que las líneas que sólo difieren en marcas de
+* tiempo, contadores o identificadores de proceso también se consideran repetidas.
+* Un DeduplicadorDeLineas no es thread safe: debe utilizarse desde un único hilo, el del MonitorDeFicheros.
+*/
+class DeduplicadorDeLineas
+{
+	public:
+	
+	/**
+	* Constructor de la clase DeduplicadorDeLineas. Mientras no se configure, no colapsa nada
+	*/
+	DeduplicadorDeLineas (void): segundos_(0), ignorar_cifras_(false) {}
+	
+	/**
+	* Establece la ventana en la que se colapsan las líneas repetidas de cada fichero
+	* @param segundos Duración de la ventana, contada desde la primera aparición de cada línea, o 0 para no
+	* colapsar ninguna
+	* @param ignorarCifras true para considerar repetidas también las líneas que sólo difieren en sus cifras,
+	* false para colapsar sólo las idénticas
+	*/
+	void configurar (const unsigned int segundos, const bool ignorarCifras = false);
+	
+	/**
+	* Indica si el DeduplicadorDeLineas colapsa las líneas repetidas
+	* @return true si se ha configurado una ventana, false en caso contrario
+	*/
+	inline bool estaActivo (void) { return segundos_ > 0; }
+	
+	/**
+	* Colapsa las líneas repetidas del contenido añadido a un fichero. Delante de las líneas que se conservan se
+	* sitúan los resúmenes de las repeticiones del fichero cuya ventana se ha cerrado
+	* @param nombre Nombre del fichero
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero
+	* @param contenido Líneas añadidas al fichero, separadas por '\n'
+	* @return Líneas que deben difundirse, separadas por '\n', o cadena vacía si todas eran repeticiones
+	*/
+	std::string deduplicar (const std::string& nombre, const std::string& ubicacion, const std::string& contenido);
+	
+	/**
+	* Colapsa los registros repetidos de los ensamblados en un fichero (ver EnsambladorDeRegistros). Cada
+	* registro, aunque tenga varias líneas, se trata como una única línea, de forma que no se parte
+	* @param nombre Nombre del fichero
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero
+	* @param registros Registros ensamblados en el fichero
+	* @return Registros que deben difundirse, separados por '\n', o cadena vacía si todos eran repeticiones
+	*/
+	std::string deduplicar (	const std::string& nombre,
+								const std::string& ubicacion,
+								const std::vector<std::string>& registros	);
+	
+	/**
+	* Obtiene el tiempo que falta para que se cierre la ventana de la primera línea con repeticiones sin
+	* resumir, que es lo máximo que debe esperarse un nuevo contenido antes de llamar a vencer
+	* @return Milisegundos hasta el siguiente cierre (0 si ya ha pasado), o -1 si no hay repeticiones pendientes
+	*/
+	int obtenerEspera (void);
+	
+	/**
+	* Cierra las ventanas vencidas de un fichero y devuelve el resumen de sus repeticiones, de forma que se
+	* difundan aunque no se vuelva a escribir en él
+	* @return Puntero al Evento con los resúmenes de un fichero, o nulo (nullptr) si ninguna ventana con
+	* repeticiones ha vencido. Debe llamarse de nuevo hasta obtener nulo
+	*/
+	std::unique_ptr<Evento> vencer (void);
+	
+	/**
+	* Calcula el resumen xxHash64 (semilla 0) de una secuencia de bytes. Las secuencias de 32 bytes o más se
+	* procesan en cuatro acumuladores independientes, que el compilador puede mantener en paralelo
+	* @param datos Secuencia de bytes
+	* @param longitud Número de bytes de la secuencia
+	* @return Resumen de 64 bits de la secuencia
+	*/
+	static unsigned long long calcularResumen (const char* datos, const size_t longitud);
+	
+	private:
+	
+	/**
+	* Última línea distinta de un fichero, con las repeticiones colapsadas en su ventana
+	*/
+	struct Entrada
+	{
+		unsigned long long resumen;					///< Resumen de la línea (sin cifras, si se ignoran)
+		std::string linea;							///< Texto de la primera aparición de la línea
+		std::chrono::steady_clock::time_point inicio;	///< Instante en que se abrió la ventana
+		unsigned long long repeticiones;			///< Repeticiones colapsadas desde entonces
+	};
+	
+	/**
+	* Últimas líneas distintas de un fichero
+	*/
+	struct Tabla
+	{
+		std::string nombre;							///< Nombre del fichero
+		std::string ubicacion;						///< Ubicación del fichero
+		std::vector<Entrada> entradas;				///< Entradas, como máximo ENTRADAS_POR_FICHERO_
+	};
+	
+	/**
+	* Obtiene la tabla de un fichero, creándola si es necesario
+	* @param nombre Nombre del fichero
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero
+	* @return Tabla del fichero
+	*/
+	Tabla& obtenerTabla (const std::string& nombre, const std::string& ubicacion);
+	
+	/**
+	* Busca un texto (una línea o un registro) entre los últimos distintos de una tabla. Si está, cuenta una
+	* repetición; si no, lo anota, sustituyendo si es necesario al más antiguo
+	* @param tabla Tabla del fichero
+	* @param texto Puntero al primer carácter del texto
+	* @param longitud Número de caracteres del texto
+	* @param ahora Instante actual
+	* @param resumenes Texto al que se añade el resumen de las repeticiones del texto sustituido, si las tiene
+	* @return true si el texto es una repetición y no debe difundirse, false en caso contrario
+	*/
+	bool anotar (	Tabla& tabla,
+					const char* texto,
+					const size_t longitud,
+					const std::chrono::steady_clock::time_point ahora,
+					std::string& resumenes	);
+	
+	/**
+	* Cierra las ventanas vencidas de una tabla, añadiendo los resúmenes de sus repeticiones a un texto
+	* @param tabla Tabla cuyas ventanas se cierran
+	* @param ahora Instante actual
+	* @param resumenes Texto al que se añaden los resúmenes, separados por '\n'
+	*/
+	void cerrarVentanas (Tabla& tabla, const std::chrono::steady_clock::time_point ahora, std::string& resumenes);
+	
+	/**
+	* Añade a un texto el resumen de las repeticiones de una entrada, si las tiene
+	* @param entrada Entrada que se resume
+	* @param resumenes Texto al que se añade el resumen, separado por '\n'
+	*/
+	void resumir (const Entrada& entrada, std::string& resumenes);
+	
+	/**
+	* Calcula el resumen de una línea. Si se ignoran las cifras, se calcula sobre la línea normalizada, en la
+	* que cada secuencia de dígitos cuenta como un único '#'
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @return Resumen de 64 bits de la línea
+	*/
+	unsigned long long resumirLinea (const char* linea, const size_t longitud);
+	
+	//Constantes
+	constexpr static unsigned int ENTRADAS_POR_FICHERO_ = 8;	///< Líneas distintas recordadas por fichero
+	
+	//Variables miembro
+	unsigned int segundos_;							///< Duración de la ventana de cada línea
+	bool ignorar_cifras_;							///< Indica si las líneas se comparan sin sus cifras
+	std::map<std::string, Tabla> tablas_;			///< Tabla de cada fichero, por su ruta completa
+	std::string normalizada_;						///< Espacio en el que se normaliza cada línea
+};
+
+} //namespace lognotify
+
+#endif //_deduplicador_de_lineas_h_
\ No newline at end of file
@@ -0,0 +1,191 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "ensamblador_de_registros.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <chrono>
+#include <utility>
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int EnsambladorDeRegistros::LINEAS_POR_REGISTRO_;
+constexpr unsigned int EnsambladorDeRegistros::MILISEGUNDOS_ESPERA_;
+
+bool EnsambladorDeRegistros::anadirRegla (const std::string& ruta, const std::string& regla)
+{
+	//Se separa el tipo de regla de su expresión, si la tiene
+	size_t separador = regla.find_first_of(" \t");
+	string tipo = regla.substr(0, separador);
+	string expresion = "";
+	if (separador != string::npos)
+	{
+		size_t comienzo = regla.find_first_not_of(" \t", separador);
+		if (comienzo != string::npos) expresion = regla.substr(comienzo);
+	}
+	
+	//Se compila la regla. La expresión regular sólo se compila una vez, y se aplica después a cada línea
+	Estado estado;
+	if ((tipo == "inicio") || (tipo == "continuacion"))
+	{
+		if (expresion.empty()) return false;
+		estado.tipo = (tipo == "inicio") ? INICIO : CONTINUACION;
+		try
+		{
+			estado.expresion = regex(expresion, regex::ECMAScript | regex::optimize);
+		}
+		catch (regex_error&)
+		{
+			return false;
+		}
+	}
+	else if ((tipo == "sangria") && expresion.empty()) estado.tipo = SANGRIA;
+	else return false;
+	estado.lineas = 0;
+	estado.bytes = 0;
+	estado.partida = false;
+	estados_[ruta] = estado;
+	return true;
+}
+
+std::vector<std::string> EnsambladorDeRegistros::ensamblar (	const std::string& ruta,
+																const std::string& nombre,
+																const std::string& ubicacion,
+																const std::string& contenido,
+																const bool completo	)
+{
+	vector<string> registros;
+	map<string, Estado>::iterator encontrado = estados_.find(ruta);
+	if (encontrado == estados_.end()) return registros;
+	Estado& estado = encontrado->second;
+	estado.nombre = nombre;
+	estado.ubicacion = ubicacion;
+	
+	//Si la última línea leída no terminaba en salto de línea, lo leído comienza por su continuación, que se une
+	//a su comienzo antes de clasificarla. Sus bytes se vuelven a contar con la línea completa
+	string unido;
+	const string *texto = &contenido;
+	if (estado.partida)
+	{
+		unido = estado.fragmento + contenido;
+		texto = &unido;
+		estado.bytes = estado.bytes - estado.fragmento.length();
+		estado.fragmento.clear();
+		estado.partida = false;
+	}
+	
+	//Se añade cada línea al registro en curso, contando los bytes que ocupa en el fichero incluido su salto. La
+	//última, si no termina en salto de línea, no se clasifica hasta que se complete: espera aparte
+	size_t inicio = 0;
+	while (inicio <= texto->length())
+	{
+		size_t fin = texto->find('\n', inicio);
+		if ((fin == string::npos) && !completo)
+		{
+			estado.fragmento = texto->substr(inicio);
+			estado.bytes = estado.bytes + estado.fragmento.length();
+			estado.partida = true;
+			break;
+		}
+		if (fin == string::npos) fin = texto->length();
+		anadirLinea(estado, &(*texto)[inicio], fin - inicio, registros);
+		estado.bytes = estado.bytes + (fin - inicio) + 1;
+		inicio = fin + 1;
+	}
+	estado.ultima = chrono::steady_clock::now();
+	return registros;
+}
+
+int EnsambladorDeRegistros::obtenerEspera (void)
+{
+	//Se busca el registro en curso que antes vence
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	long long espera = -1;
+	for (map<string, Estado>::iterator i = estados_.begin(); i != estados_.end(); ++i)
+	{
+		if ((i->second.lineas == 0) && !i->second.partida) continue;
+		long long restante = chrono::duration_cast<chrono::milliseconds>(i->second.ultima +
+			chrono::milliseconds(MILISEGUNDOS_ESPERA_) - ahora).count() + 1;
+		if (restante < 0) restante = 0;
+		if ((espera < 0) || (restante < espera)) espera = restante;
+	}
+	return (int) espera;
+}
+
+std::vector<std::string> EnsambladorDeRegistros::vencer (std::string& nombre, std::string& ubicacion)
+{
+	vector<string> registros;
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	for (map<string, Estado>::iterator i = estados_.begin(); i != estados_.end(); ++i)
+		if (((i->second.lineas > 0) || i->second.partida) &&
+			(ahora - i->second.ultima >= chrono::milliseconds(MILISEGUNDOS_ESPERA_)))
+		{
+			//Una línea incompleta que ha esperado demasiado se clasifica tal cual. Lo que la continúe se tratará
+			//como una línea nueva
+			Estado& estado = i->second;
+			nombre = estado.nombre;
+			ubicacion = estado.ubicacion;
+			if (estado.partida)
+			{
+				anadirLinea(estado, estado.fragmento.data(), estado.fragmento.length(), registros);
+				estado.fragmento.clear();
+				estado.partida = false;
+			}
+			cerrarRegistro(estado, registros);
+			break;
+		}
+	return registros;
+}
+
+long long EnsambladorDeRegistros::obtenerPendiente (const std::string& ruta)
+{
+	map<string, Estado>::iterator encontrado = estados_.find(ruta);
+	if (encontrado == estados_.end()) return 0;
+	return encontrado->second.bytes;
+}
+
+bool EnsambladorDeRegistros::esContinuacion (const Estado& estado, const char* linea, const size_t longitud)
+{
+	if (longitud == 0) return true;
+	switch (estado.tipo)
+	{
+		case INICIO:
+			return !regex_search(linea, linea + longitud, estado.expresion);
+		case CONTINUACION:
+			return regex_search(linea, linea + longitud, estado.expresion);
+		default:
+			return (linea[0] == ' ') || (linea[0] == '\t');
+	}
+}
+
+void EnsambladorDeRegistros::anadirLinea (	Estado& estado,
+											const char* linea,
+											const size_t longitud,
+											std::vector<std::string>& registros	)
+{
+	//Una línea que comienza registro, o que no cabe en el registro en curso, lo cierra antes de añadirse
+	if ((estado.lineas >= LINEAS_POR_REGISTRO_) || ((estado.lineas > 0) && !esContinuacion(estado, linea, longitud)))
+		cerrarRegistro(estado, registros);
+	if (estado.lineas > 0) estado.registro.push_back('\n');
+	estado.registro.append(linea, longitud);
+	++estado.lineas;
+}
+
+void EnsambladorDeRegistros::cerrarRegistro (Estado& estado, std::vector<std::string>& registros)
+{
+	if (estado.lineas == 0) return;
+	registros.push_back(move(estado.registro));
+	estado.registro.clear();
+	estado.lineas = 0;
+	estado.bytes = 0;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,159 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _ensamblador_de_registros_h_
+#define _ensamblador_de_registros_h_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <chrono>
+
+namespace lognotify
+{
+
+/**
+* Un EnsambladorDeRegistros agrupa las líneas que se añaden a un fichero en registros de varias líneas (trazas
+* de pila de Java o Python, mensajes partidos...), de forma que cada registro se difunde entero aunque se
+* escriba en varias veces. Cada fichero con una regla de ensamblado conserva el registro en curso hasta que
+* llega la primera línea del siguiente, acumula el número máximo de líneas por registro o pasa el tiempo máximo
+* sin recibir líneas nuevas. Las reglas de ensamblado, que se compilan al añadirlas, son:
+*	- "inicio expresion": comienzan registro las líneas en las que se encuentra la expresión regular
+*	- "continuacion expresion": continúan el registro en curso las líneas en las que se encuentra la expresión
+*	  regular, y el resto lo comienzan
+*	- "sangria": continúan el registro en curso las líneas que comienzan por un espacio o un tabulador, y el
+*	  resto lo comienzan
+* Las líneas vacías continúan siempre el registro en curso, y una línea que se escribe en varias veces se une
+* antes de aplicarle la regla.
+* Un EnsambladorDeRegistros no es thread safe: debe utilizarse desde un único hilo, el del MonitorDeFicheros.
+*/
+class EnsambladorDeRegistros
+{
+	public:
+	
+	/**
+	* Añade o sustituye la regla de ensamblado de un fichero
+	* @param ruta Ruta del fichero relativa al directorio de ficheros de registro
+	* @param regla Regla de ensamblado: "inicio expresion", "continuacion expresion" o "sangria"
+	* @return true si la regla es válida, false si no se reconoce o su expresión regular no es correcta
+	*/
+	bool anadirRegla (const std::string& ruta, const std::string& regla);
+	
+	/**
+	* Indica si un fichero tiene regla de ensamblado
+	* @param ruta Ruta del fichero relativa al directorio de ficheros de registro
+	* @return true si el fichero tiene regla de ensamblado, false en caso contrario
+	*/
+	inline bool tieneRegla (const std::string& ruta) { return estados_.find(ruta) != estados_.end(); }
+	
+	/**
+	* Agrupa en registros las líneas añadidas a un fichero con regla de ensamblado. El último registro queda en
+	* curso, pues puede continuar en lo próximo que se añada al fichero, y la última línea, si no termina en
+	* salto de línea, no se clasifica hasta que se complete
+	* @param ruta Ruta del fichero relativa al directorio de ficheros de registro
+	* @param nombre Nombre del fichero
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero
+	* @param contenido Líneas añadidas al fichero, separadas por '\n'
+	* @param completo Indica si lo añadido termina en un salto de línea, que no forma parte de contenido
+	* @return Registros completados, con sus líneas separadas por '\n'
+	*/
+	std::vector<std::string> ensamblar (	const std::string& ruta,
+											const std::string& nombre,
+											const std::string& ubicacion,
+											const std::string& contenido,
+											const bool completo	);
+	
+	/**
+	* Obtiene el tiempo que falta para que venza el primer registro en curso, que es lo máximo que debe esperarse
+	* un nuevo contenido antes de llamar a vencer
+	* @return Milisegundos hasta el siguiente vencimiento (0 si ya ha pasado), o -1 si no hay registros en curso
+	*/
+	int obtenerEspera (void);
+	
+	/**
+	* Cierra el registro en curso de un fichero que lleva el tiempo máximo sin recibir líneas nuevas, de forma
+	* que se difunda aunque no se vuelva a escribir en el fichero. Su última línea, si estaba incompleta, se
+	* clasifica tal cual
+	* @param nombre Nombre del fichero del registro cerrado
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero del registro cerrado
+	* @return Registros cerrados (dos si la línea incompleta comenzaba otro), o ninguno si no ha vencido ningún
+	* registro. Debe llamarse de nuevo hasta no obtener ninguno
+	*/
+	std::vector<std::string> vencer (std::string& nombre, std::string& ubicacion);
+	
+	/**
+	* Obtiene los bytes del fichero que ocupan su registro en curso y su última línea incompleta, que ya se han
+	* leído pero no se han difundido
+	* @param ruta Ruta del fichero relativa al directorio de ficheros de registro
+	* @return Bytes del registro en curso y de la línea incompleta, o 0 si no hay ninguno
+	*/
+	long long obtenerPendiente (const std::string& ruta);
+	
+	private:
+	
+	/**
+	* Tipos de regla de ensamblado
+	*/
+	enum TipoDeRegla { INICIO, CONTINUACION, SANGRIA };
+	
+	/**
+	* Regla de ensamblado de un fichero y su registro en curso
+	*/
+	struct Estado
+	{
+		TipoDeRegla tipo;							///< Tipo de la regla
+		std::regex expresion;						///< Expresión compilada de las reglas INICIO y CONTINUACION
+		std::string nombre;							///< Nombre del fichero
+		std::string ubicacion;						///< Ubicación del fichero
+		std::string registro;						///< Líneas del registro en curso, separadas por '\n'
+		unsigned int lineas;						///< Líneas del registro en curso
+		long long bytes;							///< Bytes del registro en curso y el fragmento
+		bool partida;								///< Indica si la última línea no terminaba en salto de línea
+		std::string fragmento;						///< Comienzo de dicha línea, aún sin clasificar
+		std::chrono::steady_clock::time_point ultima;	///< Instante en que se añadió su última línea
+	};
+	
+	/**
+	* Comprueba si una línea continúa el registro en curso según la regla de su fichero
+	* @param estado Estado del fichero
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @return true si la línea continúa el registro en curso, false si comienza uno nuevo
+	*/
+	bool esContinuacion (const Estado& estado, const char* linea, const size_t longitud);
+	
+	/**
+	* Añade una línea completa al registro en curso de un fichero, cerrándolo antes si la línea comienza uno
+	* nuevo o no cabe en él
+	* @param estado Estado del fichero
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea
+	* @param registros Registros a los que se añade el registro cerrado, si se cierra
+	*/
+	void anadirLinea (	Estado& estado,
+						const char* linea,
+						const size_t longitud,
+						std::vector<std::string>& registros	);
+	
+	/**
+	* Cierra el registro en curso de un fichero, si lo hay
+	* @param estado Estado del fichero
+	* @param registros Registros a los que se añade el registro cerrado
+	*/
+	void cerrarRegistro (Estado& estado, std::vector<std::string>& registros);
+	
+	//Constantes
+	constexpr static unsigned int LINEAS_POR_REGISTRO_ = 500;	///< Máximo de líneas de un registro
+	constexpr static unsigned int MILISEGUNDOS_ESPERA_ = 1000;	///< Espera máxima a la siguiente línea
+	
+	//Variables miembro
+	std::map<std::string, Estado> estados_;		///< Estado de cada fichero con regla, por su ruta relativa
+};
+
+} //namespace lognotify
+
+#endif //_ensamblador_de_registros_h_
\ No newline at end of file
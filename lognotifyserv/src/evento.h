@@ -16,6 +16,8 @@ namespace lognotify
 * Un objeto de tipo Evento es generado cada vez que un fichero monitorizado es modificado.
 * El evento contiene los datos relativos al mismo, incluyendo la ubicación completa y nombre del fichero,
 * así como una descripcion textual del evento (que normalmente contendrá el texto añadido en la modificación). 
+* Los eventos recibidos de otro servidor (en modo repetidor) conservan además su origen, el servidor en que se
+* produjeron, que viaja por red delante de la ubicación: "origen:ubicacion".
 */
 class Evento
 {
@@ -27,11 +29,39 @@ class Evento
 	* @param ubicacion La ruta completa del directorio en que se encuentra el fichero que ha
 	* provocado el evento
 	* @param descripcion La descripción textual del evento provocado
+	* @param origen Servidor en que se produjo el evento, "direccion/puerto", o cadena vacía si se ha producido
+	* en este mismo servidor
 	*/
-	Evento (const std::string& nombre, const std::string& ubicacion, const std::string& descripcion):
+	Evento (	const std::string& nombre,
+				const std::string& ubicacion,
+				const std::string& descripcion,
+				const std::string& origen = ""	):
 		nombre_(nombre),
 		ubicacion_(ubicacion),
-		descripcion_(descripcion) {}
+		descripcion_(descripcion),
+		origen_(origen) {}
+	
+	/**
+	* Construye un Evento a partir de sus campos tal y como se envían por red, separando de la ubicación el
+	* origen de los eventos reenviados por un repetidor. Las ubicaciones son rutas absolutas, por lo que sólo
+	* las de estos eventos no comienzan por '/'
+	* @param nombre El nombre del fichero que ha provocado el evento
+	* @param ubicacionCompleta La ubicación recibida, precedida del origen si lo tiene: "origen:ubicacion"
+	* @param descripcion La descripción textual del evento provocado
+	* @param origen Origen asignado al Evento si la ubicación no incluye ninguno
+	* @return Evento con los campos recibidos
+	*/
+	static Evento recibido (	const std::string& nombre,
+								const std::string& ubicacionCompleta,
+								const std::string& descripcion,
+								const std::string& origen	)
+	{
+		size_t separador = ubicacionCompleta.find(":/");
+		if (ubicacionCompleta.empty() || (ubicacionCompleta[0] == '/') || (separador == std::string::npos))
+			return Evento(nombre, ubicacionCompleta, descripcion, origen);
+		return Evento(	nombre, ubicacionCompleta.substr(separador + 1), descripcion,
+						ubicacionCompleta.substr(0, separador)	);
+	}
 		
 	/**
 	* Obtiene el nombre del fichero que ha provocado el evento
@@ -54,20 +84,40 @@ class Evento
 	}
 	
 	/**
-	* Obtiene la descripción textual del evento provocado
-	* @return Descripción textual del evento provocado
+	* Obtiene la descripción textual del evento provocado, sin copiarla, pues puede ser larga
+	* @return Referencia a la descripción textual del evento provocado, válida mientras exista el Evento
 	*/
-	inline std::string obtener_descripcion (void)
+	inline const std::string& obtener_descripcion (void)
 	{
 		return descripcion_;
 	}
 	
+	/**
+	* Obtiene el servidor en que se produjo el evento
+	* @return Servidor en que se produjo el evento, "direccion/puerto", o cadena vacía si se ha producido en
+	* este mismo servidor
+	*/
+	inline std::string obtener_origen (void)
+	{
+		return origen_;
+	}
+	
+	/**
+	* Obtiene la ubicación del fichero tal y como se envía por red, precedida del origen del evento si lo tiene
+	* @return La ubicación del fichero, "origen:ubicacion" si el evento procede de otro servidor
+	*/
+	inline std::string obtener_ubicacion_completa (void)
+	{
+		return origen_.empty() ? ubicacion_ : origen_ + ":" + ubicacion_;
+	}
+	
 	private:
 	
 	//Variables miembro
 	std::string nombre_;		///< Nombre del fichero que provoca el evento
 	std::string ubicacion_;		///< Ubicación del fichero que provoca el evento
 	std::string descripcion_;	///< Descripción del evento producido
+	std::string origen_;		///< Servidor en que se produjo el evento (vacío si es este mismo)
 	
 }; //class Evento
 
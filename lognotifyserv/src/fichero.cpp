@@ -92,14 +92,12 @@ std::string Fichero::ultimaModificacion (const std::string& dirRegistro) {
 	//Se desplaza el puntero a la última posición reportada del fichero
 	fichero.seekg(ultimo_tamano_, ios::beg);
 	
-	//Se copia en destino todo el contenido hasta el final del fichero
-	string linea;
-	string destino = "";
-	if (getline(fichero, linea)) destino = linea;
-	while (getline(fichero, linea))
-	{
-		destino = destino + '\n' + linea;
-	}
+	//Se copia en destino el contenido hasta la posición final obtenida, y no hasta el final del fichero, pues
+	//lo que se le siga añadiendo mientras tanto se leerá en la siguiente llamada. Se descarta el último salto
+	//de línea, si lo hay
+	string destino(fin - ultimo_tamano_, '\0');
+	if (!fichero.read(&destino[0], destino.length())) destino.resize(fichero.gcount());
+	if (!destino.empty() && (destino.back() == '\n')) destino.pop_back();
 	
 	//Se cierra el fichero una vez terminado con él
 	fichero.close();
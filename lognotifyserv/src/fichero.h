@@ -67,6 +67,19 @@ class Fichero
 	*/
 	std::string ultimaModificacion (const std::string& dirRegistro);
 	
+	/**
+	* Devuelve la posición del fichero hasta la que se ha leído su contenido
+	* @return Tamaño del fichero la última vez que fue accedido
+	*/
+	inline long long obtener_posicion (void) { return ultimo_tamano_; }
+	
+	/**
+	* Establece la posición del fichero hasta la que se ha leído su contenido, de forma que la siguiente
+	* llamada a ultimaModificacion devuelva lo añadido a partir de ella
+	* @param posicion Posición desde la que continuar la lectura
+	*/
+	inline void establecer_posicion (const long long posicion) { ultimo_tamano_ = posicion; }
+	
 	private:
 	
 	//Variables miembro
@@ -0,0 +1,118 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "filtro.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <sstream>
+
+#include "regla.h"
+#include "condicion.h"
+
+using namespace std;
+namespace lognotify
+{
+
+bool Filtro::inicializar (const std::string& reglas)
+{
+	//Se comprueba que no haya sido inicializado con anterioridad
+	if (estaInicializado()) return false;
+	
+	//Se cargan las reglas, si el proceso es correcto la instancia quedará inicializada, de no ser así,
+	//termina en error
+	inicializado_ = cargarReglas(reglas);
+	return inicializado_;
+}
+
+std::string Filtro::normalizarReglas (const std::string& reglas)
+{
+	//Se recorre el texto línea por línea, eliminando los espacios iniciales de cada una y conservando
+	//únicamente aquellas que comienzan con alguna de las palabras clave reconocidas
+	istringstream texto (reglas);
+	string linea = "";
+	string normalizadas = "";
+	while (getline(texto, linea))
+	{
+		size_t inicio = linea.find_first_not_of(" \t");
+		if (inicio == string::npos) continue;
+		linea = linea.substr(inicio, string::npos);
+		
+		//La palabra clave regla admite cualquier texto a continuación, que no tiene significado
+		if (linea.compare(0, 5, "regla") == 0) linea = "regla";
+		else if (	(linea.compare(0, 7, "origen=") != 0) && (linea.compare(0, 8, "origen!=") != 0) &&
+					(linea.compare(0, 8, "fichero=") != 0) && (linea.compare(0, 9, "fichero!=") != 0) &&
+					(linea.compare(0, 10, "contenido=") != 0) && (linea.compare(0, 11, "contenido!=") != 0) &&
+					!esCondicionDeCampo(linea)	)
+			continue;
+		
+		normalizadas = normalizadas + linea + '\n';
+	}
+	return normalizadas;
+}
+
+bool Filtro::esCondicionDeCampo (const std::string& linea)
+{
+	//La clave, entre "campo." y el signo, no puede estar vacía
+	if (linea.compare(0, 6, "campo.") != 0) return false;
+	size_t igual = linea.find_first_of('=');
+	if (igual == string::npos) return false;
+	return (igual > 7) || ((igual == 7) && (linea[6] != '!'));
+}
+
+bool Filtro::cargarReglas (const std::string& reglas)
+{
+	//Se parsea el texto normalizado completo, línea por línea. Cada regla lleva asociada una marca que indica
+	//si contiene condiciones que no pueden evaluarse en el servidor (origen=, origen!=) y debe descartarse
+	istringstream texto (normalizarReglas(reglas));
+	vector<bool> descartadas;
+	string linea = "";
+	string expresion = "";
+	while (getline(texto, linea))
+	{
+		//Si la línea es la palabra clave regla, se añade una nueva regla
+		if (linea == "regla")
+		{
+			reglas_.emplace_back();
+			descartadas.push_back(false);
+			continue;
+		}
+		
+		//En cualquier otro caso se trata de una condición; si no hay una regla creada, se crea una nueva
+		if (reglas_.empty())
+		{
+			reglas_.emplace_back();
+			descartadas.push_back(false);
+		}
+		
+		//Se extrae la expresión regular de la línea y se añade la nueva condición a la regla
+		expresion = linea.substr(linea.find_first_of('=') + 1, string::npos);
+		bool signo = (linea[linea.find_first_of('=') - 1] != '!');
+		if (linea.compare(0, 6, "origen") == 0) descartadas.back() = true;
+		else if (linea.compare(0, 7, "fichero") == 0)
+			reglas_.back().anadirCondicion(Condicion(Condicion::CAMPO_FICHERO, expresion, signo));
+		else if (linea.compare(0, 6, "campo.") == 0)
+		{
+			string clave = linea.substr(6, linea.find_first_of('=') - (signo ? 6 : 7));
+			reglas_.back().anadirCondicion(Condicion(Condicion::CAMPO_JSON, expresion, signo, clave));
+		}
+		else reglas_.back().anadirCondicion(Condicion(Condicion::CAMPO_CONTENIDO, expresion, signo));
+	}
+	
+	//Se eliminan las reglas descartadas y se retorna con éxito
+	for (int i = reglas_.size() - 1; i >= 0; --i)
+	{
+		if (descartadas[i])
+		{
+			reglas_[i] = move(reglas_.back());
+			reglas_.pop_back();
+		}
+	}
+	return true;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _filtro_h_
+#define _filtro_h_
+
+#include <vector>
+#include <string>
+
+#include "regla.h"
+
+namespace lognotify
+{
+
+/**
+* Un objeto de tipo Filtro contiene el conjunto de reglas de omisión que un cliente ha subido al servidor, de
+* forma que los eventos que el cliente descartaría de todos modos no lleguen a enviarse por la red. Un evento
+* pasa el Filtro si no cumple ninguna de sus reglas. Las reglas se expresan con la misma sintaxis que el
+* fichero de filtro de lognotifycli (palabras clave regla, fichero=, fichero!=, contenido=, contenido!=,
+* campo.clave= y campo.clave!=, una por línea). Las condiciones campo.clave comparan el valor de la clave en las
+* líneas JSON del evento, por lo que permiten filtrar por nivel o servicio sin expresiones sobre toda la línea.
+* Las condiciones origen= y origen!= dependen de la dirección con la que el cliente identifica al servidor, que
+* el servidor desconoce, por lo que las reglas que las contienen se descartan: evaluarlas en el servidor podría
+* omitir eventos que el cliente sí desea, mientras que no hacerlo sólo provoca que el propio cliente los filtre
+* a su llegada. El Filtro sólo describe las reglas; su evaluación corre a cargo del
+* MotorDeSuscripciones en el que se registra. Un objeto de tipo Filtro debe de ser inicializado para estar activo
+*/
+class Filtro
+{
+	public:
+	
+	/**
+	* Constructor de la clase Filtro
+	*/
+	Filtro (void): inicializado_ (false) {}
+	
+	/**
+	* Inicializa el Filtro con las reglas contenidas en el texto que se pasa por parámetro
+	* @param reglas Texto con la definición de las reglas del Filtro, una palabra clave por línea
+	* @return true si la inicialización ha tenido éxito, false en caso contrario
+	*/
+	bool inicializar (const std::string& reglas);
+	
+	/**
+	* Indica si la instancia de Filtro ya ha sido correctamente inicializada
+	* @return true si el Filtro está inicializado, false en caso contrario
+	*/
+	inline bool estaInicializado (void) { return inicializado_; }
+	
+	/**
+	* Indica si el Filtro carece de reglas, en cuyo caso todos los eventos lo pasan
+	* @return true si el Filtro no contiene ninguna regla, false en caso contrario
+	*/
+	inline bool estaVacio (void) const { return reglas_.empty(); }
+	
+	/**
+	* Devuelve las reglas que componen el Filtro
+	* @return Conjunto de reglas del Filtro
+	*/
+	inline const std::vector<Regla>& obtener_reglas (void) const { return reglas_; }
+	
+	/**
+	* Obtiene la forma canónica de un texto de reglas: se eliminan los espacios iniciales de cada línea y se
+	* descartan las líneas que no pueden ser reconocidas
+	* @param reglas Texto con la definición de las reglas de un Filtro
+	* @return Forma canónica del texto de reglas
+	*/
+	static std::string normalizarReglas (const std::string& reglas);
+	
+	private:
+	
+	/**
+	* Indica si una línea de reglas es una condición sobre una clave de las líneas JSON: "campo.clave=expresion"
+	* o "campo.clave!=expresion"
+	* @param linea Línea de reglas, sin espacios iniciales
+	* @return true si la línea es una condición campo.clave con la clave no vacía, false en caso contrario
+	*/
+	static bool esCondicionDeCampo (const std::string& linea);
+	
+	/**
+	* Extrae las reglas definidas en el texto indicado, cargándolas en el Filtro
+	* @param reglas Texto con la definición de las reglas del Filtro
+	* @return true si el proceso ha finalizado sin errores, false en caso contrario
+	*/
+	bool cargarReglas (const std::string& reglas);
+	
+	//Variables miembro
+	std::vector<Regla> reglas_;		///< Conjunto de reglas usadas para filtrar eventos
+	bool inicializado_;				///< Indica si ha sido correctamente inicializado o no
+};
+
+} //namespace lognotify
+
+#endif //_filtro_h_
\ No newline at end of file
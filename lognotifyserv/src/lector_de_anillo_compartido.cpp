@@ -0,0 +1,130 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "lector_de_anillo_compartido.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+#include "anillo_compartido.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr int LectorDeAnilloCompartido::TRAMA_LEIDA;
+constexpr int LectorDeAnilloCompartido::ANILLO_VACIO;
+constexpr int LectorDeAnilloCompartido::TRAMAS_PERDIDAS;
+
+LectorDeAnilloCompartido::~LectorDeAnilloCompartido (void)
+{
+	if (cabecera_ != nullptr) munmap(cabecera_, tamano_segmento_);
+}
+
+bool LectorDeAnilloCompartido::abrir (const std::string& nombre)
+{
+	if (cabecera_ != nullptr) return false;
+	
+	//Se proyecta el segmento completo en memoria. Se necesita escritura para anotar las esperas en la cabecera
+	int descriptor = shm_open(nombre.c_str(), O_RDWR | O_CLOEXEC, 0);
+	if (descriptor < 0) return false;
+	struct stat estado;
+	if ((fstat(descriptor, &estado) < 0) || (estado.st_size < CabeceraDeAnilloCompartido::TAMANO_CABECERA))
+	{
+		close(descriptor);
+		return false;
+	}
+	void *segmento = mmap(nullptr, estado.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (segmento == MAP_FAILED) return false;
+	
+	//Se comprueba que el anillo está listo y que su formato y tamaño son los esperados
+	CabeceraDeAnilloCompartido *cabecera = (CabeceraDeAnilloCompartido*) segmento;
+	bool valido = (cabecera->magia == CabeceraDeAnilloCompartido::MAGIA);
+	atomic_thread_fence(memory_order_acquire);
+	valido = valido && (cabecera->version == CabeceraDeAnilloCompartido::VERSION) &&
+		(CabeceraDeAnilloCompartido::TAMANO_CABECERA + cabecera->capacidad == (uint64_t) estado.st_size);
+	if (!valido)
+	{
+		munmap(segmento, estado.st_size);
+		return false;
+	}
+	
+	cabecera_ = cabecera;
+	datos_ = (const char*) segmento + CabeceraDeAnilloCompartido::TAMANO_CABECERA;
+	tamano_segmento_ = estado.st_size;
+	cursor_ = cabecera_->escritura.load(memory_order_acquire);
+	return true;
+}
+
+int LectorDeAnilloCompartido::leer (Trama& trama)
+{
+	if (cabecera_ == nullptr) return ANILLO_VACIO;
+	uint64_t capacidad = cabecera_->capacidad;
+	while (true)
+	{
+		//Si no se han publicado tramas desde la última leída, no hay nada que leer
+		uint64_t escritura = cabecera_->escritura.load(memory_order_acquire);
+		if (cursor_ == escritura) return ANILLO_VACIO;
+		
+		//Se copia la cabecera de la trama y se comprueba, después, que no ha sido sobrescrita mientras tanto
+		RegistroDeAnilloCompartido registro;
+		memcpy(&registro, datos_ + (cursor_ & (capacidad - 1)), sizeof registro);
+		atomic_thread_fence(memory_order_acquire);
+		if (cursor_ < cabecera_->validez.load(memory_order_relaxed))
+		{
+			cursor_ = cabecera_->escritura.load(memory_order_acquire);
+			return TRAMAS_PERDIDAS;
+		}
+		
+		//Las tramas de relleno se saltan; el resto se devuelve en su sitio
+		uint64_t posicion = cursor_;
+		cursor_ = cursor_ + registro.tamano;
+		if (registro.secuencia == 0) continue;
+		trama.secuencia = registro.secuencia;
+		trama.contenido = datos_ + (posicion & (capacidad - 1)) + sizeof registro;
+		trama.longitud = registro.longitud;
+		trama.posicion = posicion;
+		return TRAMA_LEIDA;
+	}
+}
+
+bool LectorDeAnilloCompartido::sigueVigente (const Trama& trama)
+{
+	atomic_thread_fence(memory_order_acquire);
+	return trama.posicion >= cabecera_->validez.load(memory_order_relaxed);
+}
+
+void LectorDeAnilloCompartido::esperar (const int milisegundos)
+{
+	if (cabecera_ == nullptr) return;
+	
+	//Se anota la espera antes de comprobar si hay tramas nuevas, de forma que el productor, que publica antes
+	//de comprobar si hay lectores esperando, no pueda dejar de despertar a este lector
+	cabecera_->esperando.fetch_add(1);
+	uint32_t aviso = cabecera_->aviso.load();
+	if (cabecera_->escritura.load() == cursor_)
+	{
+		struct timespec plazo;
+		plazo.tv_sec = milisegundos / 1000;
+		plazo.tv_nsec = (milisegundos % 1000) * 1000000L;
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&cabecera_->aviso), FUTEX_WAIT, aviso,
+			(milisegundos < 0) ? nullptr : &plazo, nullptr, 0);
+	}
+	cabecera_->esperando.fetch_sub(1);
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,103 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _lector_de_anillo_compartido_h_
+#define _lector_de_anillo_compartido_h_
+
+#include <cstdint>
+#include <string>
+
+#include "anillo_compartido.h"
+
+namespace lognotify
+{
+
+/**
+* Un LectorDeAnilloCompartido permite a un proceso de la misma máquina que lognotifyserv leer los eventos que
+* éste publica en un AnilloCompartido (opción -s), directamente de la memoria compartida y sin copiarlos. Cada
+* lector lleva su propia posición, y el productor nunca le espera: si se queda tan atrás que las tramas que le
+* faltan por leer se sobrescriben, lo detecta al leer y salta a la trama más reciente. Se compila en la
+* biblioteca liblognotifyshm.a (make lib) para su uso desde otras aplicaciones.
+* Cada trama contiene el número de secuencia del evento y sus campos en el mismo formato que los envíos por
+* red: "nombre"\0"ubicacion"\0"descripcion"\0. Como la trama se lee en su sitio, puede ser sobrescrita
+* mientras se usa: tras procesarla, sigueVigente indica si lo leído es válido.
+* El LectorDeAnilloCompartido NO es thread safe.
+*/
+class LectorDeAnilloCompartido
+{
+	public:
+	
+	//Constantes públicas
+	constexpr static int TRAMA_LEIDA = 0;		///< Resultado de leer: se ha leído una trama
+	constexpr static int ANILLO_VACIO = 1;		///< Resultado de leer: no hay tramas nuevas
+	constexpr static int TRAMAS_PERDIDAS = 2;	///< Resultado de leer: se han sobrescrito tramas sin leer
+	
+	/**
+	* Trama leída del anillo, que permanece en la memoria compartida
+	*/
+	struct Trama
+	{
+		uint64_t secuencia;		///< Número de secuencia del evento
+		const char *contenido;	///< Campos del evento, cada uno terminado en '\0'
+		uint32_t longitud;		///< Longitud en bytes del contenido
+		uint64_t posicion;		///< Posición de la trama en el anillo, para comprobar su vigencia
+	};
+	
+	/**
+	* Constructor de la clase LectorDeAnilloCompartido
+	*/
+	LectorDeAnilloCompartido (void): cabecera_(nullptr), datos_(nullptr), tamano_segmento_(0), cursor_(0) {}
+	
+	/**
+	* Destructor de la clase LectorDeAnilloCompartido
+	*/
+	~LectorDeAnilloCompartido (void);
+	
+	LectorDeAnilloCompartido (const LectorDeAnilloCompartido&) = delete;
+	LectorDeAnilloCompartido& operator= (const LectorDeAnilloCompartido&) = delete;
+	
+	/**
+	* Abre el anillo publicado por lognotifyserv. La lectura comienza por la siguiente trama que se publique
+	* @param nombre Nombre del segmento de memoria compartida, el mismo indicado a lognotifyserv
+	* @return true si el anillo ha sido abierto, false si no existe, no está listo o su formato no es válido
+	*/
+	bool abrir (const std::string& nombre);
+	
+	/**
+	* Lee la siguiente trama del anillo, sin bloquear
+	* @param trama Trama en la que se devuelve la leída
+	* @return TRAMA_LEIDA si se ha leído una trama, ANILLO_VACIO si no hay ninguna nueva, o TRAMAS_PERDIDAS si
+	* el lector se ha quedado atrás y se han sobrescrito tramas sin leer, en cuyo caso la lectura continúa por
+	* la siguiente trama que se publique (el salto en la secuencia indica cuántas se han perdido)
+	*/
+	int leer (Trama& trama);
+	
+	/**
+	* Comprueba que una trama leída no ha sido sobrescrita, y por tanto lo leído de ella es válido. Debe
+	* llamarse después de procesar la trama
+	* @param trama Trama leída mediante leer
+	* @return true si lo leído de la trama es válido, false si ha podido ser sobrescrita mientras se leía
+	*/
+	bool sigueVigente (const Trama& trama);
+	
+	/**
+	* Espera a que se publiquen nuevas tramas, si no hay ninguna sin leer
+	* @param milisegundos Tiempo máximo de espera, o un valor negativo para esperar indefinidamente
+	*/
+	void esperar (const int milisegundos);
+	
+	private:
+	
+	//Variables miembro
+	CabeceraDeAnilloCompartido *cabecera_;	///< Cabecera del segmento de memoria compartida
+	const char *datos_;						///< Zona de datos del segmento
+	unsigned long tamano_segmento_;			///< Tamaño total del segmento
+	uint64_t cursor_;						///< Posición de la siguiente trama a leer
+};
+
+} //namespace lognotify
+
+#endif //_lector_de_anillo_compartido_h_
\ No newline at end of file
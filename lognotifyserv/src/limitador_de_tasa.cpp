@@ -0,0 +1,133 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "limitador_de_tasa.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+#include "evento.h"
+
+using namespace std;
+namespace lognotify
+{
+
+void LimitadorDeTasa::configurar (const unsigned int lineasPorSegundo, const unsigned int rafaga)
+{
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	lineas_por_segundo_ = lineasPorSegundo;
+	rafaga_ = (rafaga > lineasPorSegundo) ? rafaga : lineasPorSegundo;
+	
+	//Se libera el mutex
+	mutex_.unlock();
+}
+
+bool LimitadorDeTasa::limitar (Evento& evento, const bool registros)
+{
+	if (!estaActivo()) return true;
+	
+	//Se cuentan las líneas de la descripción, separadas por '\n'
+	string descripcion = evento.obtener_descripcion();
+	unsigned long long lineas = count(descripcion.begin(), descripcion.end(), '\n') + 1;
+	chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Se rellena la cubeta del fichero con las fichas correspondientes al tiempo transcurrido desde la última vez,
+	//sin superar su capacidad. La de un fichero nuevo comienza llena
+	string clave = evento.obtener_ubicacion() + evento.obtener_nombre();
+	map<string, Cubeta>::iterator encontrada = cubetas_.find(clave);
+	if (encontrada == cubetas_.end())
+	{
+		Cubeta nueva;
+		nueva.nombre = evento.obtener_nombre();
+		nueva.ubicacion = evento.obtener_ubicacion();
+		nueva.fichas = rafaga_;
+		nueva.relleno = ahora;
+		nueva.admitidas = 0;
+		nueva.suprimidas = 0;
+		nueva.sin_resumir = 0;
+		encontrada = cubetas_.insert(make_pair(clave, nueva)).first;
+	}
+	Cubeta& cubeta = encontrada->second;
+	cubeta.fichas = min(rafaga_, cubeta.fichas + chrono::duration<double>(ahora - cubeta.relleno).count() * lineas_por_segundo_);
+	cubeta.relleno = ahora;
+	
+	//Se admiten tantas líneas como fichas haya, y el resto se anota como suprimido. Los registros se admiten o
+	//se suprimen enteros: uno mayor que la ráfaga se admite con la cubeta llena, que queda en deuda hasta que se
+	//rellene por las líneas que ha aportado de más
+	unsigned long long admitidas = (cubeta.fichas > 0) ? min(lineas, (unsigned long long) cubeta.fichas) : 0;
+	if (registros) admitidas = (cubeta.fichas >= min((double) lineas, rafaga_)) ? lineas : 0;
+	cubeta.fichas = cubeta.fichas - admitidas;
+	cubeta.admitidas = cubeta.admitidas + admitidas;
+	cubeta.suprimidas = cubeta.suprimidas + (lineas - admitidas);
+	cubeta.sin_resumir = cubeta.sin_resumir + (lineas - admitidas);
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	//Si no se ha suprimido nada el Evento queda intacto, y si se ha suprimido todo se descarta sin más. En otro
+	//caso se conservan sus primeras líneas
+	if (admitidas == lineas) return true;
+	if (admitidas == 0) return false;
+	size_t corte = 0;
+	for (unsigned long long i = 0; i < admitidas; ++i) corte = descripcion.find('\n', corte) + 1;
+	descripcion.resize(corte - 1);
+	evento = Evento(evento.obtener_nombre(), evento.obtener_ubicacion(), descripcion, evento.obtener_origen());
+	return true;
+}
+
+std::vector<Evento> LimitadorDeTasa::obtenerResumenes (const unsigned int segundos)
+{
+	vector<Evento> resumenes;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Se genera un resumen por cada cubeta con líneas suprimidas sin resumir, que quedan resumidas
+	for (map<string, Cubeta>::iterator i = cubetas_.begin(); i != cubetas_.end(); ++i)
+	{
+		Cubeta& cubeta = i->second;
+		if (cubeta.sin_resumir == 0) continue;
+		resumenes.push_back(Evento(cubeta.nombre, cubeta.ubicacion, to_string(cubeta.sin_resumir) +
+			" líneas suprimidas de " + i->first + " en los últimos " + to_string(segundos) + " segundos (límite: " +
+			to_string((unsigned long long) lineas_por_segundo_) + " líneas por segundo)"));
+		cubeta.sin_resumir = 0;
+	}
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	return resumenes;
+}
+
+std::string LimitadorDeTasa::obtenerContadores (void)
+{
+	string contadores;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	for (map<string, Cubeta>::iterator i = cubetas_.begin(); i != cubetas_.end(); ++i)
+	{
+		if (!contadores.empty()) contadores.push_back('\n');
+		contadores = contadores + i->first + ' ' + to_string(i->second.admitidas) + ' ' + to_string(i->second.suprimidas);
+	}
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	return contadores;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _limitador_de_tasa_h_
+#define _limitador_de_tasa_h_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* Un LimitadorDeTasa limita el número de líneas por segundo que cada fichero aporta a los eventos difundidos,
+* de forma que un proceso que escribe en su registro sin control no inunde a todos los clientes ni deje sin
+* servicio a los demás ficheros. Cada fichero dispone de una cubeta de fichas (token bucket) que se rellena a la
+* tasa configurada hasta un máximo (la ráfaga); cada línea consume una ficha, y las que no la encuentran se
+* suprimen sin más coste que contarlas. Los eventos formados por registros de varias líneas (ver
+* EnsambladorDeRegistros) no se parten: se admiten o se suprimen enteros. Periódicamente se obtiene un resumen
+* de lo suprimido en cada fichero (ver obtenerResumenes), que se difunde en su lugar, y en todo momento los
+* contadores acumulados de cada fichero (ver obtenerContadores).
+* El LimitadorDeTasa es thread safe.
+*/
+class LimitadorDeTasa
+{
+	public:
+	
+	/**
+	* Constructor de la clase LimitadorDeTasa. Mientras no se configure, no limita nada
+	*/
+	LimitadorDeTasa (void): lineas_por_segundo_(0), rafaga_(0) {}
+	
+	/**
+	* Establece la tasa máxima de líneas de cada fichero
+	* @param lineasPorSegundo Líneas por segundo que admite cada fichero de forma sostenida, o 0 para no limitar
+	* @param rafaga Líneas que admite un fichero de una vez tras un periodo de calma. Si es menor que
+	* lineasPorSegundo, se toma lineasPorSegundo
+	*/
+	void configurar (const unsigned int lineasPorSegundo, const unsigned int rafaga);
+	
+	/**
+	* Indica si el LimitadorDeTasa limita las líneas de los ficheros
+	* @return true si se ha configurado una tasa máxima, false en caso contrario
+	*/
+	inline bool estaActivo (void) { return lineas_por_segundo_ > 0; }
+	
+	/**
+	* Aplica el límite de su fichero a un Evento: consume una ficha por cada una de sus líneas y suprime de su
+	* descripción las que no encuentran ficha, que quedan anotadas para el siguiente resumen. Si el Evento está
+	* formado por registros completos, se admite entero si la cubeta tiene fichas para todas sus líneas (o está
+	* llena, aunque no basten), y en otro caso se suprime entero
+	* @param evento Evento de monitorización, cuya descripción se recorta si es necesario
+	* @param registros Indica si el Evento está formado por registros completos, que no deben partirse
+	* @return true si el Evento conserva alguna línea y debe difundirse, false si se han suprimido todas
+	*/
+	bool limitar (Evento& evento, const bool registros);
+	
+	/**
+	* Obtiene un Evento de resumen por cada fichero con líneas suprimidas desde el resumen anterior, con el
+	* mismo nombre y ubicación que sus eventos y el número de líneas suprimidas en la descripción, de forma que
+	* los filtros de los clientes lo traten como a los del propio fichero
+	* @param segundos Periodo que abarca el resumen, que se indica en su descripción
+	* @return Eventos de resumen, uno por fichero con líneas suprimidas
+	*/
+	std::vector<Evento> obtenerResumenes (const unsigned int segundos);
+	
+	/**
+	* Obtiene los contadores acumulados de cada fichero que ha aportado alguna línea, uno por línea de texto:
+	* "ruta admitidas suprimidas"
+	* @return Contadores de todos los ficheros, o cadena vacía si ninguno ha aportado líneas
+	*/
+	std::string obtenerContadores (void);
+	
+	private:
+	
+	/**
+	* Cubeta de fichas de un fichero, con sus contadores
+	*/
+	struct Cubeta
+	{
+		std::string nombre;							///< Nombre del fichero
+		std::string ubicacion;						///< Ubicación del fichero
+		double fichas;								///< Líneas que el fichero puede aportar ahora (negativo si
+													///< ha admitido un registro mayor que la ráfaga)
+		std::chrono::steady_clock::time_point relleno;	///< Instante hasta el que se ha rellenado la cubeta
+		unsigned long long admitidas;				///< Líneas admitidas desde el inicio
+		unsigned long long suprimidas;				///< Líneas suprimidas desde el inicio
+		unsigned long long sin_resumir;				///< Líneas suprimidas desde el último resumen
+	};
+	
+	//Variables miembro
+	double lineas_por_segundo_;					///< Tasa de relleno de las cubetas
+	double rafaga_;								///< Capacidad de las cubetas
+	std::map<std::string, Cubeta> cubetas_;		///< Cubeta de cada fichero, por su ruta completa
+	std::mutex mutex_;							///< Mutex que protege las cubetas
+};
+
+} //namespace lognotify
+
+#endif //_limitador_de_tasa_h_
\ No newline at end of file
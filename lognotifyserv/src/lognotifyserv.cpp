@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <climits>
+#include <thread>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -33,13 +34,38 @@ int main (int argc, char** argv)
 	unsigned short puerto = 0;
 	string ruta_ficheros = "$HOME/.lognotify";
 	string ruta_registro = "/var/log";
+	unsigned long memoria_reenvio = 4096;
+	unsigned int aceptores = thread::hardware_concurrency();
+	if (aceptores == 0) aceptores = 1;
+	if (aceptores > 8) aceptores = 8;
+	unsigned int trabajadores = aceptores;
+	unsigned int segundos_latido = 10;
+	unsigned int segundos_inactividad = 30;
+	string ruta_local = "";
+	string anillo_compartido = "";
+	string grupo_multidifusion = "";
+	vector<string> origenes;
+	unsigned int lineas_por_segundo = 0;
+	unsigned int rafaga_lineas = 0;
+	unsigned int segundos_deduplicacion = 0;
+	bool deduplicar_cifras = false;
+	int descriptor_relevo = -1;
 	bool mostrar_ayuda = false;
 	bool error_parametros = false;
 	
+	//Se conservan los parámetros tal como se reciben (getopt puede reordenarlos) para ejecutar con ellos el
+	//proceso que tome el relevo, salvo el de uso interno con que se le indica que releva a este
+	vector<string> argumentos;
+	for (int i = 0; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-H") == 0) ++i;
+		else if (strncmp(argv[i], "-H", 2) != 0) argumentos.push_back(argv[i]);
+	}
+	
 	//Se procesan los parámetros de línea de comandos
 	opterr = 0;
 	int opcion = 0;
-	while ((opcion = getopt(argc, argv, "dp:f:w:h")) != -1)
+	while ((opcion = getopt(argc, argv, "dp:f:w:r:a:t:l:i:u:s:m:o:q:e:H:h")) != -1)
 	{
 		switch (opcion)
 		{
@@ -56,6 +82,62 @@ int main (int argc, char** argv)
 			case 'w':
 				ruta_registro = optarg;
 				break;
+			case 'r':
+				if (regex_match(optarg, regex("\\d{1,9}"))) memoria_reenvio = strtoul(optarg, nullptr, 10);
+				else error_parametros = true;
+				break;
+			case 'a':
+				if (regex_match(optarg, regex("\\d{1,2}")) && (atoi(optarg) > 0)) aceptores = atoi(optarg);
+				else error_parametros = true;
+				break;
+			case 't':
+				if (regex_match(optarg, regex("\\d{1,2}")) && (atoi(optarg) > 0)) trabajadores = atoi(optarg);
+				else error_parametros = true;
+				break;
+			case 'l':
+				if (regex_match(optarg, regex("\\d{1,4}")) && (atoi(optarg) > 0)) segundos_latido = atoi(optarg);
+				else error_parametros = true;
+				break;
+			case 'i':
+				if (regex_match(optarg, regex("\\d{1,4}")) && (atoi(optarg) > 0)) segundos_inactividad = atoi(optarg);
+				else error_parametros = true;
+				break;
+			case 'u':
+				ruta_local = optarg;
+				break;
+			case 's':
+				if (regex_match(optarg, regex("/[^/]{1,200}"))) anillo_compartido = optarg;
+				else error_parametros = true;
+				break;
+			case 'm':
+				if (regex_match(optarg, regex("(\\[[0-9A-Fa-f:.]+\\]|[0-9.]+):\\d{1,5}"))) grupo_multidifusion = optarg;
+				else error_parametros = true;
+				break;
+			case 'o':
+				if (regex_match(optarg, regex("[^/\\s]+/\\d{1,5}"))) origenes.push_back(optarg);
+				else error_parametros = true;
+				break;
+			case 'q':
+				if (regex_match(optarg, regex("\\d{1,7}(:\\d{1,7})?")) && (atoi(optarg) > 0))
+				{
+					lineas_por_segundo = atoi(optarg);
+					const char *rafaga = strchr(optarg, ':');
+					rafaga_lineas = (rafaga != nullptr) ? atoi(rafaga + 1) : lineas_por_segundo;
+				}
+				else error_parametros = true;
+				break;
+			case 'e':
+				if (regex_match(optarg, regex("\\d{1,4}(:cifras)?")) && (atoi(optarg) > 0))
+				{
+					segundos_deduplicacion = atoi(optarg);
+					deduplicar_cifras = (strchr(optarg, ':') != nullptr);
+				}
+				else error_parametros = true;
+				break;
+			case 'H':
+				if (regex_match(optarg, regex("\\d{1,9}"))) descriptor_relevo = atoi(optarg);
+				else error_parametros = true;
+				break;
 			case 'h':
 				mostrar_ayuda = true;
 				break;
@@ -71,6 +153,7 @@ int main (int argc, char** argv)
 	}
 	if (optind < argc) error_parametros = true;
 	if (puerto == 0) error_parametros = true;
+	if (segundos_inactividad < segundos_latido) error_parametros = true;
 		
 	//Si ha habido errores o se ha pedido la ayuda, se muestra en pantalla y se termina
 	if (error_parametros) cout << "El formato de los parámetros es incorrecto" << endl;
@@ -81,12 +164,25 @@ int main (int argc, char** argv)
 		cout << "-d Ejecutar lognotifyserv como demonio" << endl;
 		cout << "-f Especificar ruta alternativa a $HOME/.lognotify (ej. -f /mis/ficheros)" << endl;
 		cout << "-w Especificar ruta alternativa a /var/log (ej. -w /mis/logs)" << endl;
+		cout << "-r Especificar memoria en KiB para reenviar eventos a clientes reconectados (ej. -r 4096, por defecto)" << endl;
+		cout << "-a Especificar número de hilos que aceptan conexiones (ej. -a 4; por defecto, uno por núcleo hasta 8)" << endl;
+		cout << "-t Especificar número de hilos que envían los eventos a los clientes (ej. -t 4; por defecto, uno por núcleo hasta 8)" << endl;
+		cout << "-l Especificar segundos entre latidos a los clientes (ej. -l 10, por defecto)" << endl;
+		cout << "-i Especificar segundos sin noticias de un cliente tras los que se da por perdido (ej. -i 30, por defecto)" << endl;
+		cout << "-u Aceptar también clientes locales en un socket de dominio UNIX (ej. -u /run/lognotify.sock)" << endl;
+		cout << "-s Publicar todos los eventos en un anillo de memoria compartida para lectores locales (ej. -s /lognotify)" << endl;
+		cout << "-m Difundir además los eventos a un grupo de multidifusión UDP de la red local (ej. -m 239.255.0.1:5700)" << endl;
+		cout << "-o Reenviar también los eventos de otro servidor, como repetidor; puede repetirse (ej. -o servidor1/5556)" << endl;
+		cout << "-q Limitar las líneas por segundo de cada fichero, y opcionalmente su ráfaga; las que excedan el límite se resumen periódicamente (ej. -q 100:1000)" << endl;
+		cout << "-e Colapsar las líneas repetidas de cada fichero durante los segundos indicados en la primera y un resumen de sus repeticiones; con :cifras, también las que sólo difieren en sus cifras (ej. -e 30:cifras)" << endl;
 		cout << "-h Mostrar ayuda de ejecución de lognotifyserv (no se ejecutará el programa)" << endl;
+		cout << "Para actualizar lognotifyserv sin desconectar a los clientes, envíele la señal SIGUSR2: ejecutará de nuevo su binario, que tomará el relevo (-H es de uso interno)" << endl;
 		return 0;
 	}
 	
-	//Si se ha pedido ejecutar el programa como demonio, se realiza el proceso correspondiente
-	if (demonio)
+	//Si se ha pedido ejecutar el programa como demonio, se realiza el proceso correspondiente. El proceso que
+	//toma el relevo a otro ya se ejecuta como tal
+	if (demonio && (descriptor_relevo < 0))
 	{
 		pid_t pid, sid;
         
@@ -113,12 +209,12 @@ int main (int argc, char** argv)
         close(STDERR_FILENO);
 	}
 	
-	//Se carga la lista de ficheros a monitorizar del fichero indicado
+	//Se carga la lista de ficheros a monitorizar del fichero indicado, que puede no existir en modo repetidor
 	vector<string> ficheros;
 	ifstream fichero_ficheros_registro;
 	string linea;
 	fichero_ficheros_registro.open(ruta_ficheros + "/ficheros");
-	if(!fichero_ficheros_registro.is_open())
+	if(!fichero_ficheros_registro.is_open() && origenes.empty())
 	{
 		if (!demonio) cout << "No se ha podido inicializar Lognotify. No se ha encontrado \'ficheros\' en la ubicación indicada, o ha sido imposible abrirlo";
 		return -1;
@@ -132,12 +228,28 @@ int main (int argc, char** argv)
 		}
 	}
 	fichero_ficheros_registro.close();
+	
+	//Se cargan las reglas de ensamblado de registros de varias líneas del fichero "multilinea", si existe, junto
+	//a la lista de ficheros. Cada línea contiene un fichero y su regla; las que comienzan por '#' se ignoran
+	vector<string> reglas_multilinea;
+	ifstream fichero_multilinea;
+	fichero_multilinea.open(ruta_ficheros + "/multilinea");
+	while (getline(fichero_multilinea, linea))
+	{
+		if (regex_match(linea, regex("[\\s\\t]*[^\\s\\t#].*")))
+		{
+			reglas_multilinea.push_back(linea.substr(linea.find_first_not_of(" \t")));
+		}
+	}
+	fichero_multilinea.close();
 		
-	//Se crea e inicializa una instancia de ServidorDeNotificaciones, poniéndola a hacer su función
+	//Se crea e inicializa una instancia de ServidorDeNotificaciones, poniéndola a hacer su función. El relevo
+	//se habilita antes de inicializarla, pues afecta a todos los hilos que cree
 	ServidorDeNotificaciones servidor;
-	if (!servidor.inicializar(puerto, ruta_registro, ficheros))
+	if (!servidor.habilitarRelevo(argumentos) && !demonio) cout << "No se podrá relevar a lognotifyserv con SIGUSR2" << endl;
+	if (!servidor.inicializar(puerto, ruta_registro, ficheros, memoria_reenvio * 1024, aceptores, trabajadores, segundos_latido, segundos_inactividad, ruta_local, anillo_compartido, grupo_multidifusion, origenes, lineas_por_segundo, rafaga_lineas, segundos_deduplicacion, deduplicar_cifras, reglas_multilinea, descriptor_relevo))
 	{
-		if (!demonio) cout << "No se ha podido inicializar Lognotify. Es posible que no se haya proporcionado una lista de 1+ ficheros de registro que monitorizar en el fichero \"ficheros\" o que ninguno sea válido" << endl;
+		if (!demonio) cout << "No se ha podido inicializar Lognotify. Es posible que no se haya proporcionado una lista de 1+ ficheros de registro que monitorizar en el fichero \"ficheros\" o que ninguno sea válido, o que alguna regla del fichero \"multilinea\" no lo sea" << endl;
 		return -1;
 	}
 	servidor.darServicio();
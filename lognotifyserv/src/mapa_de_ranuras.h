@@ -0,0 +1,188 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _mapa_de_ranuras_h_
+#define _mapa_de_ranuras_h_
+
+#include <vector>
+#include <utility>
+
+namespace lognotify
+{
+
+/**
+* Un MapaDeRanuras es un contenedor que asigna a cada elemento insertado una llave estable, válida hasta su
+* eliminación, con inserción y eliminación en tiempo constante amortizado y acceso por llave en tiempo
+* constante. Los elementos se guardan de forma contigua para poder recorrerlos eficientemente (sus posiciones
+* sí cambian al eliminar otros), y cada llave se compone de una ranura, que sí es fija mientras el elemento
+* existe, y de la generación de dicha ranura, que cambia cada vez que ésta se libera: una llave de un elemento
+* ya eliminado nunca identifica a otro elemento, aunque ocupe su misma ranura. La ranura de una llave (ver
+* obtener_ranura) puede usarse, por ejemplo, para repartir los elementos de forma estable.
+* Estos costes son los del propio contenedor: quien lo publica por copia en escritura (ver TablaDeClientes)
+* paga además la copia completa, lineal en el número de elementos, en cada modificación.
+* El MapaDeRanuras NO es thread safe; su acceso debe protegerse externamente.
+*/
+template <typename T>
+class MapaDeRanuras
+{
+	public:
+	
+	/**
+	* Llave que identifica a un elemento del MapaDeRanuras. El valor 0 no es nunca una llave válida
+	*/
+	typedef unsigned long long Llave;
+	
+	/**
+	* Constructor de la clase MapaDeRanuras
+	*/
+	MapaDeRanuras (void): primera_libre_(NINGUNA_) {}
+	
+	/**
+	* Inserta un elemento en el MapaDeRanuras
+	* @param elemento Elemento que desea insertarse
+	* @return Llave asignada al elemento
+	*/
+	Llave insertar (T elemento)
+	{
+		//Se reutiliza la primera ranura libre o, si no hay ninguna, se crea una nueva
+		unsigned int ranura = primera_libre_;
+		if (ranura == NINGUNA_)
+		{
+			ranura = ranuras_.size();
+			ranuras_.push_back(Ranura {0, 1});
+		}
+		else primera_libre_ = ranuras_[ranura].indice;
+		
+		//El elemento se inserta al final de los elementos, y la ranura apunta a su posición
+		ranuras_[ranura].indice = elementos_.size();
+		elementos_.push_back(std::move(elemento));
+		ranuras_de_elementos_.push_back(ranura);
+		return componerLlave(ranura, ranuras_[ranura].generacion);
+	}
+	
+	/**
+	* Elimina un elemento del MapaDeRanuras. La posición del elemento pasa a ocuparla el último de ellos
+	* @param llave Llave del elemento que desea eliminarse
+	* @return true si el elemento ha sido eliminado, false si la llave no corresponde a ningún elemento
+	*/
+	bool eliminar (const Llave llave)
+	{
+		if (obtener(llave) == nullptr) return false;
+		unsigned int ranura = obtener_ranura(llave);
+		unsigned int indice = ranuras_[ranura].indice;
+		
+		//Se mueve el último elemento a la posición del eliminado, actualizando la ranura que le apunta
+		elementos_[indice] = std::move(elementos_.back());
+		ranuras_de_elementos_[indice] = ranuras_de_elementos_.back();
+		ranuras_[ranuras_de_elementos_[indice]].indice = indice;
+		elementos_.pop_back();
+		ranuras_de_elementos_.pop_back();
+		
+		//La ranura pasa a una nueva generación, invalidando la llave, y se añade a la lista de libres
+		if (++ranuras_[ranura].generacion == 0) ranuras_[ranura].generacion = 1;
+		ranuras_[ranura].indice = primera_libre_;
+		primera_libre_ = ranura;
+		return true;
+	}
+	
+	/**
+	* Obtiene el elemento correspondiente a una llave
+	* @param llave Llave del elemento
+	* @return Puntero al elemento, válido hasta la siguiente modificación del MapaDeRanuras, o nullptr si la
+	* llave no corresponde a ningún elemento
+	*/
+	T* obtener (const Llave llave)
+	{
+		unsigned int ranura = obtener_ranura(llave);
+		if ((ranura >= ranuras_.size()) || (ranuras_[ranura].generacion != (unsigned int) (llave >> 32)))
+			return nullptr;
+		return &elementos_[ranuras_[ranura].indice];
+	}
+	
+	/**
+	* Versión constante de obtener
+	* @param llave Llave del elemento
+	* @return Puntero al elemento, o nullptr si la llave no corresponde a ningún elemento
+	*/
+	const T* obtener (const Llave llave) const
+	{
+		return const_cast<MapaDeRanuras*>(this)->obtener(llave);
+	}
+	
+	/**
+	* Devuelve el número de elementos del MapaDeRanuras
+	* @return Número de elementos
+	*/
+	inline unsigned int tamano (void) const { return elementos_.size(); }
+	
+	/**
+	* Obtiene el elemento que ocupa una posición, para recorrer todos los elementos
+	* @param indice Posición del elemento, entre 0 y tamano() - 1
+	* @return Elemento que ocupa la posición
+	*/
+	inline T& obtener_elemento (const unsigned int indice) { return elementos_[indice]; }
+	
+	/**
+	* Versión constante de obtener_elemento
+	* @param indice Posición del elemento, entre 0 y tamano() - 1
+	* @return Elemento que ocupa la posición
+	*/
+	inline const T& obtener_elemento (const unsigned int indice) const { return elementos_[indice]; }
+	
+	/**
+	* Obtiene la llave del elemento que ocupa una posición
+	* @param indice Posición del elemento, entre 0 y tamano() - 1
+	* @return Llave del elemento que ocupa la posición
+	*/
+	inline Llave obtener_llave (const unsigned int indice) const
+	{
+		unsigned int ranura = ranuras_de_elementos_[indice];
+		return componerLlave(ranura, ranuras_[ranura].generacion);
+	}
+	
+	/**
+	* Devuelve la ranura que ocupa el elemento de una llave, fija mientras el elemento existe
+	* @param llave Llave del elemento
+	* @return Ranura del elemento
+	*/
+	inline static unsigned int obtener_ranura (const Llave llave) { return (unsigned int) llave; }
+	
+	private:
+	
+	/**
+	* Ranura del MapaDeRanuras: posición del elemento que la ocupa (o, si está libre, siguiente ranura libre) y
+	* generación actual
+	*/
+	struct Ranura
+	{
+		unsigned int indice;		///< Posición del elemento, o siguiente ranura libre
+		unsigned int generacion;	///< Generación de la ranura (nunca 0)
+	};
+	
+	/**
+	* Compone la llave correspondiente a una ranura y generación
+	* @param ranura Ranura del elemento
+	* @param generacion Generación de la ranura
+	* @return Llave compuesta
+	*/
+	inline static Llave componerLlave (const unsigned int ranura, const unsigned int generacion)
+	{
+		return (((Llave) generacion) << 32) | ranura;
+	}
+	
+	//Constantes
+	constexpr static unsigned int NINGUNA_ = 0xFFFFFFFF;	///< Marca de fin de la lista de ranuras libres
+	
+	//Variables miembro
+	std::vector<T> elementos_;						///< Elementos, de forma contigua
+	std::vector<unsigned int> ranuras_de_elementos_;	///< Ranura de cada elemento, por posición
+	std::vector<Ranura> ranuras_;					///< Ranuras, ocupadas o libres
+	unsigned int primera_libre_;					///< Primera ranura de la lista de libres
+};
+
+} //namespace lognotify
+
+#endif //_mapa_de_ranuras_h_
\ No newline at end of file
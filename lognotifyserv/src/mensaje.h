@@ -8,13 +8,20 @@
 #define _mensaje_h_
 
 #include <cstring>
+#include <memory>
+#include <vector>
+#include <mutex>
 
 namespace lognotify
 {
 
 /**
 * La clase Mensaje encapsula un buffer con datos para enviar mediante una comunicación de red asegurando que
-* su contenido permanezca inalterable hasta su destrucción
+* su contenido permanezca inalterable hasta su destrucción. El buffer puede comenzar con una cabecera que sólo
+* se envía a los destinatarios que la entienden (por ejemplo el número de secuencia de un evento, que los
+* clientes antiguos no esperan); al resto se les envía el mensaje a partir del final de la cabecera.
+* Junto al mensaje se conservan sus codificaciones en otros formatos (ver obtener_codificacion), que se generan
+* sólo cuando algún destinatario las necesita y se comparten entre todos los que usan el mismo formato
 */
 class Mensaje
 {
@@ -25,8 +32,11 @@ class Mensaje
 	* @param buffer Puntero al primer byte del buffer que contiene el mensaje. El contenido del buffer será
 	* copiado por lo que puede ser liberado inmediatamente después de la llamada al constructor
 	* @param longitud Longitud en bytes del buffer
+	* @param longitudCabecera Longitud en bytes de la cabecera con que comienza el buffer (0 si no tiene)
 	*/
-	Mensaje (const char *buffer, const unsigned int longitud): longitud_(longitud)
+	Mensaje (const char *buffer, const unsigned int longitud, const unsigned int longitudCabecera = 0):
+		longitud_(longitud),
+		longitud_cabecera_(longitudCabecera)
 	{
 		inicio_ = new char [longitud];
 		memcpy(inicio_, buffer, longitud);
@@ -36,7 +46,7 @@ class Mensaje
 	* Constructor-copia de la clase Mensaje
 	* @param origen Objeto Mensaje orígen de la copia
 	*/
-	Mensaje (const Mensaje& origen): longitud_(origen.longitud_)
+	Mensaje (const Mensaje& origen): longitud_(origen.longitud_), longitud_cabecera_(origen.longitud_cabecera_)
 	{
 		inicio_ = new char [origen.longitud_];
 		memcpy(inicio_, origen.inicio_, origen.longitud_);
@@ -46,7 +56,7 @@ class Mensaje
 	* Constructor-mover de la clase Mensaje
 	* @param origen Objeto Mensaje orígen del movimiento
 	*/
-	Mensaje (Mensaje&& origen): longitud_(origen.longitud_)
+	Mensaje (Mensaje&& origen): longitud_(origen.longitud_), longitud_cabecera_(origen.longitud_cabecera_)
 	{
 		inicio_ = origen.inicio_;
 		origen.inicio_ = nullptr;
@@ -66,12 +76,42 @@ class Mensaje
 	*/
 	inline unsigned int obtener_longitud (void) { return longitud_; }
 	
+	/**
+	* Devuelve la longitud en bytes de la cabecera con que comienza el mensaje
+	* @return Longitud en bytes de la cabecera, 0 si el mensaje no tiene cabecera
+	*/
+	inline unsigned int obtener_longitud_cabecera (void) { return longitud_cabecera_; }
+	
 	/**
 	* Devuelve un puntero al primer byte del mensaje
 	* @return Puntero al primer byte del mensaje
 	*/
 	inline char* obtener_inicio (void) { return inicio_; }
 	
+	/**
+	* Devuelve la codificación del mensaje en otro formato, generándola sólo la primera vez que se solicita.
+	* Aunque se solicite desde varios hilos a la vez, se genera una única vez y todos comparten el mismo
+	* Mensaje, que se conserva mientras exista éste. Las copias de un mensaje no conservan sus codificaciones
+	* @param formato Identificador del formato, mayor que 0
+	* @param generar Función que genera la codificación a partir del mensaje y el formato
+	* @return Mensaje con la codificación del mensaje en el formato indicado
+	*/
+	std::shared_ptr<Mensaje> obtener_codificacion (	const unsigned int formato,
+													Mensaje (*generar)(Mensaje&, const unsigned int)	)
+	{
+		//Se adquiere el mutex
+		mutex_codificaciones_.lock();
+		
+		//Si la codificación todavía no existe, se genera y se conserva
+		if (codificaciones_.size() <= formato) codificaciones_.resize(formato + 1);
+		if (!codificaciones_[formato]) codificaciones_[formato] = std::make_shared<Mensaje> (generar(*this, formato));
+		std::shared_ptr<Mensaje> codificacion = codificaciones_[formato];
+		
+		//Se libera el mutex
+		mutex_codificaciones_.unlock();
+		return codificacion;
+	}
+	
 	/**
 	* Operador de asignación-copia
 	* @param origen Objeto Mensaje orígen de la copia en la asignación
@@ -81,6 +121,8 @@ class Mensaje
 	{
 		if (this == &origen) return *this;
 		longitud_ = origen.longitud_;
+		longitud_cabecera_ = origen.longitud_cabecera_;
+		codificaciones_.clear();
 		inicio_ = new char [origen.longitud_];
 		memcpy(inicio_, origen.inicio_, origen.longitud_);
 		return *this;
@@ -95,6 +137,8 @@ class Mensaje
 	{
 		if (this == &origen) return *this;
 		longitud_ = origen.longitud_;
+		longitud_cabecera_ = origen.longitud_cabecera_;
+		codificaciones_.clear();
 		inicio_ = origen.inicio_;
 		origen.inicio_ = nullptr;
 		return *this;
@@ -104,7 +148,10 @@ class Mensaje
 	
 	//Variables miembro
 	unsigned int longitud_;		///< Longitud de buffer del mensaje (número de bytes)
+	unsigned int longitud_cabecera_;	///< Longitud de la cabecera al comienzo del buffer (número de bytes)
 	char* inicio_;				///< Puntero al primer byte del buffer de mensaje
+	std::vector<std::shared_ptr<Mensaje>> codificaciones_;	///< Codificaciones en otros formatos, por formato
+	std::mutex mutex_codificaciones_;	///< Mutex que protege las codificaciones
 };
 
 } //namespace lognotify
@@ -0,0 +1,289 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "minador_de_plantillas.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#include "evento.h"
+#include "analizador_de_syslog.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr const char* MinadorDePlantillas::PARAMETRO_;
+
+MinadorDePlantillas::MinadorDePlantillas (void):
+	usuarios_(0),
+	siguiente_identificador_(1),
+	usos_(0)
+{
+	raiz_.plantillas = 0;
+}
+
+void MinadorDePlantillas::minar (Evento& evento)
+{
+	//Si nadie utiliza las plantillas no se mina nada, sin copiar siquiera la descripción
+	if (usuarios_.load() == 0) return;
+	string nombre = evento.obtener_nombre();
+	string descripcion = evento.obtener_descripcion();
+	
+	//Las líneas se dividen en palabras antes de adquirir el mutex. Si tienen cabecera de syslog, sólo se
+	//considera su mensaje, precedido del programa que la escribió, pues la fecha y el host varían en cada línea
+	vector<Linea> lineas;
+	AnalizadorDeSyslog::Campos cabecera;
+	size_t inicio = 0;
+	while (inicio < descripcion.length())
+	{
+		size_t fin = descripcion.find('\n', inicio);
+		if (fin == string::npos) fin = descripcion.length();
+		Linea linea;
+		linea.inicio = descripcion.data() + inicio;
+		linea.longitud = fin - inicio;
+		AnalizadorDeSyslog::analizar(linea.inicio, linea.longitud, cabecera);
+		if (cabecera.longitud[AnalizadorDeSyslog::CAMPO_PROGRAMA] > 0)
+			linea.palabras.emplace_back(linea.inicio + cabecera.inicio[AnalizadorDeSyslog::CAMPO_PROGRAMA],
+				cabecera.longitud[AnalizadorDeSyslog::CAMPO_PROGRAMA]);
+		dividir(linea.inicio + cabecera.inicio[AnalizadorDeSyslog::CAMPO_MENSAJE],
+			cabecera.longitud[AnalizadorDeSyslog::CAMPO_MENSAJE], linea.palabras);
+		if (!linea.palabras.empty()) lineas.push_back(move(linea));
+		inicio = fin + 1;
+	}
+	if (lineas.empty()) return;
+	long long ahora = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	for (unsigned int i = 0; i < lineas.size(); ++i) asignar(lineas[i], nombre, ahora);
+	
+	//Se libera el mutex
+	mutex_.unlock();
+}
+
+std::vector<MinadorDePlantillas::Plantilla> MinadorDePlantillas::resumir (void)
+{
+	vector<Plantilla> plantillas;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	for (list<Grupo>::iterator grupo = grupos_.begin(); grupo != grupos_.end(); ++grupo)
+	{
+		if (grupo->plantilla.lineas == 0) continue;
+		plantillas.push_back(grupo->plantilla);
+		grupo->plantilla.lineas = 0;
+	}
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	return plantillas;
+}
+
+std::vector<MinadorDePlantillas::Plantilla> MinadorDePlantillas::consultar (void)
+{
+	vector<Plantilla> plantillas;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	for (list<Grupo>::iterator grupo = grupos_.begin(); grupo != grupos_.end(); ++grupo)
+		plantillas.push_back(grupo->plantilla);
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	return plantillas;
+}
+
+void MinadorDePlantillas::dividir (const char* linea, const size_t longitud, std::vector<std::string>& palabras)
+{
+	size_t posicion = 0;
+	while ((posicion < longitud) && (palabras.size() < MAX_PALABRAS_))
+	{
+		//Se saltan los separadores entre palabras
+		if ((linea[posicion] == ' ') || (linea[posicion] == '\t'))
+		{
+			++posicion;
+			continue;
+		}
+		
+		//Las palabras con dígitos (números, direcciones, fechas, identificadores...) y las demasiado largas
+		//(resúmenes, datos codificados...) son casi siempre parámetros
+		size_t comienzo = posicion;
+		bool digitos = false;
+		for (; (posicion < longitud) && (linea[posicion] != ' ') && (linea[posicion] != '\t'); ++posicion)
+			if ((linea[posicion] >= '0') && (linea[posicion] <= '9')) digitos = true;
+		if (digitos || (posicion - comienzo > MAX_LONGITUD_PALABRA_)) palabras.push_back(PARAMETRO_);
+		else palabras.emplace_back(linea + comienzo, posicion - comienzo);
+	}
+}
+
+void MinadorDePlantillas::asignar (const Linea& linea, const std::string& fichero, const long long ahora)
+{
+	//Se busca en la hoja de la línea la plantilla que más palabras comparte con ella, prefiriendo a igualdad la
+	//que más parámetros tiene. Un parámetro de la plantilla sólo cuenta como palabra compartida si la línea
+	//también tiene un parámetro en su lugar
+	const vector<string>& palabras = linea.palabras;
+	vector<string> ruta;
+	Nodo *hoja = buscarHoja(palabras, ruta);
+	list<Grupo>::iterator elegido = grupos_.end();
+	unsigned int mas_iguales = 0, mas_parametros = 0;
+	for (unsigned int i = 0; (hoja != nullptr) && (i < hoja->grupos.size()); ++i)
+	{
+		const vector<string>& plantilla = hoja->grupos[i]->palabras;
+		unsigned int iguales = 0, parametros = 0;
+		for (unsigned int j = 0; j < palabras.size(); ++j)
+		{
+			if (plantilla[j] == palabras[j]) ++iguales;
+			else if (plantilla[j] == PARAMETRO_) ++parametros;
+		}
+		if ((elegido == grupos_.end()) || (iguales > mas_iguales) ||
+			((iguales == mas_iguales) && (parametros > mas_parametros)))
+		{
+			elegido = hoja->grupos[i];
+			mas_iguales = iguales;
+			mas_parametros = parametros;
+		}
+	}
+	
+	//Si la línea comparte con ella al menos la mitad de sus palabras, se le asigna, convirtiendo en parámetros
+	//las palabras en que difieren, y pasa a ser la utilizada más recientemente
+	if ((elegido != grupos_.end()) && (2 * mas_iguales >= palabras.size()))
+	{
+		Grupo& grupo = *elegido;
+		bool generalizada = false;
+		for (unsigned int i = 0; i < palabras.size(); ++i)
+		{
+			if ((grupo.palabras[i] == palabras[i]) || (grupo.palabras[i] == PARAMETRO_)) continue;
+			grupo.palabras[i] = PARAMETRO_;
+			generalizada = true;
+		}
+		if (generalizada)
+		{
+			grupo.plantilla.texto = grupo.palabras[0];
+			for (unsigned int i = 1; i < grupo.palabras.size(); ++i)
+				grupo.plantilla.texto = grupo.plantilla.texto + ' ' + grupo.palabras[i];
+		}
+		++grupo.plantilla.lineas;
+		++grupo.plantilla.total;
+		grupo.uso = ++usos_;
+		grupos_.splice(grupos_.begin(), grupos_, elegido);
+		return;
+	}
+	
+	//En caso contrario la línea forma una plantilla nueva. Si su hoja está completa se descarta antes la
+	//utilizada hace más tiempo de la hoja, de forma que la búsqueda en ella siga siendo breve, y si lo está la
+	//tabla, la utilizada hace más tiempo de todas, lo que puede podar los nodos que conducen a la hoja
+	if ((hoja != nullptr) && (hoja->grupos.size() >= MAX_PLANTILLAS_HOJA_))
+	{
+		list<Grupo>::iterator antiguo = hoja->grupos[0];
+		for (unsigned int i = 1; i < hoja->grupos.size(); ++i)
+			if (hoja->grupos[i]->uso < antiguo->uso) antiguo = hoja->grupos[i];
+		descartar(antiguo);
+		buscarHoja(palabras, ruta);
+	}
+	if (grupos_.size() >= MAX_PLANTILLAS_)
+	{
+		descartar(prev(grupos_.end()));
+		buscarHoja(palabras, ruta);
+	}
+	Nodo *nodo = &raiz_;
+	++nodo->plantillas;
+	for (unsigned int i = 0; i < ruta.size(); ++i)
+	{
+		unique_ptr<Nodo>& hijo = nodo->hijos[ruta[i]];
+		if (!hijo)
+		{
+			hijo.reset(new Nodo);
+			hijo->plantillas = 0;
+		}
+		nodo = hijo.get();
+		++nodo->plantillas;
+	}
+	
+	//La línea de ejemplo se trunca, si es preciso, sin partir ningún carácter UTF-8
+	size_t longitud = linea.longitud;
+	if (longitud > MAX_LONGITUD_EJEMPLO_)
+	{
+		longitud = MAX_LONGITUD_EJEMPLO_;
+		while ((longitud > 0) && ((linea.inicio[longitud] & 0xC0) == 0x80)) --longitud;
+	}
+	grupos_.emplace_front();
+	Grupo& grupo = grupos_.front();
+	grupo.palabras = palabras;
+	grupo.ruta = move(ruta);
+	grupo.plantilla.identificador = siguiente_identificador_++;
+	grupo.plantilla.texto = palabras[0];
+	for (unsigned int i = 1; i < palabras.size(); ++i)
+		grupo.plantilla.texto = grupo.plantilla.texto + ' ' + palabras[i];
+	grupo.plantilla.fichero = fichero;
+	grupo.plantilla.ejemplo.assign(linea.inicio, longitud);
+	grupo.plantilla.primera = ahora;
+	grupo.plantilla.lineas = 1;
+	grupo.plantilla.total = 1;
+	grupo.uso = ++usos_;
+	nodo->grupos.push_back(grupos_.begin());
+}
+
+MinadorDePlantillas::Nodo* MinadorDePlantillas::buscarHoja (	const std::vector<std::string>& palabras,
+															std::vector<std::string>& ruta	)
+{
+	//El primer nivel del árbol es el número de palabras, y los siguientes las primeras palabras. Una palabra
+	//sin nodo propio en un nodo que ya tiene demasiados hijos comparte el de los parámetros, de forma que el
+	//árbol no crezca sin control con líneas que comienzan por palabras distintas
+	ruta.clear();
+	Nodo *nodo = &raiz_;
+	unsigned int niveles = 1 + ((palabras.size() < PALABRAS_RUTA_) ? palabras.size() : PALABRAS_RUTA_);
+	for (unsigned int i = 0; i < niveles; ++i)
+	{
+		string clave = (i == 0) ? to_string(palabras.size()) : palabras[i - 1];
+		if (nodo != nullptr)
+		{
+			unordered_map<string, unique_ptr<Nodo>>::iterator hijo = nodo->hijos.find(clave);
+			if ((hijo == nodo->hijos.end()) && (i > 0) && (nodo->hijos.size() >= MAX_HIJOS_))
+			{
+				clave = PARAMETRO_;
+				hijo = nodo->hijos.find(clave);
+			}
+			nodo = (hijo != nodo->hijos.end()) ? hijo->second.get() : nullptr;
+		}
+		ruta.push_back(move(clave));
+	}
+	return nodo;
+}
+
+void MinadorDePlantillas::descartar (std::list<Grupo>::iterator descartado)
+{
+	//Se descuenta la plantilla en cada nodo de su ruta, podando el primero que quede vacío y, con él, todos
+	//los que cuelgan de él. Si no queda ninguno vacío, se retira la plantilla de su hoja
+	const vector<string>& ruta = descartado->ruta;
+	Nodo *nodo = &raiz_;
+	--nodo->plantillas;
+	for (unsigned int i = 0; (i < ruta.size()) && (nodo != nullptr); ++i)
+	{
+		unordered_map<string, unique_ptr<Nodo>>::iterator hijo = nodo->hijos.find(ruta[i]);
+		if (--hijo->second->plantillas > 0) nodo = hijo->second.get();
+		else
+		{
+			nodo->hijos.erase(hijo);
+			nodo = nullptr;
+		}
+	}
+	if (nodo != nullptr) nodo->grupos.erase(find(nodo->grupos.begin(), nodo->grupos.end(), descartado));
+	grupos_.erase(descartado);
+}
+
+} //namespace lognotify
\ No newline at end of file
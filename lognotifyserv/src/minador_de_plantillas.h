@@ -0,0 +1,182 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _minador_de_plantillas_h_
+#define _minador_de_plantillas_h_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* El MinadorDePlantillas agrupa en línea las líneas de los eventos por su plantilla, la forma común de las líneas
+* que sólo se diferencian en sus parámetros (por ejemplo, "Failed password for <*> from <*> port <*> ssh2"), de
+* forma que a los clientes que resumen la corriente les baste conocer qué clases de líneas aparecen y cuántas.
+* Sigue el método de Drain: las palabras de cada línea (sólo el mensaje, con el programa delante, si tiene
+* cabecera de syslog) se clasifican en un árbol de profundidad fija, cuyo primer nivel es el número de palabras
+* y los siguientes las primeras palabras de la línea; cada hoja contiene como mucho MAX_PLANTILLAS_HOJA_
+* plantillas, y la línea se asigna a la más parecida, siempre que coincida en al menos la mitad de sus
+* palabras, convirtiendo en parámetro "<*>" las que difieren. En caso contrario forma una plantilla nueva, que
+* en una hoja completa sustituye a la utilizada hace más tiempo de la hoja. Las palabras que contienen
+* dígitos, o que son demasiado largas, se tratan siempre como parámetros. Así, asignar una línea cuesta un
+* tiempo proporcional a su número de palabras.
+* La tabla de plantillas está acotada: al alcanzar el máximo se descarta la utilizada hace más tiempo, y con
+* ella las ramas del árbol que sólo conducían a ella. Sólo se minan las líneas mientras algún cliente lo
+* necesita (ver activar).
+* El MinadorDePlantillas es thread safe.
+*/
+class MinadorDePlantillas
+{
+	public:
+	
+	/**
+	* Plantilla de la tabla, tal como se entrega a los clientes
+	*/
+	struct Plantilla
+	{
+		unsigned long long identificador;			///< Identificador de la plantilla, que no se reasigna
+		std::string texto;							///< Palabras de la plantilla, con "<*>" en los parámetros
+		std::string fichero;						///< Nombre del fichero de su primera línea
+		std::string ejemplo;						///< Primera línea asignada, posiblemente truncada
+		long long primera;							///< Instante de su primera línea, en segundos desde 1970
+		unsigned long long lineas;					///< Líneas asignadas desde el último resumen
+		unsigned long long total;					///< Líneas asignadas desde su primera línea
+	};
+	
+	/**
+	* Constructor de la clase MinadorDePlantillas
+	*/
+	MinadorDePlantillas (void);
+	
+	/**
+	* Anota un usuario más del MinadorDePlantillas. Mientras haya alguno, se minan las líneas de los eventos
+	*/
+	inline void activar (void) { usuarios_.fetch_add(1); }
+	
+	/**
+	* Retira un usuario del MinadorDePlantillas. Cada llamada a activar debe corresponderse con una llamada a
+	* desactivar. Las plantillas ya conocidas se conservan
+	*/
+	inline void desactivar (void) { usuarios_.fetch_sub(1); }
+	
+	/**
+	* Asigna una plantilla a cada línea de un Evento, si el MinadorDePlantillas está activo
+	* @param evento Evento cuyas líneas se minan
+	*/
+	void minar (Evento& evento);
+	
+	/**
+	* Obtiene las plantillas a las que se han asignado líneas desde el último resumen, con el número de ellas,
+	* y comienza el siguiente
+	* @return Plantillas con líneas asignadas desde el último resumen, de la utilizada más recientemente a la que
+	* menos
+	*/
+	std::vector<Plantilla> resumir (void);
+	
+	/**
+	* Obtiene la tabla completa de plantillas, sin comenzar un nuevo resumen
+	* @return Plantillas de la tabla, de la utilizada más recientemente a la que menos
+	*/
+	std::vector<Plantilla> consultar (void);
+	
+	private:
+	
+	/**
+	* Plantilla de la tabla, con lo necesario para asignarle líneas y retirarla del árbol
+	*/
+	struct Grupo
+	{
+		Plantilla plantilla;						///< Plantilla tal como se entrega a los clientes
+		std::vector<std::string> palabras;			///< Palabras de la plantilla, "<*>" en los parámetros
+		std::vector<std::string> ruta;				///< Claves de los nodos del árbol hasta su hoja
+		unsigned long long uso;						///< Número de orden de su última línea, entre todas
+	};
+	
+	/**
+	* Nodo del árbol de clasificación. Los nodos internos sólo tienen hijos y las hojas sólo plantillas
+	*/
+	struct Nodo
+	{
+		std::unordered_map<std::string, std::unique_ptr<Nodo>> hijos;	///< Hijos, por su clave
+		std::vector<std::list<Grupo>::iterator> grupos;					///< Plantillas de la hoja
+		unsigned int plantillas;					///< Plantillas bajo el nodo, para podarlo al quedar vacío
+	};
+	
+	/**
+	* Línea de un Evento dividida en palabras, pendiente de asignarle plantilla
+	*/
+	struct Linea
+	{
+		std::vector<std::string> palabras;			///< Palabras de la línea, "<*>" en los parámetros
+		const char *inicio;							///< Primer carácter de la línea en la descripción
+		size_t longitud;							///< Número de caracteres de la línea
+	};
+	
+	/**
+	* Divide una línea en palabras, separadas por espacios o tabuladores, sustituyendo los parámetros por "<*>",
+	* hasta completar MAX_PALABRAS_
+	* @param linea Puntero al primer carácter de la línea
+	* @param longitud Número de caracteres de la línea, sin el salto de línea
+	* @param palabras Vector al que se añaden las palabras
+	*/
+	static void dividir (const char* linea, const size_t longitud, std::vector<std::string>& palabras);
+	
+	/**
+	* Asigna una línea a su plantilla, creándola si no existe. Debe llamarse con el mutex adquirido
+	* @param linea Línea dividida en palabras
+	* @param fichero Nombre del fichero del Evento al que pertenece la línea
+	* @param ahora Instante actual, en segundos desde 1970
+	*/
+	void asignar (const Linea& linea, const std::string& fichero, const long long ahora);
+	
+	/**
+	* Calcula las claves de los nodos del árbol que conducen a la hoja de unas palabras, según los hijos que
+	* existen. Debe llamarse con el mutex adquirido
+	* @param palabras Palabras de la línea
+	* @param ruta Vector en que se devuelven las claves, que se vacía antes
+	* @return Hoja a la que conducen las claves, o nullptr si alguno de sus nodos todavía no existe
+	*/
+	Nodo* buscarHoja (const std::vector<std::string>& palabras, std::vector<std::string>& ruta);
+	
+	/**
+	* Descarta una plantilla, retirándola de su hoja y podando los nodos que quedan vacíos. Debe llamarse con el
+	* mutex adquirido
+	* @param descartado Plantilla que se descarta
+	*/
+	void descartar (std::list<Grupo>::iterator descartado);
+	
+	//Constantes
+	constexpr static const char* PARAMETRO_ = "<*>";		///< Palabra que ocupa el lugar de un parámetro
+	constexpr static unsigned int MAX_PLANTILLAS_ = 1024;	///< Plantillas que conserva la tabla
+	constexpr static unsigned int MAX_PLANTILLAS_HOJA_ = 16;	///< Plantillas que conserva cada hoja
+	constexpr static unsigned int PALABRAS_RUTA_ = 2;		///< Primeras palabras que clasifican una línea
+	constexpr static unsigned int MAX_HIJOS_ = 100;			///< Hijos de un nodo a partir de los cuales las
+															///< palabras nuevas comparten el de parámetros
+	constexpr static unsigned int MAX_PALABRAS_ = 64;		///< Palabras consideradas de cada línea
+	constexpr static unsigned int MAX_LONGITUD_PALABRA_ = 64;	///< Longitud a partir de la cual es parámetro
+	constexpr static unsigned int MAX_LONGITUD_EJEMPLO_ = 256;	///< Longitud máxima de la línea de ejemplo
+	
+	//Variables miembro
+	std::atomic<unsigned int> usuarios_;			///< Número de usuarios del MinadorDePlantillas
+	Nodo raiz_;										///< Raíz del árbol, cuyos hijos son el número de palabras
+	std::list<Grupo> grupos_;						///< Plantillas, de la utilizada más recientemente a la que menos
+	unsigned long long siguiente_identificador_;	///< Identificador que se asignará a la siguiente plantilla
+	unsigned long long usos_;						///< Líneas asignadas, con las que se numera cada uso
+	std::mutex mutex_;								///< Mutex que protege el árbol y las plantillas
+};
+
+} //namespace lognotify
+
+#endif //_minador_de_plantillas_h_
\ No newline at end of file
@@ -12,12 +12,21 @@
 #include <unistd.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <cerrno>
+#include <string>
 #include <vector>
 #include <list>
+#include <map>
 #include <memory>
+#include <utility>
+#include <functional>
 
 #include "fichero.h"
+#include "deduplicador_de_lineas.h"
+#include "ensamblador_de_registros.h"
 #include "evento.h"
+#include "reparador_de_utf8.h"
 
 using namespace std;
 namespace lognotify
@@ -27,6 +36,8 @@ MonitorDeFicheros::MonitorDeFicheros (void):
 		descriptor_inotify_(-1),
 		ocupado_buffer_inotify_(0),
 		puntero_buffer_inotify_(0),
+		descriptor_aviso_(-1),
+		interrumpido_(false),
 		directorio_registro_("") {}
 
 MonitorDeFicheros::~MonitorDeFicheros (void)
@@ -38,7 +49,7 @@ MonitorDeFicheros::~MonitorDeFicheros (void)
 bool MonitorDeFicheros::inicializar (const std::string& dirRegistro)
 {
 	//Se inicializa la instancia de inotify, obteniendo el descriptor de la misma
-	descriptor_inotify_ = inotify_init();
+	descriptor_inotify_ = inotify_init1(IN_CLOEXEC);
 	
 	//Si el proceso ha fallado, se termina con error
 	if (descriptor_inotify_ < 0) return false;
@@ -163,14 +174,70 @@ std::unique_ptr<Evento> MonitorDeFicheros::obtenerSiguienteEvento (void)
 	//No todos los eventos generados por inotify son devueltos, algunos son sólo procesados internamente
 	//obtenerSiguienteEvento sigue su ejecución hasta que se obtenga un evento válido para retorno
 	struct inotify_event* aviso;
-	string temporal;
+	unique_ptr<Evento> evento;
+	interrumpido_ = false;
 	while (true)
 	{
+		//Antes que nada se lee lo añadido a los ficheros pendientes, que no llegará a avisarse con inotify
+		while (!pendientes_.empty())
+		{
+			unsigned int indice = pendientes_.back();
+			pendientes_.pop_back();
+			if ((indice < ficheros_vigilados_.size()) && ficheros_vigilados_[indice])
+			{
+				evento = leerModificacion(indice);
+				if (evento) return sanearEvento(move(evento));
+			}
+		}
+		
+		//También se devuelven los registros en curso que han esperado demasiado a su continuación, y los
+		//resúmenes de las líneas repetidas cuya ventana se ha cerrado
+		string nombre_vencido, ubicacion_vencida;
+		vector<string> registros_vencidos = ensamblador_.vencer(nombre_vencido, ubicacion_vencida);
+		if (!registros_vencidos.empty())
+		{
+			evento = componerEvento(nombre_vencido, ubicacion_vencida, registros_vencidos);
+			if (evento) return sanearEvento(move(evento));
+			continue;
+		}
+		if (deduplicador_.estaActivo())
+		{
+			evento = deduplicador_.vencer();
+			if (evento) return sanearEvento(move(evento));
+		}
+		
 		//En primer lugar se lee un nuevo evento del buffer de inotify
 		//Si el puntero de lectura del buffer de inotify ha alcanzado los bytes válidos contenidos en este,
 		//hay que leer más eventos de la instancia de inotify
 		if (puntero_buffer_inotify_ >= ocupado_buffer_inotify_)
 		{
+			//Si hay descriptor de aviso, se espera a la vez a que haya eventos o a que se vuelva legible. En
+			//ese caso se termina sin evento, pero sin haber perdido ninguno. Si hay repeticiones sin resumir
+			//o registros en curso, la espera termina además al cerrarse la primera ventana o vencer el primer
+			//registro, para volver a comprobarlos
+			int espera = deduplicador_.estaActivo() ? deduplicador_.obtenerEspera() : -1;
+			int espera_registros = ensamblador_.obtenerEspera();
+			if ((espera < 0) || ((espera_registros >= 0) && (espera_registros < espera))) espera = espera_registros;
+			if ((descriptor_aviso_ >= 0) || (espera >= 0))
+			{
+				struct pollfd esperas [2];
+				esperas[0].fd = descriptor_inotify_;
+				esperas[0].events = POLLIN;
+				esperas[1].fd = descriptor_aviso_;
+				esperas[1].events = POLLIN;
+				int preparados = poll(esperas, (descriptor_aviso_ >= 0) ? 2 : 1, espera);
+				if (preparados < 0)
+				{
+					if (errno == EINTR) continue;
+					return nullptr;
+				}
+				if (preparados == 0) continue;
+				if ((descriptor_aviso_ >= 0) && (esperas[1].revents != 0))
+				{
+					interrumpido_ = true;
+					return nullptr;
+				}
+			}
 			puntero_buffer_inotify_ = 0;
 			ocupado_buffer_inotify_ = read(	descriptor_inotify_,
 											buffer_inotify_,
@@ -188,15 +255,9 @@ std::unique_ptr<Evento> MonitorDeFicheros::obtenerSiguienteEvento (void)
 		//Normalmente los ficheros esperan eventos de tipo IN_MODIFY, IN_DELETE_SELF e IN_MOVE_SELF
 		if (aviso->mask == IN_MODIFY)
 		{
-			//Si es IN_MODIFY, se obtiene la última entrada de datos al fichero, y se devuelve un nuevo
-			//Evento con los datos del mismo (excepto si los datos son "", en cuyo caso se ignora; ya se
-			//tratarán las posibles situaciones que puedan dar lugar a ello con otros avisos de inotify)
-			temporal = ficheros_vigilados_[aviso->wd]->ultimaModificacion(directorio_registro_);
-			if (temporal != "")
-				return unique_ptr<Evento>(new Evento (	ficheros_vigilados_[aviso->wd]->obtener_nombre(),
-														directorio_registro_ +
-															ficheros_vigilados_[aviso->wd]->obtener_ubicacion(),
-														temporal	));
+			//Si es IN_MODIFY, se devuelve un nuevo Evento con la última entrada de datos al fichero, si la hay
+			evento = leerModificacion(aviso->wd);
+			if (evento) return sanearEvento(move(evento));
 		}
 		else if ((aviso->mask == IN_DELETE_SELF) || (aviso->mask == IN_MOVE_SELF))
 		{
@@ -217,6 +278,146 @@ std::unique_ptr<Evento> MonitorDeFicheros::obtenerSiguienteEvento (void)
 	}
 }
 
+std::vector<std::pair<std::string, long long>> MonitorDeFicheros::obtenerPosiciones (void)
+{
+	//Se recorre la lista de ficheros anotando la posición de todos aquellos que no sean nulos. El registro en
+	//curso de cada uno no se ha difundido todavía, por lo que se anota la posición en que comienza
+	vector<pair<string, long long>> posiciones;
+	for (unsigned int i = 0; i < ficheros_vigilados_.size(); ++i)
+		if (ficheros_vigilados_[i])
+		{
+			long long posicion = ficheros_vigilados_[i]->obtener_posicion() -
+				ensamblador_.obtenerPendiente(ficheros_vigilados_[i]->obtener_ruta());
+			posiciones.push_back(make_pair(ficheros_vigilados_[i]->obtener_ruta(), (posicion > 0) ? posicion : 0));
+		}
+	return posiciones;
+}
+
+void MonitorDeFicheros::establecerPosiciones (const std::vector<std::pair<std::string, long long>>& posiciones)
+{
+	//Se busca cada fichero en la lista, y si se encuentra se continúa desde su posición, anotándolo para leer
+	//en cuanto se obtenga el siguiente evento lo que se le haya añadido desde entonces
+	for (unsigned int i = 0; i < posiciones.size(); ++i)
+		for (unsigned int j = 0; j < ficheros_vigilados_.size(); ++j)
+			if (ficheros_vigilados_[j] && (ficheros_vigilados_[j]->obtener_ruta() == posiciones[i].first))
+			{
+				ficheros_vigilados_[j]->establecer_posicion(posiciones[i].second);
+				pendientes_.push_back(j);
+				break;
+			}
+}
+
+std::unique_ptr<Evento> MonitorDeFicheros::leerModificacion (const unsigned int indice)
+{
+	//Se obtiene la última entrada de datos al fichero, y se devuelve un nuevo Evento con los datos del mismo
+	//(excepto si los datos son "", en cuyo caso se ignora; ya se tratarán las posibles situaciones que puedan
+	//dar lugar a ello con otros avisos de inotify)
+	long long desde = ficheros_vigilados_[indice]->obtener_posicion();
+	string temporal = ficheros_vigilados_[indice]->ultimaModificacion(directorio_registro_);
+	
+	//El rango leído, si lo hay, se notifica antes de devolver el Evento, de forma que quien refleje el fichero
+	//lo reciba aunque no dé lugar a ningún Evento
+	long long hasta = ficheros_vigilados_[indice]->obtener_posicion();
+	if (reflejo_ && (hasta > desde))
+	{
+		string ruta = ficheros_vigilados_[indice]->obtener_ruta();
+		reflejo_(ruta, directorio_registro_ + ruta, desde, hasta);
+	}
+	
+	//Las líneas se cuentan para los agregados tal como se han leído, antes de colapsarlas o ensamblarlas. Lo
+	//leído termina en un salto de línea si ocupa un byte más que su contenido
+	string nombre = ficheros_vigilados_[indice]->obtener_nombre();
+	string ruta = ficheros_vigilados_[indice]->obtener_ruta();
+	bool terminado = hasta - desde > (long long) temporal.length();
+	if (agregador_ && (hasta > desde)) contarLineas(ruta, nombre, temporal, desde, hasta, terminado);
+	if (temporal == "") return nullptr;
+	
+	//Si el fichero tiene regla de ensamblado, sólo se difunden sus registros completos
+	string ubicacion = directorio_registro_ + ficheros_vigilados_[indice]->obtener_ubicacion();
+	if (ensamblador_.tieneRegla(ruta))
+		return componerEvento(nombre, ubicacion, ensamblador_.ensamblar(ruta, nombre, ubicacion, temporal, terminado));
+	
+	//Si se colapsan las líneas repetidas, sólo se conservan las que no lo son
+	if (deduplicador_.estaActivo()) temporal = deduplicador_.deduplicar(nombre, ubicacion, temporal);
+	if (temporal == "") return nullptr;
+	return unique_ptr<Evento>(new Evento (nombre, ubicacion, temporal));
+}
+
+void MonitorDeFicheros::contarLineas (	const std::string& ruta,
+										const std::string& nombre,
+										const std::string& leido,
+										const long long desde,
+										const long long hasta,
+										const bool terminado	)
+{
+	//El fragmento sin terminar de la lectura anterior sólo se antepone si esta continúa justo donde terminó; si
+	//no, el fichero se ha truncado o rotado entre medias y el fragmento se descarta
+	string contenido;
+	map<string, pair<long long, string>>::iterator fragmento = fragmentos_.find(ruta);
+	if (fragmento != fragmentos_.end())
+	{
+		if (fragmento->second.first == desde) contenido = move(fragmento->second.second);
+		fragmentos_.erase(fragmento);
+	}
+	contenido += leido;
+	
+	//Si lo leído no termina en un salto de línea, su última línea se guarda hasta que se complete, salvo que
+	//sea tan larga que no valga la pena esperar más por ella
+	if (!terminado)
+	{
+		size_t salto = contenido.rfind('\n');
+		size_t inicio = (salto == string::npos) ? 0 : salto + 1;
+		if (contenido.length() - inicio < MAX_FRAGMENTO_)
+		{
+			fragmentos_[ruta] = make_pair(hasta, contenido.substr(inicio));
+			contenido.resize((salto == string::npos) ? 0 : salto);
+		}
+	}
+	if (contenido != "") agregador_->contar(nombre, contenido, 0);
+}
+
+std::unique_ptr<Evento> MonitorDeFicheros::componerEvento (	const std::string& nombre,
+															const std::string& ubicacion,
+															const std::vector<std::string>& registros	)
+{
+	if (registros.empty()) return nullptr;
+	string descripcion;
+	if (deduplicador_.estaActivo()) descripcion = deduplicador_.deduplicar(nombre, ubicacion, registros);
+	else
+	{
+		descripcion = registros[0];
+		for (unsigned int i = 1; i < registros.size(); ++i) descripcion = descripcion + '\n' + registros[i];
+	}
+	if (descripcion == "") return nullptr;
+	return unique_ptr<Evento>(new Evento (nombre, ubicacion, descripcion));
+}
+
+std::unique_ptr<Evento> MonitorDeFicheros::sanearEvento (std::unique_ptr<Evento> evento)
+{
+	//La descripción sólo se copia si contiene algo que reparar, lo que no ocurre casi nunca
+	const string& original = evento->obtener_descripcion();
+	if (ReparadorDeUtf8::esValido(original.data(), original.length())) return evento;
+	string descripcion = original;
+	ReparadorDeUtf8::reparar(descripcion);
+	return unique_ptr<Evento>(new Evento (evento->obtener_nombre(), evento->obtener_ubicacion(), descripcion));
+}
+
+bool MonitorDeFicheros::anadirReglaMultilinea (const std::string& ruta, const std::string& regla)
+{
+	//Se normaliza la ruta como al añadir el fichero, pero si todavía no existe se utiliza la indicada
+	string ruta_canonica = estaInicializado() ? normalizarRuta(ruta, directorio_registro_) : "";
+	if (ruta_canonica == "") ruta_canonica = ruta;
+	return ensamblador_.anadirRegla(ruta_canonica, regla);
+}
+
+bool MonitorDeFicheros::ensamblaRegistros (Evento& evento)
+{
+	//La ubicación de los eventos de los ficheros monitorizados comienza por el directorio de ficheros de registro
+	string ubicacion = evento.obtener_ubicacion();
+	if (ubicacion.compare(0, directorio_registro_.length(), directorio_registro_) != 0) return false;
+	return ensamblador_.tieneRegla(ubicacion.substr(directorio_registro_.length()) + evento.obtener_nombre());
+}
+
 void MonitorDeFicheros::iniciarRotacionFichero (std::unique_ptr<Fichero> fichero)
 {
 	//Se buscan otros ficheros con la misma ubicación que ya estén en rotación
@@ -7,11 +7,18 @@
 #ifndef _monitor_de_ficheros_h_
 #define _monitor_de_ficheros_h_
 
+#include <string>
 #include <vector>
 #include <list>
+#include <map>
 #include <memory>
+#include <utility>
+#include <functional>
 
 #include "fichero.h"
+#include "deduplicador_de_lineas.h"
+#include "ensamblador_de_registros.h"
+#include "agregador_de_metricas.h"
 #include "evento.h"
 
 namespace lognotify
@@ -22,11 +29,22 @@ namespace lognotify
 * a uno de los ficheros monitorizados se le añada un contenido adicional, y pudiendo capturar estos
 * eventos mediante una llamada bloqueante: obtenerSiguienteEvento(). Un objeto de esta clase debe ser
 * inicializado antes de que se le puedan añadir ficheros o capturar eventos. 
+* Opcionalmente, las líneas que se repiten en un fichero dentro de una ventana de tiempo se colapsan en la
+* primera y en un resumen de sus repeticiones al cerrarse la ventana (ver DeduplicadorDeLineas), y las de los
+* ficheros con regla de ensamblado se agrupan en registros de varias líneas que nunca se reparten entre dos
+* eventos (ver EnsambladorDeRegistros).
 */
 class MonitorDeFicheros
 {
 	public:
 	
+	/**
+	* Función a la que se notifica cada rango de bytes añadido a un fichero monitorizado: ruta relativa al
+	* directorio de ficheros de registro, ruta absoluta y posiciones del primer byte añadido y del siguiente
+	* al último
+	*/
+	typedef std::function<void (const std::string&, const std::string&, long long, long long)> Reflejo;
+	
 	/**
 	* Constructor de la clase MonitorDeFicheros
 	*/
@@ -87,12 +105,133 @@ class MonitorDeFicheros
 	* obtenerSiguienteEvento es una función bloqueante: la ejecución continuará cuando se
 	* produzca el siguiente evento que pueda devolverse desde el momento en que sea llamada
 	* @return Puntero al objeto Evento que contiene los datos del evento producido.
-	* Este puntero será nulo (nullptr) en el caso de que se haya producido algún error
+	* Este puntero será nulo (nullptr) en el caso de que se haya producido algún error, o de que el descriptor
+	* de aviso se vuelva legible (ver estaInterrumpido)
 	*/
 	std::unique_ptr<Evento> obtenerSiguienteEvento (void);
 	
+	/**
+	* Establece un descriptor de aviso que interrumpe la espera de obtenerSiguienteEvento cuando se vuelve
+	* legible, por ejemplo para detener el hilo que obtiene los eventos durante un Relevo
+	* @param descriptor Descriptor de aviso, que no llega a leerse, o un valor negativo para no utilizar ninguno
+	*/
+	inline void establecerAviso (const int descriptor) { descriptor_aviso_ = descriptor; }
+	
+	/**
+	* Indica si la última llamada a obtenerSiguienteEvento ha terminado sin evento por haberse vuelto legible el
+	* descriptor de aviso, y no por un error
+	* @return true si la espera ha sido interrumpida por el aviso, false en caso contrario
+	*/
+	inline bool estaInterrumpido (void) { return interrumpido_; }
+	
+	/**
+	* Establece la función a la que se notifica, desde obtenerSiguienteEvento y antes de devolver el Evento
+	* correspondiente, el rango de bytes añadido a un fichero cada vez que se lee. Se le notifica aunque el
+	* contenido añadido no llegue a dar lugar a ningún Evento (por ejemplo, si sólo son saltos de línea)
+	* @param reflejo Función a la que se notifican los rangos añadidos, o nula para no notificarlos
+	*/
+	inline void establecerReflejo (const Reflejo& reflejo) { reflejo_ = reflejo; }
+	
+	/**
+	* Establece la ventana en la que se colapsan las líneas repetidas de cada fichero. Los resúmenes de las
+	* repeticiones se devuelven como eventos de su fichero en obtenerSiguienteEvento, al cerrarse su ventana
+	* @param segundos Duración de la ventana, o 0 para no colapsar las líneas repetidas
+	* @param ignorarCifras true para colapsar también las líneas que sólo difieren en sus cifras
+	*/
+	inline void establecerDeduplicacion (const unsigned int segundos, const bool ignorarCifras = false)
+	{
+		deduplicador_.configurar(segundos, ignorarCifras);
+	}
+	
+	/**
+	* Establece el AgregadorDeMetricas en que se cuentan las líneas leídas de los ficheros, en el fragmento 0.
+	* Se cuentan tal como se leen, antes de colapsar las repetidas y de ensamblarlas en registros, de forma que
+	* cada línea escrita cuente una vez aunque no llegue a difundirse
+	* @param agregador AgregadorDeMetricas en que se cuentan las líneas, o nulo para no contarlas
+	*/
+	inline void establecerAgregador (std::shared_ptr<AgregadorDeMetricas> agregador) { agregador_ = agregador; }
+	
+	/**
+	* Establece la regla con que se agrupan en registros las líneas de un fichero (ver EnsambladorDeRegistros).
+	* Cada Evento del fichero contiene entonces sólo registros completos, y la última línea leída espera a la
+	* siguiente, o al tiempo máximo de espera, para saber si su registro continúa
+	* @param ruta Ruta del fichero relativa al directorio de ficheros de registro del sistema, que no es
+	* necesario que exista todavía
+	* @param regla Regla de ensamblado: "inicio expresion", "continuacion expresion" o "sangria"
+	* @return true si la regla es válida, false en caso contrario
+	*/
+	bool anadirReglaMultilinea (const std::string& ruta, const std::string& regla);
+	
+	/**
+	* Indica si un Evento devuelto por obtenerSiguienteEvento procede de un fichero con regla de ensamblado, en
+	* cuyo caso está formado sólo por registros completos
+	* @param evento Evento del fichero
+	* @return true si el fichero del Evento tiene regla de ensamblado, false en caso contrario
+	*/
+	bool ensamblaRegistros (Evento& evento);
+	
+	/**
+	* Obtiene la posición hasta la que se ha leído cada fichero monitorizado, para que otra ejecución del
+	* servidor pueda continuar desde ella (ver establecerPosiciones)
+	* @return Ruta de cada fichero, relativa al directorio de ficheros de registro, y su posición
+	*/
+	std::vector<std::pair<std::string, long long>> obtenerPosiciones (void);
+	
+	/**
+	* Establece la posición desde la que continuar la lectura de los ficheros monitorizados indicados. Lo añadido
+	* a cada uno a partir de ella se devuelve en las siguientes llamadas a obtenerSiguienteEvento, aunque no
+	* vuelva a modificarse. Los ficheros que no se monitorizan se ignoran
+	* @param posiciones Ruta de cada fichero, relativa al directorio de ficheros de registro, y su posición
+	*/
+	void establecerPosiciones (const std::vector<std::pair<std::string, long long>>& posiciones);
+	
 	private:
 
+	/**
+	* Lee lo añadido a un fichero monitorizado desde el último acceso
+	* @param indice Índice del fichero, que es el descriptor de su watch
+	* @return Puntero al Evento con el contenido añadido, o nulo (nullptr) si no se ha añadido nada
+	*/
+	std::unique_ptr<Evento> leerModificacion (const unsigned int indice);
+	
+	/**
+	* Cuenta para los agregados las líneas completas leídas de un fichero. La última línea de lo leído, si no
+	* está terminada, se guarda y se cuenta junto con su continuación en la siguiente lectura
+	* @param ruta Ruta relativa del fichero al directorio de ficheros de registro
+	* @param nombre Nombre del fichero
+	* @param leido Contenido leído del fichero, sin el último salto de línea
+	* @param desde Posición del fichero en que comienza lo leído
+	* @param hasta Posición del fichero en que termina lo leído
+	* @param terminado Indica si lo leído termina en un salto de línea
+	*/
+	void contarLineas (	const std::string& ruta,
+						const std::string& nombre,
+						const std::string& leido,
+						const long long desde,
+						const long long hasta,
+						const bool terminado	);
+	
+	/**
+	* Compone el Evento de un fichero a partir de sus registros completos, colapsando los repetidos si se
+	* colapsan las líneas repetidas
+	* @param nombre Nombre del fichero
+	* @param ubicacion Ruta completa del directorio en que se encuentra el fichero
+	* @param registros Registros completos del fichero
+	* @return Puntero al Evento con los registros, o nulo (nullptr) si no queda ninguno que difundir
+	*/
+	std::unique_ptr<Evento> componerEvento (	const std::string& nombre,
+												const std::string& ubicacion,
+												const std::vector<std::string>& registros	);
+	
+	/**
+	* Repara la descripción de un Evento antes de devolverlo, de forma que sea UTF-8 válido y no contenga
+	* caracteres de control (ver ReparadorDeUtf8). Se aplica una vez ensamblados y colapsados los registros, que
+	* cuentan los bytes del fichero tal y como se han leído
+	* @param evento Evento que se devuelve
+	* @return El mismo Evento si su descripción ya era válida, o uno nuevo con la descripción reparada
+	*/
+	std::unique_ptr<Evento> sanearEvento (std::unique_ptr<Evento> evento);
+	
 	/**
 	* Inicia el proceso de rotación de ficheros para el fichero proporcionado, dejando el fichero inactivo
 	* a la espera de que un evento posibilite empezar a monitorizarlo
@@ -135,12 +274,22 @@ class MonitorDeFicheros
 	
 	//Constantes
 	static constexpr unsigned int LON_BUF_INOT_ = 10;	///< Longitud del buffer de inotify en número de eventos
+	static constexpr size_t MAX_FRAGMENTO_ = 65536;	///< Longitud máxima de la línea sin terminar que se guarda
 	
 	//Variables miembro
 	int descriptor_inotify_;				///< Descriptor de la instancia de inotify
 	char* buffer_inotify_;					///< Buffer de lectura de eventos de inotify
 	ssize_t ocupado_buffer_inotify_;		///< Número de bytes de datos válidos contenidos en buffer_inotify_
 	unsigned int puntero_buffer_inotify_;	///< Referencia al siguiente byte del buffer_inotify_ por procesar
+	int descriptor_aviso_;					///< Descriptor cuya lectura interrumpe la espera de eventos
+	bool interrumpido_;						///< Indica si la última espera ha sido interrumpida por el aviso
+	std::vector<unsigned int> pendientes_;	///< Ficheros cuyo contenido añadido debe leerse sin esperar aviso
+	Reflejo reflejo_;						///< Función a la que se notifica cada rango de bytes añadido
+	std::shared_ptr<AgregadorDeMetricas> agregador_;	///< Agregador en que se cuentan las líneas leídas
+	std::map<std::string, std::pair<long long, std::string>> fragmentos_;	///< Última línea sin terminar de cada
+		///< fichero, con la posición en que termina, a la espera de contarla completa
+	DeduplicadorDeLineas deduplicador_;		///< Deduplicador de las líneas repetidas de cada fichero
+	EnsambladorDeRegistros ensamblador_;	///< Ensamblador de los registros de varias líneas de cada fichero
 	std::string directorio_registro_;		///< Ruta absoluta del directorio de ficheros de registro del sistema
 	std::vector<std::unique_ptr<Fichero>> ficheros_vigilados_;		///< Lista de ficheros vigilados con inotify
 	std::vector<std::list<std::unique_ptr<Fichero>>> ficheros_en_rotacion_;	///< Ficheros sin vigilancia
@@ -0,0 +1,439 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "motor_de_suscripciones.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <tuple>
+#include <algorithm>
+#include <regex>
+#include <mutex>
+
+#include "filtro.h"
+#include "regla.h"
+#include "condicion.h"
+#include "evento.h"
+#include "analizador_de_syslog.h"
+#include "extractor_de_json.h"
+
+using namespace std;
+namespace lognotify
+{
+
+int MotorDeSuscripciones::registrarFiltro (const Filtro& filtro)
+{
+	//Se compilan en primer lugar las expresiones regulares del filtro, antes de modificar el índice, de forma
+	//que si alguna no es válida el motor quede intacto. Las que ya están indexadas no necesitan compilarse.
+	//Compilar puede ser costoso, por lo que se hace sin el mutex adquirido, que sólo se adquiere para
+	//consultar qué predicados faltan en el índice. Si mientras tanto se retira alguno de los que estaban, se
+	//repite la consulta, hasta que todos estén indexados o compilados; el mutex queda entonces adquirido
+	map<ClaveDePredicado, regex> compiladas;
+	vector<ClaveDePredicado> pendientes;
+	const vector<Regla>& reglas = filtro.obtener_reglas();
+	while (true)
+	{
+		mutex_.lock();
+		pendientes.clear();
+		for (unsigned int i = 0; i < reglas.size(); ++i)
+		{
+			const vector<Condicion>& condiciones = reglas[i].obtener_condiciones();
+			for (unsigned int j = 0; j < condiciones.size(); ++j)
+			{
+				ClaveDePredicado clave (	condiciones[j].obtener_campo(), condiciones[j].obtener_clave(),
+											condiciones[j].obtener_expresion()	);
+				if ((indice_predicados_.find(clave) == indice_predicados_.end()) &&
+					(compiladas.find(clave) == compiladas.end()))
+					pendientes.push_back(move(clave));
+			}
+		}
+		if (pendientes.empty()) break;
+		mutex_.unlock();
+		try
+		{
+			for (unsigned int i = 0; i < pendientes.size(); ++i)
+				if (compiladas.find(pendientes[i]) == compiladas.end())
+					compiladas[pendientes[i]] = regex(get<2>(pendientes[i]));
+		}
+		catch (regex_error&)
+		{
+			return -1;
+		}
+	}
+	
+	//Se obtiene la forma canónica de cada regla (condiciones ordenadas y sin repeticiones) y su identificador.
+	//Las reglas que contienen un mismo predicado con ambos signos nunca pueden cumplirse y se descartan
+	vector<unsigned int> clave_filtro;
+	vector<pair<unsigned int, bool>> clave_regla;
+	for (unsigned int i = 0; i < reglas.size(); ++i)
+	{
+		const vector<Condicion>& condiciones = reglas[i].obtener_condiciones();
+		clave_regla.clear();
+		for (unsigned int j = 0; j < condiciones.size(); ++j)
+		{
+			ClaveDePredicado clave (	condiciones[j].obtener_campo(), condiciones[j].obtener_clave(),
+										condiciones[j].obtener_expresion()	);
+			auto compilada = compiladas.find(clave);
+			unsigned int predicado;
+			if (compilada != compiladas.end())
+				predicado = obtenerPredicado(get<0>(clave), get<1>(clave), get<2>(clave), compilada->second);
+			else predicado = indice_predicados_[clave];
+			clave_regla.push_back(make_pair(predicado, condiciones[j].obtener_signo()));
+		}
+		sort(clave_regla.begin(), clave_regla.end());
+		clave_regla.erase(unique(clave_regla.begin(), clave_regla.end()), clave_regla.end());
+		
+		bool contradictoria = false;
+		for (unsigned int j = 1; j < clave_regla.size(); ++j)
+			if (clave_regla[j].first == clave_regla[j - 1].first) contradictoria = true;
+		if (!contradictoria) clave_filtro.push_back(obtenerRegla(clave_regla));
+	}
+	sort(clave_filtro.begin(), clave_filtro.end());
+	clave_filtro.erase(unique(clave_filtro.begin(), clave_filtro.end()), clave_filtro.end());
+	
+	//Si ya existe un filtro equivalente, simplemente se anota un nuevo registro del mismo. En tal caso todas
+	//sus reglas existían ya, por lo que no ha sido añadida ninguna nueva
+	unsigned int identificador;
+	auto encontrado = indice_filtros_.find(clave_filtro);
+	if (encontrado != indice_filtros_.end())
+	{
+		identificador = encontrado->second;
+		++filtros_[identificador].referencias;
+	}
+	else
+	{
+		//En caso contrario se añade el nuevo filtro, reutilizando una posición libre si la hay
+		if (filtros_libres_.empty())
+		{
+			identificador = filtros_.size();
+			filtros_.emplace_back();
+		}
+		else
+		{
+			identificador = filtros_libres_.back();
+			filtros_libres_.pop_back();
+		}
+		filtros_[identificador].reglas = clave_filtro;
+		filtros_[identificador].referencias = 1;
+		indice_filtros_[clave_filtro] = identificador;
+		
+		//Y se vincula a cada una de sus reglas
+		for (unsigned int i = 0; i < clave_filtro.size(); ++i) reglas_[clave_filtro[i]].filtros.push_back(identificador);
+	}
+	
+	//Los predicados añadidos por reglas contradictorias que no han llegado a utilizarse se retiran
+	for (auto i = compiladas.begin(); i != compiladas.end(); ++i)
+	{
+		unsigned int predicado = indice_predicados_[i->first];
+		if (predicados_[predicado].apariciones.empty()) liberarPredicado(predicado);
+	}
+	
+	mutex_.unlock();
+	return identificador;
+}
+
+void MotorDeSuscripciones::retirarFiltro (const int identificador)
+{
+	mutex_.lock();
+	
+	//Se comprueba que el identificador corresponde a un filtro registrado
+	if ((identificador < 0) || ((unsigned int) identificador >= filtros_.size()) ||
+		(filtros_[identificador].referencias == 0))
+	{
+		mutex_.unlock();
+		return;
+	}
+	
+	//Si todavía quedan registros vigentes del filtro, basta con descontar éste
+	FiltroIndexado& filtro = filtros_[identificador];
+	if (--filtro.referencias > 0)
+	{
+		mutex_.unlock();
+		return;
+	}
+	
+	//En caso contrario, se desvincula el filtro de sus reglas, eliminando las que dejan de formar parte de
+	//algún filtro, y se libera su posición
+	for (unsigned int i = 0; i < filtro.reglas.size(); ++i)
+	{
+		vector<unsigned int>& filtros_regla = reglas_[filtro.reglas[i]].filtros;
+		filtros_regla.erase(find(filtros_regla.begin(), filtros_regla.end(), (unsigned int) identificador));
+		if (filtros_regla.empty()) eliminarRegla(filtro.reglas[i]);
+	}
+	indice_filtros_.erase(filtro.reglas);
+	filtro.reglas.clear();
+	filtros_retirados_.push_back(make_pair((unsigned int) identificador, evaluaciones_));
+	
+	mutex_.unlock();
+}
+
+unsigned long long MotorDeSuscripciones::evaluar (Evento& evento, std::vector<bool>& pasan)
+{
+	//Se obtienen una sola vez los campos del evento que pueden compararse
+	string campos [2];
+	campos[Condicion::CAMPO_FICHERO] = evento.obtener_nombre();
+	campos[Condicion::CAMPO_CONTENIDO] = evento.obtener_descripcion();
+	vector<string> claves;
+	vector<string> valores;
+	
+	mutex_.lock();
+	
+	//Y los valores de las claves JSON que utilizan los predicados, que dependen de los filtros registrados
+	extraerValores(campos[Condicion::CAMPO_CONTENIDO], claves, valores);
+	
+	//Inicialmente el evento pasa todos los filtros
+	++evaluaciones_;
+	pasan.assign(filtros_.size(), true);
+	
+	//Se avanza la marca de evento, lo que invalida los contadores de todas las reglas sin tener que
+	//recorrerlas. Si la marca da la vuelta, se reinician todas para evitar confundirlas con las antiguas
+	if (++marca_ == 0)
+	{
+		for (unsigned int i = 0; i < reglas_.size(); ++i) reglas_[i].marca = 0;
+		marca_ = 1;
+	}
+	
+	//Las reglas sin condiciones se cumplen siempre
+	for (unsigned int i = 0; i < incondicionales_.size(); ++i) dispararRegla(incondicionales_[i], pasan);
+	
+	//Se evalúa cada predicado distinto una única vez, y se cuenta una condición satisfecha en cada regla en
+	//que aparece con el signo coincidente con el resultado. Una regla se cumple en el momento en que su
+	//contador alcanza su número de condiciones
+	for (unsigned int i = 0; i < predicados_.size(); ++i)
+	{
+		Predicado& predicado = predicados_[i];
+		if (predicado.apariciones.empty()) continue;
+		bool igual = cumplePredicado(predicado, campos, claves, valores);
+		for (unsigned int j = 0; j < predicado.apariciones.size(); ++j)
+		{
+			if (predicado.apariciones[j].second != igual) continue;
+			ReglaIndexada& regla = reglas_[predicado.apariciones[j].first];
+			if (regla.marca != marca_)
+			{
+				regla.marca = marca_;
+				regla.contador = 0;
+			}
+			if (++regla.contador == regla.condiciones.size())
+				dispararRegla(predicado.apariciones[j].first, pasan);
+		}
+	}
+	unsigned long long evaluacion = evaluaciones_;
+	
+	mutex_.unlock();
+	
+	return evaluacion;
+}
+
+void MotorDeSuscripciones::liberarFiltros (const unsigned long long evaluacion)
+{
+	mutex_.lock();
+	
+	//Los filtros retirados tras la evaluación indicada, o tras alguna anterior, pasan a estar libres. No se
+	//reutilizan antes para que el resultado de esas evaluaciones no se atribuya a un filtro distinto
+	for (unsigned int i = 0; i < filtros_retirados_.size(); )
+	{
+		if (filtros_retirados_[i].second <= evaluacion)
+		{
+			filtros_libres_.push_back(filtros_retirados_[i].first);
+			filtros_retirados_[i] = filtros_retirados_.back();
+			filtros_retirados_.pop_back();
+		}
+		else ++i;
+	}
+	
+	mutex_.unlock();
+}
+
+bool MotorDeSuscripciones::evaluar (Evento& evento, const int identificador)
+{
+	//Se obtienen los campos del evento que pueden compararse
+	string campos [2];
+	campos[Condicion::CAMPO_FICHERO] = evento.obtener_nombre();
+	campos[Condicion::CAMPO_CONTENIDO] = evento.obtener_descripcion();
+	vector<string> claves;
+	vector<string> valores;
+	
+	mutex_.lock();
+	
+	//Si el identificador no corresponde a un filtro registrado, el evento lo pasa
+	bool pasa = true;
+	if ((identificador < 0) || ((unsigned int) identificador >= filtros_.size()) ||
+		(filtros_[identificador].referencias == 0))
+	{
+		mutex_.unlock();
+		return pasa;
+	}
+	extraerValores(campos[Condicion::CAMPO_CONTENIDO], claves, valores);
+	
+	//Se evalúan directamente las reglas del filtro hasta encontrar una que se cumpla
+	const vector<unsigned int>& reglas = filtros_[identificador].reglas;
+	for (unsigned int i = 0; (i < reglas.size()) && pasa; ++i)
+	{
+		const vector<pair<unsigned int, bool>>& condiciones = reglas_[reglas[i]].condiciones;
+		bool cumplida = true;
+		for (unsigned int j = 0; (j < condiciones.size()) && cumplida; ++j)
+		{
+			Predicado& predicado = predicados_[condiciones[j].first];
+			if (cumplePredicado(predicado, campos, claves, valores) != condiciones[j].second) cumplida = false;
+		}
+		if (cumplida) pasa = false;
+	}
+	
+	mutex_.unlock();
+	return pasa;
+}
+
+unsigned int MotorDeSuscripciones::obtenerPredicado (	const unsigned int campo,
+														const std::string& clave_json,
+														const std::string& expresion,
+														const std::regex& regex	)
+{
+	//Si el predicado ya está indexado, se devuelve su identificador
+	ClaveDePredicado clave (campo, clave_json, expresion);
+	auto encontrado = indice_predicados_.find(clave);
+	if (encontrado != indice_predicados_.end()) return encontrado->second;
+	
+	//En caso contrario se añade, reutilizando una posición libre si la hay
+	unsigned int identificador;
+	if (predicados_libres_.empty())
+	{
+		identificador = predicados_.size();
+		predicados_.emplace_back();
+	}
+	else
+	{
+		identificador = predicados_libres_.back();
+		predicados_libres_.pop_back();
+	}
+	predicados_[identificador].campo = campo;
+	predicados_[identificador].clave = clave_json;
+	predicados_[identificador].expresion = expresion;
+	predicados_[identificador].regex = regex;
+	indice_predicados_[clave] = identificador;
+	
+	//Las claves JSON se cuentan para localizar en cada evento sólo las que se utilizan
+	if (campo == Condicion::CAMPO_JSON) ++claves_[clave_json];
+	return identificador;
+}
+
+void MotorDeSuscripciones::liberarPredicado (const unsigned int identificador)
+{
+	Predicado& predicado = predicados_[identificador];
+	indice_predicados_.erase(ClaveDePredicado(predicado.campo, predicado.clave, predicado.expresion));
+	if ((predicado.campo == Condicion::CAMPO_JSON) && (--claves_[predicado.clave] == 0))
+		claves_.erase(predicado.clave);
+	predicado.clave.clear();
+	predicado.expresion.clear();
+	predicado.regex = regex();
+	predicados_libres_.push_back(identificador);
+}
+
+unsigned int MotorDeSuscripciones::obtenerRegla (const std::vector<std::pair<unsigned int, bool>>& condiciones)
+{
+	//Si la regla ya está indexada, se devuelve su identificador
+	auto encontrado = indice_reglas_.find(condiciones);
+	if (encontrado != indice_reglas_.end()) return encontrado->second;
+	
+	//En caso contrario se añade, reutilizando una posición libre si la hay
+	unsigned int identificador;
+	if (reglas_libres_.empty())
+	{
+		identificador = reglas_.size();
+		reglas_.emplace_back();
+	}
+	else
+	{
+		identificador = reglas_libres_.back();
+		reglas_libres_.pop_back();
+	}
+	reglas_[identificador].condiciones = condiciones;
+	reglas_[identificador].contador = 0;
+	reglas_[identificador].marca = 0;
+	indice_reglas_[condiciones] = identificador;
+	
+	//Se anota la aparición de la regla en cada uno de sus predicados, o como incondicional si no tiene ninguno
+	for (unsigned int i = 0; i < condiciones.size(); ++i)
+		predicados_[condiciones[i].first].apariciones.push_back(make_pair(identificador, condiciones[i].second));
+	if (condiciones.empty()) incondicionales_.push_back(identificador);
+	return identificador;
+}
+
+void MotorDeSuscripciones::eliminarRegla (const unsigned int identificador)
+{
+	//Se retira la regla de cada uno de sus predicados, liberando los que dejan de aparecer en alguna regla
+	ReglaIndexada& regla = reglas_[identificador];
+	for (unsigned int i = 0; i < regla.condiciones.size(); ++i)
+	{
+		Predicado& predicado = predicados_[regla.condiciones[i].first];
+		predicado.apariciones.erase(find(	predicado.apariciones.begin(),
+											predicado.apariciones.end(),
+											make_pair(identificador, regla.condiciones[i].second)	));
+		if (predicado.apariciones.empty()) liberarPredicado(regla.condiciones[i].first);
+	}
+	if (regla.condiciones.empty())
+		incondicionales_.erase(find(incondicionales_.begin(), incondicionales_.end(), identificador));
+	
+	//Se elimina la regla del índice y se libera su posición
+	indice_reglas_.erase(regla.condiciones);
+	regla.condiciones.clear();
+	reglas_libres_.push_back(identificador);
+}
+
+void MotorDeSuscripciones::dispararRegla (const unsigned int identificador, std::vector<bool>& pasan)
+{
+	//El evento no pasa ninguno de los filtros de los que forma parte la regla
+	for (unsigned int i = 0; i < reglas_[identificador].filtros.size(); ++i)
+		pasan[reglas_[identificador].filtros[i]] = false;
+}
+
+void MotorDeSuscripciones::extraerValores (	const std::string& descripcion,
+											std::vector<std::string>& claves,
+											std::vector<std::string>& valores	)
+{
+	claves.clear();
+	valores.clear();
+	if (claves_.empty()) return;
+	for (auto i = claves_.begin(); i != claves_.end(); ++i) claves.push_back(i->first);
+	valores.resize(claves.size());
+	
+	//Se recorren las líneas de la descripción, localizando las claves utilizadas en las que son objetos JSON.
+	//Si la línea tiene cabecera de syslog, el objeto es su mensaje
+	vector<ExtractorDeJson::Miembro> miembros (claves.size());
+	AnalizadorDeSyslog::Campos cabecera;
+	size_t inicio = 0;
+	while (inicio < descripcion.length())
+	{
+		size_t fin = descripcion.find('\n', inicio);
+		if (fin == string::npos) fin = descripcion.length();
+		AnalizadorDeSyslog::analizar(&descripcion[inicio], fin - inicio, cabecera);
+		size_t mensaje = inicio + cabecera.inicio[AnalizadorDeSyslog::CAMPO_MENSAJE];
+		if (ExtractorDeJson::extraer(	&descripcion[mensaje], cabecera.longitud[AnalizadorDeSyslog::CAMPO_MENSAJE],
+										claves, &miembros[0]	) > 0)
+		{
+			for (unsigned int i = 0; i < claves.size(); ++i)
+			{
+				if (miembros[i].longitud_clave == 0) continue;
+				if (!valores[i].empty()) valores[i].push_back('\n');
+				valores[i].append(descripcion, mensaje + miembros[i].inicio_valor, miembros[i].longitud_valor);
+			}
+		}
+		inicio = fin + 1;
+	}
+}
+
+bool MotorDeSuscripciones::cumplePredicado (	const Predicado& predicado,
+												const std::string* campos,
+												const std::vector<std::string>& claves,
+												const std::vector<std::string>& valores	)
+{
+	if (predicado.campo != Condicion::CAMPO_JSON) return regex_match(campos[predicado.campo], predicado.regex);
+	size_t indice = lower_bound(claves.begin(), claves.end(), predicado.clave) - claves.begin();
+	return regex_match(valores[indice], predicado.regex);
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,214 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _motor_de_suscripciones_h_
+#define _motor_de_suscripciones_h_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <tuple>
+#include <regex>
+#include <mutex>
+
+#include "filtro.h"
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* El MotorDeSuscripciones evalúa de forma conjunta los filtros de todos los clientes conectados. En lugar de
+* evaluar el Filtro de cada cliente por separado, indexa todas sus condiciones: cada predicado distinto (un
+* campo del Evento comparado con una expresión regular) se compila y evalúa una única vez por Evento, aunque lo
+* utilicen muchas reglas, y un algoritmo de conteo deduce a partir de los predicados satisfechos qué reglas se
+* cumplen y, a partir de éstas, qué filtros omiten el Evento. Las reglas y filtros idénticos también se
+* comparten, de forma que el coste por Evento depende del número de predicados y reglas distintos y no del
+* número de clientes. De las líneas JSON de cada Evento sólo se localizan las claves que utiliza algún
+* predicado, sin analizar el resto de la línea (ver ExtractorDeJson). El MotorDeSuscripciones es thread safe.
+*/
+class MotorDeSuscripciones
+{
+	public:
+	
+	/**
+	* Constructor de la clase MotorDeSuscripciones
+	*/
+	MotorDeSuscripciones (void): marca_(0), evaluaciones_(0) {}
+	
+	/**
+	* Registra un Filtro en el motor. Si ya hay registrado un Filtro equivalente, se comparte con él
+	* @param filtro Filtro que desea registrarse
+	* @return Identificador asignado al Filtro, o -1 si alguna de sus expresiones regulares no es válida. El
+	* identificador es válido hasta que se retire el Filtro mediante retirarFiltro
+	*/
+	int registrarFiltro (const Filtro& filtro);
+	
+	/**
+	* Retira un Filtro del motor. Cada llamada a registrarFiltro debe corresponderse con una llamada a
+	* retirarFiltro cuando el Filtro deje de utilizarse. Su identificador no se reasigna hasta que se liberen
+	* las evaluaciones anteriores a la retirada (ver liberarFiltros)
+	* @param identificador Identificador asignado al Filtro durante su registro
+	*/
+	void retirarFiltro (const int identificador);
+	
+	/**
+	* Evalúa un Evento frente a todos los filtros registrados
+	* @param evento Evento que desea evaluarse
+	* @param pasan Vector en el que se devuelve, indexado por el identificador de cada Filtro, si el Evento pasa
+	* dicho Filtro (true) o es omitido por alguna de sus reglas (false). Como los identificadores de los filtros
+	* retirados no se reasignan mientras se utilice el resultado (ver liberarFiltros), éste sigue siendo válido
+	* para los filtros existentes durante la evaluación; los registrados después pueden no tener resultado o
+	* tenerlo a true
+	* @return Número de la evaluación, consecutivo al de la anterior y comenzando por 1
+	*/
+	unsigned long long evaluar (Evento& evento, std::vector<bool>& pasan);
+	
+	/**
+	* Permite reasignar los identificadores de los filtros retirados tras una evaluación, cuando ya no se
+	* utiliza su resultado ni el de ninguna de las anteriores
+	* @param evaluacion Número de la última evaluación cuyo resultado ya no se utiliza
+	*/
+	void liberarFiltros (const unsigned long long evaluacion);
+	
+	/**
+	* Evalúa un Evento frente a un único Filtro registrado, sin recorrer los demás
+	* @param evento Evento que desea evaluarse
+	* @param identificador Identificador asignado al Filtro durante su registro
+	* @return true si el Evento pasa el Filtro (o éste no está registrado), false si alguna de sus reglas lo omite
+	*/
+	bool evaluar (Evento& evento, const int identificador);
+	
+	private:
+	
+	/**
+	* Clave que identifica a un predicado: campo, clave JSON (vacía salvo en CAMPO_JSON) y expresión regular
+	*/
+	typedef std::tuple<unsigned int, std::string, std::string> ClaveDePredicado;
+	
+	/**
+	* Predicado indexado: comparación de un campo del Evento con una expresión regular compilada, junto con las
+	* reglas en que aparece y el signo con que lo hace en cada una
+	*/
+	struct Predicado
+	{
+		unsigned int campo;										///< Campo del Evento comparado
+		std::string clave;										///< Clave JSON comparada, si campo es CAMPO_JSON
+		std::string expresion;									///< Texto de la expresión regular
+		std::regex regex;										///< Expresión regular compilada
+		std::vector<std::pair<unsigned int, bool>> apariciones;	///< Reglas (y signo) en que aparece
+	};
+	
+	/**
+	* Regla indexada: conjunto de condiciones (predicado y signo) y filtros de los que forma parte, junto con
+	* el contador de condiciones satisfechas utilizado durante la evaluación de cada Evento
+	*/
+	struct ReglaIndexada
+	{
+		std::vector<std::pair<unsigned int, bool>> condiciones;	///< Predicados (y signo) que la componen
+		std::vector<unsigned int> filtros;						///< Filtros de los que forma parte
+		unsigned int contador;									///< Condiciones satisfechas por el Evento
+		unsigned int marca;										///< Evento al que corresponde el contador
+	};
+	
+	/**
+	* Filtro indexado: conjunto de reglas que lo componen y número de clientes que lo utilizan
+	*/
+	struct FiltroIndexado
+	{
+		std::vector<unsigned int> reglas;						///< Reglas que lo componen
+		unsigned int referencias;								///< Número de registros vigentes del filtro
+	};
+	
+	/**
+	* Obtiene el identificador de un predicado, añadiéndolo al índice si todavía no existe
+	* @param campo Campo del Evento comparado
+	* @param clave Clave JSON comparada, si campo es CAMPO_JSON
+	* @param expresion Texto de la expresión regular
+	* @param regex Expresión regular ya compilada, utilizada si el predicado debe añadirse
+	* @return Identificador del predicado
+	*/
+	unsigned int obtenerPredicado (	const unsigned int campo,
+									const std::string& clave,
+									const std::string& expresion,
+									const std::regex& regex	);
+	
+	/**
+	* Libera un predicado que ya no aparece en ninguna regla, retirándolo del índice
+	* @param identificador Identificador del predicado
+	*/
+	void liberarPredicado (const unsigned int identificador);
+	
+	/**
+	* Obtiene el identificador de una regla, añadiéndola al índice (sin ningún filtro) si todavía no existe
+	* @param condiciones Condiciones de la regla en forma canónica (ordenadas y sin repeticiones)
+	* @return Identificador de la regla
+	*/
+	unsigned int obtenerRegla (const std::vector<std::pair<unsigned int, bool>>& condiciones);
+	
+	/**
+	* Elimina una regla que ya no forma parte de ningún filtro, retirando los predicados que dejan de usarse
+	* @param identificador Identificador de la regla
+	*/
+	void eliminarRegla (const unsigned int identificador);
+	
+	/**
+	* Anota que la regla especificada se cumple para el Evento en evaluación, de forma que ninguno de los
+	* filtros de los que forma parte es superado
+	* @param identificador Identificador de la regla
+	* @param pasan Resultado de la evaluación en curso
+	*/
+	void dispararRegla (const unsigned int identificador, std::vector<bool>& pasan);
+	
+	/**
+	* Localiza en las líneas JSON de la descripción de un Evento (o en su mensaje, si tienen cabecera de syslog)
+	* las claves que utiliza algún predicado, y sólo ellas. El valor de cada clave es el de todas las líneas en
+	* que aparece, separados por '\n', o cadena vacía si no aparece en ninguna
+	* @param descripcion Descripción del Evento
+	* @param claves Vector en que se devuelven las claves, ordenadas
+	* @param valores Vector en que se devuelve el valor de cada clave
+	*/
+	void extraerValores (	const std::string& descripcion,
+							std::vector<std::string>& claves,
+							std::vector<std::string>& valores	);
+	
+	/**
+	* Evalúa un predicado sobre los campos de un Evento
+	* @param predicado Predicado evaluado
+	* @param campos Nombre del fichero y descripción del Evento, indexados por CAMPO_FICHERO y CAMPO_CONTENIDO
+	* @param claves Claves JSON obtenidas mediante extraerValores
+	* @param valores Valores de las claves JSON obtenidos mediante extraerValores
+	* @return true si el campo del predicado iguala su expresión regular, false en caso contrario
+	*/
+	bool cumplePredicado (	const Predicado& predicado,
+							const std::string* campos,
+							const std::vector<std::string>& claves,
+							const std::vector<std::string>& valores	);
+	
+	//Variables miembro
+	std::vector<Predicado> predicados_;			///< Predicados indexados (los libres tienen expresion vacía
+												///< y ninguna aparición)
+	std::vector<ReglaIndexada> reglas_;			///< Reglas indexadas
+	std::vector<FiltroIndexado> filtros_;		///< Filtros indexados
+	std::vector<unsigned int> predicados_libres_;	///< Posiciones libres de predicados_
+	std::vector<unsigned int> reglas_libres_;		///< Posiciones libres de reglas_
+	std::vector<unsigned int> filtros_libres_;		///< Posiciones libres de filtros_
+	std::vector<std::pair<unsigned int, unsigned long long>> filtros_retirados_;	///< Posiciones de filtros_
+																			///< retiradas y evaluación anterior
+	std::vector<unsigned int> incondicionales_;		///< Reglas sin condiciones, que siempre se cumplen
+	std::map<ClaveDePredicado, unsigned int> indice_predicados_;							///< Predicados por clave
+	std::map<std::vector<std::pair<unsigned int, bool>>, unsigned int> indice_reglas_;	///< Reglas por clave
+	std::map<std::vector<unsigned int>, unsigned int> indice_filtros_;					///< Filtros por clave
+	std::map<std::string, unsigned int> claves_;	///< Claves JSON de los predicados, con cuántos la utilizan
+	unsigned int marca_;						///< Número de Evento en evaluación, para invalidar contadores
+	unsigned long long evaluaciones_;			///< Número de la última evaluación de todos los filtros
+	std::mutex mutex_;							///< Mutex para permitir acceso concurrente seguro al motor
+};
+
+} //namespace lognotify
+
+#endif //_motor_de_suscripciones_h_
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "publicador_de_multidifusion.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "mensaje.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int PublicadorDeMultidifusion::TAMANO_DATAGRAMA_;
+constexpr unsigned int PublicadorDeMultidifusion::MAX_ENCOLADOS_;
+
+PublicadorDeMultidifusion::~PublicadorDeMultidifusion (void)
+{
+	//Se avisa al hilo de envío de que debe terminar y se espera a que lo haga
+	mutex_.lock();
+	terminar_ = true;
+	mutex_.unlock();
+	aviso_.notify_all();
+	if (hilo_envio_.joinable()) hilo_envio_.join();
+	if (descriptor_socket_ >= 0) close(descriptor_socket_);
+}
+
+bool PublicadorDeMultidifusion::inicializar (const std::string& destino, const std::string& instancia)
+{
+	//Sólo puede inicializarse una vez
+	if (estaInicializado()) return false;
+	
+	//Se separan el grupo y el puerto; un grupo IPv6 puede ir entre corchetes
+	size_t separador = destino.rfind(':');
+	if ((separador == string::npos) || (separador == 0) || (separador + 1 == destino.length())) return false;
+	string grupo = destino.substr(0, separador);
+	string puerto = destino.substr(separador + 1);
+	if ((grupo.front() == '[') && (grupo.back() == ']')) grupo = grupo.substr(1, grupo.length() - 2);
+	
+	//Se obtiene la dirección del grupo, que debe ser de multidifusión
+	struct addrinfo indicaciones, *info_grupo;
+	memset(&indicaciones, 0, sizeof indicaciones);
+	indicaciones.ai_family = AF_UNSPEC;
+	indicaciones.ai_socktype = SOCK_DGRAM;
+	indicaciones.ai_flags = AI_NUMERICHOST;
+	if (getaddrinfo(&grupo[0], &puerto[0], &indicaciones, &info_grupo) != 0) return false;
+	bool es_grupo = false;
+	if (info_grupo->ai_family == AF_INET)
+		es_grupo = IN_MULTICAST(ntohl(((struct sockaddr_in*) info_grupo->ai_addr)->sin_addr.s_addr));
+	else if (info_grupo->ai_family == AF_INET6)
+		es_grupo = IN6_IS_ADDR_MULTICAST(&((struct sockaddr_in6*) info_grupo->ai_addr)->sin6_addr);
+	
+	//Se crea el socket de envío. Los datagramas no salen de la red local, y se entregan también en esta misma
+	//máquina, de forma que los clientes locales (y las pruebas) pueden recibirlos por la interfaz de bucle
+	int descriptor_socket = es_grupo ? socket(info_grupo->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0) : -1;
+	if (descriptor_socket >= 0)
+	{
+		int saltos = 1;
+		int bucle = 1;
+		bool configurado = (info_grupo->ai_family == AF_INET) ?
+			(setsockopt(descriptor_socket, IPPROTO_IP, IP_MULTICAST_TTL, &saltos, sizeof saltos) == 0) &&
+			(setsockopt(descriptor_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &bucle, sizeof bucle) == 0) :
+			(setsockopt(descriptor_socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &saltos, sizeof saltos) == 0) &&
+			(setsockopt(descriptor_socket, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &bucle, sizeof bucle) == 0);
+		if (!configurado)
+		{
+			close(descriptor_socket);
+			descriptor_socket = -1;
+		}
+	}
+	if (descriptor_socket >= 0)
+	{
+		const char *direccion = (const char*) info_grupo->ai_addr;
+		direccion_.assign(direccion, direccion + info_grupo->ai_addrlen);
+	}
+	freeaddrinfo(info_grupo);
+	if (descriptor_socket < 0) return false;
+	
+	//Se lanza el hilo de envío
+	descriptor_socket_ = descriptor_socket;
+	destino_ = destino;
+	instancia_ = instancia;
+	hilo_envio_ = thread(&PublicadorDeMultidifusion::difundir, this);
+	return true;
+}
+
+void PublicadorDeMultidifusion::publicar (std::shared_ptr<Mensaje> mensaje)
+{
+	if (!estaInicializado()) return;
+	
+	//Se encola el mensaje y se avisa al hilo de envío. Si la red no da abasto y la cola está llena, el mensaje
+	//no se difunde; los clientes lo solicitarán por TCP
+	mutex_.lock();
+	bool encolado = (encolados_.size() < MAX_ENCOLADOS_);
+	if (encolado) encolados_.push_back(move(mensaje));
+	mutex_.unlock();
+	if (encolado) aviso_.notify_one();
+}
+
+void PublicadorDeMultidifusion::difundir (void)
+{
+	vector<shared_ptr<Mensaje>> lote;
+	string datagrama;
+	datagrama.reserve(TAMANO_DATAGRAMA_);
+	while (true)
+	{
+		//Se espera a que haya mensajes encolados y se toman todos a la vez
+		unique_lock<mutex> bloqueo (mutex_);
+		aviso_.wait(bloqueo, [this] { return terminar_ || !encolados_.empty(); });
+		if (terminar_) return;
+		lote.swap(encolados_);
+		bloqueo.unlock();
+		
+		//Se agrupan los mensajes en datagramas que no superen el tamaño máximo, enviando cada uno en cuanto el
+		//siguiente mensaje ya no cabe en él
+		datagrama.assign(instancia_ + '\0');
+		unsigned int vacio = datagrama.length();
+		for (unsigned int i = 0; i <= lote.size(); ++i)
+		{
+			bool ultimo = (i == lote.size());
+			if (!ultimo && (vacio + lote[i]->obtener_longitud() > TAMANO_DATAGRAMA_)) continue;
+			if ((ultimo || (datagrama.length() + lote[i]->obtener_longitud() > TAMANO_DATAGRAMA_)) &&
+				(datagrama.length() > vacio))
+			{
+				while ((sendto(descriptor_socket_, &datagrama[0], datagrama.length(), 0,
+					(struct sockaddr*) &direccion_[0], direccion_.size()) < 0) && (errno == EINTR));
+				datagrama.resize(vacio);
+			}
+			if (!ultimo) datagrama.append(lote[i]->obtener_inicio(), lote[i]->obtener_longitud());
+		}
+		lote.clear();
+	}
+}
+
+} //namespace lognotify
\ No newline at end of file
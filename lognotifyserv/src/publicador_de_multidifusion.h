@@ -0,0 +1,112 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _publicador_de_multidifusion_h_
+#define _publicador_de_multidifusion_h_
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "mensaje.h"
+
+namespace lognotify
+{
+
+/**
+* Un PublicadorDeMultidifusion difunde los eventos a un grupo de multidifusión UDP, de forma que llegar a
+* cientos de clientes de la misma red cueste un único envío por lote en lugar de uno por cliente.
+* Cada datagrama comienza con el identificador de la instancia del servidor, seguido de uno o más eventos con
+* su número de secuencia, en el mismo formato que los envíos secuenciados por TCP:
+* "instancia"\0"secuencia"\0"nombre"\0"ubicacion"\0"descripcion"\0...
+* Los eventos se agrupan en datagramas de hasta TAMANO_DATAGRAMA_ bytes, para no fragmentarse en una red
+* Ethernet. Los eventos publicados mientras se envía un lote forman el siguiente, por lo que con poca carga cada
+* evento sale inmediatamente y con mucha se aprovecha cada datagrama. Los eventos que no caben solos en un
+* datagrama no se difunden: los clientes detectan el salto en la secuencia y los solicitan por TCP, igual que
+* los datagramas perdidos (ver TablaDeClientes::repararCliente).
+* La publicación es thread safe; los envíos se realizan en un hilo propio para no retrasar la difusión por TCP.
+* Prueba en una sola máquina: los datagramas también se entregan a los procesos locales, por lo que basta con
+* lanzar el servidor con -m 239.255.0.1:5700 -l 1 y un lognotifycli conectado a él (si la máquina no tiene ruta
+* por defecto, se añade una para el grupo: ip route add 239.0.0.0/8 dev lo). Para probar la reparación se
+* descarta parte de los datagramas al recibirlos, con
+* iptables -A INPUT -d 239.255.0.1 -m statistic --mode random --probability 0.3 -j DROP
+* y se escriben líneas en un fichero monitorizado: el cliente debe mostrarlas todas, en orden, incluidas las de
+* los últimos datagramas, que sólo solicita tras el siguiente latido.
+*/
+class PublicadorDeMultidifusion
+{
+	public:
+	
+	/**
+	* Constructor de la clase PublicadorDeMultidifusion
+	*/
+	PublicadorDeMultidifusion (void): descriptor_socket_(-1), terminar_(false) {}
+	
+	/**
+	* Destructor de la clase PublicadorDeMultidifusion. Espera a que termine el hilo de envío y cierra el socket
+	*/
+	~PublicadorDeMultidifusion (void);
+	
+	PublicadorDeMultidifusion (const PublicadorDeMultidifusion&) = delete;
+	PublicadorDeMultidifusion& operator= (const PublicadorDeMultidifusion&) = delete;
+	
+	/**
+	* Crea el socket de envío al grupo de multidifusión y lanza el hilo que envía los datagramas. Los datagramas
+	* no salen de la red local (TTL 1) y también se entregan a los clientes de la propia máquina
+	* @param destino Grupo de multidifusión y puerto UDP, en la forma "grupo:puerto" (ej. 239.255.0.1:5700)
+	* @param instancia Identificador de la ejecución del servidor, con el que comienza cada datagrama
+	* @return true si el publicador ha sido inicializado, false si el destino no es válido o no hay socket
+	*/
+	bool inicializar (const std::string& destino, const std::string& instancia);
+	
+	/**
+	* Indica si el publicador ha sido inicializado correctamente
+	* @return true si el publicador ha sido inicializado, false en caso contrario
+	*/
+	inline bool estaInicializado (void) { return descriptor_socket_ >= 0; }
+	
+	/**
+	* Devuelve el grupo de multidifusión y el puerto UDP al que se difunden los eventos
+	* @return Destino de los datagramas, en la forma "grupo:puerto"
+	*/
+	inline std::string obtener_destino (void) { return destino_; }
+	
+	/**
+	* Encola un Mensaje para su difusión en el siguiente datagrama, sin esperar a que se envíe
+	* @param mensaje Mensaje serializado por ServidorDeNotificaciones, con su número de secuencia en la cabecera
+	*/
+	void publicar (std::shared_ptr<Mensaje> mensaje);
+	
+	private:
+	
+	/**
+	* Función del hilo de envío: agrupa en datagramas los mensajes encolados y los envía al grupo, hasta que se
+	* destruye el publicador
+	*/
+	void difundir (void);
+	
+	//Constantes
+	constexpr static unsigned int TAMANO_DATAGRAMA_ = 1400;	///< Máximo de bytes por datagrama
+	constexpr static unsigned int MAX_ENCOLADOS_ = 65536;		///< Máximo de mensajes pendientes de difundir
+	
+	//Variables miembro
+	int descriptor_socket_;				///< Descriptor del socket UDP de envío
+	std::vector<char> direccion_;		///< Dirección del grupo (struct sockaddr) a la que se envía
+	std::string destino_;				///< Grupo y puerto de destino, "grupo:puerto"
+	std::string instancia_;				///< Identificador de la ejecución del servidor
+	std::vector<std::shared_ptr<Mensaje>> encolados_;	///< Mensajes pendientes de difundir
+	bool terminar_;						///< Indica al hilo de envío que debe terminar
+	std::mutex mutex_;					///< Mutex que protege la cola de mensajes
+	std::condition_variable aviso_;		///< Aviso al hilo de envío de nuevos mensajes encolados
+	std::thread hilo_envio_;			///< Hilo que envía los datagramas
+};
+
+} //namespace lognotify
+
+#endif //_publicador_de_multidifusion_h_
\ No newline at end of file
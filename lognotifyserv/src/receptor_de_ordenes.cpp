@@ -0,0 +1,161 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "receptor_de_ordenes.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <cerrno>
+#include <string>
+#include <memory>
+#include <chrono>
+
+#include "tabla_de_clientes.h"
+#include "relevo.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int ReceptorDeOrdenes::SEGUNDOS_ESPERA_;
+
+void ReceptorDeOrdenes::recibir (void)
+{
+	//La conexión se ha cerrado o perdido, o el cliente ha dejado de dar señales de vida: se elimina el cliente,
+	//liberando sus envíos pendientes. Si ya se había eliminado (al fallar un envío), no se hace nada, y si la
+	//tabla de clientes ya no existe, tampoco hay cliente que eliminar
+	if (recibirOrdenes())
+	{
+		shared_ptr<TablaDeClientes> destino = destino_.lock();
+		if (destino) destino->eliminarCliente(identificador_cliente_);
+	}
+	if (relevo_) relevo_->retirar();
+}
+
+bool ReceptorDeOrdenes::recibirOrdenes (void)
+{
+	//Si el cliente había enviado parte de una orden a otra ejecución del servidor, se continúa con ella
+	if (!orden_pendiente_.empty() && !procesarDatos(&orden_pendiente_[0], orden_pendiente_.length())) return false;
+	orden_pendiente_.clear();
+	
+	char buffer [TAMANO_BUFFER_];
+	
+	//Hasta que el cliente decide cómo recibir los eventos, la tabla se los retiene (ver
+	//TablaDeClientes::reanudarCliente). Si no lo ha hecho al agotarse la espera, se le envían los retenidos
+	chrono::steady_clock::time_point fin_de_espera = chrono::steady_clock::now() + chrono::seconds(SEGUNDOS_ESPERA_);
+	bool esperando = true;
+	int recibidos = 1;
+	while (recibidos > 0)
+	{
+		//Se espera la siguiente orden: si el cliente envía latidos, como mucho el tiempo de inactividad, y
+		//mientras dura la espera, como mucho hasta su fin. Se espera a la vez el aviso del relevo, si lo hay (un
+		//descriptor negativo se ignora)
+		struct pollfd esperas [2];
+		esperas[0].fd = descriptor_socket_;
+		esperas[0].events = POLLIN;
+		esperas[1].fd = relevo_ ? relevo_->obtener_aviso() : -1;
+		esperas[1].events = POLLIN;
+		esperas[1].revents = 0;
+		int milisegundos = (latiendo_ && (segundos_inactividad_ > 0)) ? segundos_inactividad_ * 1000 : -1;
+		int restante = -1;
+		if (esperando)
+		{
+			chrono::steady_clock::duration hasta_fin = fin_de_espera - chrono::steady_clock::now();
+			restante = chrono::duration_cast<chrono::milliseconds>(hasta_fin).count();
+			if (restante < 0) restante = 0;
+			if ((milisegundos < 0) || (restante < milisegundos)) milisegundos = restante;
+		}
+		int resultado = poll(esperas, 2, milisegundos);
+		if ((resultado < 0) && (errno == EINTR)) continue;
+		if ((resultado == 0) && esperando && (milisegundos == restante))
+		{
+			esperando = false;
+			shared_ptr<TablaDeClientes> destino = destino_.lock();
+			if (!destino || !destino->terminarEspera(identificador_cliente_)) return false;
+			continue;
+		}
+		if (resultado <= 0) break;
+		
+		//Durante un relevo se anota en el cliente la orden recibida sólo en parte, tal como se recibió, y se
+		//detiene la recepción. Lo que el cliente envíe mientras tanto espera en la conexión
+		if (esperas[1].revents != 0)
+		{
+			shared_ptr<TablaDeClientes> destino = destino_.lock();
+			if (!destino) return false;
+			string pendiente = campos_[0];
+			if (campo_actual_ == 1) pendiente = pendiente + '\0' + campos_[1];
+			destino->anotarOrdenPendiente(identificador_cliente_, pendiente, latiendo_);
+			destino.reset();
+			relevo_->esperarReanudacion();
+			continue;
+		}
+		
+		//El socket del cliente es no bloqueante (ver Cliente), por lo que un aviso sin datos se ignora
+		recibidos = recv(descriptor_socket_, buffer, TAMANO_BUFFER_, 0);
+		if ((recibidos < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			recibidos = 1;
+			continue;
+		}
+		if ((recibidos > 0) && !procesarDatos(buffer, recibidos)) return false;
+	}
+	return true;
+}
+
+bool ReceptorDeOrdenes::procesarDatos (const char *datos, const int longitud)
+{
+	//Las órdenes llegan en la forma "orden"\0"argumento"\0, por lo que se van acumulando caracteres en el
+	//campo en curso hasta encontrar un '\0', alternando entre orden y argumento
+	for (int i = 0; i < longitud; ++i)
+	{
+		if (datos[i] != '\0')
+		{
+			//Un campo más largo de lo permitido no se almacena completo; la orden a la que pertenece será
+			//descartada al completarse
+			if (campos_[campo_actual_].length() < MAX_LONGITUD_CAMPO_) campos_[campo_actual_].push_back(datos[i]);
+			else descartar_ = true;
+		}
+		else if (campo_actual_ == 0) campo_actual_ = 1;
+		else
+		{
+			//Al completarse el argumento se dispone de una orden completa, que se aplica salvo que deba
+			//descartarse. Si la tabla de clientes ya no existe, no tiene sentido seguir recibiendo
+			if (!descartar_ && !procesarOrden(campos_[0], campos_[1])) return false;
+			campos_[0].clear();
+			campos_[1].clear();
+			campo_actual_ = 0;
+			descartar_ = false;
+		}
+	}
+	return true;
+}
+
+bool ReceptorDeOrdenes::procesarOrden (const std::string& orden, const std::string& argumento)
+{
+	//Se obtiene acceso a la tabla de clientes
+	shared_ptr<TablaDeClientes> destino = destino_.lock();
+	if (!destino) return false;
+	
+	//Se aplica la orden correspondiente; las órdenes desconocidas se ignoran
+	if (orden == "filtro") destino->establecerFiltro(identificador_cliente_, argumento);
+	else if (orden == "formato") destino->establecerFormato(identificador_cliente_, argumento);
+	else if (orden == "reanudar") destino->reanudarCliente(identificador_cliente_, argumento);
+	else if (orden == "confirmar") destino->confirmarCliente(identificador_cliente_, argumento);
+	else if (orden == "multidifusion") destino->activarMultidifusion(identificador_cliente_);
+	else if (orden == "repetidor") destino->aceptarOrigenes(identificador_cliente_);
+	else if (orden == "reparar") destino->repararCliente(identificador_cliente_, argumento);
+	else if (orden == "contadores") destino->enviarContadores(identificador_cliente_);
+	else if (orden == "crudo") destino->reflejarFichero(identificador_cliente_, argumento);
+	else if (orden == "agregar") destino->suscribirAgregado(identificador_cliente_, argumento);
+	else if (orden == "resumir") destino->establecerResumen(identificador_cliente_, argumento);
+	else if (orden == "plantillas") destino->enviarPlantillas(identificador_cliente_);
+	else if (orden == "latido") latiendo_ = true;
+	
+	return true;
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,143 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _receptor_de_ordenes_h_
+#define _receptor_de_ordenes_h_
+
+#include <string>
+#include <memory>
+
+#include "tabla_de_clientes.h"
+#include "relevo.h"
+
+namespace lognotify
+{
+
+/**
+* Un ReceptorDeOrdenes atiende las órdenes que un cliente envía al servidor a través de su conexión. Las órdenes
+* siguen el mismo formato que los eventos que el servidor envía a los clientes, con campos de texto terminados
+* en '\0': "orden"\0"argumento"\0. Las órdenes desconocidas se ignoran, de forma que clientes más modernos
+* puedan conectar con servidores que no las soporten. Las órdenes reconocidas son:
+*	- filtro: el argumento contiene las reglas de filtrado del cliente (ver TablaDeClientes::establecerFiltro)
+*	- formato: el argumento contiene el formato en que el cliente desea recibir los eventos con su secuencia,
+*	  "texto", "binario", "comprimido" o "estructurado"; debe preceder a reanudar (ver TablaDeClientes::establecerFormato)
+*	- reanudar: el argumento contiene el último evento recibido por el cliente en una conexión anterior, para
+*	  que se le reenvíen los que se ha perdido (ver TablaDeClientes::reanudarCliente)
+*	- confirmar: el argumento contiene el número de secuencia del último evento procesado por el cliente, que
+*	  limita los que se le envían sin confirmar (ver TablaDeClientes::confirmarCliente)
+*	- multidifusion: el cliente ya recibe los datagramas del grupo anunciado y deja de necesitar que se le
+*	  envíen los eventos por su conexión; el argumento se ignora (ver TablaDeClientes::activarMultidifusion)
+*	- repetidor: el cliente entiende el origen con que un repetidor precede la ubicación de los eventos que
+*	  reenvía de otros servidores; sin esta orden se le envían sin él. El argumento se ignora (ver
+*	  TablaDeClientes::aceptarOrigenes)
+*	- reparar: el argumento contiene el rango "desde:hasta" de eventos perdidos por multidifusión, que se le
+*	  reenvían por su conexión (ver TablaDeClientes::repararCliente)
+*	- contadores: el cliente solicita los contadores del servidor, por ejemplo las líneas admitidas y
+*	  suprimidas de cada fichero; el argumento se ignora (ver TablaDeClientes::enviarContadores)
+*	- crudo: el argumento contiene la ruta de un fichero monitorizado cuyos bytes añadidos desea recibir el
+*	  cliente tal cual, en lugar de eventos (ver TablaDeClientes::reflejarFichero)
+*	- agregar: el argumento contiene la duración de una ventana en segundos y, en las líneas siguientes, reglas
+*	  con la sintaxis del filtro; al cerrarse cada ventana, el cliente recibe el número de líneas que las han
+*	  cumplido. Vacío, anula las suscripciones del cliente (ver TablaDeClientes::suscribirAgregado)
+*	- resumir: con el argumento "1", el cliente pasa a recibir periódicamente el número de líneas de cada
+*	  plantilla aparecida, y con "0" deja de recibirlo (ver TablaDeClientes::establecerResumen)
+*	- plantillas: el cliente solicita la tabla completa de plantillas conocidas; el argumento se ignora (ver
+*	  TablaDeClientes::enviarPlantillas)
+*	- latido: el cliente sigue activo; el argumento se ignora. A partir del primero, el cliente debe enviar
+*	  alguna orden dentro de cada tiempo de inactividad, o se le da por perdido
+* Los clientes que no envían ninguna orden reciben todos los eventos, como hasta ahora, aunque los difundidos
+* durante los SEGUNDOS_ESPERA_ siguientes a su conexión les llegan al terminar ésta (ver
+* TablaDeClientes::terminarEspera), pues hasta entonces se espera a que decidan si reanudan.
+* Cuando la conexión se cierra o falla (incluso porque el núcleo la da por perdida) o el cliente deja de
+* enviar latidos, el ReceptorDeOrdenes elimina al cliente de la TablaDeClientes.
+* Durante un Relevo, el ReceptorDeOrdenes deja anotada en el cliente la orden que haya recibido sólo en parte
+* y se detiene; el proceso entrante continúa con un nuevo ReceptorDeOrdenes a partir de ella.
+*/
+class ReceptorDeOrdenes
+{
+	public:
+	
+	/**
+	* Constructor de la clase ReceptorDeOrdenes
+	* @param descriptorSocket Descriptor de fichero del socket correspondiente a la conexión al cliente
+	* @param identificadorCliente Identificador asignado al cliente en la TablaDeClientes
+	* @param destino TablaDeClientes en la que está registrado el cliente y sobre la que se aplican sus órdenes
+	* @param segundosInactividad Tiempo máximo entre órdenes de un cliente que envía latidos antes de darlo por
+	* perdido, o 0 para esperar indefinidamente
+	* @param relevo Relevo en el que el hilo que recibe las órdenes ya está registrado, o nullptr si no hay
+	* @param ordenPendiente Bytes recibidos en otra ejecución del servidor de una orden enviada sólo en parte
+	* @param latiendo Indica si el cliente ya enviaba latidos en otra ejecución del servidor
+	*/
+	ReceptorDeOrdenes (	const int descriptorSocket,
+						const TablaDeClientes::IdentificadorDeCliente identificadorCliente,
+						std::weak_ptr<TablaDeClientes> destino,
+						const unsigned int segundosInactividad = 0,
+						std::shared_ptr<Relevo> relevo = nullptr,
+						const std::string& ordenPendiente = "",
+						const bool latiendo = false	):
+		descriptor_socket_(descriptorSocket),
+		identificador_cliente_(identificadorCliente),
+		destino_(destino),
+		segundos_inactividad_(segundosInactividad),
+		latiendo_(latiendo),
+		relevo_(relevo),
+		orden_pendiente_(ordenPendiente),
+		campo_actual_(0),
+		descartar_(false) {}
+	
+	/**
+	* Recibe y aplica las órdenes del cliente hasta que la conexión se cierre o falle, o el cliente deje de
+	* enviar latidos, y entonces lo elimina de la TablaDeClientes. Es una función bloqueante, pensada para ser
+	* ejecutada en un hilo propio por cada cliente. Al terminar retira su registro del Relevo, si lo hay
+	*/
+	void recibir (void);
+	
+	private:
+	
+	/**
+	* Reparte los bytes recibidos entre los campos de la orden en curso, aplicando cada orden al completarse
+	* @param datos Bytes recibidos
+	* @param longitud Número de bytes recibidos
+	* @return false si la TablaDeClientes de destino ya no existe, true en caso contrario
+	*/
+	bool procesarDatos (const char *datos, const int longitud);
+	
+	/**
+	* Recibe y aplica las órdenes del cliente hasta que la conexión se cierre o falle, o el cliente deje de
+	* enviar latidos
+	* @return false si la TablaDeClientes de destino ya no existe, true en caso contrario
+	*/
+	bool recibirOrdenes (void);
+	
+	/**
+	* Aplica una orden recibida del cliente
+	* @param orden Nombre de la orden recibida
+	* @param argumento Argumento de la orden recibida
+	* @return false si la TablaDeClientes de destino ya no existe, true en caso contrario
+	*/
+	bool procesarOrden (const std::string& orden, const std::string& argumento);
+	
+	//Constantes
+	constexpr static int TAMANO_BUFFER_ = 4096;				///< Tamaño del buffer utilizado para recibir datos
+	constexpr static unsigned int MAX_LONGITUD_CAMPO_ = 65536;	///< Longitud máxima de un campo de una orden
+	constexpr static unsigned int SEGUNDOS_ESPERA_ = 2;	///< Espera máxima a que el cliente solicite reanudar
+	
+	//Variables miembro
+	int descriptor_socket_;					///< Descriptor de fichero del socket de conexión con el cliente
+	TablaDeClientes::IdentificadorDeCliente identificador_cliente_;	///< Identificador del cliente en la tabla
+	std::weak_ptr<TablaDeClientes> destino_;	///< Tabla en la que está registrado el cliente
+	unsigned int segundos_inactividad_;		///< Tiempo máximo entre órdenes de un cliente que envía latidos
+	bool latiendo_;							///< Indica si el cliente envía latidos
+	std::shared_ptr<Relevo> relevo_;		///< Relevo que puede detener la recepción, o nullptr si no hay
+	std::string orden_pendiente_;			///< Bytes de una orden recibidos en otra ejecución del servidor
+	std::string campos_ [2];				///< Orden y argumento en curso
+	unsigned int campo_actual_;				///< Campo en curso: 0 para la orden, 1 para el argumento
+	bool descartar_;						///< Indica si la orden en curso debe descartarse por su longitud
+};
+
+} //namespace lognotify
+
+#endif //_receptor_de_ordenes_h_
\ No newline at end of file
@@ -0,0 +1,46 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _regla_h_
+#define _regla_h_
+
+#include <vector>
+
+#include "condicion.h"
+
+namespace lognotify
+{
+
+/**
+* Cada instancia de Regla describe una regla de un Filtro subido por un cliente. Una Regla está compuesta por
+* un conjunto de condiciones lógicas y se cumple cuando TODAS ellas se cumplen. Es decir, la evaluación de la
+* Regla es equivalente al AND (Y) lógico de todas las condiciones que la componen
+*/
+class Regla
+{
+	public:
+	
+	/**
+	* Añade una nueva condición a la Regla
+	* @param condicion Condicion que pasa a formar parte de la regla
+	*/
+	inline void anadirCondicion (const Condicion& condicion) { condiciones_.push_back(condicion); }
+	
+	/**
+	* Devuelve las condiciones que componen la Regla
+	* @return Conjunto de condiciones que componen la regla
+	*/
+	inline const std::vector<Condicion>& obtener_condiciones (void) const { return condiciones_; }
+	
+	private:
+	
+	//Variables miembro
+	std::vector<Condicion> condiciones_;	///< Conjunto de condiciones que componen la regla
+};
+
+} //namespace lognotify
+
+#endif //_regla_h_
\ No newline at end of file
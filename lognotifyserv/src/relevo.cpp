@@ -0,0 +1,332 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "relevo.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int Relevo::DESCRIPTORES_POR_LOTE_;
+constexpr unsigned int Relevo::TAMANO_FRAGMENTO_;
+
+Relevo::Relevo (void): solicitado_(false), activos_(0), pausados_(0)
+{
+	descriptores_aviso_[0] = -1;
+	descriptores_aviso_[1] = -1;
+}
+
+Relevo::~Relevo (void)
+{
+	if (descriptores_aviso_[0] >= 0) close(descriptores_aviso_[0]);
+	if (descriptores_aviso_[1] >= 0) close(descriptores_aviso_[1]);
+}
+
+bool Relevo::inicializar (void)
+{
+	//El aviso es una tubería en la que se escribe un byte al solicitar la pausa y de la que se lee al
+	//reanudar: mientras tanto es legible para todos los hilos que la esperan
+	if (descriptores_aviso_[0] >= 0) return false;
+	return pipe2(descriptores_aviso_, O_CLOEXEC | O_NONBLOCK) == 0;
+}
+
+void Relevo::registrar (void)
+{
+	mutex_.lock();
+	++activos_;
+	mutex_.unlock();
+}
+
+void Relevo::retirar (void)
+{
+	mutex_.lock();
+	--activos_;
+	mutex_.unlock();
+	cambio_.notify_all();
+}
+
+void Relevo::esperarReanudacion (void)
+{
+	//Se anota que el hilo está detenido y se espera a que termine la pausa
+	unique_lock<mutex> bloqueo (mutex_);
+	if (!solicitado_) return;
+	++pausados_;
+	cambio_.notify_all();
+	cambio_.wait(bloqueo, [this] { return !solicitado_; });
+	--pausados_;
+}
+
+bool Relevo::pausar (const unsigned int segundos)
+{
+	//Se solicita la pausa y se avisa a todos los hilos registrados, esperando a que se detengan
+	unique_lock<mutex> bloqueo (mutex_);
+	if (solicitado_) return false;
+	solicitado_ = true;
+	char aviso = 0;
+	if (write(descriptores_aviso_[1], &aviso, 1) != 1) return false;
+	return cambio_.wait_for(bloqueo, chrono::seconds(segundos), [this] { return pausados_ == activos_; });
+}
+
+void Relevo::reanudar (void)
+{
+	//Se vacía la tubería de aviso y se deja continuar a los hilos detenidos
+	mutex_.lock();
+	char aviso;
+	while (read(descriptores_aviso_[0], &aviso, 1) == 1);
+	solicitado_ = false;
+	mutex_.unlock();
+	cambio_.notify_all();
+}
+
+bool Relevo::enviarEstado (const int descriptorSocket, const Estado& estado)
+{
+	//Se componen los datos del estado, salvo los descriptores, en un único bloque
+	string bloque;
+	anadirCampo(bloque, estado.instancia);
+	anadirCampo(bloque, to_string(estado.secuencia));
+	anadirCampo(bloque, to_string(estado.escucha.size()));
+	anadirCampo(bloque, to_string(estado.ficheros.size()));
+	for (unsigned int i = 0; i < estado.ficheros.size(); ++i)
+	{
+		anadirCampo(bloque, estado.ficheros[i].first);
+		anadirCampo(bloque, to_string(estado.ficheros[i].second));
+	}
+	anadirCampo(bloque, to_string(estado.origenes.size()));
+	for (unsigned int i = 0; i < estado.origenes.size(); ++i)
+	{
+		anadirCampo(bloque, estado.origenes[i].first);
+		anadirCampo(bloque, estado.origenes[i].second);
+	}
+	anadirCampo(bloque, to_string(estado.conservados.size()));
+	for (unsigned int i = 0; i < estado.conservados.size(); ++i)
+	{
+		anadirCampo(bloque, to_string(estado.conservados[i].first));
+		anadirCampo(bloque, estado.conservados[i].second);
+	}
+	anadirCampo(bloque, to_string(estado.clientes.size()));
+	for (unsigned int i = 0; i < estado.clientes.size(); ++i)
+	{
+		const ClienteRelevado& cliente = estado.clientes[i];
+		anadirCampo(bloque, cliente.reglas);
+		anadirCampo(bloque, to_string(cliente.secuenciado));
+		anadirCampo(bloque, to_string(cliente.formato));
+		anadirCampo(bloque, to_string(cliente.multidifusion));
+		anadirCampo(bloque, to_string(cliente.confirmando));
+		anadirCampo(bloque, to_string(cliente.secuencia_de_alta));
+		anadirCampo(bloque, to_string(cliente.cursor));
+		anadirCampo(bloque, cliente.orden_pendiente);
+		anadirCampo(bloque, to_string(cliente.latiendo));
+		anadirCampo(bloque, to_string(cliente.reflejados.size()));
+		for (unsigned int j = 0; j < cliente.reflejados.size(); ++j) anadirCampo(bloque, cliente.reflejados[j]);
+		anadirCampo(bloque, to_string(cliente.agregados.size()));
+		for (unsigned int j = 0; j < cliente.agregados.size(); ++j) anadirCampo(bloque, cliente.agregados[j]);
+		anadirCampo(bloque, to_string(cliente.resumido));
+		anadirCampo(bloque, to_string(cliente.origenes));
+	}
+	
+	//El socket conserva los límites de cada mensaje (SOCK_SEQPACKET). Se envía primero una cabecera con el
+	//número de descriptores y la longitud del bloque
+	vector<int> descriptores = estado.escucha;
+	for (unsigned int i = 0; i < estado.clientes.size(); ++i) descriptores.push_back(estado.clientes[i].descriptor);
+	string cabecera;
+	anadirCampo(cabecera, to_string(descriptores.size()));
+	anadirCampo(cabecera, to_string(bloque.length()));
+	if (send(descriptorSocket, cabecera.data(), cabecera.length(), MSG_NOSIGNAL) < 0) return false;
+	
+	//A continuación se envían los descriptores por lotes, cada uno adjunto a un mensaje de un byte
+	for (unsigned int i = 0; i < descriptores.size(); i = i + DESCRIPTORES_POR_LOTE_)
+	{
+		unsigned int numero = descriptores.size() - i;
+		if (numero > DESCRIPTORES_POR_LOTE_) numero = DESCRIPTORES_POR_LOTE_;
+		vector<char> control (CMSG_SPACE(numero * sizeof(int)));
+		char dato = 0;
+		struct iovec segmento;
+		segmento.iov_base = &dato;
+		segmento.iov_len = 1;
+		struct msghdr mensaje;
+		memset(&mensaje, 0, sizeof mensaje);
+		mensaje.msg_iov = &segmento;
+		mensaje.msg_iovlen = 1;
+		mensaje.msg_control = &control[0];
+		mensaje.msg_controllen = control.size();
+		struct cmsghdr *adjunto = CMSG_FIRSTHDR(&mensaje);
+		adjunto->cmsg_level = SOL_SOCKET;
+		adjunto->cmsg_type = SCM_RIGHTS;
+		adjunto->cmsg_len = CMSG_LEN(numero * sizeof(int));
+		memcpy(CMSG_DATA(adjunto), &descriptores[i], numero * sizeof(int));
+		if (sendmsg(descriptorSocket, &mensaje, MSG_NOSIGNAL) < 0) return false;
+	}
+	
+	//Y por último el bloque, en fragmentos que caben en un mensaje
+	for (size_t i = 0; i < bloque.length(); i = i + TAMANO_FRAGMENTO_)
+	{
+		size_t longitud = bloque.length() - i;
+		if (longitud > TAMANO_FRAGMENTO_) longitud = TAMANO_FRAGMENTO_;
+		if (send(descriptorSocket, &bloque[i], longitud, MSG_NOSIGNAL) < 0) return false;
+	}
+	return true;
+}
+
+bool Relevo::recibirEstado (const int descriptorSocket, Estado& estado)
+{
+	//Se recibe la cabecera con el número de descriptores y la longitud del bloque
+	vector<char> buffer (TAMANO_FRAGMENTO_);
+	ssize_t recibidos = recv(descriptorSocket, &buffer[0], buffer.size(), 0);
+	if (recibidos <= 0) return false;
+	string cabecera (&buffer[0], recibidos);
+	size_t posicion = 0;
+	unsigned long long numero_descriptores, longitud_bloque;
+	if (!leerNumero(cabecera, posicion, numero_descriptores) || !leerNumero(cabecera, posicion, longitud_bloque))
+		return false;
+	
+	//Se reciben los descriptores adjuntos a cada lote
+	vector<int> descriptores;
+	while (descriptores.size() < numero_descriptores)
+	{
+		vector<char> control (CMSG_SPACE(DESCRIPTORES_POR_LOTE_ * sizeof(int)));
+		char dato;
+		struct iovec segmento;
+		segmento.iov_base = &dato;
+		segmento.iov_len = 1;
+		struct msghdr mensaje;
+		memset(&mensaje, 0, sizeof mensaje);
+		mensaje.msg_iov = &segmento;
+		mensaje.msg_iovlen = 1;
+		mensaje.msg_control = &control[0];
+		mensaje.msg_controllen = control.size();
+		if (recvmsg(descriptorSocket, &mensaje, MSG_CMSG_CLOEXEC) <= 0) return false;
+		struct cmsghdr *adjunto = CMSG_FIRSTHDR(&mensaje);
+		if ((adjunto == nullptr) || (adjunto->cmsg_level != SOL_SOCKET) || (adjunto->cmsg_type != SCM_RIGHTS))
+			return false;
+		unsigned int numero = (adjunto->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		size_t anterior = descriptores.size();
+		descriptores.resize(anterior + numero);
+		memcpy(&descriptores[anterior], CMSG_DATA(adjunto), numero * sizeof(int));
+	}
+	
+	//Se recibe el bloque completo, fragmento a fragmento
+	string bloque;
+	while (bloque.length() < longitud_bloque)
+	{
+		recibidos = recv(descriptorSocket, &buffer[0], buffer.size(), 0);
+		if (recibidos <= 0) return false;
+		bloque.append(&buffer[0], recibidos);
+	}
+	
+	//Se interpretan los datos del bloque, asignando los descriptores en el mismo orden en que se enviaron
+	posicion = 0;
+	unsigned long long numero, valor;
+	string campo;
+	if (!leerCampo(bloque, posicion, estado.instancia) || !leerNumero(bloque, posicion, estado.secuencia)) return false;
+	if (!leerNumero(bloque, posicion, numero) || (numero > descriptores.size())) return false;
+	estado.escucha.assign(descriptores.begin(), descriptores.begin() + numero);
+	unsigned int siguiente_descriptor = numero;
+	if (!leerNumero(bloque, posicion, numero)) return false;
+	estado.ficheros.clear();
+	for (unsigned long long i = 0; i < numero; ++i)
+	{
+		if (!leerCampo(bloque, posicion, campo) || !leerNumero(bloque, posicion, valor)) return false;
+		estado.ficheros.push_back(make_pair(campo, (long long) valor));
+	}
+	if (!leerNumero(bloque, posicion, numero)) return false;
+	estado.origenes.clear();
+	for (unsigned long long i = 0; i < numero; ++i)
+	{
+		string origen;
+		if (!leerCampo(bloque, posicion, origen) || !leerCampo(bloque, posicion, campo)) return false;
+		estado.origenes.push_back(make_pair(origen, campo));
+	}
+	if (!leerNumero(bloque, posicion, numero)) return false;
+	estado.conservados.clear();
+	for (unsigned long long i = 0; i < numero; ++i)
+	{
+		if (!leerNumero(bloque, posicion, valor) || !leerCampo(bloque, posicion, campo)) return false;
+		estado.conservados.push_back(make_pair(valor, campo));
+	}
+	if (!leerNumero(bloque, posicion, numero) || (siguiente_descriptor + numero != descriptores.size())) return false;
+	estado.clientes.clear();
+	for (unsigned long long i = 0; i < numero; ++i)
+	{
+		ClienteRelevado cliente;
+		cliente.descriptor = descriptores[siguiente_descriptor++];
+		unsigned long long secuenciado, formato, multidifusion, confirmando, latiendo, reflejados;
+		if (!leerCampo(bloque, posicion, cliente.reglas) || !leerNumero(bloque, posicion, secuenciado) ||
+			!leerNumero(bloque, posicion, formato) || !leerNumero(bloque, posicion, multidifusion) ||
+			!leerNumero(bloque, posicion, confirmando) || !leerNumero(bloque, posicion, cliente.secuencia_de_alta) ||
+			!leerNumero(bloque, posicion, cliente.cursor) || !leerCampo(bloque, posicion, cliente.orden_pendiente) ||
+			!leerNumero(bloque, posicion, latiendo) || !leerNumero(bloque, posicion, reflejados)) return false;
+		for (unsigned long long j = 0; j < reflejados; ++j)
+		{
+			string ruta;
+			if (!leerCampo(bloque, posicion, ruta)) return false;
+			cliente.reflejados.push_back(ruta);
+		}
+		unsigned long long agregados;
+		if (!leerNumero(bloque, posicion, agregados)) return false;
+		for (unsigned long long j = 0; j < agregados; ++j)
+		{
+			string definicion;
+			if (!leerCampo(bloque, posicion, definicion)) return false;
+			cliente.agregados.push_back(definicion);
+		}
+		unsigned long long resumido, origenes;
+		if (!leerNumero(bloque, posicion, resumido) || !leerNumero(bloque, posicion, origenes)) return false;
+		cliente.secuenciado = secuenciado;
+		cliente.formato = formato;
+		cliente.multidifusion = multidifusion;
+		cliente.confirmando = confirmando;
+		cliente.latiendo = latiendo;
+		cliente.resumido = resumido;
+		cliente.origenes = origenes;
+		estado.clientes.push_back(move(cliente));
+	}
+	return true;
+}
+
+void Relevo::anadirCampo (std::string& bloque, const std::string& campo)
+{
+	bloque.append(to_string(campo.length()));
+	bloque.push_back(':');
+	bloque.append(campo);
+}
+
+bool Relevo::leerCampo (const std::string& bloque, size_t& posicion, std::string& campo)
+{
+	//Se lee la longitud hasta el separador, y a continuación tantos bytes como indica
+	size_t separador = bloque.find(':', posicion);
+	if ((separador == string::npos) || (separador == posicion) ||
+		(bloque.find_first_not_of("0123456789", posicion) != separador)) return false;
+	unsigned long long longitud = strtoull(&bloque[posicion], nullptr, 10);
+	if (longitud > bloque.length() - separador - 1) return false;
+	campo.assign(bloque, separador + 1, longitud);
+	posicion = separador + 1 + longitud;
+	return true;
+}
+
+bool Relevo::leerNumero (const std::string& bloque, size_t& posicion, unsigned long long& numero)
+{
+	string campo;
+	if (!leerCampo(bloque, posicion, campo) || campo.empty() ||
+		(campo.find_first_not_of("0123456789") != string::npos)) return false;
+	numero = strtoull(campo.c_str(), nullptr, 10);
+	return true;
+}
+
+} //namespace lognotify
\ No newline at end of file
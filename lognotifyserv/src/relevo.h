@@ -0,0 +1,186 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _relevo_h_
+#define _relevo_h_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+
+namespace lognotify
+{
+
+/**
+* Un Relevo coordina la sustitución en caliente del proceso servidor por una nueva ejecución (por ejemplo, de
+* un binario actualizado) sin perder clientes ni eventos. El proceso saliente detiene en un punto seguro todos
+* los hilos que reciben datos del exterior (ver pausar) y traspasa al entrante su estado, incluidos los
+* descriptores de los sockets de escucha y de los clientes, a través de un socket local (SCM_RIGHTS); el
+* entrante continúa con la misma instancia y numeración de eventos, de forma que los clientes ni siquiera
+* llegan a reconectar.
+* Los hilos que participan en el relevo se registran (ver registrar) e incluyen en sus esperas el descriptor
+* de aviso (ver obtener_aviso): cuando se vuelve legible, deben dejar su estado a salvo y esperar en
+* esperarReanudacion, que sólo retorna si el relevo se cancela.
+* La coordinación es thread safe; enviarEstado y recibirEstado no utilizan el estado del objeto.
+*/
+class Relevo
+{
+	public:
+	
+	/**
+	* Estado de un cliente traspasado, con su conexión y todo lo que ha negociado con el servidor
+	*/
+	struct ClienteRelevado
+	{
+		int descriptor;							///< Descriptor del socket de la conexión con el cliente
+		std::string reglas;						///< Reglas de filtrado subidas por el cliente
+		bool secuenciado;						///< Indica si recibe los eventos con su secuencia
+		unsigned int formato;					///< Formato de los eventos con secuencia
+		bool multidifusion;						///< Indica si recibe los eventos por multidifusión
+		bool origenes;							///< Indica si entiende el origen de los eventos reenviados
+		bool confirmando;						///< Indica si confirma los eventos procesados
+		unsigned long long secuencia_de_alta;	///< Último evento anterior a la conexión del cliente
+		unsigned long long cursor;				///< Último evento tratado para el cliente
+		std::string orden_pendiente;			///< Orden recibida sólo en parte, tal como se recibió
+		bool latiendo;							///< Indica si el cliente envía latidos
+		std::vector<std::string> reflejados;	///< Ficheros que el cliente refleja en crudo
+		std::vector<std::string> agregados;		///< Definiciones de los agregados a los que está suscrito
+		bool resumido;							///< Indica si recibe los resúmenes de plantillas
+	};
+	
+	/**
+	* Estado completo que el proceso saliente traspasa al entrante
+	*/
+	struct Estado
+	{
+		std::string instancia;					///< Identificador de la ejecución del servidor
+		unsigned long long secuencia;			///< Número de secuencia del último evento difundido
+		std::vector<int> escucha;				///< Descriptores de los sockets de escucha
+		std::vector<std::pair<std::string, long long>> ficheros;	///< Posición leída de cada fichero
+		std::vector<std::pair<std::string, std::string>> origenes;	///< Origen y posición difundida de cada
+																		///< servidor de origen
+		std::vector<std::pair<unsigned long long, std::string>> conservados;	///< Eventos para reenvío
+		std::vector<ClienteRelevado> clientes;	///< Clientes conectados
+	};
+	
+	/**
+	* Constructor de la clase Relevo
+	*/
+	Relevo (void);
+	
+	/**
+	* Destructor de la clase Relevo
+	*/
+	~Relevo (void);
+	
+	Relevo (const Relevo&) = delete;
+	Relevo& operator= (const Relevo&) = delete;
+	
+	/**
+	* Crea el descriptor de aviso a los hilos registrados
+	* @return true si el Relevo ha sido inicializado, false en caso contrario
+	*/
+	bool inicializar (void);
+	
+	/**
+	* Devuelve el descriptor que se vuelve legible cuando se solicita una pausa para el relevo, y deja de
+	* serlo al reanudar. Los hilos registrados deben incluirlo en sus esperas, sin leer de él
+	* @return Descriptor de aviso, o un valor negativo si el Relevo no se ha inicializado
+	*/
+	inline int obtener_aviso (void) { return descriptores_aviso_[0]; }
+	
+	/**
+	* Registra un hilo que debe detenerse antes del relevo. Puede llamarse desde otro hilo antes de lanzarlo,
+	* de forma que no se le pueda esperar antes de que exista
+	*/
+	void registrar (void);
+	
+	/**
+	* Retira el registro de un hilo que termina
+	*/
+	void retirar (void);
+	
+	/**
+	* Detiene el hilo que llama, que ya debe haber dejado su estado a salvo, mientras dure la pausa solicitada.
+	* Si no hay ninguna solicitada, retorna inmediatamente
+	*/
+	void esperarReanudacion (void);
+	
+	/**
+	* Solicita a todos los hilos registrados que se detengan y espera a que lo hagan
+	* @param segundos Tiempo máximo de espera
+	* @return true si todos los hilos registrados se han detenido, false si alguno no lo ha hecho a tiempo (la
+	* pausa sigue solicitada; debe llamarse a reanudar)
+	*/
+	bool pausar (const unsigned int segundos);
+	
+	/**
+	* Termina la pausa solicitada, dejando continuar a los hilos detenidos
+	*/
+	void reanudar (void);
+	
+	/**
+	* Envía el Estado a través de un socket local: primero los descriptores (mediante SCM_RIGHTS, en lotes) y
+	* después el resto de datos, con cada campo precedido de su longitud
+	* @param descriptorSocket Descriptor del socket local conectado con el proceso entrante
+	* @param estado Estado que desea traspasarse
+	* @return true si el Estado se ha enviado completo, false en caso contrario
+	*/
+	static bool enviarEstado (const int descriptorSocket, const Estado& estado);
+	
+	/**
+	* Recibe el Estado enviado por enviarEstado, con los descriptores ya válidos en este proceso
+	* @param descriptorSocket Descriptor del socket local conectado con el proceso saliente
+	* @param estado Estado en que se devuelve el recibido
+	* @return true si se ha recibido un Estado completo y válido, false en caso contrario
+	*/
+	static bool recibirEstado (const int descriptorSocket, Estado& estado);
+	
+	private:
+	
+	/**
+	* Añade un campo a un bloque de datos, precedido de su longitud: "longitud":"campo"
+	* @param bloque Bloque de datos al que se añade el campo
+	* @param campo Contenido del campo
+	*/
+	static void anadirCampo (std::string& bloque, const std::string& campo);
+	
+	/**
+	* Lee el siguiente campo de un bloque de datos compuesto con anadirCampo
+	* @param bloque Bloque de datos
+	* @param posicion Posición del campo en el bloque, que avanza hasta el siguiente
+	* @param campo Campo en que se devuelve el contenido leído
+	* @return true si se ha leído un campo completo, false si el bloque no es válido
+	*/
+	static bool leerCampo (const std::string& bloque, size_t& posicion, std::string& campo);
+	
+	/**
+	* Lee el siguiente campo de un bloque de datos como número sin signo
+	* @param bloque Bloque de datos
+	* @param posicion Posición del campo en el bloque, que avanza hasta el siguiente
+	* @param numero Número en que se devuelve el valor leído
+	* @return true si se ha leído un número, false si el bloque no es válido
+	*/
+	static bool leerNumero (const std::string& bloque, size_t& posicion, unsigned long long& numero);
+	
+	//Constantes
+	constexpr static unsigned int DESCRIPTORES_POR_LOTE_ = 200;	///< Descriptores enviados en cada mensaje
+	constexpr static unsigned int TAMANO_FRAGMENTO_ = 65536;	///< Máximo de bytes de datos en cada mensaje
+	
+	//Variables miembro
+	int descriptores_aviso_ [2];			///< Tubería de aviso: extremo de lectura y de escritura
+	bool solicitado_;						///< Indica si hay una pausa solicitada
+	unsigned int activos_;					///< Hilos registrados
+	unsigned int pausados_;					///< Hilos registrados detenidos
+	std::mutex mutex_;						///< Mutex que protege el estado de la pausa
+	std::condition_variable cambio_;		///< Aviso de cambios en el estado de la pausa
+};
+
+} //namespace lognotify
+
+#endif //_relevo_h_
\ No newline at end of file
@@ -8,28 +8,48 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <poll.h>
+#include <cerrno>
 #include <cstring>
+#include <string>
 #include <memory>
+#include <vector>
 #include <thread>
+#include <chrono>
 
 #include "tabla_de_clientes.h"
+#include "receptor_de_ordenes.h"
+#include "relevo.h"
 
 using namespace std;
 namespace lognotify
 {
 	
-ServidorDeConexion::ServidorDeConexion (void): descriptor_socket_escucha_(-1) {}
+constexpr mode_t ServidorDeConexion::PERMISOS_SOCKET_LOCAL_;
+constexpr unsigned int ServidorDeConexion::MILISEGUNDOS_REINTENTO_;
 
-bool ServidorDeConexion::inicializar (const unsigned short puerto, std::shared_ptr<TablaDeClientes> destino)
+ServidorDeConexion::ServidorDeConexion (void): segundos_latido_(0), segundos_inactividad_(0) {}
+
+ServidorDeConexion::~ServidorDeConexion (void)
 {
-	//Si ya está inicializado, primero cierra el socket previo
-	if (estaInicializado())
-	{
-		close(descriptor_socket_escucha_);
-		descriptor_socket_escucha_ = -1;
-	}
+	eliminarSocketLocal();
+}
+
+bool ServidorDeConexion::inicializar (	const unsigned short puerto,
+										std::shared_ptr<TablaDeClientes> destino,
+										const unsigned int aceptores,
+										const unsigned int segundosLatido,
+										const unsigned int segundosInactividad	)
+{
+	//Si ya está inicializado, primero cierra los sockets previos
+	for (unsigned int i = 0; i < descriptores_escucha_.size(); ++i) close(descriptores_escucha_[i]);
+	descriptores_escucha_.clear();
 	
 	//Se rellenan los datos de conexión necesarios para crear un socket
 	struct addrinfo indicaciones;
@@ -45,79 +65,267 @@ bool ServidorDeConexion::inicializar (const unsigned short puerto, std::shared_p
 	if (getaddrinfo(nullptr, &cad_puerto[0], &indicaciones, &info_servidor) != 0) return false;
 		
 	//Se recorren los resultados obtenidos creando y asociando el socket a la primera dirección posible
-	for (struct addrinfo *p = info_servidor; p != nullptr; p = p->ai_next)
+	for (struct addrinfo *p = info_servidor; (p != nullptr) && descriptores_escucha_.empty(); p = p->ai_next)
 	{
-		descriptor_socket_escucha_ = socket (p->ai_family, p->ai_socktype, p->ai_protocol);
-		if (descriptor_socket_escucha_ >= 0)
-		{	
-			//Si se ha encontrado una dirección válida, se establecen las opciones del socket
-			int si = 1;
-			if (setsockopt(descriptor_socket_escucha_, SOL_SOCKET, SO_REUSEADDR, &si, sizeof(int)) < 0)
-			{				
-				//Si esta operación falla, se devuelve error
-				freeaddrinfo(info_servidor);
-				close(descriptor_socket_escucha_);
-				descriptor_socket_escucha_ = -1;
-				return false;
-			}
-			
-			//Se asocia el socket a la dirección encontrada
-			if (bind(descriptor_socket_escucha_, p->ai_addr, p->ai_addrlen) >= 0)
-			{
-				//En caso de que todo haya ido correctamente, se guarda la tabla de clientes y se termina
-				freeaddrinfo(info_servidor);
-				clientes_ = destino;
-				return true;
-			}
-			
-			//Si ha fallado la asociación del socket a la dirección, se cierra el socket y se sigue buscando
-			close(descriptor_socket_escucha_);
+		int descriptor = crearSocketDeEscucha(p, aceptores > 1);
+		if (descriptor < 0) continue;
+		descriptores_escucha_.push_back(descriptor);
+		
+		//Se asocian a la misma dirección el resto de sockets de escucha. Si alguno no puede asociarse (el
+		//sistema no soporta SO_REUSEPORT), se continúa con los ya creados
+		while (descriptores_escucha_.size() < aceptores)
+		{
+			descriptor = crearSocketDeEscucha(p, true);
+			if (descriptor < 0) break;
+			descriptores_escucha_.push_back(descriptor);
 		}
 	}
-	
-	//Si se ha llegado a este punto, no se ha conseguido conectar a ninguna dirección válida
 	freeaddrinfo(info_servidor);
-	return false;
+	
+	//Si no se ha conseguido asociar ningún socket a una dirección válida, se termina con error
+	if (descriptores_escucha_.empty()) return false;
+	
+	//En caso de que todo haya ido correctamente, se guarda la tabla de clientes y se termina
+	clientes_ = destino;
+	segundos_latido_ = segundosLatido;
+	segundos_inactividad_ = segundosInactividad;
+	return true;
+}
+
+bool ServidorDeConexion::anadirSocketLocal (const std::string& ruta)
+{
+	//El servidor debe haber sido inicializado y la ruta debe caber en una dirección local
+	struct sockaddr_un local;
+	if (!estaInicializado() || ruta.empty() || (ruta.length() >= sizeof local.sun_path)) return false;
+	
+	//Se compone la dirección local
+	memset(&local, 0, sizeof local);
+	local.sun_family = AF_UNIX;
+	memcpy(local.sun_path, ruta.c_str(), ruta.length());
+	
+	//Si ya existe un fichero en la ruta, sólo se sustituye si es un socket en el que nadie acepta conexiones (el
+	//de una ejecución anterior que no pudo eliminarlo). Nunca se elimina otro tipo de fichero ni el socket de un
+	//servidor en funcionamiento
+	struct stat estado;
+	if (lstat(local.sun_path, &estado) == 0)
+	{
+		if (!S_ISSOCK(estado.st_mode)) return false;
+		int sonda = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (sonda < 0) return false;
+		bool en_uso = (connect(sonda, (struct sockaddr *) &local, sizeof local) == 0) || (errno != ECONNREFUSED);
+		close(sonda);
+		if (en_uso || (unlink(local.sun_path) < 0)) return false;
+	}
+	else if (errno != ENOENT) return false;
+	
+	struct addrinfo direccion;
+	memset(&direccion, 0, sizeof direccion);
+	direccion.ai_family = AF_UNIX;
+	direccion.ai_socktype = SOCK_STREAM;
+	direccion.ai_addr = (struct sockaddr *) &local;
+	direccion.ai_addrlen = sizeof local;
+	
+	//Se crea el socket de escucha, que se atenderá junto con los demás, con permisos explícitos en lugar de los
+	//que dejaría la máscara del proceso
+	int descriptor = crearSocketDeEscucha(&direccion, false);
+	if (descriptor < 0) return false;
+	if (chmod(local.sun_path, PERMISOS_SOCKET_LOCAL_) < 0)
+	{
+		close(descriptor);
+		unlink(local.sun_path);
+		return false;
+	}
+	descriptores_escucha_.push_back(descriptor);
+	ruta_local_ = ruta;
+	return true;
+}
+
+void ServidorDeConexion::eliminarSocketLocal (void)
+{
+	if (!ruta_local_.empty()) unlink(ruta_local_.c_str());
+	ruta_local_.clear();
+}
+
+bool ServidorDeConexion::adoptar (	const std::vector<int>& descriptoresEscucha,
+									std::shared_ptr<TablaDeClientes> destino,
+									const unsigned int segundosLatido,
+									const unsigned int segundosInactividad	)
+{
+	//Si ya está inicializado, primero cierra los sockets previos
+	for (unsigned int i = 0; i < descriptores_escucha_.size(); ++i) close(descriptores_escucha_[i]);
+	
+	//Se toman los sockets de escucha tal como están, con su dirección ya asociada
+	descriptores_escucha_ = descriptoresEscucha;
+	if (descriptores_escucha_.empty()) return false;
+	clientes_ = destino;
+	segundos_latido_ = segundosLatido;
+	segundos_inactividad_ = segundosInactividad;
+	return true;
+}
+
+void ServidorDeConexion::anadirClientesRelevados (	const std::vector<Relevo::ClienteRelevado>& clientes,
+													const std::vector<TablaDeClientes::IdentificadorDeCliente>& identificadores	)
+{
+	for (unsigned int i = 0; (i < clientes.size()) && (i < identificadores.size()); ++i)
+		relevados_.push_back(ReceptorDeOrdenes(clientes[i].descriptor, identificadores[i], clientes_,
+			segundos_inactividad_, relevo_, clientes[i].orden_pendiente, clientes[i].latiendo));
 }
 
 bool ServidorDeConexion::recibirClientes (void)
 {
-	//Se chequea si el servidor ha sido ya correctamente inicializado y dispone de un socket operativo
+	//Se chequea si el servidor ha sido ya correctamente inicializado y dispone de sockets operativos
 	if (!estaInicializado()) return false;
 	
-	//El servidor comienza a escuchar en el socket
-	if (listen(descriptor_socket_escucha_, MAX_PENDIENTES_) < 0) return false;
+	//El servidor comienza a escuchar en los sockets
+	for (unsigned int i = 0; i < descriptores_escucha_.size(); ++i)
+		if (listen(descriptores_escucha_[i], MAX_PENDIENTES_) < 0) return false;
+	
+	//Se lanza un hilo por cada cliente traspasado de otra ejecución, que continúa recibiendo sus órdenes
+	for (unsigned int i = 0; i < relevados_.size(); ++i)
+	{
+		if (relevo_) relevo_->registrar();
+		thread hilo_ordenes ([](ReceptorDeOrdenes receptor) { receptor.recibir(); }, relevados_[i]);
+		hilo_ordenes.detach();
+	}
+	relevados_.clear();
+	
+	//Se crea un nuevo hilo por cada socket para obtener nuevos clientes
+	for (unsigned int i = 0; i < descriptores_escucha_.size(); ++i)
+	{
+		if (relevo_) relevo_->registrar();
+		thread hilo_servidor (aceptarClientes, descriptores_escucha_[i], weak_ptr<TablaDeClientes> (clientes_),
+			segundos_latido_, segundos_inactividad_, relevo_);
+		hilo_servidor.detach();
+	}
+	
+	return true;
+}
+
+int ServidorDeConexion::crearSocketDeEscucha (struct addrinfo *direccion, const bool reutilizarPuerto)
+{
+	//Se crea el socket, no bloqueante para poder aceptar en lote las conexiones pendientes
+	int descriptor = socket(direccion->ai_family, direccion->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		direccion->ai_protocol);
+	if (descriptor < 0) return -1;
+	
+	//Se establecen las opciones del socket y se asocia a la dirección. Si alguna operación falla, se
+	//devuelve error
+	int si = 1;
+	if ((setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &si, sizeof(int)) < 0) ||
+		(reutilizarPuerto && (setsockopt(descriptor, SOL_SOCKET, SO_REUSEPORT, &si, sizeof(int)) < 0)) ||
+		(bind(descriptor, direccion->ai_addr, direccion->ai_addrlen) < 0))
+	{
+		close(descriptor);
+		return -1;
+	}
+	return descriptor;
+}
+
+void ServidorDeConexion::configurarConexion (	const int descriptorSocket,
+												const unsigned int segundosLatido,
+												const unsigned int segundosInactividad	)
+{
+	//Si la conexión permanece inactiva, se envían sondas keepalive cada intervalo de latido, dándola por perdida
+	//cuando dejan de responderse durante el tiempo de inactividad. Las opciones fallan en un socket local
+	if (segundosLatido > 0)
+	{
+		int si = 1;
+		int intervalo = segundosLatido;
+		int sondas = (segundosInactividad > segundosLatido) ? segundosInactividad / segundosLatido : 1;
+		setsockopt(descriptorSocket, SOL_SOCKET, SO_KEEPALIVE, &si, sizeof si);
+		setsockopt(descriptorSocket, IPPROTO_TCP, TCP_KEEPIDLE, &intervalo, sizeof intervalo);
+		setsockopt(descriptorSocket, IPPROTO_TCP, TCP_KEEPINTVL, &intervalo, sizeof intervalo);
+		setsockopt(descriptorSocket, IPPROTO_TCP, TCP_KEEPCNT, &sondas, sizeof sondas);
+	}
+	
+	//Los datos enviados que el cliente no confirma en el tiempo de inactividad también dan la conexión por
+	//perdida, en lugar de reintentarse durante muchos minutos
+	if (segundosInactividad > 0)
+	{
+		unsigned int milisegundos = segundosInactividad * 1000;
+		setsockopt(descriptorSocket, IPPROTO_TCP, TCP_USER_TIMEOUT, &milisegundos, sizeof milisegundos);
+	}
+}
+
+void ServidorDeConexion::aceptarClientes (	const int descriptorSocketEscucha,
+											std::weak_ptr<TablaDeClientes> clientes,
+											const unsigned int segundosLatido,
+											const unsigned int segundosInactividad,
+										std::shared_ptr<Relevo> relevo	)
+{
+	//Se crea un bucle que espera nuevas conexiones y las añade a los clientes ya existentes
+	vector<int> lote;
+	bool terminar = false;
+	while (!terminar)
+	{
+		//Se espera a que haya conexiones pendientes, o al aviso del relevo si lo hay (un descriptor negativo se
+		//ignora). Durante un relevo no se aceptan conexiones: esperan en el socket de escucha, que se traspasa
+		struct pollfd esperas [2];
+		esperas[0].fd = descriptorSocketEscucha;
+		esperas[0].events = POLLIN;
+		esperas[1].fd = relevo ? relevo->obtener_aviso() : -1;
+		esperas[1].events = POLLIN;
+		esperas[1].revents = 0;
+		if (poll(esperas, 2, -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (esperas[1].revents != 0)
+		{
+			relevo->esperarReanudacion();
+			continue;
+		}
 		
-	//Se crea un nuevo hilo para obtener nuevos clientes
-	thread hilo_servidor ([]
-		(const int descriptor_socket_escucha, weak_ptr<TablaDeClientes> clientes)
+		//Se aceptan todas las conexiones pendientes, hasta un máximo por lote. Los sockets de los clientes se
+		//hacen no bloqueantes al crear cada Cliente: sus envíos los continúa el trabajador de su partición y sus
+		//órdenes las espera con poll el hilo de su ReceptorDeOrdenes
+		while (lote.size() < MAX_LOTE_)
 		{
-			//En el hilo, se crea un bucle que obtiene nuevos clientes y los añade a los ya existentes
-			shared_ptr<TablaDeClientes> sp_clientes;
-			int socket_nuevo_cliente;
-			struct sockaddr_storage direccion_nuevo_cliente;
-			socklen_t tamano_direccion = sizeof(struct sockaddr_storage);
-			bool terminar = false;
-			while (!terminar)
+			int socket_nuevo_cliente = accept4(descriptorSocketEscucha, nullptr, nullptr, SOCK_CLOEXEC);
+			if (socket_nuevo_cliente >= 0)
+			{
+				configurarConexion(socket_nuevo_cliente, segundosLatido, segundosInactividad);
+				lote.push_back(socket_nuevo_cliente);
+			}
+			else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) break;
+			else if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS) || (errno == ENOMEM))
+			{
+				//Sin descriptores o memoria libres la conexión sigue pendiente y poll volvería a avisar de
+				//inmediato: se registra lo ya aceptado y se reintenta tras una pausa, cuando se hayan liberado
+				if (lote.empty()) this_thread::sleep_for(chrono::milliseconds(MILISEGUNDOS_REINTENTO_));
+				break;
+			}
+			else if ((errno != EINTR) && (errno != ECONNABORTED))
 			{
-				socket_nuevo_cliente = accept (	descriptor_socket_escucha,
-												(struct sockaddr *)& direccion_nuevo_cliente,
-												&tamano_direccion	);
-				if (socket_nuevo_cliente >= 0)
-				{
-					sp_clientes = clientes.lock();
-					if (!sp_clientes) terminar = true;
-					else sp_clientes->anadirCliente(socket_nuevo_cliente);
-					sp_clientes.reset();
-				}
-				else terminar = true;
+				terminar = true;
+				break;
 			}
-			
-		}, descriptor_socket_escucha_, clientes_);
+		}
+		if (lote.empty()) continue;
 		
-	//Se desvincula del hilo servidor y termina con éxito
-	hilo_servidor.detach();
-	return true;
+		//Si la tabla de clientes ya no existe, se cierran las conexiones aceptadas y se termina
+		shared_ptr<TablaDeClientes> sp_clientes = clientes.lock();
+		if (!sp_clientes)
+		{
+			for (unsigned int i = 0; i < lote.size(); ++i) close(lote[i]);
+			break;
+		}
+		
+		//Una vez registrados los clientes de una vez, se lanza para cada uno un hilo que atiende las órdenes
+		//que envíe
+		vector<TablaDeClientes::IdentificadorDeCliente> identificadores = sp_clientes->anadirClientes(lote);
+		sp_clientes.reset();
+		for (unsigned int i = 0; i < lote.size(); ++i)
+		{
+			if (relevo) relevo->registrar();
+			thread hilo_ordenes ([](ReceptorDeOrdenes receptor) { receptor.recibir(); },
+				ReceptorDeOrdenes(lote[i], identificadores[i], clientes, segundosInactividad, relevo));
+			hilo_ordenes.detach();
+		}
+		lote.clear();
+	}
+	if (relevo) relevo->retirar();
 }
-	
+
 } //namespace lognotify
\ No newline at end of file
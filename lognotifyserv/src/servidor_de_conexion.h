@@ -8,8 +8,15 @@
 #define _servidor_de_conexion_h_
 
 #include <memory>
+#include <vector>
+#include <string>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
 
 #include "tabla_de_clientes.h"
+#include "receptor_de_ordenes.h"
+#include "relevo.h"
 
 namespace lognotify
 {
@@ -19,6 +26,19 @@ namespace lognotify
 * llegando estas. El ServidorDeConexion trabaja en un hilo aparte de forma que la aplicación no quede bloqueada
 * esperando nuevas conexiones entrantes. Un objeto ServidorDeConexion debe de ser inicializado después de su
 * construcción (ServidorDeConexion::inicializar()) antes de comenzar a recibir conexiones.
+* Para repartir la llegada simultánea de muchos clientes (por ejemplo, al reconectar todos tras un corte de
+* red), el ServidorDeConexion puede escuchar con varios sockets asociados al mismo puerto (SO_REUSEPORT), cada
+* uno atendido por su propio hilo; el núcleo reparte las conexiones entrantes entre ellos. Cada hilo acepta
+* todas las conexiones pendientes de una vez y las añade a la TablaDeClientes en un único lote.
+* Además del puerto TCP, el ServidorDeConexion puede escuchar en un socket local (AF_UNIX) para los clientes
+* que se ejecutan en la misma máquina, que reciben los eventos exactamente igual que los remotos.
+* Para detectar cuanto antes los clientes que desaparecen sin cerrar la conexión (por ejemplo, un portátil que
+* se apaga), las conexiones TCP aceptadas envían sondas keepalive mientras están inactivas y se dan por
+* perdidas si los datos enviados no se confirman en el tiempo de inactividad (TCP_USER_TIMEOUT). Cuando el
+* núcleo da una conexión por perdida, o el cliente deja de enviar latidos, su ReceptorDeOrdenes lo elimina.
+* Para sustituir en caliente el proceso servidor (ver Relevo), el ServidorDeConexion puede adoptar los sockets
+* de escucha y las conexiones de los clientes de otra ejecución en lugar de crearlos, y detiene la aceptación
+* de conexiones y la recepción de órdenes mientras se traspasan.
 */
 class ServidorDeConexion
 {
@@ -29,14 +49,94 @@ class ServidorDeConexion
 	*/
 	ServidorDeConexion (void);
 	
+	/**
+	* Destructor de la clase ServidorDeConexion. Elimina el socket local, si lo hay, de su ruta
+	*/
+	~ServidorDeConexion (void);
+	
 	/**
 	* Inicializa el ServidorDeConexion con los valores especificados, quedando preparado para empezar a
 	* recibir nuevos clientes. NOTA: Es necesario ejecutar esta función antes de empezar a recibir clientes.
 	* @param puerto Puerto TCP en el que escuchará la entrada de solicitudes de conexión
 	* @param destino Puntero a la TablaDeClientes donde se almacenarán los clientes que se conecten mediante
 	* este servicio
+	* @param aceptores Número de sockets de escucha (y de hilos) que aceptan conexiones. Si el sistema no
+	* permite asociar varios sockets al mismo puerto, se utiliza uno solo
+	* @param segundosLatido Intervalo entre sondas keepalive de las conexiones inactivas, o 0 para no enviarlas
+	* @param segundosInactividad Tiempo máximo sin noticias de un cliente antes de darlo por perdido, o 0 para
+	* esperar indefinidamente
+	* @return true si el proceso de inicialización es correcto, false en caso contrario
+	*/
+	bool inicializar (	const unsigned short puerto,
+						std::shared_ptr<TablaDeClientes> destino,
+						const unsigned int aceptores = 1,
+						const unsigned int segundosLatido = 0,
+						const unsigned int segundosInactividad = 0	);
+	
+	/**
+	* Añade un socket local (AF_UNIX) en el que también se escucharán conexiones entrantes, atendido por su
+	* propio hilo, con permisos de lectura y escritura sólo para el propietario y su grupo. Debe llamarse después
+	* de inicializar y antes de recibirClientes. Si en la ruta indicada queda el socket de una ejecución anterior
+	* que ya no acepta conexiones, se sustituye; si existe cualquier otro fichero, o un socket en uso, se termina
+	* con error
+	* @param ruta Ruta del socket local en el sistema de ficheros
+	* @return true si el socket local ha sido creado correctamente, false en caso contrario
+	*/
+	bool anadirSocketLocal (const std::string& ruta);
+	
+	/**
+	* Inicializa el ServidorDeConexion con sockets de escucha ya creados y asociados a su dirección, por
+	* ejemplo los traspasados en un Relevo, en lugar de inicializar y anadirSocketLocal
+	* @param descriptoresEscucha Descriptores de los sockets de escucha, no bloqueantes, de los que el
+	* ServidorDeConexion pasa a ser responsable
+	* @param destino Puntero a la TablaDeClientes donde se almacenarán los clientes que se conecten mediante
+	* este servicio
+	* @param segundosLatido Intervalo entre sondas keepalive de las conexiones inactivas, o 0 para no enviarlas
+	* @param segundosInactividad Tiempo máximo sin noticias de un cliente antes de darlo por perdido, o 0 para
+	* esperar indefinidamente
+	* @return true si el proceso de inicialización es correcto, false en caso contrario
+	*/
+	bool adoptar (	const std::vector<int>& descriptoresEscucha,
+					std::shared_ptr<TablaDeClientes> destino,
+					const unsigned int segundosLatido = 0,
+					const unsigned int segundosInactividad = 0	);
+	
+	/**
+	* Asume la ruta del socket local entre los adoptados, que a partir de entonces se elimina al terminar. Debe
+	* llamarse sólo una vez confirmado el relevo, pues hasta entonces el socket sigue perteneciendo al proceso
+	* anterior
+	* @param ruta Ruta del socket local
 	*/
-	bool inicializar (const unsigned short puerto, std::shared_ptr<TablaDeClientes> destino);
+	inline void asumirSocketLocal (const std::string& ruta) { ruta_local_ = ruta; }
+	
+	/**
+	* Elimina el socket local, si lo hay, de su ruta, de forma que no quede en el sistema de ficheros al terminar
+	* el proceso. Los clientes ya conectados a él no se ven afectados
+	*/
+	void eliminarSocketLocal (void);
+	
+	/**
+	* Añade los clientes traspasados en un Relevo, ya restaurados en la TablaDeClientes (ver
+	* TablaDeClientes::restaurarEstado), cuyas órdenes empezarán a recibirse en recibirClientes a partir de la
+	* que cada uno dejó pendiente. Debe llamarse después de inicializar o adoptar y antes de recibirClientes
+	* @param clientes Clientes traspasados
+	* @param identificadores Identificadores asignados a los clientes, en el mismo orden
+	*/
+	void anadirClientesRelevados (	const std::vector<Relevo::ClienteRelevado>& clientes,
+									const std::vector<TablaDeClientes::IdentificadorDeCliente>& identificadores	);
+	
+	/**
+	* Establece el Relevo que puede detener la aceptación de conexiones y la recepción de órdenes. Debe
+	* llamarse antes de recibirClientes
+	* @param relevo Relevo en el que se registran los hilos del ServidorDeConexion
+	*/
+	inline void establecerRelevo (std::shared_ptr<Relevo> relevo) { relevo_ = relevo; }
+	
+	/**
+	* Devuelve los descriptores de los sockets de escucha, por ejemplo para traspasarlos en un Relevo
+	* @return Descriptores de los sockets de escucha
+	*/
+	inline std::vector<int> obtener_descriptores_escucha (void) { return descriptores_escucha_; }
 	
 	/**
 	* Indica si la instancia del ServidorDeConexion ya ha sido correctamente inicializada
@@ -44,26 +144,74 @@ class ServidorDeConexion
 	*/
 	inline bool estaInicializado (void)
 	{
-		if (descriptor_socket_escucha_ < 0) return false;
+		if (descriptores_escucha_.empty()) return false;
 		return true;
 	}
 	
 	/**
-	* Crea un nuevo hilo de ejecución en el que el servidor escucha nuevas conexiones entrantes para aceptar
-	* nuevos clientes y añadirlos a la TablaDeClientes. El ServidorDeConexion debe haber sido previamente
-	* inicializado correctamente; en caso contrario, recibirClientes retornará un error
+	* Crea un nuevo hilo de ejecución por cada socket de escucha en el que el servidor escucha nuevas conexiones
+	* entrantes para aceptar nuevos clientes y añadirlos a la TablaDeClientes. El ServidorDeConexion debe haber sido
+	* previamente inicializado correctamente; en caso contrario, recibirClientes retornará un error. Si se agotan los
+	* descriptores de fichero, la aceptación se reintenta tras una breve pausa en lugar de terminar el hilo
 	* @return true si el proceso de escucha ha sido lanzado correctamente, false en caso contrario
 	*/
 	bool recibirClientes (void);
 	
 	private:
 	
+	/**
+	* Crea un socket de escucha no bloqueante y lo asocia a una dirección
+	* @param direccion Dirección a la que se asocia el socket
+	* @param reutilizarPuerto Indica si se permite asociar otros sockets a la misma dirección (SO_REUSEPORT)
+	* @return Descriptor del socket creado, o un valor negativo si no ha sido posible crearlo o asociarlo
+	*/
+	static int crearSocketDeEscucha (struct addrinfo *direccion, const bool reutilizarPuerto);
+	
+	/**
+	* Configura la conexión TCP aceptada de un cliente para detectar su pérdida: sondas keepalive mientras está
+	* inactiva y un límite al tiempo sin confirmar los datos enviados (TCP_USER_TIMEOUT). Las conexiones locales
+	* no lo necesitan, y las opciones que no admiten se ignoran
+	* @param descriptorSocket Descriptor del socket de la conexión
+	* @param segundosLatido Intervalo entre sondas keepalive, o 0 para no enviarlas
+	* @param segundosInactividad Tiempo máximo sin respuesta del cliente, o 0 para no limitarlo
+	*/
+	static void configurarConexion (	const int descriptorSocket,
+										const unsigned int segundosLatido,
+										const unsigned int segundosInactividad	);
+	
+	/**
+	* Acepta conexiones entrantes en un socket de escucha y añade los nuevos clientes a una TablaDeClientes,
+	* lanzando para cada uno un hilo que atiende sus órdenes. Es una función bloqueante, pensada para ser
+	* ejecutada en un hilo propio por cada socket de escucha, que termina si el socket falla o la TablaDeClientes
+	* deja de existir
+	* @param descriptorSocketEscucha Descriptor del socket de escucha, no bloqueante
+	* @param clientes TablaDeClientes en la que se añaden los nuevos clientes
+	* @param segundosLatido Intervalo entre sondas keepalive de las conexiones inactivas, o 0 para no enviarlas
+	* @param segundosInactividad Tiempo máximo sin noticias de un cliente antes de darlo por perdido, o 0 para
+	* esperar indefinidamente
+	* @param relevo Relevo en el que el hilo ya está registrado y en el que registra los que lanza, o nullptr si
+	* no hay
+	*/
+	static void aceptarClientes (	const int descriptorSocketEscucha,
+									std::weak_ptr<TablaDeClientes> clientes,
+									const unsigned int segundosLatido,
+									const unsigned int segundosInactividad,
+									std::shared_ptr<Relevo> relevo	);
+	
 	//Constantes
-	constexpr static int MAX_PENDIENTES_ = 20;	///< Máximo de conexiones pendientes a la escucha
+	constexpr static int MAX_PENDIENTES_ = SOMAXCONN;	///< Máximo de conexiones pendientes a la escucha
+	constexpr static unsigned int MAX_LOTE_ = 256;		///< Máximo de conexiones aceptadas en un mismo lote
+	constexpr static mode_t PERMISOS_SOCKET_LOCAL_ = 0660;	///< Permisos del socket local
+	constexpr static unsigned int MILISEGUNDOS_REINTENTO_ = 100;	///< Pausa al agotarse los descriptores
 	
 	//Variables miembro
-	int descriptor_socket_escucha_;				///< Descriptor del socket asignado para escuchar conexiones
+	std::vector<int> descriptores_escucha_;		///< Descriptores de los sockets asignados para escuchar conexiones
 	std::shared_ptr<TablaDeClientes> clientes_;	///< Todos los clientes que se han conectado a este servidor
+	unsigned int segundos_latido_;				///< Intervalo entre sondas keepalive (0 si no se envían)
+	unsigned int segundos_inactividad_;			///< Tiempo sin noticias antes de perder un cliente (0 si no hay)
+	std::shared_ptr<Relevo> relevo_;			///< Relevo que detiene los hilos, o nullptr si no hay
+	std::vector<ReceptorDeOrdenes> relevados_;	///< Receptores de los clientes traspasados, pendientes de lanzar
+	std::string ruta_local_;					///< Ruta del socket local (vacía si no hay)
 };
 
 } //namespace lognotify
@@ -6,12 +6,33 @@
 
 #include "servidor_de_notificaciones.h"
 
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <climits>
+#include <cerrno>
+#include <cstring>
 #include <string>
+#include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 
 #include "monitor_de_ficheros.h"
 #include "tabla_de_clientes.h"
 #include "servidor_de_conexion.h"
+#include "servidor_de_origen.h"
+#include "relevo.h"
+#include "limitador_de_tasa.h"
+#include "agregador_de_metricas.h"
+#include "minador_de_plantillas.h"
 #include "evento.h"
 #include "mensaje.h"
 
@@ -19,21 +40,139 @@ using namespace std;
 namespace lognotify
 {
 
+constexpr unsigned int ServidorDeNotificaciones::SEGUNDOS_RELEVO_;
+constexpr unsigned int ServidorDeNotificaciones::SEGUNDOS_PAUSA_;
+constexpr unsigned int ServidorDeNotificaciones::SEGUNDOS_RESUMEN_;
+
+bool ServidorDeNotificaciones::habilitarRelevo (const std::vector<std::string>& argumentos)
+{
+	//Se localiza el binario en ejecución por su ruta, de forma que al relevar se ejecute el que la ocupe
+	//entonces (por ejemplo, una versión actualizada)
+	char ruta [PATH_MAX];
+	ssize_t longitud = readlink("/proc/self/exe", ruta, sizeof ruta - 1);
+	if ((longitud <= 0) || argumentos.empty()) return false;
+	ruta_ejecutable_.assign(ruta, longitud);
+	argumentos_ = argumentos;
+	
+	//La señal se atiende en un hilo propio con sigwait, por lo que debe estar bloqueada en todos los hilos;
+	//los que se crean después heredan el bloqueo. También se atienden allí las de terminación, para eliminar
+	//antes el socket local
+	sigset_t senales;
+	sigemptyset(&senales);
+	sigaddset(&senales, SIGUSR2);
+	sigaddset(&senales, SIGTERM);
+	sigaddset(&senales, SIGINT);
+	return pthread_sigmask(SIG_BLOCK, &senales, nullptr) == 0;
+}
+
 bool ServidorDeNotificaciones::inicializar (const unsigned short puerto,
 											const std::string& dirRegistro,
-											const std::vector<std::string> ficheros	)
+											const std::vector<std::string> ficheros,
+											const unsigned long memoriaReenvio,
+											const unsigned int aceptores,
+											const unsigned int trabajadores,
+											const unsigned int segundosLatido,
+											const unsigned int segundosInactividad,
+											const std::string& rutaLocal,
+											const std::string& nombreAnilloCompartido,
+											const std::string& grupoMultidifusion,
+											const std::vector<std::string>& origenes,
+											const unsigned int lineasPorSegundo,
+											const unsigned int rafagaLineas,
+											const unsigned int segundosDeduplicacion,
+											const bool deduplicarCifras,
+											const std::vector<std::string>& reglasMultilinea,
+											const int descriptorRelevo	)
 {
 	//Si ha sido previamente inicializado, termina con error
 	if (esta_inicializado()) return false;
 	
-	//Se inicializa la tabla de clientes
-	destinatarios_ = make_shared<TablaDeClientes>();
+	//Si se releva a otra ejecución del servidor, se le indica que este proceso está listo y se recibe su
+	//estado, con el que se continúa
+	Relevo::Estado estado;
+	bool relevando = (descriptorRelevo >= 0);
+	if (relevando)
+	{
+		if ((send(descriptorRelevo, "listo", 5, MSG_NOSIGNAL) < 0) || !Relevo::recibirEstado(descriptorRelevo, estado))
+			return false;
+		secuencia_ = estado.secuencia;
+	}
+	
+	//Se inicializa la tabla de clientes, repartidos entre los trabajadores indicados. El instante de inicio
+	//identifica esta ejecución del servidor, de forma que los clientes no confundan sus números de secuencia con
+	//los de una ejecución anterior. Al relevar, en cambio, la ejecución continúa con la misma numeración
+	instancia_ = relevando ? estado.instancia : to_string(chrono::system_clock::now().time_since_epoch().count());
+	destinatarios_ = shared_ptr<TablaDeClientes> (
+		new TablaDeClientes(instancia_, MENSAJES_DE_REENVIO_, memoriaReenvio, trabajadores));
+	
+	//Se crea el publicador de multidifusión, si se ha solicitado, y se anuncia su grupo a los clientes
+	if (!grupoMultidifusion.empty())
+	{
+		if (!multidifusion_.inicializar(grupoMultidifusion, instancia_)) return false;
+		destinatarios_->establecerMultidifusion(grupoMultidifusion);
+	}
+	
+	//En modo repetidor, se anuncia a los clientes que los eventos pueden proceder de varios servidores
+	if (!origenes.empty()) destinatarios_->establecerRepetidor(true);
 	
-	//Se inicializa el servidor de conexión
-	if (!proveedor_de_clientes_.inicializar(puerto, destinatarios_)) return false;
+	//Se indica a los clientes el intervalo de los latidos, con el que deben enviar los suyos
+	segundos_latido_ = segundosLatido;
+	destinatarios_->establecerLatido(segundosLatido);
 	
-	//Se inicializa el monitor de ficheros
+	//Se limita la tasa de líneas de cada fichero, si se ha solicitado, y se ofrecen sus contadores a los clientes
+	limitador_.configurar(lineasPorSegundo, rafagaLineas);
+	destinatarios_->establecerContadores([this] { return limitador_.obtenerContadores(); });
+	
+	//Se crea el agregador de métricas, en el que cuentan sus líneas el hilo del monitor de ficheros y el de cada
+	//servidor de origen, cada uno en su fragmento
+	agregador_ = make_shared<AgregadorDeMetricas>(origenes.size() + 1);
+	destinatarios_->establecerAgregador(agregador_);
+	proveedor_de_eventos_.establecerAgregador(agregador_);
+	
+	//Se crea el minador de plantillas, que sólo trabaja mientras algún cliente solicita resúmenes
+	minador_ = make_shared<MinadorDePlantillas>();
+	destinatarios_->establecerMinador(minador_);
+	
+	//Se crea el relevo, que detiene a los hilos que reciben datos del exterior cuando otro proceso toma el
+	//relevo a éste
+	relevo_ = make_shared<Relevo>();
+	if (!relevo_->inicializar()) return false;
+	
+	//Se inicializa el servidor de conexión. Al relevar, se adoptan los sockets de escucha y los clientes
+	//traspasados, que continúan con su conexión
+	if (relevando)
+	{
+		if (!proveedor_de_clientes_.adoptar(estado.escucha, destinatarios_, segundosLatido, segundosInactividad))
+			return false;
+	}
+	else
+	{
+		if (!proveedor_de_clientes_.inicializar(puerto, destinatarios_, aceptores, segundosLatido, segundosInactividad))
+			return false;
+		if (!rutaLocal.empty() && !proveedor_de_clientes_.anadirSocketLocal(rutaLocal)) return false;
+	}
+	proveedor_de_clientes_.establecerRelevo(relevo_);
+	if (relevando)
+		proveedor_de_clientes_.anadirClientesRelevados(estado.clientes, destinatarios_->restaurarEstado(estado));
+	
+	//Se inicializa el monitor de ficheros. Lo añadido a cada fichero pasa además tal cual a los clientes que lo
+	//reflejan en crudo
 	if (!proveedor_de_eventos_.inicializar(dirRegistro)) return false;
+	proveedor_de_eventos_.establecerAviso(relevo_->obtener_aviso());
+	proveedor_de_eventos_.establecerDeduplicacion(segundosDeduplicacion, deduplicarCifras);
+	proveedor_de_eventos_.establecerReflejo([this]
+		(const string& ruta, const string& rutaAbsoluta, long long desde, long long hasta)
+		{ destinatarios_->reflejar(ruta, rutaAbsoluta, desde, hasta); });
+	
+	//Se establecen las reglas de ensamblado de los ficheros que las tienen: la ruta del fichero va delante
+	for (unsigned int i = 0; i < reglasMultilinea.size(); ++i)
+	{
+		size_t separador = reglasMultilinea[i].find_first_of(" \t");
+		size_t comienzo = (separador != string::npos) ? reglasMultilinea[i].find_first_not_of(" \t", separador) : string::npos;
+		if (comienzo == string::npos) return false;
+		if (!proveedor_de_eventos_.anadirReglaMultilinea(	reglasMultilinea[i].substr(0, separador),
+															reglasMultilinea[i].substr(comienzo)	)) return false;
+	}
 	
 	//Se añaden los ficheros pasados por parámetro al monitor de ficheros
 	vector<string> no_abiertos;
@@ -43,9 +182,39 @@ bool ServidorDeNotificaciones::inicializar (const unsigned short puerto,
 	//Se hace una segunda intentona con los ficheros no abiertos por si estaban temporalmente indisponibles
 	for (unsigned int i = 0; i < no_abiertos.size(); ++i)
 		proveedor_de_eventos_.anadirFichero(no_abiertos[i]);
+	
+	//Al relevar, cada fichero continúa desde donde lo dejó el proceso anterior, sin perder lo añadido entre tanto
+	if (relevando) proveedor_de_eventos_.establecerPosiciones(estado.ficheros);
 		
-	//Si no ha logrado abrir ningún fichero, termina con error
-	if (proveedor_de_eventos_.obtenerNumeroDeFicheros() == 0) return false;
+	//Se preparan los servidores de origen, "direccion/puerto", a los que se conectará al dar servicio. Al
+	//relevar, cada uno continúa desde el último evento suyo que se difundió
+	for (unsigned int i = 0; i < origenes.size(); ++i)
+	{
+		size_t separador = origenes[i].rfind('/');
+		if ((separador == string::npos) || (separador == 0) || (separador + 1 == origenes[i].length())) return false;
+		string posicion;
+		for (unsigned int j = 0; j < estado.origenes.size(); ++j)
+			if (estado.origenes[j].first == origenes[i]) posicion = estado.origenes[j].second;
+		origenes_.emplace_back(new ServidorDeOrigen(origenes[i].substr(0, separador), origenes[i].substr(separador + 1),
+			posicion));
+		posiciones_origenes_.push_back(posicion);
+	}
+	
+	//Si no ha logrado abrir ningún fichero ni tiene servidores de los que reenviar eventos, termina con error
+	if ((proveedor_de_eventos_.obtenerNumeroDeFicheros() == 0) && origenes_.empty()) return false;
+	
+	//Se crea el anillo compartido, si se ha solicitado. Al relevar, los lectores deben volver a abrirlo
+	if (!nombreAnilloCompartido.empty() &&
+		!anillo_compartido_.crear(nombreAnilloCompartido, CAPACIDAD_ANILLO_COMPARTIDO_)) return false;
+	
+	//Por último, se confirma el relevo al proceso anterior, que termina sin volver a utilizar lo traspasado. Desde
+	//entonces el socket local, si lo hay, es de este proceso, que lo elimina al terminar
+	if (relevando)
+	{
+		if (send(descriptorRelevo, "ok", 2, MSG_NOSIGNAL) < 0) return false;
+		close(descriptorRelevo);
+		if (!rutaLocal.empty()) proveedor_de_clientes_.asumirSocketLocal(rutaLocal);
+	}
 	
 	return true;
 }
@@ -56,40 +225,271 @@ void ServidorDeNotificaciones::darServicio (void)
 	//Se empieza a aceptar la conexión de nuevos clientes
 	if (!proveedor_de_clientes_.recibirClientes()) return;
 	
-	//Da comienzo la secuencia de obtención de nueva notificación -> envío a los clientes subscritos
-	bool error = false;
+	//Se envían los latidos en un hilo propio, al igual que las medidas de los agregados y los resúmenes de las
+	//líneas suprimidas si se limitan
+	thread hilo_latidos (&ServidorDeNotificaciones::latir, this);
+	thread hilo_medidas (&ServidorDeNotificaciones::medir, this);
+	thread hilo_resumenes;
+	if (limitador_.estaActivo()) hilo_resumenes = thread(&ServidorDeNotificaciones::resumir, this);
+	
+	//Si el relevo está habilitado, se atiende en un hilo propio, que termina el proceso si tiene éxito
+	if (!ruta_ejecutable_.empty())
+	{
+		thread hilo_relevos (&ServidorDeNotificaciones::atenderRelevos, this);
+		hilo_relevos.detach();
+	}
+	
+	//Se reciben en un hilo propio los eventos de cada servidor de origen
+	vector<thread> hilos_origen;
+	for (unsigned int i = 0; i < origenes_.size(); ++i)
+		hilos_origen.emplace_back(&ServidorDeNotificaciones::repetir, this, i);
+	
+	//Da comienzo la secuencia de obtención de nueva notificación -> envío a los clientes subscritos, si hay
+	//ficheros que monitorizar. En caso contrario se da servicio sólo con los eventos de los servidores de origen
+	bool monitorizar = (proveedor_de_eventos_.obtenerNumeroDeFicheros() > 0);
+	bool error = !monitorizar;
 	unique_ptr<Evento> evento;
+	if (monitorizar) relevo_->registrar();
 	while (!error)
 	{
-		//Se toma el siguiente evento
+		//Se toma el siguiente evento (cuyas líneas ya ha contado el monitor para los agregados) y, si no ha
+		//existido error, se minan sus plantillas y se difunde con las que admita el límite de su fichero, sin
+		//partir sus registros si los ensambla. Durante un relevo, el monitor interrumpe la espera y el hilo se
+		//detiene hasta que termina
 		evento = proveedor_de_eventos_.obtenerSiguienteEvento();
-		if (!evento) error = true;
-		else
+		if (evento)
 		{
-			//Si no ha existido error, se envía el evento serializado a todos los destinatarios
-			destinatarios_->enviar(make_shared<Mensaje> (serializarEvento(move(evento))));
+			minador_->minar(*evento);
+			if (limitador_.limitar(*evento, proveedor_de_eventos_.ensamblaRegistros(*evento))) difundir(*evento);
 		}
+		else if (proveedor_de_eventos_.estaInterrumpido()) relevo_->esperarReanudacion();
+		else error = true;
+	}
+	if (monitorizar) relevo_->retirar();
+	
+	//Los servidores de origen siguen dando servicio indefinidamente. Cuando terminan, también lo hacen los
+	//latidos
+	for (unsigned int i = 0; i < hilos_origen.size(); ++i) hilos_origen[i].join();
+	mutex_difusion_.lock();
+	terminar_ = true;
+	mutex_difusion_.unlock();
+	aviso_terminar_.notify_all();
+	hilo_latidos.join();
+	hilo_medidas.join();
+	if (hilo_resumenes.joinable()) hilo_resumenes.join();
+}
+
+void ServidorDeNotificaciones::difundir (Evento& evento, const int origen)
+{
+	//Se adquiere el mutex
+	mutex_difusion_.lock();
+	
+	//Si el evento procede de un servidor de origen, se anota su posición, desde la que continuaría otro proceso
+	//que tomara el relevo a éste
+	if (origen >= 0) posiciones_origenes_[origen] = origenes_[origen]->obtener_posicion();
+	
+	//Se asigna al evento el siguiente número de secuencia y se envía serializado a todos los destinatarios cuyo
+	//filtro lo deje pasar
+	++secuencia_;
+	shared_ptr<Mensaje> mensaje = make_shared<Mensaje> (serializarEvento(evento, secuencia_));
+	
+	//Todos los eventos se publican además en el anillo compartido, si existe, para los lectores locales.
+	//Por multidifusión se difunden después de conservarse para su reenvío, de forma que cualquier evento que
+	//un cliente eche en falta al recibir un datagrama ya pueda reparársele
+	if (anillo_compartido_.estaCreado()) anillo_compartido_.publicar(secuencia_, *mensaje);
+	if (multidifusion_.estaInicializado())
+	{
+		destinatarios_->enviar(mensaje, evento, secuencia_);
+		multidifusion_.publicar(move(mensaje));
 	}
+	else destinatarios_->enviar(move(mensaje), evento, secuencia_);
+	
+	//Se libera el mutex
+	mutex_difusion_.unlock();
+}
+
+void ServidorDeNotificaciones::repetir (const unsigned int origen)
+{
+	//El ServidorDeOrigen recupera la conexión por sí mismo, por lo que siempre termina devolviendo un evento
+	while (true)
+	{
+		unique_ptr<Evento> evento = origenes_[origen]->obtenerSiguienteEvento();
+		if (!evento) continue;
+		agregador_->contar(*evento, origen + 1);
+		minador_->minar(*evento);
+		difundir(*evento, origen);
+	}
+}
+
+void ServidorDeNotificaciones::latir (void)
+{
+	//Los latidos se envían con el mutex de difusión adquirido, igual que los eventos, pues comparten con ellos
+	//los trabajadores de la tabla de clientes
+	unique_lock<mutex> bloqueo (mutex_difusion_);
+	while (!aviso_terminar_.wait_for(bloqueo, chrono::seconds(segundos_latido_), [this] { return terminar_; }))
+		destinatarios_->enviarLatidos();
+}
+
+void ServidorDeNotificaciones::resumir (void)
+{
+	//Se espera con el mutex de difusión, como los latidos, pero se libera para difundir los resúmenes
+	unique_lock<mutex> bloqueo (mutex_difusion_);
+	while (!aviso_terminar_.wait_for(bloqueo, chrono::seconds(SEGUNDOS_RESUMEN_), [this] { return terminar_; }))
+	{
+		vector<Evento> resumenes = limitador_.obtenerResumenes(SEGUNDOS_RESUMEN_);
+		bloqueo.unlock();
+		for (unsigned int i = 0; i < resumenes.size(); ++i) difundir(resumenes[i]);
+		bloqueo.lock();
+	}
+}
+
+void ServidorDeNotificaciones::medir (void)
+{
+	//Las medidas y los resúmenes de plantillas se envían con el mutex de difusión adquirido, como los latidos,
+	//de forma que no se envíe ninguno mientras se traspasan los clientes en un relevo
+	unique_lock<mutex> bloqueo (mutex_difusion_);
+	unsigned int segundos = 0;
+	while (!aviso_terminar_.wait_for(bloqueo, chrono::seconds(1), [this] { return terminar_; }))
+	{
+		destinatarios_->enviarMetricas(agregador_->cerrarVentanas());
+		if (++segundos % SEGUNDOS_RESUMEN_ == 0) destinatarios_->enviarResumen(minador_->resumir());
+	}
+}
+
+void ServidorDeNotificaciones::atenderRelevos (void)
+{
+	//Las señales están bloqueadas en todos los hilos, por lo que sólo se reciben aquí
+	sigset_t senales;
+	sigemptyset(&senales);
+	sigaddset(&senales, SIGUSR2);
+	sigaddset(&senales, SIGTERM);
+	sigaddset(&senales, SIGINT);
+	int senal;
+	while ((sigwait(&senales, &senal) == 0) && (senal == SIGUSR2)) relevar();
+	
+	//Al recibir una señal de terminación, se elimina el socket local y se vuelve a generar la señal con su acción
+	//por defecto, de forma que el proceso termina igual que si no se hubiera atendido
+	proveedor_de_clientes_.eliminarSocketLocal();
+	signal(senal, SIG_DFL);
+	sigemptyset(&senales);
+	sigaddset(&senales, senal);
+	pthread_sigmask(SIG_UNBLOCK, &senales, nullptr);
+	raise(senal);
 }
 
-Mensaje ServidorDeNotificaciones::serializarEvento (std::unique_ptr<Evento> evento)
+bool ServidorDeNotificaciones::relevar (void)
 {
-	//Se calcula la longitud total del evento sumando la de cada campo, y +1 por cada uno para el caracter
-	//separador (fin de cadena o '\0')
-	unsigned int longitud_total 	= evento->obtener_nombre().length()
-									+ evento->obtener_ubicacion().length()
-									+ evento->obtener_descripcion().length() + 3;
-	
-	//Se copia el contenido de cada campo en un buffer de caracteres, incluído el caracter separador/fin de
-	//cadena ('\0') tras cada uno								
+	//Se crea el socket local por el que se traspasa el estado, que conserva los límites de cada mensaje
+	int extremos [2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, extremos) < 0) return false;
+	
+	//Se preparan los parámetros del nuevo proceso antes de crearlo, pues en el hijo de un proceso con varios
+	//hilos sólo deben hacerse llamadas seguras en señales. Se le indica el descriptor de su extremo del socket
+	vector<string> argumentos = argumentos_;
+	argumentos.push_back("-H");
+	argumentos.push_back(to_string(extremos[1]));
+	vector<char*> parametros;
+	for (unsigned int i = 0; i < argumentos.size(); ++i) parametros.push_back(&argumentos[i][0]);
+	parametros.push_back(nullptr);
+	
+	//Se ejecuta de nuevo el binario en un proceso hijo, que hereda sólo su extremo del socket
+	pid_t hijo = fork();
+	if (hijo == 0)
+	{
+		fcntl(extremos[1], F_SETFD, 0);
+		execv(ruta_ejecutable_.c_str(), &parametros[0]);
+		_exit(127);
+	}
+	close(extremos[1]);
+	if (hijo < 0)
+	{
+		close(extremos[0]);
+		return false;
+	}
+	
+	//Cuando el nuevo proceso está listo, se detienen los hilos que reciben datos del exterior
+	bool relevado = esperarConfirmacion(extremos[0], "listo", SEGUNDOS_RELEVO_) && relevo_->pausar(SEGUNDOS_PAUSA_);
+	if (relevado)
+	{
+		//Con el mutex de difusión adquirido no se difunden más eventos ni latidos, y los que estuvieran en
+		//curso ya han terminado
+		mutex_difusion_.lock();
+		
+		//Se compone el estado y se traspasa al nuevo proceso
+		Relevo::Estado estado;
+		estado.instancia = instancia_;
+		estado.secuencia = secuencia_;
+		estado.escucha = proveedor_de_clientes_.obtener_descriptores_escucha();
+		estado.ficheros = proveedor_de_eventos_.obtenerPosiciones();
+		for (unsigned int i = 0; i < origenes_.size(); ++i)
+			estado.origenes.push_back(make_pair(origenes_[i]->obtener_origen(), posiciones_origenes_[i]));
+		relevado = destinatarios_->exportarEstado(estado, SEGUNDOS_PAUSA_) &&
+			Relevo::enviarEstado(extremos[0], estado) && esperarConfirmacion(extremos[0], "ok", SEGUNDOS_RELEVO_);
+		
+		//Si el nuevo proceso ha tomado el relevo, éste termina inmediatamente, sin destruir nada: las conexiones
+		//y el anillo compartido pertenecen ya al nuevo proceso
+		if (relevado) _exit(0);
+		
+		//Se libera el mutex
+		mutex_difusion_.unlock();
+	}
+	
+	//Si el relevo ha fallado, se termina el nuevo proceso antes de continuar dando servicio, de forma que nunca
+	//haya dos procesos utilizando las mismas conexiones
+	kill(hijo, SIGKILL);
+	waitpid(hijo, nullptr, 0);
+	close(extremos[0]);
+	relevo_->reanudar();
+	return false;
+}
+
+bool ServidorDeNotificaciones::esperarConfirmacion (	const int descriptorSocket,
+														const std::string& confirmacion,
+														const unsigned int segundos	)
+{
+	//Se espera a que llegue un mensaje, o a que se cierre el socket si el otro proceso termina
+	struct pollfd espera;
+	espera.fd = descriptorSocket;
+	espera.events = POLLIN;
+	int resultado;
+	do resultado = poll(&espera, 1, segundos * 1000);
+	while ((resultado < 0) && (errno == EINTR));
+	if (resultado <= 0) return false;
+	
+	//Se comprueba que el mensaje recibido es la confirmación esperada
+	char buffer [16];
+	ssize_t recibidos = recv(descriptorSocket, buffer, sizeof buffer, MSG_DONTWAIT);
+	return (recibidos == (ssize_t) confirmacion.length()) && (memcmp(buffer, confirmacion.data(), recibidos) == 0);
+}
+
+Mensaje ServidorDeNotificaciones::serializarEvento (Evento& evento, const unsigned long long secuencia)
+{
+	//La cabecera contiene el número de secuencia como un campo más, terminado también en '\0'
+	string cabecera = to_string(secuencia);
+	unsigned int longitud_cabecera = cabecera.length() + 1;
+	
+	//La ubicación de los eventos procedentes de otro servidor va precedida de su origen
+	string ubicacion = evento.obtener_ubicacion_completa();
+	
+	//Se calcula la longitud total del evento sumando la de la cabecera y la de cada campo, y +1 por cada uno
+	//para el caracter separador (fin de cadena o '\0')
+	unsigned int longitud_total 	= longitud_cabecera
+									+ evento.obtener_nombre().length()
+									+ ubicacion.length()
+									+ evento.obtener_descripcion().length() + 3;
+	
+	//Se copia la cabecera y el contenido de cada campo en un buffer de caracteres, incluído el caracter
+	//separador/fin de cadena ('\0') tras cada uno
 	char *buffer = new char [longitud_total];
-	strcpy(&buffer[0], &(evento->obtener_nombre())[0]);
-	strcpy(&buffer[evento->obtener_nombre().length() + 1], &(evento->obtener_ubicacion())[0]);
-	strcpy(	&buffer[evento->obtener_nombre().length() + evento->obtener_ubicacion().length() + 2],
-			&(evento->obtener_descripcion())[0]	);
+	char *campos = &buffer[longitud_cabecera];
+	strcpy(&buffer[0], &cabecera[0]);
+	strcpy(&campos[0], &(evento.obtener_nombre())[0]);
+	strcpy(&campos[evento.obtener_nombre().length() + 1], &ubicacion[0]);
+	strcpy(	&campos[evento.obtener_nombre().length() + ubicacion.length() + 2],
+			&(evento.obtener_descripcion())[0]	);
 
 	//Una vez se dispone del contenido del evento serializado en el buffer, se crea y devuelve el nuevo mensaje
-	Mensaje nuevo_mensaje (buffer, longitud_total);
+	Mensaje nuevo_mensaje (buffer, longitud_total, longitud_cabecera);
 	delete[] buffer;
 	return nuevo_mensaje;
 }
@@ -8,11 +8,21 @@
 #define _servidor_de_notificaciones_h_
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include "monitor_de_ficheros.h"
 #include "tabla_de_clientes.h"
+#include "anillo_compartido.h"
+#include "publicador_de_multidifusion.h"
 #include "servidor_de_conexion.h"
+#include "servidor_de_origen.h"
+#include "relevo.h"
+#include "limitador_de_tasa.h"
+#include "agregador_de_metricas.h"
+#include "minador_de_plantillas.h"
 #include "evento.h"
 #include "mensaje.h"
 
@@ -25,6 +35,20 @@ namespace lognotify
 * para especificar su configuración. Con una llamada posterior a ServidorDeNotificaciones::darServicio el
 * servidor empezará a enviar eventos de modificación en los ficheros especificados a aquellos clientes que
 * se conecten al sistema logNotify. 
+* En modo repetidor, el servidor se suscribe además a otros servidores (ver ServidorDeOrigen) y reenvía sus
+* eventos, junto con los propios, a sus clientes, conservando el origen de cada uno.
+* Mientras da servicio, el servidor envía periódicamente latidos a los clientes que los entienden, y da por
+* perdidos a los que dejan de dar señales de vida durante el tiempo de inactividad.
+* Si se habilita el relevo (ver habilitarRelevo), al recibir la señal SIGUSR2 el servidor se sustituye en
+* caliente por una nueva ejecución de su binario, con los mismos parámetros: le traspasa los sockets de
+* escucha, las conexiones de los clientes y la posición de cada fichero y servidor de origen (ver Relevo), y
+* termina. Los clientes continúan recibiendo los eventos por la misma conexión, sin perder ninguno.
+* Si se limita la tasa de líneas de cada fichero (ver LimitadorDeTasa), las que la exceden se suprimen antes de
+* difundirse, y periódicamente se difunde en su lugar un resumen de las suprimidas en cada fichero.
+* Las líneas de todos los eventos, propios y reenviados, se cuentan además para los agregados a los que se
+* suscriben los clientes (ver AgregadorDeMetricas), cuyas medidas se envían a los suscritos al cerrarse cada
+* ventana, y se les asigna una plantilla (ver MinadorDePlantillas) mientras algún cliente solicita resúmenes,
+* que se le envían con la misma frecuencia que los de las líneas suprimidas.
 */
 class ServidorDeNotificaciones
 {
@@ -33,18 +57,74 @@ class ServidorDeNotificaciones
 	/**
 	* Constructor de la clase ServidorDeNotificaciones
 	*/
-	ServidorDeNotificaciones (void): esta_inicializado_ (false) {}
+	ServidorDeNotificaciones (void): esta_inicializado_ (false), secuencia_ (0), segundos_latido_ (0), terminar_ (false) {}
+	
+	/**
+	* Habilita el relevo del servidor al recibir la señal SIGUSR2, que queda bloqueada en todos los hilos para
+	* atenderla en uno propio junto con las de terminación (SIGTERM y SIGINT). Debe llamarse desde el hilo
+	* principal antes de inicializar el servidor
+	* @param argumentos Parámetros de línea de comandos, incluido el nombre del programa, con los que ejecutar
+	* el proceso que tomará el relevo
+	* @return true si el relevo ha sido habilitado, false si no es posible localizar el binario en ejecución
+	*/
+	bool habilitarRelevo (const std::vector<std::string>& argumentos);
 	
 	/**
 	* Inicializa el servidor de notificaciones con los parámetros introducidos
 	* @param puerto Puerto TCP/IP en el que el servidor debe aceptar conexiones entrantes de nuevos clientes
 	* @param dirRegistro Ruta del directorio donde el sistema mantiene los ficheros de registro
 	* @param ficheros Lista de rutas relativas a dirRegistro de ficheros a monitorizar
-	* @return true si el proceso de inicialización es correcto, false en caso contrario
+	* @param memoriaReenvio Memoria máxima (en bytes) dedicada a conservar los últimos eventos enviados, para
+	* reenviarlos a los clientes que pierdan la conexión y la recuperen
+	* @param aceptores Número de hilos que aceptan conexiones de nuevos clientes, cada uno con su propio socket
+	* de escucha
+	* @param trabajadores Número de hilos entre los que se reparten los clientes para enviarles los eventos
+	* @param segundosLatido Intervalo entre los latidos enviados a los clientes, y entre las sondas keepalive de
+	* las conexiones inactivas
+	* @param segundosInactividad Tiempo máximo sin noticias de un cliente (sin latidos ni confirmación de los
+	* datos enviados) antes de darlo por perdido y eliminarlo
+	* @param rutaLocal Ruta de un socket local (AF_UNIX) en el que aceptar también conexiones de los clientes
+	* que se ejecutan en la misma máquina, o cadena vacía para aceptarlas sólo por TCP/IP
+	* @param nombreAnilloCompartido Nombre del segmento de memoria compartida ("/nombre") en el que publicar
+	* todos los eventos para los lectores locales (ver AnilloCompartido), o cadena vacía para no publicarlos
+	* @param grupoMultidifusion Grupo de multidifusión y puerto UDP ("grupo:puerto") en el que difundir todos
+	* los eventos a los clientes de la red local (ver PublicadorDeMultidifusion), o cadena vacía para enviarlos
+	* sólo por la conexión de cada cliente
+	* @param origenes Servidores ("direccion/puerto") de los que recibir eventos para reenviarlos (modo
+	* repetidor). Si hay alguno, no es necesario monitorizar ningún fichero
+	* @param lineasPorSegundo Líneas por segundo que se difunden como máximo de cada fichero monitorizado, o 0
+	* para no limitarlas
+	* @param rafagaLineas Líneas que se difunden como máximo de una vez de cada fichero tras un periodo de calma
+	* @param segundosDeduplicacion Ventana en la que se colapsan las líneas repetidas de cada fichero (ver
+	* MonitorDeFicheros::establecerDeduplicacion), o 0 para difundirlas todas
+	* @param deduplicarCifras Indica si se colapsan también las líneas que sólo difieren en sus cifras
+	* @param reglasMultilinea Reglas con que se agrupan en registros las líneas de algunos ficheros, cada una
+	* con la ruta del fichero relativa a dirRegistro seguida de la regla (ver EnsambladorDeRegistros), separadas
+	* por espacios o tabuladores
+	* @param descriptorRelevo Descriptor del socket local por el que recibir el estado de la ejecución del
+	* servidor a la que se releva, o un valor negativo para comenzar desde cero. Al relevar, los sockets de
+	* escucha se toman del estado recibido en lugar de crearse
+	* @return true si el proceso de inicialización es correcto, false en caso contrario (también si alguna
+	* regla de ensamblado no es válida)
 	*/
 	bool inicializar (	const unsigned short puerto,
 						const std::string& dirRegistro,
-						const std::vector<std::string> ficheros	);
+						const std::vector<std::string> ficheros,
+						const unsigned long memoriaReenvio,
+						const unsigned int aceptores,
+						const unsigned int trabajadores,
+						const unsigned int segundosLatido,
+						const unsigned int segundosInactividad,
+						const std::string& rutaLocal,
+						const std::string& nombreAnilloCompartido,
+						const std::string& grupoMultidifusion,
+						const std::vector<std::string>& origenes,
+						const unsigned int lineasPorSegundo,
+						const unsigned int rafagaLineas,
+						const unsigned int segundosDeduplicacion,
+						const bool deduplicarCifras,
+						const std::vector<std::string>& reglasMultilinea,
+						const int descriptorRelevo = -1	);
 	
 	/**
 	* Comprueba si el servidor ha sido ya inicializado con anterioridad
@@ -58,19 +138,109 @@ class ServidorDeNotificaciones
 	void darServicio (void);
 	
 	private:
+	
+	/**
+	* Asigna a un Evento el siguiente número de secuencia y lo envía serializado a todos los destinatarios
+	* cuyo filtro lo deje pasar, publicándolo además en el anillo compartido y por multidifusión si existen.
+	* Puede llamarse desde varios hilos (uno por cada proveedor de eventos): los eventos se difunden de uno en
+	* uno, en el orden de su número de secuencia
+	* @param evento Evento que desea difundirse
+	* @param origen Índice del ServidorDeOrigen del que procede el Evento, cuya posición difundida se anota, o
+	* un valor negativo si procede de los ficheros monitorizados
+	*/
+	void difundir (Evento& evento, const int origen = -1);
+	
+	/**
+	* Recibe los eventos de un ServidorDeOrigen y los difunde, indefinidamente. Es una función bloqueante,
+	* pensada para ser ejecutada en un hilo propio por cada ServidorDeOrigen
+	* @param origen Índice del ServidorDeOrigen del que se reciben los eventos
+	*/
+	void repetir (const unsigned int origen);
+	
+	/**
+	* Envía latidos a los clientes cada intervalo de latido, hasta que se indica que debe terminar. Es una
+	* función bloqueante, pensada para ser ejecutada en un hilo propio
+	*/
+	void latir (void);
+	
+	/**
+	* Difunde el resumen de las líneas suprimidas en cada fichero por exceder su tasa cada intervalo de resumen,
+	* hasta que se indica que debe terminar. Es una función bloqueante, pensada para ser ejecutada en un hilo
+	* propio
+	*/
+	void resumir (void);
+	
+	/**
+	* Cierra cada segundo las ventanas vencidas de los agregados y envía sus medidas a los clientes suscritos, y
+	* cada SEGUNDOS_RESUMEN_ envía el resumen de las plantillas a los clientes que lo reciben, hasta que se indica
+	* que debe terminar. Es una función bloqueante, pensada para ser ejecutada en un hilo propio
+	*/
+	void medir (void);
+	
+	/**
+	* Espera la señal SIGUSR2 y, cada vez que se recibe, intenta relevar al servidor. Al recibir SIGTERM o SIGINT
+	* elimina el socket local y termina el proceso. Es una función bloqueante, pensada para ser ejecutada en un
+	* hilo propio
+	*/
+	void atenderRelevos (void);
+	
+	/**
+	* Ejecuta de nuevo el binario del servidor y le traspasa el estado (ver Relevo): detiene los hilos que
+	* reciben datos del exterior y la difusión de eventos, espera a que terminen los envíos en curso y, si el
+	* nuevo proceso confirma que ha tomado el relevo, termina este proceso. Si falla en cualquier punto, termina
+	* el nuevo proceso y se continúa dando servicio
+	* @return false si el relevo ha fallado (si tiene éxito, no retorna)
+	*/
+	bool relevar (void);
+	
+	/**
+	* Espera a recibir una confirmación por el socket local de un relevo
+	* @param descriptorSocket Descriptor del socket local
+	* @param confirmacion Confirmación esperada
+	* @param segundos Tiempo máximo de espera
+	* @return true si se ha recibido la confirmación esperada, false en caso contrario
+	*/
+	static bool esperarConfirmacion (const int descriptorSocket, const std::string& confirmacion, const unsigned int segundos);
 		
 	/**
-	* Convierte un Evento de monitorización en un Mensaje listo para ser enviado por red
+	* Convierte un Evento de monitorización en un Mensaje listo para ser enviado por red. El Mensaje comienza
+	* con una cabecera que contiene el número de secuencia del Evento, que sólo se envía a los clientes que lo
+	* solicitan
 	* @param evento Evento de monitorización que desea serializarse
+	* @param secuencia Número de secuencia asignado al Evento
 	* @return Mensaje generado a partir del Evento proporcionado
 	*/
-	Mensaje serializarEvento (std::unique_ptr<Evento> evento);
+	Mensaje serializarEvento (Evento& evento, const unsigned long long secuencia);
+	
+	//Constantes
+	constexpr static unsigned int MENSAJES_DE_REENVIO_ = 65536;	///< Máximo de eventos conservados para reenvío
+	constexpr static unsigned long CAPACIDAD_ANILLO_COMPARTIDO_ = 16777216;	///< Bytes del anillo compartido
+	constexpr static unsigned int SEGUNDOS_RELEVO_ = 30;	///< Espera máxima a cada confirmación del relevo
+	constexpr static unsigned int SEGUNDOS_PAUSA_ = 5;		///< Espera máxima a que se detengan hilos y envíos
+	constexpr static unsigned int SEGUNDOS_RESUMEN_ = 10;	///< Intervalo entre resúmenes de líneas suprimidas
+															///< y de plantillas
 	
 	//Variables miembro
 	bool esta_inicializado_;						///< Indica si el servidor ha sido ya inicializado
+	unsigned long long secuencia_;					///< Número de secuencia del último evento enviado
 	MonitorDeFicheros proveedor_de_eventos_;		///< Monitor de ficheros que genera eventos de modificación
 	ServidorDeConexion proveedor_de_clientes_;		///< Servidor de conexión que acepta nuevos clientes
 	std::shared_ptr<TablaDeClientes> destinatarios_;///< Clientes a los que notificar los eventos generados
+	AnilloCompartido anillo_compartido_;			///< Anillo en el que se publican los eventos para lectores locales
+	PublicadorDeMultidifusion multidifusion_;		///< Publicador de los eventos por multidifusión
+	std::vector<std::unique_ptr<ServidorDeOrigen>> origenes_;	///< Servidores cuyos eventos se reenvían
+	std::mutex mutex_difusion_;						///< Mutex que serializa la difusión de los eventos
+	unsigned int segundos_latido_;					///< Intervalo entre los latidos enviados a los clientes
+	bool terminar_;									///< Indica al hilo de latidos que debe terminar
+	std::condition_variable aviso_terminar_;		///< Aviso al hilo de latidos de que debe terminar
+	std::string instancia_;							///< Identificador de la ejecución del servidor
+	std::vector<std::string> posiciones_origenes_;	///< Posición difundida de cada servidor de origen
+	std::shared_ptr<Relevo> relevo_;				///< Relevo que detiene los hilos al traspasar el servicio
+	std::string ruta_ejecutable_;					///< Binario que se ejecuta al relevar, o vacía si no se releva
+	std::vector<std::string> argumentos_;			///< Parámetros con que se ejecuta el binario al relevar
+	LimitadorDeTasa limitador_;						///< Limitador de la tasa de líneas de cada fichero
+	std::shared_ptr<AgregadorDeMetricas> agregador_;///< Agregador que cuenta las líneas para los agregados
+	std::shared_ptr<MinadorDePlantillas> minador_;	///< Minador que asigna plantillas a las líneas
 };
 
 } //namespace lognotify
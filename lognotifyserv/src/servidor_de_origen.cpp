@@ -0,0 +1,195 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "servidor_de_origen.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+#include "evento.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr int ServidorDeOrigen::SEGUNDOS_RECONEXION_;
+
+ServidorDeOrigen::ServidorDeOrigen (const std::string& direccion, const std::string& puerto, const std::string& posicion):
+	direccion_(direccion),
+	puerto_(puerto),
+	descriptor_socket_(-1),
+	secuencia_(0),
+	confirmada_(0),
+	campos_por_evento_(3),
+	campos_(1),
+	buffer_(TAMANO_BUFFER_),
+	inicio_(0),
+	fin_(0)
+{
+	//Si se indica una posición válida, la primera conexión se recupera desde ella
+	size_t separador = posicion.rfind(':');
+	if ((separador != string::npos) && (separador > 0) && (separador + 1 < posicion.length()))
+	{
+		instancia_ = posicion.substr(0, separador);
+		secuencia_ = strtoull(&posicion[separador + 1], nullptr, 10);
+		confirmada_ = secuencia_;
+	}
+}
+
+ServidorDeOrigen::~ServidorDeOrigen (void)
+{
+	desconectar();
+}
+
+std::unique_ptr<Evento> ServidorDeOrigen::obtenerSiguienteEvento (void)
+{
+	while (true)
+	{
+		//Si no hay conexión, se intenta establecer periódicamente hasta conseguirlo
+		if ((descriptor_socket_ < 0) && !conectar())
+		{
+			this_thread::sleep_for(chrono::seconds(SEGUNDOS_RECONEXION_));
+			continue;
+		}
+		
+		//Se reparten los bytes pendientes entre los campos del evento en curso, completando uno en cada '\0'.
+		//Cada conexión comienza con los eventos en formato "nombre"\0"ubicacion"\0"descripcion"\0 hasta el
+		//evento de control con el que el servidor acepta la orden reanudar; a partir de él, cada evento va
+		//precedido de su número de secuencia
+		while (inicio_ < fin_)
+		{
+			char *inicio = &buffer_[inicio_];
+			char *separador = (char*) memchr(inicio, '\0', fin_ - inicio_);
+			if (separador == nullptr)
+			{
+				campos_.back().append(inicio, fin_ - inicio_);
+				inicio_ = fin_;
+				break;
+			}
+			campos_.back().append(inicio, separador - inicio);
+			inicio_ = inicio_ + (separador - inicio) + 1;
+			if (campos_.size() < campos_por_evento_)
+			{
+				campos_.emplace_back();
+				continue;
+			}
+			
+			//Al completarse el último campo hay un evento completo. Los de control (con nombre vacío) sólo
+			//actualizan la posición; el resto se devuelve, conservando su origen si ya lo tenía
+			vector<string> campos;
+			campos.swap(campos_);
+			campos_.assign(1, "");
+			if ((campos_por_evento_ == 3) && campos[0].empty() && (campos[1] == "reanudar"))
+			{
+				size_t separador_posicion = campos[2].rfind(':');
+				if (separador_posicion == string::npos) continue;
+				instancia_ = campos[2].substr(0, separador_posicion);
+				secuencia_ = strtoull(&campos[2][separador_posicion + 1], nullptr, 10);
+				campos_por_evento_ = 4;
+			}
+			else if (campos_por_evento_ == 3)
+			{
+				if (!campos[0].empty())
+					return unique_ptr<Evento> (new Evento(Evento::recibido(campos[0], campos[1], campos[2], obtener_origen())));
+			}
+			else
+			{
+				secuencia_ = strtoull(&campos[0][0], nullptr, 10);
+				if (!campos[1].empty())
+					return unique_ptr<Evento> (new Evento(Evento::recibido(campos[1], campos[2], campos[3], obtener_origen())));
+			}
+		}
+		
+		//Procesado todo lo recibido, se confirman los eventos devueltos y se espera a recibir más. Si la
+		//conexión falla, se recuperará en la siguiente vuelta
+		if ((campos_por_evento_ == 4) && (secuencia_ != confirmada_))
+		{
+			enviarOrden("confirmar", to_string(secuencia_));
+			confirmada_ = secuencia_;
+		}
+		int recibidos = recv(descriptor_socket_, &buffer_[0], buffer_.size(), 0);
+		if ((recibidos < 0) && (errno == EINTR)) continue;
+		if (recibidos <= 0)
+		{
+			desconectar();
+			continue;
+		}
+		inicio_ = 0;
+		fin_ = recibidos;
+	}
+}
+
+bool ServidorDeOrigen::conectar (void)
+{
+	//Se obtiene la información de direcciones del servidor
+	struct addrinfo indicaciones, *info_servidor;
+	memset(&indicaciones, 0, sizeof indicaciones);
+	indicaciones.ai_family = AF_UNSPEC;
+	indicaciones.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(&direccion_[0], &puerto_[0], &indicaciones, &info_servidor) != 0) return false;
+	
+	//Se recorren las posibles direcciones obtenidas, conectando a la primera que lo permita
+	int descriptor_socket = -1;
+	for (struct addrinfo *p = info_servidor; p != nullptr; p = p->ai_next)
+	{
+		descriptor_socket = socket(p->ai_family, p->ai_socktype | SOCK_CLOEXEC, p->ai_protocol);
+		if (descriptor_socket < 0) continue;
+		if (connect(descriptor_socket, p->ai_addr, p->ai_addrlen) == 0) break;
+		close(descriptor_socket);
+		descriptor_socket = -1;
+	}
+	freeaddrinfo(info_servidor);
+	if (descriptor_socket < 0) return false;
+	
+	//Se solicita recibir los eventos con su número de secuencia y, si el servidor es a su vez un repetidor,
+	//con su origen, reenviando los perdidos desde el último recibido si ya se había conectado antes
+	descriptor_socket_ = descriptor_socket;
+	string posicion = instancia_.empty() ? "" : instancia_ + ":" + to_string(secuencia_);
+	if (!enviarOrden("repetidor", "") || !enviarOrden("reanudar", posicion))
+	{
+		desconectar();
+		return false;
+	}
+	return true;
+}
+
+void ServidorDeOrigen::desconectar (void)
+{
+	if (descriptor_socket_ >= 0) close(descriptor_socket_);
+	descriptor_socket_ = -1;
+	campos_por_evento_ = 3;
+	campos_.assign(1, "");
+	inicio_ = 0;
+	fin_ = 0;
+	confirmada_ = 0;
+}
+
+bool ServidorDeOrigen::enviarOrden (const std::string& orden, const std::string& argumento)
+{
+	//Se compone la orden con cada campo terminado en '\0' y se envía por completo
+	string mensaje = orden + '\0' + argumento + '\0';
+	unsigned int enviados = 0;
+	while (enviados < mensaje.length())
+	{
+		int resultado = send(descriptor_socket_, &mensaje[enviados], mensaje.length() - enviados, MSG_NOSIGNAL);
+		if ((resultado < 0) && (errno == EINTR)) continue;
+		if (resultado < 0) return false;
+		enviados = enviados + resultado;
+	}
+	return true;
+}
+
+} //namespace lognotify
\ No newline at end of file
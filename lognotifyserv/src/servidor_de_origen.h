@@ -0,0 +1,115 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _servidor_de_origen_h_
+#define _servidor_de_origen_h_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "evento.h"
+
+namespace lognotify
+{
+
+/**
+* Un ServidorDeOrigen representa otro servidor de logNotify del que este servidor, en modo repetidor, recibe
+* los eventos para reenviarlos a sus propios clientes, de forma que los servidores puedan organizarse en árbol
+* y cada cliente necesite una única conexión. Se suscribe al servidor como un cliente más, sin filtro, y
+* proporciona sus eventos mediante una llamada bloqueante, igual que un MonitorDeFicheros:
+* obtenerSiguienteEvento(). Cada Evento conserva su origen: el servidor en que se produjo, que es el propio
+* ServidorDeOrigen salvo que éste sea a su vez un repetidor.
+* Si la conexión se pierde, se recupera periódicamente, solicitando el reenvío de los eventos perdidos.
+* El ServidorDeOrigen NO es thread safe; sus eventos deben obtenerse desde un único hilo.
+*/
+class ServidorDeOrigen
+{
+	public:
+	
+	/**
+	* Constructor de la clase ServidorDeOrigen
+	* @param direccion Dirección IP o nombre del servidor
+	* @param puerto Puerto TCP en el que el servidor acepta clientes
+	* @param posicion Último evento del servidor ya difundido, "instancia:secuencia" (ver obtener_posicion), a
+	* partir del cual se reciben los siguientes; si está vacía, sólo se reciben los posteriores a la conexión
+	*/
+	ServidorDeOrigen (const std::string& direccion, const std::string& puerto, const std::string& posicion = "");
+	
+	/**
+	* Destructor de la clase ServidorDeOrigen. Termina la conexión si está abierta
+	*/
+	~ServidorDeOrigen (void);
+	
+	ServidorDeOrigen (const ServidorDeOrigen&) = delete;
+	ServidorDeOrigen& operator= (const ServidorDeOrigen&) = delete;
+	
+	/**
+	* Obtiene el siguiente evento recibido del servidor. Es una función bloqueante: conecta con el servidor si
+	* no hay conexión, y la recupera cada vez que se pierde, hasta recibir un evento. Antes de esperar nuevos
+	* eventos se confirman al servidor los ya devueltos, que deben haberse procesado
+	* @return Puntero al objeto Evento recibido, con su origen
+	*/
+	std::unique_ptr<Evento> obtenerSiguienteEvento (void);
+	
+	/**
+	* Devuelve el origen asignado a los eventos producidos en el servidor
+	* @return Dirección y puerto del servidor, "direccion/puerto"
+	*/
+	inline std::string obtener_origen (void) { return direccion_ + "/" + puerto_; }
+	
+	/**
+	* Devuelve la posición en el servidor del último evento recibido, desde la que se recupera la conexión
+	* @return Posición del último evento recibido, "instancia:secuencia", o cadena vacía si todavía no se conoce
+	*/
+	inline std::string obtener_posicion (void)
+	{
+		return instancia_.empty() ? "" : instancia_ + ":" + std::to_string(secuencia_);
+	}
+	
+	private:
+	
+	/**
+	* Establece la conexión con el servidor y le solicita recibir los eventos con su número de secuencia,
+	* reenviando los que se han perdido desde el último recibido
+	* @return true si la conexión ha sido establecida, false en caso contrario
+	*/
+	bool conectar (void);
+	
+	/**
+	* Termina la conexión con el servidor, descartando el evento que estuviera a medio recibir
+	*/
+	void desconectar (void);
+	
+	/**
+	* Envía una orden al servidor: "orden"\0"argumento"\0
+	* @param orden Nombre de la orden
+	* @param argumento Argumento de la orden
+	* @return true si la orden ha sido enviada, false si la conexión ha fallado
+	*/
+	bool enviarOrden (const std::string& orden, const std::string& argumento);
+	
+	//Constantes
+	constexpr static int TAMANO_BUFFER_ = 65536;		///< Tamaño del buffer utilizado para recibir datos
+	constexpr static int SEGUNDOS_RECONEXION_ = 5;		///< Intervalo entre intentos de recuperar la conexión
+	
+	//Variables miembro
+	std::string direccion_;				///< Dirección IP o nombre del servidor
+	std::string puerto_;				///< Puerto TCP del servidor
+	int descriptor_socket_;				///< Descriptor del socket de la conexión, negativo si no hay
+	std::string instancia_;				///< Ejecución del servidor a la que corresponde la secuencia
+	unsigned long long secuencia_;		///< Número de secuencia del último evento recibido
+	unsigned long long confirmada_;		///< Número de secuencia del último evento confirmado
+	unsigned int campos_por_evento_;	///< Campos de cada evento: 3 hasta aceptarse la orden reanudar, 4 después
+	std::vector<std::string> campos_;	///< Campos del evento en curso
+	std::vector<char> buffer_;			///< Datos recibidos todavía por procesar
+	unsigned int inicio_;				///< Posición en el buffer del primer byte por procesar
+	unsigned int fin_;					///< Posición en el buffer tras el último byte recibido
+};
+
+} //namespace lognotify
+
+#endif //_servidor_de_origen_h_
\ No newline at end of file
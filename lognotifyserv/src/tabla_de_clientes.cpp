@@ -6,42 +6,115 @@
 
 #include "tabla_de_clientes.h"
 
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <utility>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 #include "cliente.h"
+#include "evento.h"
+#include "filtro.h"
+#include "motor_de_suscripciones.h"
+#include "anillo_de_reenvio.h"
+#include "mapa_de_ranuras.h"
+#include "trabajador_de_difusion.h"
+#include "codificador.h"
+#include "relevo.h"
+#include "agregador_de_metricas.h"
+#include "minador_de_plantillas.h"
 
 using namespace std;
 namespace lognotify
 {
 
-int TablaDeClientes::anadirCliente (const int descriptor_socket)
+constexpr unsigned long TablaDeClientes::BYTES_POR_TRAMA_CRUDA_;
+
+TablaDeClientes::TablaDeClientes (	const std::string& instancia,
+									const unsigned int maxMensajesReenvio,
+									const unsigned long maxBytesReenvio,
+									const unsigned int trabajadores	):
+	clientes_(make_shared<const MapaDeRanuras<shared_ptr<Cliente>>>()),
+	instancia_(instancia),
+	anillo_(maxMensajesReenvio, maxBytesReenvio),
+	repetidor_(false),
+	segundos_latido_(0),
+	clientes_en_crudo_(0)
 {
+	//Se crean las particiones vacías y a continuación se lanza el trabajador de cada una
+	unsigned int numero = (trabajadores > 0) ? trabajadores : 1;
+	particiones_.assign(numero, make_shared<const Particion>());
+	for (unsigned int i = 0; i < numero; ++i)
+		trabajadores_.emplace_back(new TrabajadorDeDifusion(
+			[this, i] (const TrabajadorDeDifusion::Difusion& difusion) { difundir(difusion, i); },
+			[this, i] (vector<int>& pendientes) { continuarEnvios(i, pendientes); }));
+}
+
+TablaDeClientes::IdentificadorDeCliente TablaDeClientes::anadirCliente (const int descriptor_socket)
+{
+	return anadirClientes(vector<int> (1, descriptor_socket)).front();
+}
+
+std::vector<TablaDeClientes::IdentificadorDeCliente> TablaDeClientes::anadirClientes (const std::vector<int>& descriptores)
+{
+	//Se crean los clientes con su mutex adquirido, de forma que ningún envío pueda tratarlos hasta conocer a
+	//partir de qué evento les corresponden
+	vector<shared_ptr<Cliente>> nuevos_clientes;
+	for (unsigned int i = 0; i < descriptores.size(); ++i)
+	{
+		nuevos_clientes.push_back(make_shared<Cliente>(descriptores[i]));
+		nuevos_clientes.back()->bloquear();
+	}
+	
 	//Se adquiere el mutex
 	mutex_.lock();
 	
-	//Se llama a anadirClienteNoSeguro
-	int identificador = anadirClienteNoSeguro(descriptor_socket);
+	//Se publica una nueva versión de la lista con todos los clientes insertados, anotando las llaves asignadas
+	vector<IdentificadorDeCliente> identificadores;
+	shared_ptr<MapaDeRanuras<shared_ptr<Cliente>>> clientes =
+		make_shared<MapaDeRanuras<shared_ptr<Cliente>>>(*atomic_load(&clientes_));
+	for (unsigned int i = 0; i < nuevos_clientes.size(); ++i)
+	{
+		identificadores.push_back(clientes->insertar(nuevos_clientes[i]));
+		asignarTrabajador(*nuevos_clientes[i], identificadores.back());
+	}
+	repartir(*clientes);
+	atomic_store(&clientes_, shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>>(move(clientes)));
 	
 	//Se libera el mutex
 	mutex_.unlock();
 	
-	//Se devuelve el identificador obtenido
-	return identificador;
+	//Se anota el último evento difundido, pues los posteriores se les enviarán directamente una vez que decidan
+	//cómo recibirlos (ver reanudarCliente y terminarEspera). Como la lista se publica antes de consultar el
+	//anillo, un evento o bien se conserva antes (y se les reenviará si lo piden) o bien se difunde sobre una
+	//versión de la lista que ya incluye a los clientes
+	mutex_anillo_.lock();
+	unsigned long long ultima = anillo_.obtener_ultima();
+	mutex_anillo_.unlock();
+	for (unsigned int i = 0; i < nuevos_clientes.size(); ++i)
+	{
+		nuevos_clientes[i]->establecer_secuencia_de_alta(ultima);
+		nuevos_clientes[i]->establecer_en_espera(true);
+		nuevos_clientes[i]->desbloquear();
+	}
+	
+	//Se devuelven los identificadores obtenidos
+	return identificadores;
 }
 
-void TablaDeClientes::eliminarCliente (const int identificador_cliente)
+void TablaDeClientes::eliminarCliente (const IdentificadorDeCliente identificador_cliente)
 {
-	//Se adquiere el mutex
-	mutex_.lock();
-	
-	//Se llama a eliminarClienteNoSeguro
-	eliminarClienteNoSeguro(identificador_cliente);
-	
-	//Se libera el mutex
-	mutex_.unlock();
+	eliminarClientes(vector<IdentificadorDeCliente> (1, identificador_cliente));
 }
 
 void TablaDeClientes::eliminarTodo (void)
@@ -49,37 +122,45 @@ void TablaDeClientes::eliminarTodo (void)
 	//Se adquiere el mutex
 	mutex_.lock();
 	
-	//Se eliminan clientes de la lista hasta que no quede ninguno
-	while (clientes_.size() > 0)
-	{
-		clientes_.back().terminarConexion();
-		clientes_.pop_back();
-	}
+	//Se publica una lista vacía, conservando la anterior para terminar las conexiones
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	atomic_store(&clientes_, make_shared<const MapaDeRanuras<shared_ptr<Cliente>>>());
+	repartir(MapaDeRanuras<shared_ptr<Cliente>>());
 	
 	//Se libera el mutex
 	mutex_.unlock();
+	
+	//Se retira el filtro de cada cliente y se termina su conexión
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
+	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		motor_.retirarFiltro(cliente.obtener_filtro());
+		retirarAgregados(cliente);
+		if (cliente.obtener_resumido()) minador_->desactivar();
+		if (cliente.obtener_crudo()) --clientes_en_crudo_;
+		cliente.terminarConexion();
+		cliente.desbloquear();
+	}
 }
 
-bool TablaDeClientes::enviar (std::shared_ptr<Mensaje> mensaje, const int identificador_cliente)
+bool TablaDeClientes::enviar (std::shared_ptr<Mensaje> mensaje, const IdentificadorDeCliente identificador_cliente)
 {
 	bool enviado = false;
 	
-	//Se adquiere el mutex
-	mutex_.lock();
-	
 	//Se comprueba que el identificador se corresponde a una entrada válida de la TablaDeClientes
-	if (identificador_cliente < clientes_.size())
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (cliente)
 	{
 		//Se solicita al Cliente especificado que envíe el Evento
-		enviado = clientes_[identificador_cliente].enviar(move(mensaje));
+		cliente->bloquear();
+		enviado = cliente->enviar(move(mensaje));
+		cliente->desbloquear();
 		
 		//Si el envío ha fallado, se asume que la conexión se ha perdido y se elimina el cliente
-		if (!enviado) eliminarClienteNoSeguro(identificador_cliente);
+		if (!enviado) eliminarCliente(identificador_cliente);
 	}
 	
-	//Se libera el mutex
-	mutex_.unlock();
-	
 	//Se devuelve el resultado del envío
 	return enviado;
 }
@@ -87,48 +168,1011 @@ bool TablaDeClientes::enviar (std::shared_ptr<Mensaje> mensaje, const int identi
 bool TablaDeClientes::enviar (std::shared_ptr<Mensaje> mensaje)
 {
 	bool enviado = false;
+	vector<IdentificadorDeCliente> eliminados;
 	
-	//Se adquiere el mutex
-	mutex_.lock();
-	
-	//Se recorre la lista completa de clientes enviando el evento a cada uno de ellos
-	for (int i = clientes_.size() - 1; i >= 0; --i)
+	//Se recorre la versión vigente de la lista de clientes enviando el evento a cada uno de ellos
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
 	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		
 		//Si el envío tiene éxito se marca que se ha conseguido al menos un envío exitoso
-		if (clientes_[i].enviar(mensaje)) enviado = true;
+		if (cliente.enviar(mensaje)) enviado = true;
 		
-		//En caso contrario, se asume que la conexión se ha perdido y se elimina el cliente
-		else eliminarClienteNoSeguro(i);
+		//En caso contrario, se asume que la conexión se ha perdido y se eliminará el cliente
+		else eliminados.push_back(clientes->obtener_llave(i));
+		
+		cliente.desbloquear();
 	}
 	
-	//Se libera el mutex
-	mutex_.unlock();
+	//Se eliminan los clientes cuya conexión ha fallado
+	if (!eliminados.empty()) eliminarClientes(eliminados);
 	
 	//Se devuelve el resultado del envío
 	return enviado;
 }
 
-int TablaDeClientes::anadirClienteNoSeguro (const int descriptor_socket)
+void TablaDeClientes::enviar (std::shared_ptr<Mensaje> mensaje, Evento& evento, const unsigned long long secuencia)
+{
+	//Se conserva el mensaje para su posible reenvío antes de encolarlo a los trabajadores, que obtendrán su
+	//partición de la lista de clientes después. Así un cliente que se añade a la vez recibe cada evento
+	//exactamente una vez (ver anadirCliente)
+	mutex_anillo_.lock();
+	anillo_.anadir(secuencia, mensaje);
+	mutex_anillo_.unlock();
+	
+	//Los identificadores de los filtros retirados sólo se reasignan cuando todos los trabajadores han tratado
+	//las difusiones evaluadas antes de su retirada, de forma que ninguno aplique a un cliente el resultado de
+	//otro filtro que tuvo su identificador
+	unsigned long long tratada = ULLONG_MAX;
+	for (unsigned int i = 0; i < trabajadores_.size(); ++i)
+		if (trabajadores_[i]->obtener_evaluacion() < tratada) tratada = trabajadores_[i]->obtener_evaluacion();
+	motor_.liberarFiltros(tratada);
+	
+	//Se evalúa el evento frente a los filtros de todos los clientes a la vez
+	shared_ptr<vector<bool>> pasan = make_shared<vector<bool>>();
+	unsigned long long evaluacion = motor_.evaluar(evento, *pasan);
+	
+	//Se encola la difusión a cada trabajador, que comparte el mensaje y el resultado de los filtros
+	TrabajadorDeDifusion::Difusion difusion;
+	difusion.mensaje = move(mensaje);
+	difusion.pasan = move(pasan);
+	difusion.secuencia = secuencia;
+	difusion.evaluacion = evaluacion;
+	for (unsigned int i = 0; i < trabajadores_.size(); ++i) trabajadores_[i]->encolar(difusion);
+}
+
+void TablaDeClientes::enviarLatidos (void)
 {
-	//El cliente se inserta al final de la lista y se devuelve su posición
-	Cliente nuevo_cliente (descriptor_socket);
-	clientes_.push_back(move(nuevo_cliente));
-	return clientes_.size() - 1;
+	//Se encola a cada trabajador una difusión sin mensaje, que envía un latido a cada cliente de su partición
+	TrabajadorDeDifusion::Difusion difusion;
+	difusion.secuencia = 0;
+	difusion.evaluacion = 0;
+	for (unsigned int i = 0; i < trabajadores_.size(); ++i) trabajadores_[i]->encolar(difusion);
 }
 
-void TablaDeClientes::eliminarClienteNoSeguro (const int identificador_cliente)
+void TablaDeClientes::difundir (const TrabajadorDeDifusion::Difusion& difusion, const unsigned int particion)
 {
-	//Se comprueba que el identificador de cliente dado sea válido
-	if (identificador_cliente < clientes_.size())
+	vector<IdentificadorDeCliente> eliminados;
+	shared_ptr<const Particion> clientes = atomic_load(&particiones_[particion]);
+	
+	//Si la difusión es un latido, se envía a cada cliente que recibe los eventos con secuencia, indicando el
+	//último evento tratado para él: todos los anteriores le han sido ya enviados, en orden, o publicados en el
+	//grupo si los recibe por multidifusión, de forma que pueda detectar la pérdida de los últimos datagramas
+	if (!difusion.mensaje)
 	{
-		//Si es así, se pide al cliente especificado que termine su conexión
-		clientes_[identificador_cliente].terminarConexion();
+		for (unsigned int i = 0; i < clientes->size(); ++i)
+		{
+			Cliente& cliente = *(*clientes)[i].second;
+			cliente.bloquear();
+			if (cliente.obtener_secuenciado())
+			{
+				string latido = to_string(cliente.obtener_cursor()) + '\0' + '\0' + "latido" + '\0' +
+					to_string(segundos_latido_) + '\0';
+				shared_ptr<Mensaje> mensaje = make_shared<Mensaje> (&latido[0], latido.length());
+				if (!cliente.enviar(Codificador::codificar(mensaje, cliente.obtener_formato())))
+					eliminados.push_back((*clientes)[i].first);
+			}
+			cliente.desbloquear();
+		}
+		if (!eliminados.empty()) eliminarClientes(eliminados);
+		return;
+	}
+	
+	int filtro;
+	const vector<bool>& pasan = *difusion.pasan;
+	unsigned long long secuencia = difusion.secuencia;
+	
+	//Los clientes se agrupan por el formato en que reciben el evento: cada formato se obtiene para el primer
+	//cliente que lo necesita, y el resto lo comparte. Los que no reciben la secuencia usan el de texto, y los
+	//que no entienden el origen de los eventos reenviados, la variante de cada formato sin él
+	vector<shared_ptr<Mensaje>> codificados (2 * Codificador::NUMERO_DE_FORMATOS);
+	
+	//Se recorre la versión vigente de la partición enviando el evento a aquellos clientes cuyo filtro lo deja
+	//pasar y que no lo hayan tratado ya (por ser anterior a su conexión o habérseles enviado desde el anillo)
+	for (unsigned int i = 0; i < clientes->size(); ++i)
+	{
+		Cliente& cliente = *(*clientes)[i].second;
+		cliente.bloquear();
+		if (secuencia <= cliente.obtener_cursor())
+		{
+			cliente.desbloquear();
+			continue;
+		}
+		
+		//A los que todavía deciden cómo recibirlos se les retiene, sin avanzar su cursor, pues el anillo puede no
+		//conservarlo hasta que decidan (si no existe o la ráfaga no cabe en él). Si lo retenido ya no cabe en su
+		//cola, se termina su espera como si se hubiera agotado
+		if (cliente.obtener_en_espera())
+		{
+			if (!cliente.retener(secuencia, difusion.mensaje) && !entregarRetenidos(cliente))
+				eliminados.push_back((*clientes)[i].first);
+			cliente.desbloquear();
+			continue;
+		}
+		
+		//A los clientes que lo reciben por multidifusión, o que sólo reflejan ficheros en crudo, no se les envía,
+		//pero se considera tratado
+		if (cliente.obtener_multidifusion() || cliente.obtener_crudo())
+		{
+			cliente.establecer_cursor(secuencia);
+			cliente.desbloquear();
+			continue;
+		}
+		filtro = cliente.obtener_filtro();
+		bool pasa = (filtro < 0) || (filtro >= (int) pasan.size()) || pasan[filtro];
+		unsigned int formato = cliente.obtener_secuenciado() ? cliente.obtener_formato() : Codificador::FORMATO_TEXTO;
+		unsigned int variante = formato + (cliente.obtener_origenes() ? 0 : Codificador::NUMERO_DE_FORMATOS);
+		if (pasa && !codificados[variante])
+			codificados[variante] = Codificador::codificar(difusion.mensaje, formato, cliente.obtener_origenes());
+		
+		//A los clientes con control de flujo sólo se les envía el evento si no tienen otros pendientes y cabe
+		//en su ventana. En caso contrario se le enviará desde el anillo cuando confirme los anteriores
+		if (cliente.obtener_confirmando())
+		{
+			if ((cliente.obtener_cursor() + 1 != secuencia) ||
+				(pasa && !cliente.cabeEnVentana(codificados[variante]->obtener_longitud(), VENTANA_)))
+			{
+				cliente.desbloquear();
+				continue;
+			}
+			if (pasa) cliente.anotarEnvio(secuencia, codificados[variante]->obtener_longitud());
+		}
+		cliente.establecer_cursor(secuencia);
 		
-		//A continuación, se copia el último de la lista a la posición del que se quiere eliminar, y se
-		//elimina el último
-		clientes_[identificador_cliente] = move(clientes_.back());
-		clientes_.pop_back();
+		//Si el envío falla, se asume que la conexión se ha perdido y se eliminará el cliente
+		if (pasa && !cliente.enviar(codificados[variante])) eliminados.push_back((*clientes)[i].first);
+		cliente.desbloquear();
+	}
+	
+	//Se eliminan los clientes cuya conexión ha fallado
+	if (!eliminados.empty()) eliminarClientes(eliminados);
+}
+
+bool TablaDeClientes::establecerFiltro (const IdentificadorDeCliente identificador_cliente, const std::string& reglas)
+{
+	//Se interpretan las reglas y se registran en el motor antes de adquirir ningún mutex, pues compilar sus
+	//expresiones regulares puede ser costoso. Si las reglas no son válidas, el cliente conserva su filtro
+	//previo; si no contienen ninguna regla evaluable en el servidor, se le enviarán todos los eventos
+	Filtro filtro;
+	if (!filtro.inicializar(reglas)) return false;
+	int identificador = -1;
+	if (!filtro.estaVacio())
+	{
+		identificador = motor_.registrarFiltro(filtro);
+		if (identificador < 0) return false;
+	}
+	
+	//Se busca el cliente. Si ya no existe, el filtro registrado no llega a utilizarse
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente)
+	{
+		motor_.retirarFiltro(identificador);
+		return false;
+	}
+	
+	//Se le asigna el filtro, retirando el que tuviera
+	cliente->bloquear();
+	motor_.retirarFiltro(cliente->obtener_filtro());
+	cliente->establecer_filtro(identificador);
+	cliente->establecer_reglas(reglas);
+	cliente->desbloquear();
+	
+	//Se devuelve el resultado de la operación
+	return true;
+}
+
+bool TablaDeClientes::establecerFormato (const IdentificadorDeCliente identificador_cliente, const std::string& formato)
+{
+	//Se interpreta el nombre del formato
+	unsigned int nuevo_formato;
+	if (!Codificador::interpretarFormato(formato, nuevo_formato)) return false;
+	
+	//Se busca el cliente, que todavía no debe recibir los eventos con su secuencia
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente) return false;
+	cliente->bloquear();
+	bool establecido = !cliente->obtener_secuenciado();
+	if (establecido) cliente->establecer_formato(nuevo_formato);
+	cliente->desbloquear();
+	
+	//Se devuelve el resultado de la operación
+	return establecido;
+}
+
+bool TablaDeClientes::reanudarCliente (const IdentificadorDeCliente identificador_cliente, const std::string& posicion)
+{
+	//Se interpreta la posición del cliente, "instancia:secuencia". Si corresponde a una ejecución anterior
+	//del servidor, el cliente se ha perdido todos los eventos de la actual
+	bool reenviar = false;
+	unsigned long long ultima_recibida = 0;
+	if (!posicion.empty())
+	{
+		size_t separador = posicion.rfind(':');
+		if ((separador == string::npos) || (separador + 1 == posicion.length()) ||
+			(posicion.find_first_not_of("0123456789", separador + 1) != string::npos)) return false;
+		reenviar = true;
+		if (posicion.compare(0, separador, instancia_) == 0)
+			ultima_recibida = strtoull(&posicion[separador + 1], nullptr, 10);
+	}
+	
+	//Se busca el cliente, que no debe haberlo solicitado antes
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	if (cliente.obtener_secuenciado() || cliente.obtener_crudo())
+	{
+		cliente.desbloquear();
+		return false;
+	}
+	
+	//Se toman del anillo, con su mutex adquirido, los eventos conservados que el cliente no ha recibido: los
+	//posteriores al último recibido hasta su nueva posición. Ésta es su conexión actual y, si todavía se
+	//esperaba su decisión, el último evento difundido, pues los posteriores a su conexión se le han retenido:
+	//los ya tratados para él, desde lo retenido, y el resto desde el anillo. Si la espera se ha agotado, éstos
+	//ya los ha recibido en el formato antiguo
+	vector<pair<unsigned long long, shared_ptr<Mensaje>>> retenidos;
+	if (cliente.obtener_en_espera()) retenidos = cliente.tomarRetenidos();
+	vector<shared_ptr<Mensaje>> conservados;
+	mutex_anillo_.lock();
+	unsigned long long hasta = cliente.obtener_secuencia_de_alta();
+	if (cliente.obtener_en_espera()) hasta = retenidos.empty() ? anillo_.obtener_ultima() : retenidos.front().first - 1;
+	unsigned long long desde = reenviar ? ultima_recibida + 1 : cliente.obtener_secuencia_de_alta() + 1;
+	unsigned long long secuencia = desde;
+	if (secuencia < anillo_.obtener_primera()) secuencia = anillo_.obtener_primera();
+	for (; secuencia <= hasta; ++secuencia)
+	{
+		shared_ptr<Mensaje> mensaje = anillo_.obtener(secuencia);
+		if (mensaje) conservados.push_back(move(mensaje));
+	}
+	mutex_anillo_.unlock();
+	for (unsigned int i = 0; i < retenidos.size(); ++i)
+		if (retenidos[i].first >= desde) conservados.push_back(move(retenidos[i].second));
+	if (!retenidos.empty()) hasta = retenidos.back().first;
+	if (hasta > cliente.obtener_cursor()) cliente.establecer_cursor(hasta);
+	cliente.establecer_en_espera(false);
+	
+	//Se compone el evento de control que indica al cliente el cambio de formato y su nueva posición, al que
+	//siguen los eventos que su filtro deja pasar, que se evalúan tras liberar el anillo
+	string posicion_actual = instancia_ + ":" + to_string(hasta);
+	string control = string("") + '\0' + "reanudar" + '\0' + posicion_actual + '\0';
+	shared_ptr<Mensaje> reanudacion = make_shared<Mensaje> (&control[0], control.length());
+	vector<shared_ptr<Mensaje>> mensajes;
+	for (unsigned int i = 0; i < conservados.size(); ++i)
+		if (dejaPasar(cliente, *conservados[i])) mensajes.push_back(move(conservados[i]));
+	
+	//Si los eventos se difunden también por multidifusión, se anuncia el grupo al cliente, ya en el formato
+	//con secuencia
+	if (!multidifusion_.empty())
+	{
+		control = to_string(hasta) + '\0' + '\0' + "multidifusion" + '\0' + multidifusion_ + '\0';
+		mensajes.push_back(make_shared<Mensaje> (&control[0], control.length()));
+	}
+	
+	//Si el servidor es un repetidor, se indica al cliente para que no le aplique las reglas de su filtro que
+	//dependen del remitente, que ahora es el origen de cada evento
+	if (repetidor_)
+	{
+		control = to_string(hasta) + '\0' + '\0' + "repetidor" + '\0' + '\0';
+		mensajes.push_back(make_shared<Mensaje> (&control[0], control.length()));
+	}
+	
+	//Se envía el evento de control en el formato antiguo y después todo lo demás, ya en el formato que incluye
+	//la secuencia, codificado en el del cliente. Si falla, se elimina el cliente
+	for (unsigned int i = 0; i < mensajes.size(); ++i)
+		mensajes[i] = Codificador::codificar(mensajes[i], cliente.obtener_formato(), cliente.obtener_origenes());
+	bool reanudado = cliente.enviar(reanudacion);
+	cliente.establecer_secuenciado(true);
+	reanudado = reanudado && (mensajes.empty() || cliente.reenviar(mensajes));
+	cliente.desbloquear();
+	if (!reanudado) eliminarCliente(identificador_cliente);
+	
+	//Se devuelve el resultado de la operación
+	return reanudado;
+}
+
+bool TablaDeClientes::terminarEspera (const IdentificadorDeCliente identificador_cliente)
+{
+	//Se busca el cliente, que debe seguir esperando
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return true;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	bool enviado = !cliente.obtener_en_espera() || entregarRetenidos(cliente);
+	cliente.desbloquear();
+	
+	//Si el envío falla, se elimina el cliente
+	if (!enviado) eliminarCliente(identificador_cliente);
+	return enviado;
+}
+
+bool TablaDeClientes::entregarRetenidos (Cliente& cliente)
+{
+	//Se toman los eventos retenidos para el cliente y, si no hay, los retenidos en el anillo que todavía se
+	//conservan (los de un cliente traspasado en un relevo, por ejemplo). Los posteriores se le enviarán
+	//directamente, pues su cursor queda en el último tomado
+	vector<pair<unsigned long long, shared_ptr<Mensaje>>> retenidos = cliente.tomarRetenidos();
+	vector<shared_ptr<Mensaje>> conservados;
+	mutex_anillo_.lock();
+	unsigned long long secuencia = cliente.obtener_secuencia_de_alta() + 1;
+	unsigned long long ultima = retenidos.empty() ? anillo_.obtener_ultima() : retenidos.front().first - 1;
+	if (secuencia < anillo_.obtener_primera()) secuencia = anillo_.obtener_primera();
+	for (; secuencia <= ultima; ++secuencia)
+	{
+		shared_ptr<Mensaje> mensaje = anillo_.obtener(secuencia);
+		if (mensaje) conservados.push_back(move(mensaje));
+	}
+	mutex_anillo_.unlock();
+	for (unsigned int i = 0; i < retenidos.size(); ++i) conservados.push_back(move(retenidos[i].second));
+	if (!retenidos.empty()) ultima = retenidos.back().first;
+	if (ultima > cliente.obtener_cursor()) cliente.establecer_cursor(ultima);
+	cliente.establecer_en_espera(false);
+	
+	//Y se le envían, sin cabecera, los que su filtro deja pasar
+	vector<shared_ptr<Mensaje>> mensajes;
+	for (unsigned int i = 0; i < conservados.size(); ++i)
+		if (dejaPasar(cliente, *conservados[i]))
+			mensajes.push_back(Codificador::codificar(	conservados[i], Codificador::FORMATO_TEXTO,
+														cliente.obtener_origenes()	));
+	return mensajes.empty() || cliente.reenviar(mensajes);
+}
+
+bool TablaDeClientes::confirmarCliente (	const IdentificadorDeCliente identificador_cliente,
+										const std::string& secuencia	)
+{
+	//Se interpreta el número de secuencia confirmado
+	if (secuencia.empty() || (secuencia.find_first_not_of("0123456789") != string::npos)) return false;
+	unsigned long long confirmada = strtoull(&secuencia[0], nullptr, 10);
+	
+	//Se busca el cliente, que debe recibir los eventos con su secuencia
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	if (!cliente.obtener_secuenciado())
+	{
+		cliente.desbloquear();
+		return false;
+	}
+	
+	//Con la primera confirmación comienza el control de flujo del cliente; hasta entonces se le han enviado
+	//directamente todos los eventos, por lo que su cursor está al día
+	cliente.confirmar(confirmada);
+	
+	//A un cliente que recibe los eventos por multidifusión no se le envía nada más por su conexión
+	if (cliente.obtener_multidifusion())
+	{
+		cliente.desbloquear();
+		return true;
+	}
+	
+	//Se toman del anillo los eventos pendientes que todavía se conservan; los que ya no se conservan se han
+	//perdido y se saltan
+	vector<pair<unsigned long long, shared_ptr<Mensaje>>> pendientes;
+	mutex_anillo_.lock();
+	unsigned long long siguiente = cliente.obtener_cursor() + 1;
+	unsigned long long ultima = anillo_.obtener_ultima();
+	for (; siguiente <= ultima; ++siguiente)
+	{
+		shared_ptr<Mensaje> mensaje = anillo_.obtener(siguiente);
+		if (mensaje) pendientes.push_back(make_pair(siguiente, move(mensaje)));
+	}
+	mutex_anillo_.unlock();
+	
+	//Y se envían al cliente, directamente desde el anillo y en su formato, los que ahora caben en su ventana
+	vector<shared_ptr<Mensaje>> mensajes;
+	bool lleno = false;
+	for (unsigned int i = 0; i < pendientes.size(); ++i)
+	{
+		if (dejaPasar(cliente, *pendientes[i].second))
+		{
+			shared_ptr<Mensaje> mensaje = Codificador::codificar(	pendientes[i].second, cliente.obtener_formato(),
+																	cliente.obtener_origenes()	);
+			lleno = !cliente.cabeEnVentana(mensaje->obtener_longitud(), VENTANA_);
+			if (lleno) break;
+			cliente.anotarEnvio(pendientes[i].first, mensaje->obtener_longitud());
+			mensajes.push_back(move(mensaje));
+		}
+		cliente.establecer_cursor(pendientes[i].first);
+	}
+	if (!lleno && (ultima > cliente.obtener_cursor())) cliente.establecer_cursor(ultima);
+	
+	//Si el envío falla, se elimina el cliente
+	bool confirmado = mensajes.empty() || cliente.reenviar(mensajes);
+	cliente.desbloquear();
+	if (!confirmado) eliminarCliente(identificador_cliente);
+	
+	//Se devuelve el resultado de la operación
+	return confirmado;
+}
+
+bool TablaDeClientes::activarMultidifusion (const IdentificadorDeCliente identificador_cliente)
+{
+	if (multidifusion_.empty()) return false;
+	
+	//Se busca el cliente, que debe recibir los eventos con su secuencia
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	bool activado = cliente.obtener_secuenciado();
+	
+	//Los eventos que estuvieran pendientes por control de flujo tampoco se le enviarán ya por su conexión: el
+	//cliente los detectará perdidos al recibir el siguiente datagrama y solicitará su reparación
+	if (activado) cliente.establecer_multidifusion(true);
+	cliente.desbloquear();
+	return activado;
+}
+
+bool TablaDeClientes::aceptarOrigenes (const IdentificadorDeCliente identificador_cliente)
+{
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	sp_cliente->bloquear();
+	sp_cliente->establecer_origenes(true);
+	sp_cliente->desbloquear();
+	return true;
+}
+
+bool TablaDeClientes::repararCliente (const IdentificadorDeCliente identificador_cliente, const std::string& rango)
+{
+	//Se interpreta el rango de eventos perdidos, "desde:hasta"
+	size_t separador = rango.find(':');
+	if ((separador == string::npos) || (separador == 0) || (separador + 1 == rango.length()) ||
+		(rango.find_first_not_of("0123456789:") != string::npos) ||
+		(rango.find(':', separador + 1) != string::npos)) return false;
+	unsigned long long desde = strtoull(&rango[0], nullptr, 10);
+	unsigned long long hasta = strtoull(&rango[separador + 1], nullptr, 10);
+	if ((desde == 0) || (desde > hasta)) return false;
+	
+	//Se busca el cliente, que debe recibir los eventos por multidifusión
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	if (!cliente.obtener_multidifusion())
+	{
+		cliente.desbloquear();
+		return false;
+	}
+	
+	//Se toman del anillo los eventos del rango que todavía se conservan. El rango no puede ir más allá del
+	//último evento difundido
+	vector<shared_ptr<Mensaje>> conservados;
+	mutex_anillo_.lock();
+	unsigned long long ultima = anillo_.obtener_ultima();
+	if (hasta > ultima) hasta = ultima;
+	unsigned long long secuencia = anillo_.obtener_primera();
+	if (secuencia < desde) secuencia = desde;
+	for (; secuencia <= hasta; ++secuencia)
+	{
+		shared_ptr<Mensaje> mensaje = anillo_.obtener(secuencia);
+		if (mensaje) conservados.push_back(move(mensaje));
+	}
+	mutex_anillo_.unlock();
+	
+	//Se reenvían los que su filtro deja pasar, seguidos del evento de control que cierra la reparación
+	vector<shared_ptr<Mensaje>> mensajes;
+	for (unsigned int i = 0; i < conservados.size(); ++i)
+		if (dejaPasar(cliente, *conservados[i]))
+			mensajes.push_back(Codificador::codificar(	conservados[i], cliente.obtener_formato(),
+														cliente.obtener_origenes()	));
+	string control = to_string(hasta) + '\0' + '\0' + "reparado" + '\0' + '\0';
+	mensajes.push_back(Codificador::codificar(make_shared<Mensaje> (&control[0], control.length()),
+		cliente.obtener_formato()));
+	
+	//Si el envío falla, se elimina el cliente
+	bool reparado = cliente.enviar(mensajes);
+	cliente.desbloquear();
+	if (!reparado) eliminarCliente(identificador_cliente);
+	
+	//Se devuelve el resultado de la operación
+	return reparado;
+}
+
+bool TablaDeClientes::reflejarFichero (const IdentificadorDeCliente identificador_cliente, const std::string& ruta)
+{
+	//Se busca el cliente, que no debe recibir eventos de control
+	if (ruta.empty()) return false;
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente) return false;
+	cliente->bloquear();
+	bool reflejado = !cliente->obtener_secuenciado();
+	if (reflejado)
+	{
+		if (!cliente->obtener_crudo()) ++clientes_en_crudo_;
+		cliente->anadirReflejo(ruta);
+		cliente->establecer_en_espera(false);
+	}
+	cliente->desbloquear();
+	
+	//Se devuelve el resultado de la operación
+	return reflejado;
+}
+
+void TablaDeClientes::reflejar (	const std::string& ruta,
+								const std::string& rutaAbsoluta,
+								const long long desde,
+								const long long hasta	)
+{
+	//Si ningún cliente refleja ficheros, no hay nada que hacer
+	if ((clientes_en_crudo_ == 0) || (hasta <= desde)) return;
+	
+	//El fichero se abre una sola vez para todos los clientes, y se cierra cuando terminan todos sus envíos
+	int descriptor = open(rutaAbsoluta.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0) return;
+	shared_ptr<const int> fichero (new int (descriptor), [] (const int *d) { close(*d); delete d; });
+	shared_ptr<const string> ruta_tramas = make_shared<const string>(ruta);
+	
+	//Se componen las cabeceras de las tramas en que se divide el rango, comunes a todos los clientes
+	vector<pair<long long, string>> tramas;
+	for (long long posicion = desde; posicion < hasta; posicion = posicion + BYTES_POR_TRAMA_CRUDA_)
+	{
+		unsigned int longitud = (hasta - posicion < (long long) BYTES_POR_TRAMA_CRUDA_) ?
+			hasta - posicion : BYTES_POR_TRAMA_CRUDA_;
+		tramas.push_back(make_pair(posicion, Codificador::generarCabeceraCruda(ruta, posicion, longitud)));
+	}
+	
+	//Se recorre la versión vigente de la lista de clientes enviando las tramas a los que reflejan el fichero
+	vector<IdentificadorDeCliente> eliminados;
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
+	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		if (cliente.reflejaFichero(ruta) && !cliente.enviarFichero(ruta_tramas, tramas, fichero, hasta))
+			eliminados.push_back(clientes->obtener_llave(i));
+		cliente.desbloquear();
+	}
+	
+	//Se eliminan los clientes cuya conexión ha fallado
+	if (!eliminados.empty()) eliminarClientes(eliminados);
+}
+
+bool TablaDeClientes::enviarContadores (const IdentificadorDeCliente identificador_cliente)
+{
+	//Se obtienen los contadores antes de adquirir ningún mutex
+	string contadores = contadores_ ? contadores_() : "";
+	
+	//Se busca el cliente, que debe recibir los eventos con su secuencia para entender el evento de control
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	if (!cliente.obtener_secuenciado())
+	{
+		cliente.desbloquear();
+		return false;
+	}
+	
+	//Se envía el evento de control en el formato del cliente. Si el envío falla, se elimina el cliente
+	string control = to_string(cliente.obtener_multidifusion() ? 0 : cliente.obtener_cursor()) + '\0' + '\0' +
+		"contadores" + '\0' + contadores + '\0';
+	bool enviado = cliente.enviar(Codificador::codificar(make_shared<Mensaje> (&control[0], control.length()),
+		cliente.obtener_formato()));
+	cliente.desbloquear();
+	if (!enviado) eliminarCliente(identificador_cliente);
+	
+	//Se devuelve el resultado de la operación
+	return enviado;
+}
+
+bool TablaDeClientes::suscribirAgregado (	const IdentificadorDeCliente identificador_cliente,
+											const std::string& definicion	)
+{
+	//El agregado se registra antes de adquirir ningún mutex, pues compilar sus expresiones regulares puede ser
+	//costoso
+	if (!agregador_) return false;
+	int identificador = -1;
+	if (!definicion.empty())
+	{
+		identificador = agregador_->registrar(definicion);
+		if (identificador < 0) return false;
+	}
+	
+	//Se busca el cliente. Si ya no existe, el agregado registrado no llega a utilizarse
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente)
+	{
+		agregador_->retirar(identificador);
+		return false;
+	}
+	
+	//Se le suscribe al agregado o, si la definición está vacía, se anulan sus suscripciones
+	cliente->bloquear();
+	if (definicion.empty()) retirarAgregados(*cliente);
+	else cliente->anadirAgregado(identificador, definicion);
+	cliente->desbloquear();
+	
+	//Se devuelve el resultado de la operación
+	return true;
+}
+
+void TablaDeClientes::enviarMetricas (const std::vector<AgregadorDeMetricas::Medida>& medidas)
+{
+	if (medidas.empty()) return;
+	vector<IdentificadorDeCliente> eliminados;
+	
+	//Se recorre la versión vigente de la lista, enviando a cada cliente suscrito, en un único envío, un evento
+	//de control por cada medida de sus agregados
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
+	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		vector<pair<int, string>> agregados = cliente.obtener_agregados();
+		vector<shared_ptr<Mensaje>> mensajes;
+		for (unsigned int j = 0; (j < agregados.size()) && cliente.obtener_secuenciado(); ++j)
+			for (unsigned int k = 0; k < medidas.size(); ++k)
+			{
+				if (agregados[j].first != (int) medidas[k].agregado) continue;
+				string control = to_string(cliente.obtener_multidifusion() ? 0 : cliente.obtener_cursor()) + '\0' +
+					'\0' + "metrica" + '\0' + to_string(j) + ' ' + to_string(medidas[k].lineas) + ' ' +
+					to_string(medidas[k].fin) + ' ' + to_string(medidas[k].segundos) + '\0';
+				mensajes.push_back(Codificador::codificar(make_shared<Mensaje> (&control[0], control.length()),
+					cliente.obtener_formato()));
+			}
+		if (!mensajes.empty() && !cliente.enviar(mensajes)) eliminados.push_back(clientes->obtener_llave(i));
+		cliente.desbloquear();
+	}
+	
+	//Se eliminan los clientes cuya conexión ha fallado
+	if (!eliminados.empty()) eliminarClientes(eliminados);
+}
+
+bool TablaDeClientes::establecerResumen (	const IdentificadorDeCliente identificador_cliente,
+											const std::string& argumento	)
+{
+	//Se busca el cliente, que debe recibir los eventos con su secuencia para entender los eventos de control
+	if (!minador_ || ((argumento != "1") && (argumento != "0"))) return false;
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente) return false;
+	cliente->bloquear();
+	bool establecido = cliente->obtener_secuenciado();
+	
+	//Sólo se anota un usuario del minador cuando el cliente pasa a recibir los resúmenes, y sólo se retira
+	//cuando deja de hacerlo
+	bool resumido = (argumento == "1");
+	if (establecido && (resumido != cliente->obtener_resumido()))
+	{
+		if (resumido) minador_->activar();
+		else minador_->desactivar();
+		cliente->establecer_resumido(resumido);
+	}
+	cliente->desbloquear();
+	
+	//Se devuelve el resultado de la operación
+	return establecido;
+}
+
+bool TablaDeClientes::enviarPlantillas (const IdentificadorDeCliente identificador_cliente)
+{
+	//Se obtiene la tabla de plantillas antes de adquirir ningún mutex
+	if (!minador_) return false;
+	vector<MinadorDePlantillas::Plantilla> plantillas = minador_->consultar();
+	
+	//Se busca el cliente, que debe recibir los eventos con su secuencia para entender los eventos de control
+	shared_ptr<Cliente> sp_cliente = buscarCliente(identificador_cliente);
+	if (!sp_cliente) return false;
+	Cliente& cliente = *sp_cliente;
+	cliente.bloquear();
+	if (!cliente.obtener_secuenciado())
+	{
+		cliente.desbloquear();
+		return false;
+	}
+	
+	//Se envía un evento de control por plantilla, todos en un único envío. Si el envío falla, se elimina el
+	//cliente
+	vector<shared_ptr<Mensaje>> mensajes;
+	for (unsigned int i = 0; i < plantillas.size(); ++i) mensajes.push_back(componerPlantilla(cliente, plantillas[i]));
+	bool enviado = mensajes.empty() || cliente.enviar(mensajes);
+	cliente.desbloquear();
+	if (!enviado) eliminarCliente(identificador_cliente);
+	
+	//Se devuelve el resultado de la operación
+	return enviado;
+}
+
+void TablaDeClientes::enviarResumen (const std::vector<MinadorDePlantillas::Plantilla>& plantillas)
+{
+	if (plantillas.empty()) return;
+	vector<IdentificadorDeCliente> eliminados;
+	
+	//Se recorre la versión vigente de la lista, enviando a cada cliente que recibe los resúmenes, en un único
+	//envío, un evento de control por cada plantilla
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
+	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		if (cliente.obtener_resumido())
+		{
+			vector<shared_ptr<Mensaje>> mensajes;
+			for (unsigned int j = 0; j < plantillas.size(); ++j)
+				mensajes.push_back(componerPlantilla(cliente, plantillas[j]));
+			if (!cliente.enviar(mensajes)) eliminados.push_back(clientes->obtener_llave(i));
+		}
+		cliente.desbloquear();
+	}
+	
+	//Se eliminan los clientes cuya conexión ha fallado
+	if (!eliminados.empty()) eliminarClientes(eliminados);
+}
+
+void TablaDeClientes::anotarOrdenPendiente (	const IdentificadorDeCliente identificador_cliente,
+											const std::string& ordenPendiente,
+											const bool latiendo	)
+{
+	shared_ptr<Cliente> cliente = buscarCliente(identificador_cliente);
+	if (!cliente) return;
+	cliente->bloquear();
+	cliente->anotarOrdenPendiente(ordenPendiente, latiendo);
+	cliente->desbloquear();
+}
+
+bool TablaDeClientes::exportarEstado (Relevo::Estado& estado, const unsigned int segundos)
+{
+	//Se espera a que cada trabajador haya tratado todas las difusiones encoladas
+	chrono::steady_clock::time_point limite = chrono::steady_clock::now() + chrono::seconds(segundos);
+	for (unsigned int i = 0; i < trabajadores_.size(); ++i)
+		while (!trabajadores_[i]->estaInactivo())
+		{
+			if (chrono::steady_clock::now() > limite) return false;
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	
+	//Se copian los eventos conservados, con su cabecera, en orden de secuencia
+	estado.conservados.clear();
+	mutex_anillo_.lock();
+	for (unsigned long long secuencia = anillo_.obtener_primera(); secuencia <= anillo_.obtener_ultima(); ++secuencia)
+	{
+		shared_ptr<Mensaje> mensaje = anillo_.obtener(secuencia);
+		if (mensaje)
+			estado.conservados.push_back(make_pair(secuencia,
+				string(mensaje->obtener_inicio(), mensaje->obtener_longitud())));
+	}
+	mutex_anillo_.unlock();
+	
+	//Se anota cada cliente una vez terminados sus envíos, de forma que su conexión pueda continuar exactamente
+	//donde la deja este proceso. Los que han perdido la conexión no se traspasan, pero si los envíos de alguno
+	//no terminan a tiempo, el relevo falla en lugar de perderlo
+	estado.clientes.clear();
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	for (unsigned int i = 0; i < clientes->tamano(); ++i)
+	{
+		Cliente& cliente = *clientes->obtener_elemento(i);
+		cliente.bloquear();
+		bool enviado = (cliente.obtener_descriptor() >= 0) && cliente.esperarEnvios(limite);
+		if (!enviado && (cliente.obtener_descriptor() >= 0) && (chrono::steady_clock::now() >= limite))
+		{
+			cliente.desbloquear();
+			estado.clientes.clear();
+			return false;
+		}
+		if (enviado)
+		{
+			Relevo::ClienteRelevado relevado;
+			relevado.descriptor = cliente.obtener_descriptor();
+			relevado.reglas = cliente.obtener_reglas();
+			relevado.secuenciado = cliente.obtener_secuenciado();
+			relevado.formato = cliente.obtener_formato();
+			relevado.multidifusion = cliente.obtener_multidifusion();
+			relevado.origenes = cliente.obtener_origenes();
+			relevado.confirmando = cliente.obtener_confirmando();
+			relevado.secuencia_de_alta = cliente.obtener_secuencia_de_alta();
+			relevado.cursor = cliente.obtener_cursor();
+			relevado.orden_pendiente = cliente.obtener_orden_pendiente();
+			relevado.latiendo = cliente.obtener_latiendo();
+			relevado.reflejados = cliente.obtener_reflejados();
+			vector<pair<int, string>> agregados = cliente.obtener_agregados();
+			for (unsigned int j = 0; j < agregados.size(); ++j) relevado.agregados.push_back(agregados[j].second);
+			relevado.resumido = cliente.obtener_resumido();
+			estado.clientes.push_back(move(relevado));
+		}
+		cliente.desbloquear();
+	}
+	return true;
+}
+
+std::vector<TablaDeClientes::IdentificadorDeCliente> TablaDeClientes::restaurarEstado (const Relevo::Estado& estado)
+{
+	//Se restauran los eventos conservados, que continúan la numeración del proceso saliente. La cabecera de
+	//cada uno es su número de secuencia
+	mutex_anillo_.lock();
+	anillo_.reiniciar(estado.conservados.empty() ? estado.secuencia : estado.conservados.front().first - 1);
+	for (unsigned int i = 0; i < estado.conservados.size(); ++i)
+	{
+		const string& contenido = estado.conservados[i].second;
+		anillo_.anadir(estado.conservados[i].first, make_shared<Mensaje> (contenido.data(), contenido.length(),
+			to_string(estado.conservados[i].first).length() + 1));
+	}
+	if (anillo_.obtener_ultima() < estado.secuencia) anillo_.reiniciar(estado.secuencia);
+	mutex_anillo_.unlock();
+	
+	//Se crean los clientes con el estado que tenían, y se publican todos en una nueva versión de la lista. Los
+	//que no han decidido cómo recibir los eventos vuelven a esperar su decisión, que puede estar en camino, a
+	//partir de los que ya han recibido
+	vector<shared_ptr<Cliente>> nuevos_clientes;
+	for (unsigned int i = 0; i < estado.clientes.size(); ++i)
+	{
+		const Relevo::ClienteRelevado& relevado = estado.clientes[i];
+		shared_ptr<Cliente> cliente = make_shared<Cliente>(relevado.descriptor);
+		cliente->establecer_secuenciado(relevado.secuenciado);
+		cliente->establecer_formato(relevado.formato);
+		cliente->establecer_multidifusion(relevado.multidifusion);
+		cliente->establecer_origenes(relevado.origenes);
+		cliente->establecer_secuencia_de_alta(relevado.secuencia_de_alta);
+		cliente->establecer_cursor(relevado.cursor);
+		if (relevado.confirmando) cliente->confirmar(relevado.cursor);
+		for (unsigned int j = 0; j < relevado.reflejados.size(); ++j) cliente->anadirReflejo(relevado.reflejados[j]);
+		if (cliente->obtener_crudo()) ++clientes_en_crudo_;
+		else if (!relevado.secuenciado)
+		{
+			if (relevado.cursor > relevado.secuencia_de_alta) cliente->establecer_secuencia_de_alta(relevado.cursor);
+			cliente->establecer_en_espera(true);
+		}
+		nuevos_clientes.push_back(move(cliente));
+	}
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	vector<IdentificadorDeCliente> identificadores;
+	shared_ptr<MapaDeRanuras<shared_ptr<Cliente>>> clientes =
+		make_shared<MapaDeRanuras<shared_ptr<Cliente>>>(*atomic_load(&clientes_));
+	for (unsigned int i = 0; i < nuevos_clientes.size(); ++i)
+	{
+		identificadores.push_back(clientes->insertar(nuevos_clientes[i]));
+		asignarTrabajador(*nuevos_clientes[i], identificadores.back());
 	}
+	repartir(*clientes);
+	atomic_store(&clientes_, shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>>(move(clientes)));
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	//Por último se vuelven a registrar los filtros de los clientes a partir de sus reglas, y sus agregados, en el
+	//mismo orden, y se reanudan sus resúmenes. Las ventanas de los agregados comienzan de nuevo, y las plantillas
+	//conocidas no se traspasan
+	for (unsigned int i = 0; i < estado.clientes.size(); ++i)
+	{
+		if (!estado.clientes[i].reglas.empty()) establecerFiltro(identificadores[i], estado.clientes[i].reglas);
+		for (unsigned int j = 0; j < estado.clientes[i].agregados.size(); ++j)
+			suscribirAgregado(identificadores[i], estado.clientes[i].agregados[j]);
+		if (estado.clientes[i].resumido) establecerResumen(identificadores[i], "1");
+	}
+	
+	//Se devuelven los identificadores obtenidos
+	return identificadores;
+}
+
+void TablaDeClientes::repartir (const MapaDeRanuras<std::shared_ptr<Cliente>>& clientes)
+{
+	//Cada cliente pertenece a la partición que corresponde a su ranura, fija mientras existe
+	vector<shared_ptr<Particion>> particiones;
+	for (unsigned int i = 0; i < particiones_.size(); ++i) particiones.push_back(make_shared<Particion>());
+	for (unsigned int i = 0; i < clientes.tamano(); ++i)
+	{
+		IdentificadorDeCliente identificador = clientes.obtener_llave(i);
+		unsigned int particion = MapaDeRanuras<shared_ptr<Cliente>>::obtener_ranura(identificador) % particiones.size();
+		particiones[particion]->push_back(make_pair(identificador, clientes.obtener_elemento(i)));
+	}
+	
+	//Se publica la nueva versión de cada partición
+	for (unsigned int i = 0; i < particiones.size(); ++i)
+		atomic_store(&particiones_[i], shared_ptr<const Particion>(move(particiones[i])));
+}
+
+void TablaDeClientes::asignarTrabajador (Cliente& cliente, const IdentificadorDeCliente identificador_cliente)
+{
+	//El cliente pertenece a la partición de su ranura (ver repartir), cuyo trabajador continúa sus envíos
+	unsigned int ranura = MapaDeRanuras<shared_ptr<Cliente>>::obtener_ranura(identificador_cliente);
+	TrabajadorDeDifusion *trabajador = trabajadores_[ranura % trabajadores_.size()].get();
+	cliente.establecer_aviso([trabajador] { trabajador->despertar(); });
+}
+
+void TablaDeClientes::continuarEnvios (const unsigned int particion, std::vector<int>& pendientes)
+{
+	vector<IdentificadorDeCliente> eliminados;
+	shared_ptr<const Particion> clientes = atomic_load(&particiones_[particion]);
+	
+	//Sólo se adquiere el mutex de los clientes con envíos pendientes. Se eliminan aquellos cuya conexión ha
+	//fallado, y se anota el socket de los que todavía tienen envíos pendientes
+	for (unsigned int i = 0; i < clientes->size(); ++i)
+	{
+		Cliente& cliente = *(*clientes)[i].second;
+		if (!cliente.obtener_envios_pendientes()) continue;
+		cliente.bloquear();
+		if (!cliente.continuarEnvios()) eliminados.push_back((*clientes)[i].first);
+		else if (cliente.obtener_envios_pendientes()) pendientes.push_back(cliente.obtener_descriptor());
+		cliente.desbloquear();
+	}
+	if (!eliminados.empty()) eliminarClientes(eliminados);
+}
+
+std::shared_ptr<Cliente> TablaDeClientes::buscarCliente (const IdentificadorDeCliente identificador_cliente)
+{
+	//Se busca la llave en la versión vigente de la lista
+	shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>> clientes = atomic_load(&clientes_);
+	const shared_ptr<Cliente> *cliente = clientes->obtener(identificador_cliente);
+	if (cliente == nullptr) return nullptr;
+	return *cliente;
+}
+
+void TablaDeClientes::eliminarClientes (const std::vector<IdentificadorDeCliente>& eliminados)
+{
+	vector<shared_ptr<Cliente>> retirados;
+	
+	//Se adquiere el mutex
+	mutex_.lock();
+	
+	//Se construye una nueva versión de la lista sin los clientes eliminados
+	shared_ptr<MapaDeRanuras<shared_ptr<Cliente>>> clientes =
+		make_shared<MapaDeRanuras<shared_ptr<Cliente>>>(*atomic_load(&clientes_));
+	for (unsigned int i = 0; i < eliminados.size(); ++i)
+	{
+		shared_ptr<Cliente> *cliente = clientes->obtener(eliminados[i]);
+		if (cliente == nullptr) continue;
+		retirados.push_back(*cliente);
+		clientes->eliminar(eliminados[i]);
+	}
+	
+	//Si alguno seguía en la lista, se publica la nueva versión
+	if (!retirados.empty())
+	{
+		repartir(*clientes);
+		atomic_store(&clientes_, shared_ptr<const MapaDeRanuras<shared_ptr<Cliente>>>(move(clientes)));
+	}
+	
+	//Se libera el mutex
+	mutex_.unlock();
+	
+	//Se retira el filtro del motor y se termina la conexión de cada cliente eliminado. Los envíos que todavía
+	//recorran una versión anterior de la lista lo encontrarán ya desconectado
+	for (unsigned int i = 0; i < retirados.size(); ++i)
+	{
+		retirados[i]->bloquear();
+		motor_.retirarFiltro(retirados[i]->obtener_filtro());
+		retirarAgregados(*retirados[i]);
+		if (retirados[i]->obtener_resumido()) minador_->desactivar();
+		if (retirados[i]->obtener_crudo()) --clientes_en_crudo_;
+		retirados[i]->terminarConexion();
+		retirados[i]->desbloquear();
+	}
+}
+
+void TablaDeClientes::retirarAgregados (Cliente& cliente)
+{
+	vector<pair<int, string>> agregados = cliente.obtener_agregados();
+	for (unsigned int i = 0; i < agregados.size(); ++i) agregador_->retirar(agregados[i].first);
+	cliente.vaciarAgregados();
+}
+
+std::shared_ptr<Mensaje> TablaDeClientes::componerPlantilla (	Cliente& cliente,
+																const MinadorDePlantillas::Plantilla& plantilla	)
+{
+	string control = to_string(cliente.obtener_multidifusion() ? 0 : cliente.obtener_cursor()) + '\0' + '\0' +
+		"plantilla" + '\0' + to_string(plantilla.identificador) + ' ' + to_string(plantilla.lineas) + ' ' +
+		to_string(plantilla.total) + ' ' + to_string(plantilla.primera) + '\n' + plantilla.fichero + '\n' +
+		plantilla.texto + '\n' + plantilla.ejemplo + '\0';
+	return Codificador::codificar(make_shared<Mensaje> (&control[0], control.length()), cliente.obtener_formato());
+}
+
+bool TablaDeClientes::dejaPasar (Cliente& cliente, Mensaje& mensaje)
+{
+	//Sin filtro, el cliente recibe todos los eventos
+	if (cliente.obtener_filtro() < 0) return true;
+	
+	//Se reconstruye el evento a partir de los campos del mensaje que siguen a la cabecera, separando de la
+	//ubicación su origen si procede de otro servidor
+	const char *nombre = mensaje.obtener_inicio() + mensaje.obtener_longitud_cabecera();
+	const char *ubicacion = nombre + strlen(nombre) + 1;
+	const char *descripcion = ubicacion + strlen(ubicacion) + 1;
+	Evento evento = Evento::recibido(nombre, ubicacion, descripcion, "");
+	return motor_.evaluar(evento, cliente.obtener_filtro());
 }
 
 } //namespace lognotify
\ No newline at end of file
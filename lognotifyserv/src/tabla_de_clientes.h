@@ -11,8 +11,20 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <utility>
+#include <chrono>
+#include <atomic>
+#include <functional>
 
 #include "cliente.h"
+#include "evento.h"
+#include "motor_de_suscripciones.h"
+#include "anillo_de_reenvio.h"
+#include "mapa_de_ranuras.h"
+#include "trabajador_de_difusion.h"
+#include "relevo.h"
+#include "agregador_de_metricas.h"
+#include "minador_de_plantillas.h"
 
 namespace lognotify
 {
@@ -22,29 +34,127 @@ namespace lognotify
 * de red. La TablaDeClientes es thread safe, permitiendo ser accedida desde distintos hilos (por ejemplo
 * para ser poblada desde un ServidorDeConexion en un hilo y enviarse mensajes a los clientes ya registrados
 * en otro) con seguridad.
+* La lista de clientes se publica como una versión inmutable que se sustituye completa en cada alta o baja
+* (copia en escritura): los envíos recorren la versión vigente sin bloquear la tabla, de forma que las altas y
+* bajas no esperan a que termine una difusión ni la difusión a ellas. Cada versión es una copia completa, por
+* lo que cada alta o baja cuesta un tiempo lineal en el número de clientes; por eso se agrupan en lotes (ver
+* anadirClientes y eliminarClientes), mientras que buscar un cliente por su identificador es de tiempo
+* constante. Cada Cliente se protege con su propio mutex, y el AnilloDeReenvio con otro, adquirido sólo
+* durante el acceso a él.
+* Los eventos difundidos a los clientes se conservan en un AnilloDeReenvio, de forma que un cliente que
+* pierde la conexión pueda, al recuperarla, solicitar los que se ha perdido (ver reanudarCliente).
+* Los clientes se reparten por su ranura entre varios TrabajadorDeDifusion, cada uno con su propia partición
+* de la lista de clientes (publicada también por copia en escritura): cada evento se serializa y se evalúa
+* frente a los filtros una sola vez, y cada trabajador lo envía a los clientes de su partición, de forma que
+* la difusión a miles de clientes se reparte entre varios núcleos. Un cliente pertenece siempre al mismo
+* trabajador, por lo que recibe los eventos en orden. Ningún envío bloquea: lo que el socket de un cliente no
+* admite queda en su cola de salida, y es el trabajador de su partición quien la vacía cuando el socket lo admite.
+* Cada cliente puede solicitar el formato en que recibe los eventos (ver establecerFormato). Los trabajadores
+* obtienen cada formato en uso una sola vez por evento (ver Codificador), y todos los clientes que lo usan
+* comparten esa misma codificación, también en los reenvíos desde el anillo.
+* Los clientes que reflejan ficheros en crudo (ver reflejarFichero) no reciben eventos, sino los bytes
+* añadidos a esos ficheros, que pasan del fichero a su conexión sin copiarse en memoria del proceso.
+* Los clientes que se suscriben a agregados (ver suscribirAgregado) reciben además, al cerrarse cada ventana de
+* un agregado, la medida de las líneas contadas en ella, y los que solicitan resúmenes (ver establecerResumen),
+* el número de líneas de cada plantilla aparecida desde el anterior.
 */
 class TablaDeClientes
 {
 	public:
 	
+	/**
+	* Identificador de un Cliente en la TablaDeClientes, estable hasta su eliminación. Nunca vale 0
+	*/
+	typedef MapaDeRanuras<std::shared_ptr<Cliente>>::Llave IdentificadorDeCliente;
+	
+	/**
+	* Función que obtiene los contadores del servidor que se envían a los clientes que los solicitan (ver
+	* enviarContadores), en texto
+	*/
+	typedef std::function<std::string (void)> Contadores;
+	
+	/**
+	* Constructor de la clase TablaDeClientes
+	* @param instancia Identificador de la ejecución del servidor, que distingue sus números de secuencia de
+	* los de ejecuciones anteriores
+	* @param maxMensajesReenvio Número máximo de eventos conservados para su reenvío
+	* @param maxBytesReenvio Memoria máxima (en bytes) ocupada por los eventos conservados para su reenvío
+	* @param trabajadores Número de hilos (TrabajadorDeDifusion) entre los que se reparte la difusión de los
+	* eventos a los clientes
+	*/
+	TablaDeClientes (	const std::string& instancia,
+						const unsigned int maxMensajesReenvio,
+						const unsigned long maxBytesReenvio,
+						const unsigned int trabajadores = 1	);
+	
+	/**
+	* Anuncia a los clientes el grupo de multidifusión en el que se difunden todos los eventos (ver
+	* PublicadorDeMultidifusion), de forma que puedan pasar a recibirlos por él (ver activarMultidifusion).
+	* Debe llamarse antes de añadir ningún Cliente
+	* @param destino Grupo de multidifusión y puerto UDP, en la forma "grupo:puerto"
+	*/
+	inline void establecerMultidifusion (const std::string& destino) { multidifusion_ = destino; }
+	
+	/**
+	* Anuncia a los clientes que el servidor es un repetidor, que reenvía eventos de otros servidores con su
+	* origen (a los clientes que lo entienden, ver aceptarOrigenes), de forma que los clientes no resuelvan
+	* para este servidor las reglas de filtrado que dependen del remitente. Debe llamarse antes de añadir ningún
+	* Cliente
+	* @param repetidor true si el servidor reenvía eventos de otros servidores
+	*/
+	inline void establecerRepetidor (const bool repetidor) { repetidor_ = repetidor; }
+	
+	/**
+	* Establece el intervalo con que se envían latidos a los clientes (ver enviarLatidos), que se les indica en
+	* cada uno para que envíen los suyos con el mismo intervalo
+	* @param segundos Intervalo entre latidos, en segundos
+	*/
+	inline void establecerLatido (const unsigned int segundos) { segundos_latido_ = segundos; }
+	
+	/**
+	* Establece la función que obtiene los contadores que se envían a los clientes que los solicitan. Debe
+	* llamarse antes de añadir ningún Cliente
+	* @param contadores Función que obtiene los contadores, en texto
+	*/
+	inline void establecerContadores (const Contadores& contadores) { contadores_ = contadores; }
+	
+	/**
+	* Establece el AgregadorDeMetricas en el que se registran los agregados a los que se suscriben los clientes
+	* (ver suscribirAgregado). Debe llamarse antes de añadir ningún Cliente
+	* @param agregador AgregadorDeMetricas que cuenta las líneas de los eventos
+	*/
+	inline void establecerAgregador (std::shared_ptr<AgregadorDeMetricas> agregador) { agregador_ = agregador; }
+	
+	/**
+	* Establece el MinadorDePlantillas que asigna plantillas a las líneas para los clientes que solicitan
+	* resúmenes (ver establecerResumen). Debe llamarse antes de añadir ningún Cliente
+	* @param minador MinadorDePlantillas que mina las líneas de los eventos
+	*/
+	inline void establecerMinador (std::shared_ptr<MinadorDePlantillas> minador) { minador_ = minador; }
+	
 	/**
 	* Añade un nuevo Cliente a la TablaDeClientes a partir de una conexión creada para dicho cliente.
 	* @param descriptor_socket Descriptor de fichero del socket utilizado para la conexión con el cliente
-	* @return Identificador numérico asignado al nuevo Cliente. NOTA: los identificadores de cliente son
-	* volátiles y pueden cambiar al ser eliminados otros clientes. Utilizar un identificador de cliente
-	* mediando una llamada a eliminarCliente entre su obtención y su uso producirá comportamiento impredecible. 
+	* @return Identificador asignado al nuevo Cliente. Es válido hasta que el Cliente se elimina, y nunca llega
+	* a identificar a otro Cliente
 	*/
-	int anadirCliente (const int descriptor_socket);
+	IdentificadorDeCliente anadirCliente (const int descriptor_socket);
+	
+	/**
+	* Añade a la TablaDeClientes un lote de nuevos clientes a partir de las conexiones creadas para ellos. Todos
+	* se publican en una única nueva versión de la lista de clientes, por lo que añadir muchos clientes a la vez
+	* (por ejemplo, al reconectar todos tras un corte de red) es mucho más barato que añadirlos uno a uno
+	* @param descriptores Descriptores de fichero de los sockets utilizados para la conexión con cada cliente
+	* @return Identificadores asignados a los nuevos clientes, en el mismo orden que sus descriptores
+	*/
+	std::vector<IdentificadorDeCliente> anadirClientes (const std::vector<int>& descriptores);
 		
 	/**
-	* Elimina un Cliente de la TablaDeClientes, terminando la conexión si todavía está abierta.
-	* NOTA: eliminarCliente utiliza el algoritmo de eliminación de intercambio de posición con el último de la
-	* lista y eliminar el último, por lo que (salvo que el Cliente a eliminar fuese el último) su posición
-	* quedará ocupada por el último Cliente de la lista, algo importante a tener en cuenta en ciertas
-	* situaciones como al recorrer la lista eliminando condicionalmente algunos de sus elementos.
+	* Elimina un Cliente de la TablaDeClientes, terminando la conexión si todavía está abierta. Si el Cliente
+	* ya ha sido eliminado, no se hace nada
 	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
 	*/
-	void eliminarCliente (const int identificador_cliente);
+	void eliminarCliente (const IdentificadorDeCliente identificador_cliente);
 	
 	/**
 	* Elimina todos los Clientes de la TablaDeClientes, terminando la conexión de cada uno si todavía está
@@ -59,7 +169,7 @@ class TablaDeClientes
 	* @param mensaje Mensaje que se desea enviar en la comunicación
 	* @return true si el proceso ha tenido éxito, false en caso contrario
 	*/
-	bool enviar (std::shared_ptr<Mensaje> mensaje, const int identificador_cliente);
+	bool enviar (std::shared_ptr<Mensaje> mensaje, const IdentificadorDeCliente identificador_cliente);
 	
 	/**
 	* Envía un Mensaje a TODOS los clientes registrados (broadcast).
@@ -69,34 +179,367 @@ class TablaDeClientes
 	*/
 	bool enviar (std::shared_ptr<Mensaje> mensaje);
 	
+	/**
+	* Envía un Mensaje a todos los clientes registrados cuyo Filtro deja pasar el Evento del que procede, y
+	* lo conserva para su posible reenvío. Los filtros de todos los clientes se evalúan conjuntamente en el
+	* MotorDeSuscripciones, y el Mensaje se encola a cada TrabajadorDeDifusion, que lo envía a los clientes de
+	* su partición sin que esta llamada espere a ello.
+	* Si alguna de las conexiones con estos clientes se ha perdido, estos serán eliminados automáticamente.
+	* Debe llamarse siempre desde el mismo hilo, o serializando las llamadas
+	* @param mensaje Mensaje que se desea enviar en la comunicación. Debe comenzar con una cabecera que
+	* contenga su número de secuencia
+	* @param evento Evento del que procede el Mensaje, sobre el que se evalúan los filtros de los clientes
+	* @param secuencia Número de secuencia del Evento, consecutivo al del anterior
+	*/
+	void enviar (std::shared_ptr<Mensaje> mensaje, Evento& evento, const unsigned long long secuencia);
+	
+	/**
+	* Envía un latido a todos los clientes que reciben los eventos con su número de secuencia, de forma que
+	* sepan que el servidor sigue activo aunque no haya eventos, y que un envío a un cliente desaparecido
+	* termine fallando. Cada latido es un evento de control que indica el último evento tratado para el
+	* cliente (también si los recibe por multidifusión, que así detecta la pérdida de los últimos datagramas,
+	* tras los que no llega ninguno que revele el salto) y el intervalo entre latidos, en segundos:
+	* "secuencia"\0\0"latido"\0"intervalo"\0
+	* Los latidos se envían desde los TrabajadorDeDifusion, como los eventos, por lo que debe llamarse desde el
+	* mismo hilo que enviar, o serializando las llamadas
+	*/
+	void enviarLatidos (void);
+	
+	/**
+	* Establece las reglas de filtrado subidas por un cliente, de forma que sólo se le envíen los eventos que
+	* las pasen. Las reglas se registran en el MotorDeSuscripciones, que comparte sus predicados, reglas y
+	* filtros con los de los demás clientes
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param reglas Texto de las reglas de filtrado, con la sintaxis del fichero de filtro de lognotifycli.
+	* Una cadena vacía retira el filtro del cliente
+	* @return true si el filtro ha sido establecido, false si las reglas no son válidas o el cliente no existe
+	*/
+	bool establecerFiltro (const IdentificadorDeCliente identificador_cliente, const std::string& reglas);
+	
+	/**
+	* Establece el formato en que se envían a un cliente los eventos con su número de secuencia, incluidos los
+	* eventos de control (ver Codificador). Debe solicitarse antes que reanudarCliente: el evento de control
+	* que acepta la orden reanudar se envía siempre en el formato antiguo, y a partir de él todo en el formato
+	* solicitado. Los clientes que no lo solicitan reciben el formato de texto
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param formato Nombre del formato: "texto", "binario", "comprimido" o "estructurado"
+	* @return true si el formato ha sido establecido, false si el cliente no existe, ya recibe los eventos con
+	* su secuencia o el formato no es válido
+	*/
+	bool establecerFormato (const IdentificadorDeCliente identificador_cliente, const std::string& formato);
+	
+	/**
+	* Pasa a enviar a un cliente los eventos con su número de secuencia y le reenvía los que se ha perdido
+	* durante su desconexión, antes que cualquier evento nuevo. El cliente recibe primero, en el formato
+	* antiguo, un evento de control con nombre vacío, ubicación "reanudar" y como descripción la posición en
+	* la que queda el cliente, "instancia:secuencia"; a partir de él, cada evento va precedido de su número de
+	* secuencia: "secuencia"\0"nombre"\0"ubicacion"\0"descripcion"\0
+	* Se reenvían los eventos que todavía se conservan y que su Filtro deja pasar: los difundidos antes de la
+	* conexión actual del cliente y, a continuación, los difundidos desde ella, que no se le envían mientras se
+	* espera esta solicitud. Un cliente que no la hace a tiempo (ver terminarEspera) recibe esos eventos en el
+	* formato antiguo, y si la hace más tarde sólo se le reenvían los anteriores a su conexión.
+	* Si los eventos se difunden además por multidifusión, a continuación se le anuncia el grupo con un evento
+	* de control: "secuencia"\0\0"multidifusion"\0"grupo:puerto"\0
+	* Si el servidor es un repetidor, se le indica también con un evento de control:
+	* "secuencia"\0\0"repetidor"\0\0
+	* Los eventos reenviados sólo incluyen su origen si el cliente lo ha solicitado (ver aceptarOrigenes)
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param posicion Último evento recibido por el cliente en una conexión anterior, en la forma
+	* "instancia:secuencia". Si está vacía no se reenvía ningún evento anterior a la conexión actual; si la
+	* instancia no es la actual (el servidor se ha reiniciado desde entonces) se reenvían todos los conservados
+	* @return true si el cliente ha pasado a recibir los eventos con su secuencia, false si el cliente no
+	* existe, ya lo había solicitado antes, refleja ficheros en crudo o la posición no es válida
+	*/
+	bool reanudarCliente (const IdentificadorDeCliente identificador_cliente, const std::string& posicion);
+	
+	/**
+	* Termina la espera de un cliente que no ha solicitado reanudar a tiempo (ver ReceptorDeOrdenes),
+	* enviándole en el formato antiguo los eventos difundidos desde su conexión, que se le han retenido, y que
+	* su Filtro deja pasar. Los siguientes se le envían directamente. La espera también termina antes si lo
+	* retenido para el cliente deja de caber en su cola de salida
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return false si el envío ha fallado, true en caso contrario (también si el cliente ya no espera o no
+	* existe)
+	*/
+	bool terminarEspera (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Registra la confirmación de un cliente de haber procesado los eventos hasta el número de secuencia
+	* indicado. A partir de su primera confirmación, los bytes enviados al cliente y todavía no confirmados se
+	* limitan a una ventana: los eventos que no caben en ella no se le envían ni se copian, sino que permanecen
+	* en el AnilloDeReenvio hasta que nuevas confirmaciones dejan sitio, momento en que se le envían en orden.
+	* Así un cliente lento recibe los eventos a su ritmo sin afectar a los demás. Si se retrasa tanto que un
+	* evento pendiente deja de conservarse en el anillo, lo pierde
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param secuencia Número de secuencia del último evento procesado por el cliente, en texto
+	* @return true si la confirmación ha sido registrada, false si el cliente no existe, no recibe los eventos
+	* con su secuencia o la secuencia no es válida
+	*/
+	bool confirmarCliente (const IdentificadorDeCliente identificador_cliente, const std::string& secuencia);
+	
+	/**
+	* Pasa a enviar a un cliente los eventos sólo por multidifusión: a partir de ese momento no se le envían por
+	* su conexión, salvo los que solicite para reparar los datagramas perdidos (ver repararCliente). El cliente
+	* debe solicitarlo cuando ya recibe los datagramas del grupo anunciado
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return true si el cliente ha pasado a recibir los eventos por multidifusión, false si el cliente no
+	* existe, no recibe los eventos con su secuencia o no se difunden eventos por multidifusión
+	*/
+	bool activarMultidifusion (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Pasa a enviar a un cliente la ubicación de los eventos reenviados por un repetidor precedida de su
+	* origen, "origen:ubicacion". A los clientes que no lo solicitan se les envía sólo la ubicación, que es lo
+	* que esperan los clientes antiguos. Para no recibir ningún evento sin origen, el cliente debe solicitarlo
+	* antes de reanudar. Los datagramas de multidifusión, comunes a todos los clientes, lo incluyen siempre
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return true si el cliente ha pasado a recibir el origen de los eventos, false si el cliente no existe
+	*/
+	bool aceptarOrigenes (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Reenvía por su conexión a un cliente que recibe los eventos por multidifusión los del rango indicado,
+	* que se ha perdido al no recibir algún datagrama. Se le reenvían, directamente desde el anillo, los que
+	* todavía se conservan y que su Filtro deja pasar, seguidos de un evento de control que indica que el
+	* rango ha sido reparado: "hasta"\0\0"reparado"\0\0. Los que ya no se conservan se han perdido
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param rango Números de secuencia del primer y último evento perdidos, en la forma "desde:hasta"
+	* @return true si el rango ha sido reparado, false si el cliente no existe, no recibe los eventos por
+	* multidifusión o el rango no es válido
+	*/
+	bool repararCliente (const IdentificadorDeCliente identificador_cliente, const std::string& rango);
+	
+	/**
+	* Pasa a enviar a un cliente, en lugar de eventos, los bytes que se añadan a partir de ese momento a un
+	* fichero monitorizado, tal cual, en tramas de tipo Codificador::TIPO_CRUDO (ver reflejar). Un cliente puede
+	* reflejar varios ficheros, distinguiéndolos por la ruta de cada trama; la posición de cada trama en el
+	* fichero permite detectar lo que no ha llegado a reflejarse (por ejemplo, si el fichero se trunca o rota).
+	* Si el fichero se trunca mientras se envía una trama, ésta se completa con ceros y le sigue una trama vacía
+	* en la posición en que termina ahora el fichero: el cliente debe descartar lo recibido a partir de ella
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param ruta Ruta del fichero, relativa al directorio de ficheros de registro, tal como se monitoriza
+	* @return true si el cliente ha pasado a reflejar el fichero, false si el cliente no existe, recibe los
+	* eventos con su secuencia (pues sus eventos de control se mezclarían con las tramas) o la ruta está vacía
+	*/
+	bool reflejarFichero (const IdentificadorDeCliente identificador_cliente, const std::string& ruta);
+	
+	/**
+	* Envía a los clientes que reflejan un fichero el rango de bytes que se le ha añadido, directamente desde
+	* el fichero (ver Cliente::enviarFichero) y dividido en tramas de tipo Codificador::TIPO_CRUDO. Si ningún
+	* cliente refleja ficheros, no hace nada
+	* @param ruta Ruta del fichero, relativa al directorio de ficheros de registro
+	* @param rutaAbsoluta Ruta absoluta del fichero
+	* @param desde Posición en el fichero del primer byte añadido
+	* @param hasta Posición en el fichero que sigue al último byte añadido
+	*/
+	void reflejar (const std::string& ruta, const std::string& rutaAbsoluta, const long long desde, const long long hasta);
+	
+	/**
+	* Envía a un cliente que recibe los eventos con su secuencia los contadores del servidor (ver
+	* establecerContadores) en un evento de control: "secuencia"\0\0"contadores"\0"contadores"\0, con la
+	* secuencia del último evento tratado para él, como en los latidos
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return true si los contadores han sido enviados, false si el cliente no existe o no recibe los eventos
+	* con su secuencia
+	*/
+	bool enviarContadores (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Suscribe a un cliente a un agregado, registrándolo en el AgregadorDeMetricas, que lo comparte con los
+	* demás clientes que lo solicitan. Un cliente puede suscribirse a varios agregados, que se identifican en
+	* sus medidas por el orden en que los ha solicitado, comenzando por 0 (ver enviarMetricas)
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param definicion Definición del agregado (ver AgregadorDeMetricas::registrar). Una cadena vacía anula
+	* todas las suscripciones del cliente
+	* @return true si el cliente ha sido suscrito al agregado (o anuladas sus suscripciones), false si el cliente
+	* no existe, no hay AgregadorDeMetricas o la definición no es válida
+	*/
+	bool suscribirAgregado (const IdentificadorDeCliente identificador_cliente, const std::string& definicion);
+	
+	/**
+	* Envía a cada cliente que recibe los eventos con su secuencia las medidas de los agregados a los que está
+	* suscrito, cada una en un evento de control: "secuencia"\0\0"metrica"\0"indice lineas fin segundos"\0, con la
+	* secuencia del último evento tratado para él, como en los latidos, el índice del agregado entre los
+	* solicitados por el cliente, las líneas contadas y el instante de cierre de la ventana (en segundos desde
+	* 1970) y su duración
+	* @param medidas Medidas de las ventanas cerradas (ver AgregadorDeMetricas::cerrarVentanas)
+	*/
+	void enviarMetricas (const std::vector<AgregadorDeMetricas::Medida>& medidas);
+	
+	/**
+	* Establece si un cliente que recibe los eventos con su secuencia recibe periódicamente el resumen de las
+	* plantillas de las líneas (ver enviarResumen). Mientras algún cliente lo recibe, el MinadorDePlantillas
+	* mina las líneas de los eventos
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param argumento "1" para recibir los resúmenes, "0" para dejar de recibirlos
+	* @return true si se ha aplicado, false si el cliente no existe, no recibe los eventos con su secuencia, no
+	* hay MinadorDePlantillas o el argumento no es válido
+	*/
+	bool establecerResumen (const IdentificadorDeCliente identificador_cliente, const std::string& argumento);
+	
+	/**
+	* Envía a un cliente que recibe los eventos con su secuencia la tabla completa de plantillas del
+	* MinadorDePlantillas, cada una en un evento de control como los de los resúmenes (ver enviarResumen), con
+	* las líneas asignadas desde el último resumen
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return true si la tabla ha sido enviada, false si el cliente no existe, no recibe los eventos con su
+	* secuencia o no hay MinadorDePlantillas
+	*/
+	bool enviarPlantillas (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Envía a cada cliente que recibe los resúmenes, en un único envío, un evento de control por cada plantilla:
+	* "secuencia"\0\0"plantilla"\0"identificador lineas total primera\nfichero\nplantilla\nejemplo"\0, con la
+	* secuencia del último evento tratado para él, como en los latidos, el identificador de la plantilla, las
+	* líneas asignadas desde el resumen anterior y desde su primera línea, el instante de ésta (en segundos
+	* desde 1970), el nombre de su fichero, las palabras de la plantilla y la propia primera línea
+	* @param plantillas Plantillas con líneas asignadas (ver MinadorDePlantillas::resumir)
+	*/
+	void enviarResumen (const std::vector<MinadorDePlantillas::Plantilla>& plantillas);
+	
+	/**
+	* Anota en un cliente el estado de la recepción de sus órdenes al detenerse para un Relevo (ver
+	* Cliente::anotarOrdenPendiente), de forma que se traspase con él
+	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @param ordenPendiente Bytes recibidos de la orden que el cliente había enviado sólo en parte
+	* @param latiendo Indica si el cliente enviaba latidos
+	*/
+	void anotarOrdenPendiente (	const IdentificadorDeCliente identificador_cliente,
+								const std::string& ordenPendiente,
+								const bool latiendo	);
+	
+	/**
+	* Completa el Estado que se traspasa en un Relevo con los eventos conservados para reenvío y los clientes.
+	* Espera antes a que los trabajadores terminen las difusiones encoladas y a que cada cliente termine sus
+	* envíos en curso, pues sólo así su conexión puede continuar en el nuevo proceso sin perder ni repetir bytes.
+	* Debe llamarse sin que se envíen nuevos eventos ni se reciban órdenes de los clientes, y la TablaDeClientes
+	* no debe utilizarse después
+	* @param estado Estado en que se añaden los eventos conservados y los clientes
+	* @param segundos Tiempo máximo de espera
+	* @return true si el Estado se ha completado, false si los trabajadores o los envíos de algún cliente no han
+	* terminado a tiempo, en cuyo caso el relevo debe cancelarse
+	*/
+	bool exportarEstado (Relevo::Estado& estado, const unsigned int segundos);
+	
+	/**
+	* Restaura en una TablaDeClientes vacía los eventos conservados para reenvío y los clientes traspasados en
+	* un Relevo, con sus filtros y todo lo que negociaron con el servidor. Los eventos en vuelo de los clientes
+	* con control de flujo no se conocen, por lo que su ventana comienza vacía
+	* @param estado Estado recibido del proceso saliente
+	* @return Identificadores asignados a los clientes, en el mismo orden que en el Estado
+	*/
+	std::vector<IdentificadorDeCliente> restaurarEstado (const Relevo::Estado& estado);
+	
 	private:
 	
 	/**
-	* Añade un nuevo Cliente a la TablaDeClientes a partir de una conexión creada para dicho cliente.
-	* Esta versión de la función miembro anadirCliente NO es segura para acceso concurrente, por lo que sólo
-	* debe de ser llamada desde el interior de una sección crítica ya asegurada. Su uso está pensado únicamente
-	* para uso interno de objetos de la propia clase TablaDeClientes.
-	* @param descriptor_socket Descriptor de fichero del socket utilizado para la conexión con el cliente
-	* @return Identificador numérico asignado al nuevo Cliente
+	* Partición de la lista de clientes que atiende un TrabajadorDeDifusion: identificador y Cliente de cada uno
+	*/
+	typedef std::vector<std::pair<IdentificadorDeCliente, std::shared_ptr<Cliente>>> Particion;
+	
+	/**
+	* Envía un Mensaje a los clientes de una partición cuyo Filtro deja pasar el Evento del que procede, o un
+	* latido si la difusión no tiene Mensaje. Se llama desde el TrabajadorDeDifusion de la partición, en el
+	* orden de los números de secuencia
+	* @param difusion Difusión del Mensaje, con los filtros que dejan pasar el Evento
+	* @param particion Índice de la partición
+	*/
+	void difundir (const TrabajadorDeDifusion::Difusion& difusion, const unsigned int particion);
+	
+	/**
+	* Termina la espera de un cliente, ya bloqueado, enviándole en el formato antiguo los eventos que se le han
+	* retenido desde su conexión y que su Filtro deja pasar (ver terminarEspera)
+	* @param cliente Cliente cuya espera termina
+	* @return false si el envío ha fallado, true en caso contrario
+	*/
+	bool entregarRetenidos (Cliente& cliente);
+	
+	/**
+	* Continúa los envíos pendientes a los clientes de una partición que el socket no admitió sin bloquear, y
+	* elimina aquellos cuya conexión ha fallado. Se llama desde el TrabajadorDeDifusion de la partición
+	* @param particion Índice de la partición
+	* @param pendientes Vector al que se añaden los descriptores de los sockets en que todavía quedan envíos
+	* pendientes
+	*/
+	void continuarEnvios (const unsigned int particion, std::vector<int>& pendientes);
+	
+	/**
+	* Hace que un Cliente avise al TrabajadorDeDifusion de su partición cuando le quedan envíos pendientes
+	* @param cliente Cliente recién insertado en la lista, todavía no publicada
+	* @param identificador_cliente Identificador asignado al Cliente
 	*/
-	int anadirClienteNoSeguro (const int descriptor_socket);
+	void asignarTrabajador (Cliente& cliente, const IdentificadorDeCliente identificador_cliente);
 	
 	/**
-	* Elimina un Cliente de la TablaDeClientes, terminando la conexión si todavía está abierta.
-	* Esta versión de la función miembro eliminarCliente NO es segura para acceso concurrente, por lo que sólo
-	* debe de ser llamada desde el interior de una sección crítica ya asegurada. Su uso está pensado únicamente
-	* para uso interno de objetos de la propia clase TablaDeClientes.
-	* NOTA: eliminarCliente utiliza el algoritmo de eliminación de intercambio de posición con el último de la
-	* lista y eliminar el último, por lo que (salvo que el Cliente a eliminar fuese el último) su posición
-	* quedará ocupada por el último Cliente de la lista, algo importante a tener en cuenta en ciertas
-	* situaciones como al recorrer la lista eliminando condicionalmente algunos de sus elementos.
+	* Publica una nueva versión de cada partición de la lista de clientes, repartiendo los de una nueva versión
+	* de la lista por su ranura. Debe llamarse con el mutex de la lista adquirido
+	* @param clientes Nueva versión de la lista de clientes
+	*/
+	void repartir (const MapaDeRanuras<std::shared_ptr<Cliente>>& clientes);
+	
+	/**
+	* Busca en la versión vigente de la lista de clientes el Cliente correspondiente a un identificador
 	* @param identificador_cliente Identificador asignado al Cliente durante su adición a la TablaDeClientes
+	* @return Cliente correspondiente al identificador, o nullptr si no existe
 	*/
-	void eliminarClienteNoSeguro (const int identificador_cliente);
+	std::shared_ptr<Cliente> buscarCliente (const IdentificadorDeCliente identificador_cliente);
+	
+	/**
+	* Elimina una serie de clientes de la TablaDeClientes, publicando una nueva versión de la lista sin ellos,
+	* y a continuación retira sus filtros y termina sus conexiones. Los clientes que ya no estén en la lista
+	* (por haber sido eliminados desde otro hilo) se ignoran.
+	* No debe llamarse con el mutex de ninguno de los clientes adquirido.
+	* @param eliminados Identificadores de los clientes que desean eliminarse
+	*/
+	void eliminarClientes (const std::vector<IdentificadorDeCliente>& eliminados);
+	
+	/**
+	* Retira del AgregadorDeMetricas los agregados a los que está suscrito un Cliente y anula sus suscripciones.
+	* Debe llamarse con el mutex del cliente adquirido
+	* @param cliente Cliente cuyas suscripciones se anulan
+	*/
+	void retirarAgregados (Cliente& cliente);
+	
+	/**
+	* Compone el evento de control con que se envía una plantilla a un cliente (ver enviarResumen)
+	* @param cliente Cliente al que se envía. Debe estar adquirido su mutex
+	* @param plantilla Plantilla que se envía
+	* @return Mensaje con el evento de control, en el formato del cliente
+	*/
+	static std::shared_ptr<Mensaje> componerPlantilla (	Cliente& cliente,
+														const MinadorDePlantillas::Plantilla& plantilla	);
+	
+	/**
+	* Comprueba si el Filtro de un Cliente deja pasar el Evento del que procede un Mensaje conservado en el
+	* AnilloDeReenvio, reconstruyendo el Evento a partir del Mensaje.
+	* Debe llamarse con el mutex del cliente adquirido
+	* @param cliente Cliente cuyo Filtro se evalúa
+	* @param mensaje Mensaje serializado por ServidorDeNotificaciones, con cabecera
+	* @return true si el Filtro del cliente deja pasar el Evento, false en caso contrario
+	*/
+	bool dejaPasar (Cliente& cliente, Mensaje& mensaje);
+	
+	//Constantes
+	constexpr static unsigned long VENTANA_ = 262144;	///< Máximo de bytes en vuelo por cliente con control de flujo
+	constexpr static unsigned long BYTES_POR_TRAMA_CRUDA_ = 1048576;	///< Máximo de bytes de fichero por trama
 	
 	//Variables miembro
-	std::vector<Cliente> clientes_;	///< Lista de clientes subscritos al servidor
-	std::mutex mutex_;				///< Mutex utilizado para permitir acceso concurrente seguro a los clientes 
+	std::shared_ptr<const MapaDeRanuras<std::shared_ptr<Cliente>>> clientes_;	///< Versión vigente de la
+																				///< lista de clientes subscritos
+	std::mutex mutex_;				///< Mutex que serializa las modificaciones de la lista de clientes
+	std::mutex mutex_anillo_;		///< Mutex utilizado para permitir acceso concurrente seguro al anillo
+	MotorDeSuscripciones motor_;	///< Motor que evalúa conjuntamente los filtros de todos los clientes
+	std::string instancia_;			///< Identificador de la ejecución del servidor
+	AnilloDeReenvio anillo_;		///< Últimos eventos difundidos, conservados para su reenvío
+	std::string multidifusion_;		///< Grupo de multidifusión anunciado a los clientes, o vacío si no hay
+	bool repetidor_;				///< Indica si el servidor reenvía eventos de otros servidores
+	unsigned int segundos_latido_;	///< Intervalo entre latidos indicado a los clientes
+	Contadores contadores_;			///< Función que obtiene los contadores enviados a los clientes
+	std::shared_ptr<AgregadorDeMetricas> agregador_;	///< Agregador en que se registran los agregados
+	std::shared_ptr<MinadorDePlantillas> minador_;		///< Minador que asigna plantillas para los resúmenes
+	std::vector<std::shared_ptr<const Particion>> particiones_;	///< Versión vigente de cada partición
+	std::vector<std::unique_ptr<TrabajadorDeDifusion>> trabajadores_;	///< Trabajadores de cada partición
+	std::atomic<unsigned int> clientes_en_crudo_;	///< Número de clientes que reflejan algún fichero
 };
 
 } //namespace lognotify
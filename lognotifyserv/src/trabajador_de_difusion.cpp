@@ -0,0 +1,126 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#include "trabajador_de_difusion.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "anillo_sin_bloqueo.h"
+
+using namespace std;
+namespace lognotify
+{
+
+constexpr unsigned int TrabajadorDeDifusion::CAPACIDAD_;
+
+TrabajadorDeDifusion::TrabajadorDeDifusion (	std::function<void(const Difusion&)> tratar,
+											std::function<void(std::vector<int>&)> continuar	):
+	tratar_(move(tratar)),
+	continuar_(move(continuar)),
+	anillo_(CAPACIDAD_),
+	esperando_(false),
+	lleno_(false),
+	evaluacion_(0),
+	terminar_(false)
+{
+	//Si no puede crearse la tubería de aviso, el trabajador no duerme más de un milisegundo seguido (ver trabajar)
+	if (pipe2(descriptores_aviso_, O_CLOEXEC | O_NONBLOCK) != 0) descriptores_aviso_[0] = descriptores_aviso_[1] = -1;
+	hilo_ = thread(&TrabajadorDeDifusion::trabajar, this);
+}
+
+TrabajadorDeDifusion::~TrabajadorDeDifusion (void)
+{
+	//Se avisa al trabajador de que debe terminar y se espera a que lo haga
+	terminar_ = true;
+	despertar();
+	if (hilo_.joinable()) hilo_.join();
+	close(descriptores_aviso_[0]);
+	close(descriptores_aviso_[1]);
+}
+
+void TrabajadorDeDifusion::encolar (const Difusion& difusion)
+{
+	//Si el anillo está lleno, el trabajador va muy retrasado: se duerme hasta que haga sitio. La barrera
+	//garantiza que, si el trabajador no ve aún que el anillo está lleno tras extraer una difusión, aquí se ve
+	//el sitio que ha dejado
+	if (!anillo_.insertar(difusion))
+	{
+		unique_lock<mutex> bloqueo (mutex_lleno_);
+		lleno_.store(true, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		while (!anillo_.insertar(difusion)) hueco_.wait(bloqueo);
+		lleno_.store(false, memory_order_relaxed);
+	}
+	
+	//Sólo si el trabajador duerme (o está a punto) se le despierta. La barrera garantiza que, si no ve aún la
+	//nueva difusión al comprobar el anillo antes de dormir, aquí se ve que está esperando
+	atomic_thread_fence(memory_order_seq_cst);
+	if (esperando_.load(memory_order_relaxed)) despertar();
+}
+
+void TrabajadorDeDifusion::despertar (void)
+{
+	//Si la tubería está llena, el trabajador tiene ya avisos pendientes de leer
+	char aviso = 0;
+	if (write(descriptores_aviso_[1], &aviso, 1) < 0) return;
+}
+
+void TrabajadorDeDifusion::trabajar (void)
+{
+	Difusion difusion;
+	vector<int> pendientes;
+	vector<struct pollfd> esperas;
+	char avisos [64];
+	while (!terminar_)
+	{
+		//Se tratan en orden todas las difusiones encoladas, liberando cada mensaje en cuanto se ha tratado y
+		//anotando después la evaluación de los filtros que ha utilizado
+		while (!terminar_ && anillo_.extraer(difusion))
+		{
+			//Si quien encola espera a que haya sitio, se le despierta ahora que lo hay
+			atomic_thread_fence(memory_order_seq_cst);
+			if (lleno_.load(memory_order_relaxed))
+			{
+				mutex_lleno_.lock();
+				hueco_.notify_one();
+				mutex_lleno_.unlock();
+			}
+			tratar_(difusion);
+			if (difusion.evaluacion > 0) evaluacion_.store(difusion.evaluacion);
+			difusion = Difusion();
+		}
+		
+		//Se continúan los envíos que los sockets no admitieron, anotando aquellos en que todavía quedan
+		pendientes.clear();
+		continuar_(pendientes);
+		
+		//Se indica que se va a dormir y, salvo que ya se hayan encolado más difusiones, se espera a un aviso o a
+		//que alguno de los sockets con envíos pendientes admita más
+		esperando_.store(true, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (!terminar_ && anillo_.estaVacio())
+		{
+			esperas.assign(1, pollfd {descriptores_aviso_[0], POLLIN, 0});
+			for (unsigned int i = 0; i < pendientes.size(); ++i) esperas.push_back(pollfd {pendientes[i], POLLOUT, 0});
+			poll(&esperas[0], esperas.size(), (descriptores_aviso_[0] >= 0) ? -1 : 1);
+		}
+		esperando_.store(false, memory_order_relaxed);
+		
+		//Se retiran los avisos recibidos, que ya se atienden en la siguiente vuelta
+		while (read(descriptores_aviso_[0], avisos, sizeof avisos) > 0);
+	}
+}
+
+} //namespace lognotify
\ No newline at end of file
@@ -0,0 +1,122 @@
+/*
+* Lognotify - Monitorización de ficheros de registro en GNU/Linux con notificaciones de escritorio
+* Autor: Guillermo Fariña Arroyo
+* C++11 (ISO/IEC 14882:2011)
+*/
+
+#ifndef _trabajador_de_difusion_h_
+#define _trabajador_de_difusion_h_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "mensaje.h"
+#include "anillo_sin_bloqueo.h"
+
+namespace lognotify
+{
+
+/**
+* Un TrabajadorDeDifusion es un hilo que trata, en orden, las difusiones que le encola otro hilo. La
+* TablaDeClientes reparte sus clientes entre varios trabajadores, de forma que cada uno envíe los eventos
+* sólo a los suyos y el envío a miles de clientes se reparta entre varios núcleos.
+* Las difusiones se encolan en un AnilloSinBloqueo propio del trabajador, por lo que encolarlas no compite
+* con los demás trabajadores; cada difusión contiene el Mensaje serializado una única vez y compartido (no
+* copiado) por todos ellos. El trabajador también continúa los envíos que los sockets de sus clientes no han
+* admitido sin bloquear (ver Cliente::continuarEnvios), esperando a la vez nuevas difusiones y a que esos sockets
+* admitan más. Sólo duerme cuando no tiene difusiones pendientes, y sólo entonces debe despertarlo quien encola.
+* Sólo es thread safe con un único hilo que encola difusiones.
+*/
+class TrabajadorDeDifusion
+{
+	public:
+	
+	/**
+	* Difusión de un evento, común a todos los trabajadores
+	*/
+	struct Difusion
+	{
+		std::shared_ptr<Mensaje> mensaje;			///< Mensaje serializado, con su número de secuencia en la cabecera
+		std::shared_ptr<const std::vector<bool>> pasan;	///< Filtros que dejan pasar el evento, por identificador
+		unsigned long long secuencia;				///< Número de secuencia del evento
+		unsigned long long evaluacion;				///< Número de la evaluación de los filtros (0 si no la hay)
+	};
+	
+	/**
+	* Constructor de la clase TrabajadorDeDifusion. Lanza el hilo del trabajador
+	* @param tratar Función que trata cada difusión, llamada desde el hilo del trabajador
+	* @param continuar Función que continúa los envíos pendientes a los clientes del trabajador y anota los
+	* descriptores de los sockets en que todavía quedan, llamada desde el hilo del trabajador antes de dormir
+	*/
+	TrabajadorDeDifusion (	std::function<void(const Difusion&)> tratar,
+							std::function<void(std::vector<int>&)> continuar	);
+	
+	/**
+	* Destructor de la clase TrabajadorDeDifusion. Espera a que termine la difusión en curso, descartando las
+	* pendientes, y a que termine el hilo del trabajador
+	*/
+	~TrabajadorDeDifusion (void);
+	
+	TrabajadorDeDifusion (const TrabajadorDeDifusion&) = delete;
+	TrabajadorDeDifusion& operator= (const TrabajadorDeDifusion&) = delete;
+	
+	/**
+	* Encola una difusión para que el trabajador la trate tras las anteriores. Si el trabajador tiene el anillo
+	* lleno, duerme hasta que haya sitio, de forma que ninguna difusión se pierde
+	* @param difusion Difusión que desea encolarse
+	*/
+	void encolar (const Difusion& difusion);
+	
+	/**
+	* Despierta al trabajador para que continúe los envíos pendientes a sus clientes. Puede llamarse desde
+	* cualquier hilo
+	*/
+	void despertar (void);
+	
+	/**
+	* Indica si el trabajador ha tratado todas las difusiones encoladas y espera a que haya más. Sólo tiene
+	* sentido mientras no se encolan nuevas difusiones
+	* @return true si el trabajador está inactivo, false si todavía trata alguna difusión
+	*/
+	inline bool estaInactivo (void) { return esperando_ && anillo_.estaVacio(); }
+	
+	/**
+	* Devuelve el número de la evaluación de los filtros de la última difusión tratada que tenía alguna. Las
+	* difusiones se tratan en orden, por lo que el trabajador ya no utiliza el resultado de ninguna anterior
+	* @return Número de la evaluación, o 0 si todavía no ha tratado ninguna
+	*/
+	inline unsigned long long obtener_evaluacion (void) { return evaluacion_.load(); }
+	
+	private:
+	
+	/**
+	* Función del hilo del trabajador: trata las difusiones encoladas, continúa los envíos pendientes y espera a
+	* que haya más de lo uno o de lo otro, hasta que se destruye el trabajador
+	*/
+	void trabajar (void);
+	
+	//Constantes
+	constexpr static unsigned int CAPACIDAD_ = 4096;	///< Máximo de difusiones encoladas por trabajador
+	
+	//Variables miembro
+	std::function<void(const Difusion&)> tratar_;	///< Función que trata cada difusión
+	std::function<void(std::vector<int>&)> continuar_;	///< Función que continúa los envíos pendientes
+	AnilloSinBloqueo<Difusion> anillo_;			///< Difusiones encoladas pendientes de tratar
+	std::atomic<bool> esperando_;				///< Indica que el trabajador duerme o va a dormir
+	std::atomic<bool> lleno_;					///< Indica que quien encola espera a que haya sitio en el anillo
+	std::mutex mutex_lleno_;					///< Mutex de la espera a que haya sitio en el anillo
+	std::condition_variable hueco_;				///< Aviso de que hay sitio en el anillo
+	std::atomic<unsigned long long> evaluacion_;	///< Evaluación de los filtros de la última difusión tratada
+	std::atomic<bool> terminar_;				///< Indica al trabajador que debe terminar
+	int descriptores_aviso_ [2];				///< Tubería por la que se despierta al trabajador
+	std::thread hilo_;							///< Hilo del trabajador
+};
+
+} //namespace lognotify
+
+#endif //_trabajador_de_difusion_h_
\ No newline at end of file